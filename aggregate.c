@@ -0,0 +1,798 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+/*!\file
+\brief Store the daily totals to produce the reports of longer periods
+
+The records kept from the access logs are summed by day, hour, user, IP address,
+URL and HTTP code. The totals of each day are saved in one file of the directory
+set by ::AggregateDir at the end of the run. The totals are only saved if the
+report isn't restricted to some users, IP addresses, sites, hours or week days
+and a stored day is not replaced by totals counting fewer records as they are
+likely taken from a part of the logs.
+
+With --from-aggregates, the stored days are read back instead of the access logs.
+Each total is written in the user's file as one line carrying the number of records
+it stands for. The reports are then produced as usual except that the time of
+the accesses is only known to the hour. The users, IP addresses, sites, hours
+and week days can be selected as usual but a time range given with -t must be
+made of whole hours.
+
+A file starts with the 8 bytes magic string \c SARGAGG followed by a null byte,
+the format version, the date as yyyymmdd, the number of totals stored and the
+number of access log records they stand for. All
+the integers are stored in little endian. Each record starts with a byte telling
+which of the user ID, IP address, URL and HTTP code differ from the previous record.
+Only those strings are written, each preceded by its length. The hour, the number
+of records, the bytes and the elapsed time follow.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+
+extern int hours[24], weekdays[7];
+
+//! The magic string at the beginning of an aggregate file.
+#define AGGREGATE_MAGIC "SARGAGG"
+//! The version of the format of the aggregate files.
+#define AGGREGATE_VERSION 2
+
+//! The user ID is stored in the record.
+#define AGGF_User 0x01
+//! The IP address is stored in the record.
+#define AGGF_Ip   0x02
+//! The URL is stored in the record.
+#define AGGF_Url  0x04
+//! The HTTP code is stored in the record.
+#define AGGF_Code 0x08
+
+//! The totals of the records sharing the same day, hour, user, IP address, URL and HTTP code.
+struct AggregateEntryStruct
+{
+	//! The date as year*10000+month*100+day.
+	int Date;
+	//! The hour of the day.
+	int Hour;
+	//! The position of the user ID in the pool of strings.
+	int User;
+	//! The position of the IP address in the pool of strings.
+	int Ip;
+	//! The position of the URL in the pool of strings.
+	int Url;
+	//! The position of the HTTP code in the pool of strings.
+	int Code;
+	//! The number of records summed.
+	long long int Records;
+	//! The number of bytes transfered.
+	long long int Bytes;
+	//! The elapsed time in milliseconds.
+	long long int Elapsed;
+};
+
+//! The strings referenced by the totals. Each string is stored once.
+static char *Pool=NULL;
+//! The number of bytes used in the pool.
+static int PoolSize=0;
+//! The number of bytes allocated for the pool.
+static int PoolAllocated=0;
+//! The hash table to find a string in the pool. A slot contains the position in the pool plus one or zero if it is free.
+static int *StringHash=NULL;
+//! The number of slots in the hash table of the strings. It is always a power of two.
+static int StringHashSize=0;
+//! The number of slots used in the hash table of the strings.
+static int StringHashUsed=0;
+//! The totals.
+static struct AggregateEntryStruct *Entry=NULL;
+//! The number of totals stored.
+static int NEntries=0;
+//! The number of totals allocated.
+static int NAllocated=0;
+//! The hash table to find a total. A slot contains the index of the total plus one or zero if it is free.
+static int *EntryHash=NULL;
+//! The number of slots in the hash table of the totals. It is always a power of two.
+static int EntryHashSize=0;
+
+/*!
+Compute the hash of a string for the hash table of the pool.
+*/
+static unsigned int aggregate_hash_string(const char *String)
+{
+	unsigned int Hash=2166136261U;
+
+	for ( ; *String ; String++)
+		Hash=(Hash ^ (unsigned char)*String)*16777619U;
+	return(Hash);
+}
+
+/*!
+Compute the hash of the key of a total.
+*/
+static unsigned int aggregate_hash_entry(int Date,int Hour,int User,int Ip,int Url,int Code)
+{
+	unsigned int Hash=2166136261U;
+
+	Hash=(Hash ^ (unsigned int)Date)*16777619U;
+	Hash=(Hash ^ (unsigned int)Hour)*16777619U;
+	Hash=(Hash ^ (unsigned int)User)*16777619U;
+	Hash=(Hash ^ (unsigned int)Ip)*16777619U;
+	Hash=(Hash ^ (unsigned int)Url)*16777619U;
+	Hash=(Hash ^ (unsigned int)Code)*16777619U;
+	return(Hash);
+}
+
+/*!
+Store a string in the pool unless it is already there.
+
+\return The position of the string in the pool.
+*/
+static int aggregate_intern(const char *String)
+{
+	int i;
+	int Len;
+	int Offset;
+
+	if (StringHashUsed*2>=StringHashSize) {
+		int *Hash;
+		int HashSize=(StringHashSize>0) ? 2*StringHashSize : 1024;
+		int j;
+
+		Hash=calloc(HashSize,sizeof(*Hash));
+		if (!Hash) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the daily totals\n"));
+			exit(EXIT_FAILURE);
+		}
+		for (i=0 ; i<StringHashSize ; i++) {
+			if (StringHash[i]==0) continue;
+			j=aggregate_hash_string(Pool+StringHash[i]-1) & (HashSize-1);
+			while (Hash[j]!=0) j=(j+1) & (HashSize-1);
+			Hash[j]=StringHash[i];
+		}
+		if (StringHash) free(StringHash);
+		StringHash=Hash;
+		StringHashSize=HashSize;
+	}
+	i=aggregate_hash_string(String) & (StringHashSize-1);
+	while (StringHash[i]!=0) {
+		if (strcmp(Pool+StringHash[i]-1,String)==0) return(StringHash[i]-1);
+		i=(i+1) & (StringHashSize-1);
+	}
+
+	Len=strlen(String)+1;
+	if (PoolSize+Len>PoolAllocated) {
+		char *NewPool;
+		int Size=PoolAllocated+((Len>65536) ? Len : 65536);
+
+		NewPool=realloc(Pool,Size);
+		if (!NewPool) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the daily totals\n"));
+			exit(EXIT_FAILURE);
+		}
+		Pool=NewPool;
+		PoolAllocated=Size;
+	}
+	Offset=PoolSize;
+	memcpy(Pool+Offset,String,Len);
+	PoolSize+=Len;
+	StringHash[i]=Offset+1;
+	StringHashUsed++;
+	return(Offset);
+}
+
+/*!
+Double the size of the hash table of the totals.
+*/
+static void aggregate_grow_entry_hash(void)
+{
+	int *Hash;
+	int HashSize;
+	int i;
+	int j;
+	const struct AggregateEntryStruct *Item;
+
+	HashSize=(EntryHashSize>0) ? 2*EntryHashSize : 4096;
+	while (HashSize<=2*NEntries) HashSize*=2;
+	Hash=calloc(HashSize,sizeof(*Hash));
+	if (!Hash) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the daily totals\n"));
+		exit(EXIT_FAILURE);
+	}
+	for (i=0 ; i<NEntries ; i++) {
+		Item=Entry+i;
+		j=aggregate_hash_entry(Item->Date,Item->Hour,Item->User,Item->Ip,Item->Url,Item->Code) & (HashSize-1);
+		while (Hash[j]!=0) j=(j+1) & (HashSize-1);
+		Hash[j]=i+1;
+	}
+	if (EntryHash) free(EntryHash);
+	EntryHash=Hash;
+	EntryHashSize=HashSize;
+}
+
+/*!
+Add a record kept from the access log to the daily totals.
+
+Nothing is stored if ::AggregateDir is empty.
+
+\param Time The date and time of the record.
+\param User The ID of the user.
+\param Ip The IP address of the user.
+\param Url The URL as written in the user's file.
+\param Code The HTTP code.
+\param Bytes The number of bytes transfered.
+\param Elapsed The elapsed time in milliseconds.
+*/
+void aggregate_add(const struct tm *Time,const char *User,const char *Ip,const char *Url,const char *Code,long long int Bytes,long long int Elapsed)
+{
+	struct AggregateEntryStruct *Item;
+	int Date;
+	int UserPos;
+	int IpPos;
+	int UrlPos;
+	int CodePos;
+	int i;
+
+	if (AggregateDir[0]=='\0') return;
+	Date=(Time->tm_year+1900)*10000+(Time->tm_mon+1)*100+Time->tm_mday;
+	UserPos=aggregate_intern(User);
+	IpPos=aggregate_intern(Ip);
+	UrlPos=aggregate_intern(Url);
+	CodePos=aggregate_intern(Code);
+
+	if (NEntries*2>=EntryHashSize) aggregate_grow_entry_hash();
+	i=aggregate_hash_entry(Date,Time->tm_hour,UserPos,IpPos,UrlPos,CodePos) & (EntryHashSize-1);
+	while (EntryHash[i]!=0) {
+		Item=Entry+EntryHash[i]-1;
+		if (Item->Date==Date && Item->Hour==Time->tm_hour && Item->User==UserPos && Item->Ip==IpPos &&
+		    Item->Url==UrlPos && Item->Code==CodePos) {
+			Item->Records++;
+			Item->Bytes+=Bytes;
+			Item->Elapsed+=Elapsed;
+			return;
+		}
+		i=(i+1) & (EntryHashSize-1);
+	}
+
+	if (NEntries>=NAllocated) {
+		int Size=(NAllocated>0) ? 2*NAllocated : 4096;
+
+		Item=realloc(Entry,Size*sizeof(*Item));
+		if (!Item) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the daily totals\n"));
+			exit(EXIT_FAILURE);
+		}
+		Entry=Item;
+		NAllocated=Size;
+	}
+	Item=Entry+NEntries;
+	Item->Date=Date;
+	Item->Hour=Time->tm_hour;
+	Item->User=UserPos;
+	Item->Ip=IpPos;
+	Item->Url=UrlPos;
+	Item->Code=CodePos;
+	Item->Records=1;
+	Item->Bytes=Bytes;
+	Item->Elapsed=Elapsed;
+	EntryHash[i]=++NEntries;
+}
+
+/*!
+Sort the totals by date, user, IP address, URL, hour and HTTP code.
+*/
+static int aggregate_compare(const void *Ptr1,const void *Ptr2)
+{
+	const struct AggregateEntryStruct *Item1=(const struct AggregateEntryStruct *)Ptr1;
+	const struct AggregateEntryStruct *Item2=(const struct AggregateEntryStruct *)Ptr2;
+	int Diff;
+
+	if (Item1->Date!=Item2->Date) return((Item1->Date<Item2->Date) ? -1 : 1);
+	if (Item1->User!=Item2->User && (Diff=strcmp(Pool+Item1->User,Pool+Item2->User))!=0) return(Diff);
+	if (Item1->Ip!=Item2->Ip && (Diff=strcmp(Pool+Item1->Ip,Pool+Item2->Ip))!=0) return(Diff);
+	if (Item1->Url!=Item2->Url && (Diff=strcmp(Pool+Item1->Url,Pool+Item2->Url))!=0) return(Diff);
+	if (Item1->Hour!=Item2->Hour) return(Item1->Hour-Item2->Hour);
+	if (Item1->Code!=Item2->Code) return(strcmp(Pool+Item1->Code,Pool+Item2->Code));
+	return(0);
+}
+
+/*!
+Write an unsigned integer in little endian.
+*/
+static void aggregate_put(FILE *fp_out,unsigned long long int Value,int Size)
+{
+	unsigned char Buffer[8];
+	int i;
+
+	for (i=0 ; i<Size ; i++) {
+		Buffer[i]=(unsigned char)(Value & 0xFF);
+		Value>>=8;
+	}
+	fwrite(Buffer,1,Size,fp_out);
+}
+
+/*!
+Write a string preceded by its length.
+*/
+static void aggregate_put_string(FILE *fp_out,const char *String)
+{
+	int Len=strlen(String);
+
+	aggregate_put(fp_out,Len,4);
+	fwrite(String,1,Len,fp_out);
+}
+
+/*!
+Write the totals of one day.
+
+\param First The first total of the day.
+\param Count The number of totals of the day.
+\param Records The number of records the totals of the day stand for.
+*/
+static void aggregate_write_day(const struct AggregateEntryStruct *First,int Count,long long int Records)
+{
+	char FileName[MAXLEN];
+	char TempName[MAXLEN];
+	FILE *fp_out;
+	const struct AggregateEntryStruct *Item;
+	const struct AggregateEntryStruct *Prev=NULL;
+	int Flags;
+	int i;
+
+	format_path(__FILE__, __LINE__, FileName, sizeof(FileName), "%s/sarg-%08d.agg", AggregateDir, First->Date);
+	format_path(__FILE__, __LINE__, TempName, sizeof(TempName), "%s.tmp", FileName);
+	if ((fp_out=MY_FOPEN(TempName,"wb"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (fwrite(AGGREGATE_MAGIC,1,sizeof(AGGREGATE_MAGIC),fp_out)!=sizeof(AGGREGATE_MAGIC)) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	aggregate_put(fp_out,AGGREGATE_VERSION,4);
+	aggregate_put(fp_out,First->Date,4);
+	aggregate_put(fp_out,Count,8);
+	aggregate_put(fp_out,(unsigned long long int)Records,8);
+	for (i=0 ; i<Count ; i++) {
+		Item=First+i;
+		Flags=0;
+		if (!Prev || Item->User!=Prev->User) Flags|=AGGF_User;
+		if (!Prev || Item->Ip!=Prev->Ip) Flags|=AGGF_Ip;
+		if (!Prev || Item->Url!=Prev->Url) Flags|=AGGF_Url;
+		if (!Prev || Item->Code!=Prev->Code) Flags|=AGGF_Code;
+		fputc(Flags,fp_out);
+		if (Flags & AGGF_User) aggregate_put_string(fp_out,Pool+Item->User);
+		if (Flags & AGGF_Ip) aggregate_put_string(fp_out,Pool+Item->Ip);
+		if (Flags & AGGF_Url) aggregate_put_string(fp_out,Pool+Item->Url);
+		if (Flags & AGGF_Code) aggregate_put_string(fp_out,Pool+Item->Code);
+		fputc(Item->Hour,fp_out);
+		aggregate_put(fp_out,(unsigned long long int)Item->Records,8);
+		aggregate_put(fp_out,(unsigned long long int)Item->Bytes,8);
+		aggregate_put(fp_out,(unsigned long long int)Item->Elapsed,8);
+		Prev=Item;
+	}
+	// a truncated file would look valid to the next run
+	if (ferror(fp_out)) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (fclose(fp_out)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TempName,FileName)==-1) {
+		debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),TempName,FileName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (debug)
+		debuga(__FILE__,__LINE__,_("Daily totals saved in \"%s\"\n"),FileName);
+}
+
+/*!
+Tell which option restricts the report to a part of the records kept from the
+access logs.
+
+\param Filter The filtering parameters.
+
+\return The option or NULL if the report isn't restricted.
+*/
+static const char *aggregate_restricted(const struct ReadLogDataStruct *Filter)
+{
+	int i;
+
+	if (us[0]!='\0') return("-u");
+	if (addr[0]!='\0') return("-a");
+	if (site[0]!='\0') return("-s");
+	if (Filter->StartTime>=0 && Filter->EndTime>=0) return("-t");
+	for (i=0 ; i<24 ; i++)
+		if (!numlistcontains(hours,24,i)) return("hours");
+	for (i=0 ; i<7 ; i++)
+		if (!numlistcontains(weekdays,7,i)) return("weekdays");
+	return(NULL);
+}
+
+/*!
+Read an unsigned integer stored in little endian.
+
+\return \c False if the end of the file is reached.
+*/
+static bool aggregate_get(FILE *fp_in,unsigned long long int *Value,int Size)
+{
+	unsigned char Buffer[8];
+	int i;
+
+	if (fread(Buffer,1,Size,fp_in)!=(size_t)Size) return(false);
+	*Value=0ULL;
+	for (i=Size-1 ; i>=0 ; i--)
+		*Value=(*Value<<8) | Buffer[i];
+	return(true);
+}
+
+/*!
+Read how many records the totals stored for a day stand for.
+
+\param FileName The file of the day.
+
+\return The number of records or -1 if the file doesn't exist or isn't readable.
+*/
+static long long int aggregate_stored_records(const char *FileName)
+{
+	FILE *fp_in;
+	char Magic[sizeof(AGGREGATE_MAGIC)];
+	unsigned long long int Version;
+	unsigned long long int Date;
+	unsigned long long int Count;
+	unsigned long long int Records;
+	bool Valid;
+
+	if ((fp_in=MY_FOPEN(FileName,"rb"))==NULL) return(-1);
+	Valid=(fread(Magic,1,sizeof(Magic),fp_in)==sizeof(Magic) && memcmp(Magic,AGGREGATE_MAGIC,sizeof(Magic))==0 &&
+	       aggregate_get(fp_in,&Version,4) && Version==AGGREGATE_VERSION && aggregate_get(fp_in,&Date,4) &&
+	       aggregate_get(fp_in,&Count,8) && aggregate_get(fp_in,&Records,8));
+	fclose(fp_in);
+	return(Valid ? (long long int)Records : -1);
+}
+
+/*!
+Save the totals of each day found in the access logs in ::AggregateDir.
+
+The file of a day replaces the file previously stored for the same day unless
+the stored totals count more records. Nothing is saved if the report is restricted
+to a part of the records.
+
+\param Filter The filtering parameters.
+*/
+void aggregate_save(const struct ReadLogDataStruct *Filter)
+{
+	char FileName[MAXLEN];
+	const char *Option;
+	long long int Records;
+	long long int Stored;
+	int First;
+	int i;
+
+	if (AggregateDir[0]=='\0' || NEntries==0) return;
+	if ((Option=aggregate_restricted(Filter))!=NULL) {
+		debuga(__FILE__,__LINE__,_("Daily totals not saved in \"%s\" because the report is restricted by %s\n"),AggregateDir,Option);
+		return;
+	}
+	if (access(AggregateDir,R_OK)!=0)
+		my_mkdir(AggregateDir);
+
+	/*
+	The hash table is rebuilt after the sort in case more records are added
+	by the next pass of the daemon mode.
+	*/
+	qsort(Entry,NEntries,sizeof(*Entry),aggregate_compare);
+	for (First=0 ; First<NEntries ; First=i) {
+		Records=Entry[First].Records;
+		for (i=First+1 ; i<NEntries && Entry[i].Date==Entry[First].Date ; i++)
+			Records+=Entry[i].Records;
+		format_path(__FILE__, __LINE__, FileName, sizeof(FileName), "%s/sarg-%08d.agg", AggregateDir, Entry[First].Date);
+		Stored=aggregate_stored_records(FileName);
+		if (Stored>Records) {
+			debuga(__FILE__,__LINE__,_("Daily totals in \"%s\" not replaced as they count %lld records and only %lld were read\n"),
+			       FileName,Stored,Records);
+			continue;
+		}
+		aggregate_write_day(Entry+First,i-First,Records);
+	}
+	if (EntryHash) free(EntryHash);
+	EntryHash=NULL;
+	EntryHashSize=0;
+	aggregate_grow_entry_hash();
+}
+
+/*!
+Free the memory used by the daily totals.
+*/
+void aggregate_free(void)
+{
+	if (Pool) free(Pool);
+	Pool=NULL;
+	PoolSize=0;
+	PoolAllocated=0;
+	if (StringHash) free(StringHash);
+	StringHash=NULL;
+	StringHashSize=0;
+	StringHashUsed=0;
+	if (Entry) free(Entry);
+	Entry=NULL;
+	NEntries=0;
+	NAllocated=0;
+	if (EntryHash) free(EntryHash);
+	EntryHash=NULL;
+	EntryHashSize=0;
+}
+
+/*!
+Read a string preceded by its length.
+
+\param fp_in The file to read.
+\param String A pointer to the buffer to store the string into. It is enlarged if necessary.
+\param Size A pointer to the size of the buffer.
+
+\return \c False if the string cannot be read.
+*/
+static bool aggregate_get_string(FILE *fp_in,char **String,int *Size)
+{
+	unsigned long long int Len;
+
+	if (!aggregate_get(fp_in,&Len,4) || Len>=MAXLEN*64) return(false);
+	if ((int)Len>=*Size) {
+		char *Buffer=realloc(*String,Len+1);
+
+		if (!Buffer) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to read the daily totals\n"));
+			exit(EXIT_FAILURE);
+		}
+		*String=Buffer;
+		*Size=Len+1;
+	}
+	if (fread(*String,1,Len,fp_in)!=(size_t)Len) return(false);
+	(*String)[Len]='\0';
+	return(true);
+}
+
+/*!
+Set a time from a date stored as yyyymmdd.
+*/
+static void aggregate_set_time(struct tm *Time,int Date,int Hour,int Minute,int Second)
+{
+	memset(Time,0,sizeof(*Time));
+	Time->tm_year=Date/10000-1900;
+	Time->tm_mon=(Date/100)%100-1;
+	Time->tm_mday=Date%100;
+	Time->tm_hour=Hour;
+	Time->tm_min=Minute;
+	Time->tm_sec=Second;
+	Time->tm_isdst=-1;
+	mktime(Time);
+}
+
+/*!
+Sort the dates of the aggregate files.
+*/
+static int aggregate_compare_date(const void *Ptr1,const void *Ptr2)
+{
+	int Date1=*(const int *)Ptr1;
+	int Date2=*(const int *)Ptr2;
+
+	return((Date1<Date2) ? -1 : (Date1>Date2) ? 1 : 0);
+}
+
+/*!
+Write the totals of one day in the files of the users.
+
+\param Filter The filtering parameters.
+\param FileName The file containing the totals.
+\param MinHour A pointer to the earliest hour found in the file.
+\param MaxHour A pointer to the latest hour found in the file.
+
+\return The number of records the totals stand for.
+*/
+static long long int aggregate_load_day(const struct ReadLogDataStruct *Filter,const char *FileName,int *MinHour,int *MaxHour)
+{
+	FILE *fp_in;
+	FILE *fp_user=NULL;
+	char Magic[sizeof(AGGREGATE_MAGIC)];
+	char UserFile[MAXLEN];
+	static char *User=NULL;
+	static char *Ip=NULL;
+	static char *Url=NULL;
+	static char *Code=NULL;
+	static int UserSize=0;
+	static int IpSize=0;
+	static int UrlSize=0;
+	static int CodeSize=0;
+	unsigned long long int Version;
+	unsigned long long int Date;
+	unsigned long long int Count;
+	unsigned long long int Records;
+	unsigned long long int Bytes;
+	unsigned long long int Elapsed;
+	unsigned long long int n;
+	long long int Total=0;
+	int Flags;
+	int Hour;
+	bool skip=false;
+	struct userinfostruct *uinfo=NULL;
+
+	if ((fp_in=MY_FOPEN(FileName,"rb"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (fread(Magic,1,sizeof(Magic),fp_in)!=sizeof(Magic) || memcmp(Magic,AGGREGATE_MAGIC,sizeof(Magic))!=0 ||
+	    !aggregate_get(fp_in,&Version,4)) {
+		debuga(__FILE__,__LINE__,_("File \"%s\" doesn't contain daily totals\n"),FileName);
+		exit(EXIT_FAILURE);
+	}
+	if (Version!=AGGREGATE_VERSION) {
+		debuga(__FILE__,__LINE__,_("Unsupported version %llu of the daily totals in \"%s\"\n"),Version,FileName);
+		exit(EXIT_FAILURE);
+	}
+	if (!aggregate_get(fp_in,&Date,4) || !aggregate_get(fp_in,&Count,8) || !aggregate_get(fp_in,&Records,8)) {
+		debuga(__FILE__,__LINE__,_("File \"%s\" doesn't contain daily totals\n"),FileName);
+		exit(EXIT_FAILURE);
+	}
+
+	for (n=0 ; n<Count ; n++) {
+		if ((Flags=fgetc(fp_in))==EOF ||
+		    ((Flags & AGGF_User) && !aggregate_get_string(fp_in,&User,&UserSize)) ||
+		    ((Flags & AGGF_Ip) && !aggregate_get_string(fp_in,&Ip,&IpSize)) ||
+		    ((Flags & AGGF_Url) && !aggregate_get_string(fp_in,&Url,&UrlSize)) ||
+		    ((Flags & AGGF_Code) && !aggregate_get_string(fp_in,&Code,&CodeSize)) ||
+		    (Hour=fgetc(fp_in))==EOF || Hour>=24 || (n==0 && Flags!=(AGGF_User | AGGF_Ip | AGGF_Url | AGGF_Code)) ||
+		    !aggregate_get(fp_in,&Records,8) || !aggregate_get(fp_in,&Bytes,8) || !aggregate_get(fp_in,&Elapsed,8)) {
+			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),FileName);
+			exit(EXIT_FAILURE);
+		}
+
+		if (Flags & AGGF_User) {
+			if (fp_user && fclose(fp_user)==EOF) {
+				debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),UserFile,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			fp_user=NULL;
+			skip=(us[0]!='\0' && strcmp(User,us)!=0);
+		}
+		if (skip) continue;
+		if (addr[0]!='\0' && strcmp(Ip,addr)!=0) continue;
+		if (site[0]!='\0' && strstr(Url,site)==NULL) continue;
+		if (Filter->HostFilter && !vhexclude(Url)) continue;
+		if (!numlistcontains(hours,24,Hour)) continue;
+		if (Filter->StartTime>=0 && Filter->EndTime>=0 && (Hour*100<Filter->StartTime || Hour*100>=Filter->EndTime)) continue;
+
+		// the file of the user is only created if one of its records is kept
+		if (!fp_user) {
+			if (!uinfo || strcmp(uinfo->id,User)!=0) {
+				uinfo=userinfo_find_from_id(User);
+				if (!uinfo) {
+					uinfo=userinfo_create(User,(strcmp(User,Ip)==0) ? NULL : Ip);
+					nusers++;
+				}
+			}
+			format_path(__FILE__, __LINE__, UserFile, sizeof(UserFile), "%s/%s.user_unsort", tmp, uinfo->filename);
+			if ((fp_user=MY_FOPEN(UserFile,"a"))==NULL) {
+				debuga(__FILE__,__LINE__,_("(log) Cannot open temporary file %s: %s\n"),UserFile,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		if (fprintf(fp_user,"%02d/%02d/%04d\t%02d:00:00\t%s\t%s\t%"PRIu64"\t%s\t%"PRIu64"\t\"\"\t%"PRIu64"\n",
+		            (int)(Date%100),(int)((Date/100)%100),(int)(Date/10000),Hour,Ip,Url,(uint64_t)Bytes,Code,
+		            (uint64_t)Elapsed,(uint64_t)Records)<=0) {
+			debuga(__FILE__,__LINE__,_("Write error in the log file of user %s\n"),User);
+			exit(EXIT_FAILURE);
+		}
+		if (Hour<*MinHour) *MinHour=Hour;
+		if (Hour>*MaxHour) *MaxHour=Hour;
+		Total+=(long long int)Records;
+	}
+	if (fp_user && fclose(fp_user)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),UserFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fclose(fp_in);
+	return(Total);
+}
+
+/*!
+Read the daily totals stored in ::AggregateDir instead of the access logs.
+
+Only the days within the date range requested with -d and on the week days
+selected in the configuration are read. The totals being kept by hour, a time
+range given with -t is rejected unless it starts and ends on a whole hour.
+
+\param Filter The filtering parameters.
+
+\retval 1 Records found.
+\retval 0 No record found.
+*/
+int aggregate_load(const struct ReadLogDataStruct *Filter)
+{
+	DIR *dirp;
+	struct dirent *direntp;
+	int *Dates=NULL;
+	int NDates=0;
+	int NDatesAllocated=0;
+	int Date;
+	int NameLen;
+	int MinHour;
+	int MaxHour;
+	int i;
+	long long int Records;
+	char FileName[MAXLEN];
+	bool Found=false;
+	struct tm DayTime;
+
+	if (AggregateDir[0]=='\0') {
+		debuga(__FILE__,__LINE__,_("Option --from-aggregates requires aggregate_dir to be set in the configuration file\n"));
+		exit(EXIT_FAILURE);
+	}
+	if (Filter->StartTime>=0 && Filter->EndTime>=0 && (Filter->StartTime%100!=0 || Filter->EndTime%100!=0)) {
+		debuga(__FILE__,__LINE__,_("The daily totals are kept by hour so option -t must select whole hours with --from-aggregates\n"));
+		exit(EXIT_FAILURE);
+	}
+	if ((dirp=opendir(AggregateDir))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),AggregateDir,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((direntp=readdir(dirp))!=NULL) {
+		NameLen=0;
+		if (sscanf(direntp->d_name,"sarg-%8d.agg%n",&Date,&NameLen)!=1 || NameLen==0 || direntp->d_name[NameLen]!='\0') continue;
+		if (Filter->DateRange[0]!='\0' && (Date<Filter->StartDate || Date>Filter->EndDate)) continue;
+		aggregate_set_time(&DayTime,Date,12,0,0);
+		if (!numlistcontains(weekdays,7,DayTime.tm_wday)) continue;
+		if (NDates>=NDatesAllocated) {
+			int *NewDates;
+
+			NDatesAllocated+=64;
+			NewDates=realloc(Dates,NDatesAllocated*sizeof(*Dates));
+			if (!NewDates) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to read the daily totals\n"));
+				exit(EXIT_FAILURE);
+			}
+			Dates=NewDates;
+		}
+		Dates[NDates++]=Date;
+	}
+	closedir(dirp);
+	if (NDates>1) qsort(Dates,NDates,sizeof(*Dates),aggregate_compare_date);
+
+	for (i=0 ; i<NDates ; i++) {
+		format_path(__FILE__, __LINE__, FileName, sizeof(FileName), "%s/sarg-%08d.agg", AggregateDir, Dates[i]);
+		if (debug) debuga(__FILE__,__LINE__,_("Reading daily totals: %s\n"),FileName);
+		MinHour=24;
+		MaxHour=-1;
+		Records=aggregate_load_day(Filter,FileName,&MinHour,&MaxHour);
+		if (Records<=0) continue;
+		records_kept+=Records;
+		if (!Found) {
+			aggregate_set_time(&period.start,Dates[i],MinHour,0,0);
+			Found=true;
+		}
+		aggregate_set_time(&period.end,Dates[i],MaxHour,59,59);
+	}
+	if (Dates) free(Dates);
+	return(Found ? 1 : 0);
+}
@@ -27,21 +27,19 @@
 #include "include/conf.h"
 #include "include/defs.h"
 #include "include/readlog.h"
+#include "include/eventlist.h"
 
-//! Name of the file containing the unsorted authentication failure entries.
-static char authfail_unsort[MAXLEN]="";
-//! The file handle to write the entries.
-static FILE *fp_authfail=NULL;
+//! The authentication failure entries.
+static EventListObject authfail_events=NULL;
 //! \c True if at least one anthentication failure entry exists.
 static bool authfail_exists=false;
 
 /*!
-Open a file to store the authentication failure.
-
-\return The file handle or NULL if no file is necessary.
+Prepare the list to store the authentication failures.
 */
 void authfail_open(void)
 {
+	if (authfail_events) return;
 	if ((ReportType & REPORT_TYPE_AUTH_FAILURES) == 0) {
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Authentication failures report not produced as it is not requested\n"));
 		return;
@@ -51,43 +49,30 @@ void authfail_open(void)
 		return;
 	}
 
-	format_path(__FILE__, __LINE__, authfail_unsort, sizeof(authfail_unsort), "%s/authfail.int_unsort", tmp);
-	if ((fp_authfail=MY_FOPEN(authfail_unsort,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),authfail_unsort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	authfail_events=EventList_Create("authfail",EVENTSORT_UserUrl);
 	return;
 }
 
 /*!
-Write one entry in the unsorted authentication file file provided that it is required.
+Store one authentication failure entry provided that it is required.
 
-\param log_entry The entry to write into the log file.
+\param log_entry The entry to store.
 */
 void authfail_write(const struct ReadLogStruct *log_entry)
 {
-	char date[80];
-
-	if (fp_authfail && (strstr(log_entry->HttpCode,"DENIED/401") != 0 || strstr(log_entry->HttpCode,"DENIED/407") != 0)) {
-		strftime(date,sizeof(date),"%d/%m/%Y\t%H:%M:%S",&log_entry->EntryTime);
-		fprintf(fp_authfail, "%s\t%s\t%s\t%s\n",date,log_entry->User,log_entry->Ip,log_entry->Url);
+	if (authfail_events && (strstr(log_entry->HttpCode,"DENIED/401") != 0 || strstr(log_entry->HttpCode,"DENIED/407") != 0)) {
+		EventList_Add(authfail_events,&log_entry->EntryTime,log_entry->User,log_entry->Ip,log_entry->Url);
 		authfail_exists=true;
 	}
 }
 
 /*!
-Close the file opened by authfail_open().
+Stop storing the authentication failures.
 */
 void authfail_close(void)
 {
-	if (fp_authfail)
-	{
-		if (fclose(fp_authfail)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),authfail_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_authfail=NULL;
-	}
+	if (authfail_events)
+		EventList_Close(authfail_events);
 }
 
 /*!
@@ -112,68 +97,33 @@ static void show_ignored_auth(FILE *fp_ou,int count)
 
 void authfail_report(void)
 {
-	FileObject *fp_in = NULL;
 	FILE *fp_ou = NULL;
 
-	char *buf;
-	char *url;
-	char authfail_sort[MAXLEN];
 	char report[MAXLEN];
-	char ip[MAXLEN];
 	char oip[MAXLEN]="";
-	char user[MAXLEN];
 	char ouser[MAXLEN]="";
 	char ouser2[MAXLEN]="";
 	char data[15];
-	char hora[15];
-	char csort[MAXLEN];
 	int z=0;
 	int count=0;
-	int cstatus;
-	int day,month,year;
 	bool new_user;
-	struct getwordstruct gwarea;
-	longline line;
+	struct EventStruct event;
 	struct userinfostruct *uinfo;
 	struct tm t;
 
 	if (!authfail_exists) {
-		if (!KeepTempLog && authfail_unsort[0]!='\0' && unlink(authfail_unsort))
-			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),authfail_unsort,strerror(errno));
-
-		authfail_unsort[0]='\0';
+		EventList_Destroy(&authfail_events);
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Authentication failures report not produced because it is empty\n"));
 		return;
 	}
 	if (debugz>=LogLevel_Process)
 		debuga(__FILE__,__LINE__,_("Creating authentication failures report...\n"));
 
-	format_path(__FILE__, __LINE__, authfail_sort, sizeof(authfail_sort), "%s/authfail.int_log", tmp);
 	format_path(__FILE__, __LINE__, report, sizeof(report), "%s/authfail.html", outdirname);
 
-	if (snprintf(csort, sizeof(csort), "sort -b -t \"\t\" -T \"%s\" -k 3,3 -k 5,5 -o \"%s\" \"%s\"", tmp, authfail_sort, authfail_unsort) >= sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"), authfail_unsort, authfail_sort);
-		debuga_more("sort -b -t \"\t\" -T \"%s\" -k 3,3 -k 5,5 -o \"%s\" \"%s\"", tmp, authfail_sort, authfail_unsort);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if ((fp_in=FileObject_Open(authfail_sort))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),authfail_sort,FileObject_GetLastOpenError());
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if (!KeepTempLog && unlink(authfail_unsort)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),authfail_unsort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	authfail_unsort[0]='\0';
+	EventList_Sort(authfail_events);
 
-	if ((fp_ou=MY_FOPEN(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -188,56 +138,29 @@ void authfail_report(void)
 	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\">\n",fp_ou);
 	fprintf(fp_ou,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("IP/NAME"),_("DATE/TIME"),_("ACCESSED SITE"));
 
-	if ((line=longline_create())==NULL) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),authfail_sort);
-		exit(EXIT_FAILURE);
-	}
-
-	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(data,sizeof(data),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),authfail_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(hora,sizeof(hora),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid time in file \"%s\"\n"),authfail_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(user,sizeof(user),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid user ID in file \"%s\"\n"),authfail_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid IP address in file \"%s\"\n"),authfail_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),authfail_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (sscanf(data,"%d/%d/%d",&day,&month,&year)!=3) continue;
-		computedate(year,month,day,&t);
+	while (EventList_Read(authfail_events,&event)) {
+		computedate(event.Year,event.Month,event.Day,&t);
 		strftime(data,sizeof(data),"%x",&t);
 
-		uinfo=userinfo_find_from_id(user);
+		uinfo=userinfo_find_from_id(event.User);
 		if (!uinfo) {
-			debuga(__FILE__,__LINE__,_("Unknown user ID %s in file \"%s\"\n"),user,authfail_sort);
+			debuga(__FILE__,__LINE__,_("Unknown user ID %s in the authentication failures\n"),event.User);
 			exit(EXIT_FAILURE);
 		}
 
 		new_user=false;
 		if (z == 0) {
-			strcpy(ouser,user);
-			strcpy(oip,ip);
+			safe_strcpy(ouser,event.User,sizeof(ouser));
+			safe_strcpy(oip,event.Ip,sizeof(oip));
 			z++;
 			new_user=true;
 		} else {
-			if (strcmp(ouser,user) != 0) {
-				strcpy(ouser,user);
+			if (strcmp(ouser,event.User) != 0) {
+				safe_strcpy(ouser,event.User,sizeof(ouser));
 				new_user=true;
 			}
-			if (strcmp(oip,ip) != 0) {
-				strcpy(oip,ip);
+			if (strcmp(oip,event.Ip) != 0) {
+				safe_strcpy(oip,event.Ip,sizeof(oip));
 				new_user=true;
 			}
 		}
@@ -257,23 +180,18 @@ void authfail_report(void)
 
 		fputs("<tr>",fp_ou);
 		if (new_user)
-			fprintf(fp_ou,"<td class=\"data2\">%s</td><td class=\"data2\">%s</td>",uinfo->label,ip);
+			fprintf(fp_ou,"<td class=\"data2\">%s</td><td class=\"data2\">%s</td>",uinfo->label,event.Ip);
 		else
 			fputs("<td class=\"data2\"></td><td class=\"data2\"></td>",fp_ou);
-		fprintf(fp_ou,"<td class=\"data2\">%s-%s</td><td class=\"data2\">",data,hora);
-		if (BlockIt[0]!='\0' && url[0]!=ALIAS_PREFIX) {
+		fprintf(fp_ou,"<td class=\"data2\">%s-%s</td><td class=\"data2\">",data,event.Time);
+		if (BlockIt[0]!='\0' && event.Url[0]!=ALIAS_PREFIX) {
 			fprintf(fp_ou,"<a href=\"%s%s?url=",wwwDocumentRoot,BlockIt);
-			output_html_url(fp_ou,url);
+			output_html_url(fp_ou,event.Url);
 			fputs("\"><img src=\"../images/sarg-squidguard-block.png\"></a>&nbsp;",fp_ou);
 		}
-		output_html_link(fp_ou,url,100);
+		output_html_link(fp_ou,event.Url,100);
 		fputs("</td></th>\n",fp_ou);
 	}
-	if (FileObject_Close(fp_in)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),authfail_sort,FileObject_GetLastCloseError());
-		exit(EXIT_FAILURE);
-	}
-	longline_destroy(&line);
 
 	if (count>AuthfailReportLimit && AuthfailReportLimit>0)
 		show_ignored_auth(fp_ou,count-AuthfailReportLimit);
@@ -285,28 +203,13 @@ void authfail_report(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(authfail_sort)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),authfail_sort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
 	return;
 }
 
 /*!
-Remove any temporary file left by the authfail module.
+Free the authentication failures and remove any temporary file left by the authfail module.
 */
 void authfail_cleanup(void)
 {
-	if (fp_authfail) {
-		if (fclose(fp_authfail)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),authfail_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_authfail=NULL;
-	}
-	if (authfail_unsort[0]) {
-		if (!KeepTempLog && unlink(authfail_unsort)==-1)
-			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),authfail_unsort,strerror(errno));
-	}
+	EventList_Destroy(&authfail_events);
 }
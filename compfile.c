@@ -0,0 +1,511 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Write a file compressed as it is written.
+
+The data are compressed by a child process when the system can fork so that
+the compression doesn't slow down the process producing the data.
+*/
+
+// fopencookie() is a GNU extension
+#define _GNU_SOURCE
+#include "include/conf.h"
+#include "include/defs.h"
+#ifdef HAVE_ZLIB_H
+#include "zlib.h"
+#endif
+#ifdef HAVE_ZSTD_H
+#include "zstd.h"
+#endif
+
+#ifdef HAVE_FOPENCOOKIE
+//! The size of the buffer used to pass the data to the compressor.
+#define COMPFILE_BUFFER_SIZE (256*1024)
+
+/*!
+ * \brief State of a file being compressed.
+ */
+struct CompFileStruct
+{
+	//! The compression method.
+	enum StreamCompressionEnum Method;
+	//! The name of the compressed file for the messages.
+	char *FileName;
+#ifdef HAVE_ZLIB_H
+	//! The gzip file.
+	gzFile Gz;
+#endif
+#ifdef HAVE_ZSTD_H
+	//! The zstd compression context.
+	ZSTD_CCtx *Zstd;
+	//! The buffer receiving the zstd compressed data.
+	void *ZstdBuffer;
+	//! The size of the zstd buffer.
+	size_t ZstdSize;
+	//! The file the zstd compressed data are written to.
+	FILE *Output;
+#endif
+	//! The pipe to the compression process or -1 if the data are compressed by this process.
+	int Pipe;
+	//! The compression process.
+	pid_t Pid;
+	//! The next file compressed by a process.
+	struct CompFileStruct *Next;
+};
+
+//! The files compressed by a child process.
+static struct CompFileStruct *FirstForkedFile=NULL;
+
+#ifdef HAVE_ZSTD_H
+/*!
+ * Compress a block of data with zstd and write the result.
+ *
+ * \param Comp The compressed file.
+ * \param Buffer The data to compress.
+ * \param Size The number of bytes to compress.
+ * \param Mode ZSTD_e_continue or ZSTD_e_end to terminate the frame.
+ *
+ * \return \c True on success.
+ */
+static bool CompFile_Zstd(struct CompFileStruct *Comp,const void *Buffer,size_t Size,ZSTD_EndDirective Mode)
+{
+	ZSTD_inBuffer Input;
+	ZSTD_outBuffer Output;
+	size_t Remaining;
+
+	Input.src=Buffer;
+	Input.size=Size;
+	Input.pos=0;
+	do {
+		Output.dst=Comp->ZstdBuffer;
+		Output.size=Comp->ZstdSize;
+		Output.pos=0;
+		Remaining=ZSTD_compressStream2(Comp->Zstd,&Output,&Input,Mode);
+		if (ZSTD_isError(Remaining)) {
+			debuga(__FILE__,__LINE__,_("Cannot compress file \"%s\" (zstd library returned error: %s)\n"),Comp->FileName,ZSTD_getErrorName(Remaining));
+			return(false);
+		}
+		if (Output.pos>0 && fwrite(Comp->ZstdBuffer,1,Output.pos,Comp->Output)!=Output.pos) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			return(false);
+		}
+	} while ((Mode==ZSTD_e_end) ? Remaining!=0 : Input.pos<Input.size);
+	return(true);
+}
+#endif
+
+/*!
+ * Open the compressor writing the file.
+ *
+ * \param Comp The compressed file.
+ * \param fd The descriptor of the file to write. It is closed on error.
+ *
+ * \return \c True on success.
+ */
+static bool CompFile_OpenCompressor(struct CompFileStruct *Comp,int fd)
+{
+	switch (Comp->Method)
+	{
+#ifdef HAVE_ZLIB_H
+	case STREAMCOMP_Gzip:
+		Comp->Gz=gzdopen(fd,"wb");
+		if (!Comp->Gz) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to compress file \"%s\"\n"),Comp->FileName);
+			close(fd);
+			return(false);
+		}
+		gzbuffer(Comp->Gz,COMPFILE_BUFFER_SIZE);
+		return(true);
+#endif
+#ifdef HAVE_ZSTD_H
+	case STREAMCOMP_Zstd:
+		Comp->Output=fdopen(fd,"wb");
+		if (!Comp->Output) {
+			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			close(fd);
+			return(false);
+		}
+		Comp->Zstd=ZSTD_createCCtx();
+		Comp->ZstdSize=ZSTD_CStreamOutSize();
+		Comp->ZstdBuffer=malloc(Comp->ZstdSize);
+		if (!Comp->Zstd || !Comp->ZstdBuffer) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to compress file \"%s\"\n"),Comp->FileName);
+			return(false);
+		}
+		return(true);
+#endif
+	default:
+		break;
+	}
+	close(fd);
+	return(false);
+}
+
+/*!
+ * Compress a block of data.
+ *
+ * \param Comp The compressed file.
+ * \param Buffer The data to compress.
+ * \param Size The number of bytes to compress.
+ *
+ * \return \c True on success.
+ */
+static bool CompFile_Compress(struct CompFileStruct *Comp,const char *Buffer,size_t Size)
+{
+	switch (Comp->Method)
+	{
+#ifdef HAVE_ZLIB_H
+	case STREAMCOMP_Gzip:
+	{
+		size_t Written;
+		int Chunk;
+
+		for (Written=0 ; Written<Size ; Written+=Chunk) {
+			Chunk=(Size-Written>0x10000000) ? 0x10000000 : (int)(Size-Written);
+			if (gzwrite(Comp->Gz,Buffer+Written,Chunk)!=Chunk) {
+				debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),Comp->FileName,strerror(errno));
+				return(false);
+			}
+		}
+		return(true);
+	}
+#endif
+#ifdef HAVE_ZSTD_H
+	case STREAMCOMP_Zstd:
+		return(CompFile_Zstd(Comp,Buffer,Size,ZSTD_e_continue));
+#endif
+	default:
+		break;
+	}
+	return(false);
+}
+
+/*!
+ * Terminate the compressed stream and close the file.
+ *
+ * \param Comp The compressed file.
+ *
+ * \return \c True on success.
+ */
+static bool CompFile_CloseCompressor(struct CompFileStruct *Comp)
+{
+	bool Success=true;
+
+	switch (Comp->Method)
+	{
+#ifdef HAVE_ZLIB_H
+	case STREAMCOMP_Gzip:
+		if (Comp->Gz && gzclose(Comp->Gz)!=Z_OK) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			Success=false;
+		}
+		Comp->Gz=NULL;
+		break;
+#endif
+#ifdef HAVE_ZSTD_H
+	case STREAMCOMP_Zstd:
+		if (Comp->Zstd && Comp->ZstdBuffer && Comp->Output && !CompFile_Zstd(Comp,NULL,0,ZSTD_e_end))
+			Success=false;
+		if (Comp->Output && fclose(Comp->Output)==EOF) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			Success=false;
+		}
+		Comp->Output=NULL;
+		ZSTD_freeCCtx(Comp->Zstd);
+		Comp->Zstd=NULL;
+		free(Comp->ZstdBuffer);
+		Comp->ZstdBuffer=NULL;
+		break;
+#endif
+	default:
+		break;
+	}
+	return(Success);
+}
+
+#ifdef HAVE_FORK
+/*!
+ * Compress the data received through the pipe until the parent closes it.
+ *
+ * This function doesn't return.
+ *
+ * \param Comp The compressed file.
+ * \param Input The end of the pipe to read the data from.
+ * \param fd The descriptor of the file to write.
+ */
+static void CompFile_Child(struct CompFileStruct *Comp,int Input,int fd)
+{
+	char *Buffer;
+	ssize_t nread;
+
+	Buffer=malloc(COMPFILE_BUFFER_SIZE);
+	if (!Buffer) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to compress file \"%s\"\n"),Comp->FileName);
+		_exit(EXIT_FAILURE);
+	}
+	if (!CompFile_OpenCompressor(Comp,fd)) _exit(EXIT_FAILURE);
+	while ((nread=read(Input,Buffer,COMPFILE_BUFFER_SIZE))!=0) {
+		if (nread<0) {
+			if (errno==EINTR) continue;
+			debuga(__FILE__,__LINE__,_("Cannot read the data to compress into \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			_exit(EXIT_FAILURE);
+		}
+		if (!CompFile_Compress(Comp,Buffer,nread)) _exit(EXIT_FAILURE);
+	}
+	if (!CompFile_CloseCompressor(Comp)) _exit(EXIT_FAILURE);
+	_exit(EXIT_SUCCESS);
+}
+
+/*!
+ * Start the process compressing the data.
+ *
+ * \param Comp The compressed file.
+ * \param fd The descriptor of the file to write. It is closed if the process is running.
+ *
+ * \return \c True if the process is running.
+ */
+static bool CompFile_Fork(struct CompFileStruct *Comp,int fd)
+{
+	int Pipe[2];
+	pid_t Pid;
+
+	if (pipe(Pipe)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot create a pipe to compress file \"%s\": %s\n"),Comp->FileName,strerror(errno));
+		return(false);
+	}
+	// don't let the child flush the pending output of the parent a second time
+	fflush(NULL);
+	Pid=fork();
+	if (Pid==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot start a process to compress file \"%s\": %s\n"),Comp->FileName,strerror(errno));
+		close(Pipe[0]);
+		close(Pipe[1]);
+		return(false);
+	}
+	if (Pid==0) {
+		struct CompFileStruct *Other;
+
+		close(Pipe[1]);
+		// the other compression processes must not wait for this process to close their pipe
+		for (Other=FirstForkedFile ; Other ; Other=Other->Next)
+			close(Other->Pipe);
+		CompFile_Child(Comp,Pipe[0],fd);
+	}
+	close(Pipe[0]);
+	close(fd);
+	Comp->Pipe=Pipe[1];
+	Comp->Pid=Pid;
+	Comp->Next=FirstForkedFile;
+	FirstForkedFile=Comp;
+	return(true);
+}
+#endif
+
+/*!
+ * Write the data to the compressor.
+ *
+ * \param Cookie The CompFileStruct of the file.
+ * \param Buffer The data to write.
+ * \param Size The number of bytes to write.
+ *
+ * \return The number of bytes written or -1 on error.
+ */
+static ssize_t CompFile_Write(void *Cookie,const char *Buffer,size_t Size)
+{
+	struct CompFileStruct *Comp=(struct CompFileStruct *)Cookie;
+	size_t Written;
+	ssize_t nwritten;
+
+	if (Comp->Pipe<0) {
+		if (!CompFile_Compress(Comp,Buffer,Size)) {
+			errno=EIO;
+			return(-1);
+		}
+		return(Size);
+	}
+	for (Written=0 ; Written<Size ; Written+=nwritten) {
+		nwritten=write(Comp->Pipe,Buffer+Written,Size-Written);
+		if (nwritten<0) {
+			if (errno==EINTR) {
+				nwritten=0;
+				continue;
+			}
+			return(-1);
+		}
+	}
+	return(Size);
+}
+
+/*!
+ * Terminate the compressed file.
+ *
+ * \param Cookie The CompFileStruct of the file.
+ *
+ * \return 0 on success or EOF on error.
+ */
+static int CompFile_Close(void *Cookie)
+{
+	struct CompFileStruct *Comp=(struct CompFileStruct *)Cookie;
+	int RetCode=0;
+
+	if (Comp->Pipe<0) {
+		if (!CompFile_CloseCompressor(Comp)) {
+			errno=EIO;
+			RetCode=EOF;
+		}
+	} else {
+		int Status;
+		struct CompFileStruct **Ptr;
+
+		for (Ptr=&FirstForkedFile ; *Ptr && *Ptr!=Comp ; Ptr=&(*Ptr)->Next);
+		if (*Ptr) *Ptr=Comp->Next;
+		close(Comp->Pipe);
+		while (waitpid(Comp->Pid,&Status,0)==-1) {
+			if (errno==EINTR) continue;
+			debuga(__FILE__,__LINE__,_("Failed to wait for the process compressing file \"%s\": %s\n"),Comp->FileName,strerror(errno));
+			Status=1;
+			break;
+		}
+		if (!WIFEXITED(Status) || WEXITSTATUS(Status)!=EXIT_SUCCESS) {
+			errno=EIO;
+			RetCode=EOF;
+		}
+	}
+	free(Comp->FileName);
+	free(Comp);
+	return(RetCode);
+}
+#endif
+
+/*!
+ * Get the suffix to append to the name of a file compressed with
+ * the given method.
+ *
+ * \param Method The compression method.
+ *
+ * \return The suffix including the dot or an empty string if the file isn't compressed.
+ */
+const char *compressed_file_suffix(enum StreamCompressionEnum Method)
+{
+	switch (Method)
+	{
+		case STREAMCOMP_Gzip:
+			return(".gz");
+		case STREAMCOMP_Zstd:
+			return(".zst");
+		default:
+			break;
+	}
+	return("");
+}
+
+/*!
+ * Open a file whose content is compressed as it is written.
+ *
+ * The returned stream is used and closed like any other FILE. Closing it
+ * waits for the compression to complete and reports its errors.
+ *
+ * When data are appended to an existing compressed file, they are written
+ * as a new gzip member or zstd frame. The decompressors read such files as
+ * one stream.
+ *
+ * \param FileName The name of the compressed file including its suffix.
+ * \param Method The compression method.
+ * \param Append \c True to append the data to the file instead of replacing it.
+ *
+ * \return The stream or NULL on error with a message already displayed.
+ */
+FILE *open_compressed_file(const char *FileName,enum StreamCompressionEnum Method,bool Append)
+{
+	FILE *fp;
+#ifdef HAVE_FOPENCOOKIE
+	struct CompFileStruct *Comp;
+	cookie_io_functions_t Functions;
+	int fd;
+#endif
+
+	if (Method==STREAMCOMP_None) {
+		fp=MY_FOPEN(FileName,(Append) ? "a" : "w");
+		if (!fp) debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,strerror(errno));
+		return(fp);
+	}
+#ifdef HAVE_FOPENCOOKIE
+#ifndef HAVE_ZLIB_H
+	if (Method==STREAMCOMP_Gzip) {
+		debuga(__FILE__,__LINE__,_("Sarg was not compiled with gzip support to write file \"%s\"\n"),FileName);
+		return(NULL);
+	}
+#endif
+#ifndef HAVE_ZSTD_H
+	if (Method==STREAMCOMP_Zstd) {
+		debuga(__FILE__,__LINE__,_("Sarg was not compiled with zstd support to write file \"%s\"\n"),FileName);
+		return(NULL);
+	}
+#endif
+	Comp=(struct CompFileStruct *)calloc(1,sizeof(*Comp));
+	if (!Comp || (Comp->FileName=strdup(FileName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to compress file \"%s\"\n"),FileName);
+		free(Comp);
+		return(NULL);
+	}
+	Comp->Method=Method;
+	Comp->Pipe=-1;
+	// open the file here so that the errors are reported before the data are sent to the child
+	fd=open(FileName,O_WRONLY | O_CREAT | ((Append) ? O_APPEND : O_TRUNC) | O_LARGEFILE,0666);
+	if (fd==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,strerror(errno));
+		free(Comp->FileName);
+		free(Comp);
+		return(NULL);
+	}
+#ifdef HAVE_FORK
+	if (!CompFile_Fork(Comp,fd))
+#endif
+	{
+		if (!CompFile_OpenCompressor(Comp,fd)) {
+			CompFile_CloseCompressor(Comp);
+			free(Comp->FileName);
+			free(Comp);
+			return(NULL);
+		}
+	}
+	memset(&Functions,0,sizeof(Functions));
+	Functions.write=CompFile_Write;
+	Functions.close=CompFile_Close;
+	fp=fopencookie(Comp,"w",Functions);
+	if (!fp) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,strerror(errno));
+		CompFile_Close(Comp);
+		return(NULL);
+	}
+	setvbuf(fp,NULL,_IOFBF,COMPFILE_BUFFER_SIZE);
+	return(fp);
+#else
+	debuga(__FILE__,__LINE__,_("Compressed files are not supported by this build of sarg\n"));
+	exit(EXIT_FAILURE);
+#endif
+}
@@ -24,24 +24,56 @@
  *
  */
 
+/*!\file
+\brief Convert the dates of the squid logs into a human readable form.
+*/
+
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/filelist.h"
+#include "include/stage.h"
+
+//! Size of the buffer of the converted log.
+#define CONVLOG_BUFFER_SIZE (256*1024)
+
+extern FileListObject AccessLog;
+extern int ReportJobs;
 
-void convlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilter)
+//! The date format.
+static char ConvDateFormat;
+//! How to filter out log data.
+static const struct ReadLogDataStruct *ConvFilter;
+//! The path and prefix of the converted files or an empty string to write to stdout.
+static char ConvPrefix[MAXLEN];
+//! The number of processes converting the logs.
+static int ConvWorkers;
+
+/*!
+ * Convert the dates of one log.
+ *
+ * The date and time are formatted once for all the lines logged during
+ * the same second.
+ *
+ * \param arq The log to convert.
+ * \param fp_ou The file to write the converted log to.
+ */
+static void convlog_file(const char *arq,FILE *fp_ou)
 {
 	FileObject *fp_in;
 	char *buf;
-	char data[30];
+	char *Field;
+	char Prefix[40];
+	int PrefixLen=0;
 	char dia[11];
+	int DiaLen=0;
+	int LastDate=0;
 	time_t tt;
-	int idata=0;
-	struct tm *t;
-	struct getwordstruct gwarea;
+	time_t LastTime=(time_t)-1;
+	bool Skip=true;
+	struct tm t;
+	struct LocalTimeCacheStruct Cache;
 	longline line;
 
-	if (arq[0] == '\0')
-		arq="/var/log/squid/access.log";
-
 	if ((fp_in=FileObject_Open(arq))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
 		exit(EXIT_FAILURE);
@@ -51,37 +83,64 @@ void convlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilte
 		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),arq);
 		exit(EXIT_FAILURE);
 	}
+	memset(&Cache,0,sizeof(Cache));
 
 	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(data,sizeof(data),&gwarea,' ')<0) {
+		// the date is the number of seconds since the epoch with the milliseconds after a dot
+		tt=0;
+		for (Field=buf ; (unsigned char)(*Field-'0')<=9 ; Field++)
+			tt=tt*10+(*Field-'0');
+		while (*Field && *Field!=' ') Field++;
+		if (Field-buf>=30) {
 			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),arq);
 			exit(EXIT_FAILURE);
 		}
-		tt=atoi(data);
-		t=localtime(&tt);
-
-		if (ReadFilter->DateRange[0])
-		{
-			idata=(t->tm_year+1900)*10000+(t->tm_mon+1)*100+t->tm_mday;
-			if (idata<ReadFilter->StartDate || idata>ReadFilter->EndDate)
-				continue;
-		}
-		if (ReadFilter->StartTime>=0 || ReadFilter->EndTime>=0)
-		{
-			int hmr=t->tm_hour*100+t->tm_min;
-			if (hmr<ReadFilter->StartTime || hmr>=ReadFilter->EndTime)
-				continue;
-		}
 
-		if (df=='e')
-			strftime(dia, sizeof(dia), "%d/%m/%Y", t);
-		else if (df=='u')
-			strftime(dia, sizeof(dia), "%m/%d/%Y", t);
-		else //if (df=='w')
-			strftime(dia, sizeof(dia), "%Y.%U", t);
+		if (tt!=LastTime) {
+			LastTime=tt;
+			localtime_cached(&Cache,tt,&t);
+			Skip=false;
+			if (ConvFilter->DateRange[0])
+			{
+				if (Cache.Date<ConvFilter->StartDate || Cache.Date>ConvFilter->EndDate)
+					Skip=true;
+			}
+			if (ConvFilter->StartTime>=0 || ConvFilter->EndTime>=0)
+			{
+				int hmr=t.tm_hour*100+t.tm_min;
+				if (hmr<ConvFilter->StartTime || hmr>=ConvFilter->EndTime)
+					Skip=true;
+			}
+			if (!Skip) {
+				if (Cache.Date!=LastDate) {
+					if (ConvDateFormat=='e')
+						strftime(dia, sizeof(dia), "%d/%m/%Y", &t);
+					else if (ConvDateFormat=='u')
+						strftime(dia, sizeof(dia), "%m/%d/%Y", &t);
+					else //if (ConvDateFormat=='w')
+						strftime(dia, sizeof(dia), "%Y.%U", &t);
+					DiaLen=strlen(dia);
+					LastDate=Cache.Date;
+				}
+				memcpy(Prefix,dia,DiaLen);
+				PrefixLen=DiaLen;
+				Prefix[PrefixLen++]=' ';
+				Prefix[PrefixLen++]='0'+t.tm_hour/10;
+				Prefix[PrefixLen++]='0'+t.tm_hour%10;
+				Prefix[PrefixLen++]=':';
+				Prefix[PrefixLen++]='0'+t.tm_min/10;
+				Prefix[PrefixLen++]='0'+t.tm_min%10;
+				Prefix[PrefixLen++]=':';
+				Prefix[PrefixLen++]='0'+t.tm_sec/10;
+				Prefix[PrefixLen++]='0'+t.tm_sec%10;
+				Prefix[PrefixLen++]=' ';
+			}
+		}
+		if (Skip) continue;
 
-		printf("%s %02d:%02d:%02d %s\n",dia,t->tm_hour,t->tm_min,t->tm_sec,gwarea.current);
+		fwrite(Prefix,1,PrefixLen,fp_ou);
+		fputs((*Field) ? Field+1 : Field,fp_ou);
+		putc('\n',fp_ou);
 	}
 
 	longline_destroy(&line);
@@ -90,3 +149,99 @@ void convlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilte
 		exit(EXIT_FAILURE);
 	}
 }
+
+/*!
+ * Convert the logs assigned to one process into separate files.
+ *
+ * \param Worker The number of the process. It converts every log whose
+ * position in the list modulo the number of processes is \a Worker.
+ */
+static void convlog_worker(int Worker)
+{
+	FileListIterator FIter;
+	const char *FileName;
+	char OutputName[MAXLEN];
+	FILE *fp_ou;
+	int i;
+
+	FIter=FileListIter_Open(AccessLog);
+	for (i=0 ; (FileName=FileListIter_Next(FIter))!=NULL ; i++) {
+		if (i%ConvWorkers!=Worker) continue;
+		format_path(__FILE__, __LINE__, OutputName, sizeof(OutputName), "%s-%03d", ConvPrefix, i+1);
+		if ((fp_ou=MY_FOPEN(OutputName,"w"))==NULL) {
+			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),OutputName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		setvbuf(fp_ou,NULL,_IOFBF,CONVLOG_BUFFER_SIZE);
+		convlog_file(FileName,fp_ou);
+		if (fclose(fp_ou)==EOF) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),OutputName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	FileListIter_Close(FIter);
+}
+
+/*!
+Convert the date of the access logs into a human readable form.
+
+\param df The date format. It can be 'e' for European date format, 'u' for US
+date format or 'w' for the year and week number.
+\param ReadFilter How to filter out log data.
+\param prefix If it is empty, all the logs are written to the standard output.
+Otherwise, each log is written to a file named after the prefix and the position
+of the log in the list. Several logs are converted at the same time if report_jobs
+allows it.
+*/
+void convlog(char df, const struct ReadLogDataStruct *ReadFilter, const char *prefix)
+{
+	FileListIterator FIter;
+	const char *FileName;
+	int NFiles;
+	int i;
+
+	ConvDateFormat=df;
+	ConvFilter=ReadFilter;
+
+	if (prefix[0]=='\0') {
+		setvbuf(stdout,NULL,_IOFBF,CONVLOG_BUFFER_SIZE);
+		FIter=FileListIter_Open(AccessLog);
+		while ((FileName=FileListIter_Next(FIter))!=NULL)
+			convlog_file(FileName,stdout);
+		FileListIter_Close(FIter);
+		return;
+	}
+
+	if (snprintf(ConvPrefix,sizeof(ConvPrefix),"%s%s",outdir,prefix)>=sizeof(ConvPrefix)) {
+		debuga(__FILE__,__LINE__,_("Path too long: "));
+		debuga_more("%s%s-NNN\n",outdir,prefix);
+		exit(EXIT_FAILURE);
+	}
+
+	FIter=FileListIter_Open(AccessLog);
+	for (NFiles=0 ; FileListIter_Next(FIter)!=NULL ; NFiles++);
+	FileListIter_Close(FIter);
+
+	ConvWorkers=ReportJobs;
+	if (ConvWorkers>NFiles) ConvWorkers=NFiles;
+	if (ConvWorkers>MAX_STAGES) ConvWorkers=MAX_STAGES;
+#ifndef HAVE_FORK
+	ConvWorkers=1;
+#endif
+
+	if (ConvWorkers<2) {
+		ConvWorkers=1;
+		convlog_worker(0);
+	} else {
+		StageListObject stages;
+		char Name[40];
+
+		stages=Stage_Create();
+		for (i=0 ; i<ConvWorkers ; i++) {
+			snprintf(Name,sizeof(Name),"convlog%d",i);
+			Stage_AddArg(stages,Name,convlog_worker,i,NULL,NULL,0);
+		}
+		Stage_Run(stages,ConvWorkers);
+		Stage_Destroy(&stages);
+	}
+}
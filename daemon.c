@@ -0,0 +1,275 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+/*!\file
+\brief Keep reading the access logs and refresh the reports periodically
+
+The daemon reads the lines appended to the access logs since its previous pass
+and adds them to the data it accumulated in memory and in its temporary directory.
+The reports are then produced by a child process working on a snapshot of that
+data so that the memory and the files of the daemon are left untouched. The
+daemon waits for the reports to be complete before it starts the next pass.
+
+The period of the report grows as the daemon reads new lines. When the report
+of a pass is written in a different directory than the previous pass, the
+directory of the previous pass is deleted so that only one report is kept
+for the period covered by the daemon.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+#include <signal.h>
+
+//! Name of the subdirectory of the temporary directory where the reports are produced.
+#define DAEMON_REPORT_DIR "report"
+
+//! Set when the daemon is requested to terminate.
+static volatile sig_atomic_t DaemonStop=0;
+//! Set when the daemon is requested to refresh the reports without waiting.
+static volatile sig_atomic_t DaemonRefresh=0;
+//! The report directory written by the previous pass.
+static char DaemonReportDir[MAXLEN]="";
+
+/*!
+ * Catch the signals controlling the daemon.
+ *
+ * \param sig The signal received.
+ */
+static void daemon_signal(int sig)
+{
+	if (sig==SIGHUP)
+		DaemonRefresh=1;
+	else
+		DaemonStop=1;
+}
+
+/*!
+ * Install the signal handlers or restore the default handlers.
+ *
+ * The handlers are installed without SA_RESTART to interrupt the wait between
+ * two passes.
+ *
+ * \param Handler The function to call upon a signal or SIG_DFL.
+ */
+static void daemon_set_signals(void (*Handler)(int))
+{
+	struct sigaction sa;
+
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler=Handler;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGTERM,&sa,NULL);
+	sigaction(SIGINT,&sa,NULL);
+	sigaction(SIGHUP,&sa,NULL);
+}
+
+/*!
+ * Link the files of the daemon temporary directory into the directory
+ * where the reports are produced.
+ *
+ * The report generation deletes the files it processed. It only deletes its
+ * own links and the daemon keeps appending to its files.
+ *
+ * \param SrcDir The temporary directory of the daemon.
+ * \param DstDir The temporary directory of the reports.
+ */
+static void daemon_link_files(const char *SrcDir,const char *DstDir)
+{
+	DIR *dirp;
+	struct dirent *direntp;
+	struct stat st;
+	char SrcName[MAXLEN];
+	char DstName[MAXLEN];
+
+	if ((dirp=opendir(SrcDir))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),SrcDir,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((direntp=readdir(dirp))!=NULL) {
+		format_path(__FILE__, __LINE__, SrcName, sizeof(SrcName), "%s/%s", SrcDir, direntp->d_name);
+		if (lstat(SrcName,&st)==-1 || !S_ISREG(st.st_mode)) continue;
+		format_path(__FILE__, __LINE__, DstName, sizeof(DstName), "%s/%s", DstDir, direntp->d_name);
+		if (link(SrcName,DstName)==-1) {
+			debuga(__FILE__,__LINE__,_("Cannot link \"%s\" to \"%s\": %s\n"),SrcName,DstName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	closedir(dirp);
+}
+
+/*!
+ * Delete the report directory of the previous pass if the report of the
+ * current pass is written in another directory.
+ *
+ * It is called by the report process once the name of its report directory
+ * is known and before the index is built.
+ *
+ * \param ReportDir The directory of the report being produced.
+ */
+void daemon_replace_report(const char *ReportDir)
+{
+	if (!DaemonReportDir[0] || strcmp(DaemonReportDir,ReportDir)==0) return;
+	if (access(DaemonReportDir,R_OK)!=0) return;
+	if (debug)
+		debuga(__FILE__,__LINE__,_("Deleting the report \"%s\" of the previous pass\n"),DaemonReportDir);
+	unlinkdir(DaemonReportDir,false);
+	// the catalog is rebuilt without the deleted directory
+	lastlog_reset();
+}
+
+/*!
+ * Produce the reports from the data accumulated so far.
+ *
+ * The reports are produced in a child process so that the memory of the
+ * daemon is left untouched. The child sends the name of its report directory
+ * back through a pipe for the next pass to replace it.
+ *
+ * \param Filter The filtering parameters.
+ * \param Report The function producing the reports.
+ */
+static void daemon_report(struct ReadLogDataStruct *Filter,void (*Report)(struct ReadLogDataStruct *Filter))
+{
+	char ReportTmp[MAXLEN];
+	char ReportDir[MAXLEN];
+	int Pipe[2];
+	int len=0;
+	ssize_t nread;
+	pid_t pid;
+	int status;
+
+	format_path(__FILE__, __LINE__, ReportTmp, sizeof(ReportTmp), "%s/"DAEMON_REPORT_DIR, tmp);
+	if (access(ReportTmp,R_OK)==0)
+		unlinkdir(ReportTmp,false);
+
+	if (pipe(Pipe)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot create a pipe to produce the reports: %s\n"),strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fflush(NULL);
+	pid=fork();
+	if (pid==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot fork to produce the reports: %s\n"),strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (pid==0) {
+		close(Pipe[0]);
+		daemon_set_signals(SIG_DFL);
+		if (mkdir(ReportTmp,0700)==-1) {
+			debuga(__FILE__,__LINE__,_("Cannot create directory \"%s\": %s\n"),ReportTmp,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		daemon_link_files(tmp,ReportTmp);
+		strcpy(tmp,ReportTmp);
+		Report(Filter);
+		fflush(NULL);
+		if (!KeepTempLog)
+			unlinkdir(tmp,false);
+		len=strlen(outdirname);
+		if (write(Pipe[1],outdirname,len)!=len) {
+			debuga(__FILE__,__LINE__,_("Cannot send the name of the report directory to the daemon: %s\n"),strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		close(Pipe[1]);
+		exit(EXIT_SUCCESS);
+	}
+
+	close(Pipe[1]);
+	while ((nread=read(Pipe[0],ReportDir+len,sizeof(ReportDir)-1-len))!=0) {
+		if (nread==-1) {
+			if (errno==EINTR) continue;
+			debuga(__FILE__,__LINE__,_("Cannot read the name of the report directory: %s\n"),strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		len+=nread;
+		if (len>=sizeof(ReportDir)-1) break;
+	}
+	close(Pipe[0]);
+	ReportDir[len]='\0';
+
+	while (waitpid(pid,&status,0)==-1) {
+		if (errno!=EINTR) {
+			debuga(__FILE__,__LINE__,_("Failed to wait for the report process: %s\n"),strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+		debuga(__FILE__,__LINE__,_("The reports were not refreshed, the report process failed with status %d\n"),status);
+	else {
+		if (len>0) strcpy(DaemonReportDir,ReportDir);
+		if (debug)
+			debuga(__FILE__,__LINE__,_("Reports refreshed\n"));
+	}
+}
+
+/*!
+ * Keep reading the access logs and refresh the reports every
+ * \c daemon_interval seconds until a SIGTERM or SIGINT is received.
+ *
+ * A SIGHUP starts the next pass immediately.
+ *
+ * The function doesn't return.
+ *
+ * \param Filter The filtering parameters.
+ * \param Report The function producing the reports from the data read.
+ */
+void daemon_run(struct ReadLogDataStruct *Filter,void (*Report)(struct ReadLogDataStruct *Filter))
+{
+	time_t Next;
+	time_t Now;
+	unsigned long int LastRecords=0;
+	bool Refresh=true;
+
+	if (DaemonInterval<1) {
+		debuga(__FILE__,__LINE__,_("Invalid daemon_interval %d in the configuration file\n"),DaemonInterval);
+		exit(EXIT_FAILURE);
+	}
+	if (email[0]) {
+		debuga(__FILE__,__LINE__,_("The reports cannot be sent by email in daemon mode\n"));
+		exit(EXIT_FAILURE);
+	}
+	// the report of the period is refreshed in place
+	OverwriteReport=true;
+
+	daemon_set_signals(daemon_signal);
+	while (!DaemonStop) {
+		Next=time(NULL)+DaemonInterval;
+		DaemonRefresh=0;
+		if (!ReadLogFile(Filter)) {
+			if (debug) debuga(__FILE__,__LINE__,_("No records found\n"));
+		} else if (Refresh || records_kept!=LastRecords) {
+			// the report is left as is if no new record was read
+			daemon_report(Filter,Report);
+			LastRecords=records_kept;
+		}
+
+		while (!DaemonStop && !DaemonRefresh && (Now=time(NULL))<Next)
+			sleep((unsigned int)(Next-Now));
+		Refresh=(DaemonRefresh!=0);
+	}
+
+	if (debug)
+		debuga(__FILE__,__LINE__,_("End\n"));
+	exit(EXIT_SUCCESS);
+}
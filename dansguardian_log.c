@@ -26,30 +26,29 @@
 
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/eventlist.h"
+
+//! The accesses denied by DansGuardian.
+EventListObject dansguardian_events=NULL;
 
 void dansguardian_log(const struct ReadLogDataStruct *ReadFilter)
 {
-	FILE *fp_in = NULL, *fp_ou = NULL, *fp_guard = NULL;
+	FILE *fp_in = NULL, *fp_guard = NULL;
 	char buf[MAXLEN];
-	char guard_in[MAXLEN];
-	char guard_ou[MAXLEN];
 	char loglocation[MAXLEN] = "/var/log/dansguardian/access.log";
 	int year, mon, day;
 	int hour,min,sec;
 	char user[MAXLEN], code1[255], code2[255];
 	char ip[45];
 	char *url;
-	char tmp6[MAXLEN];
+	char rule[512];
 	int  idata=0;
-	int cstatus;
 	int dfrom, duntil;
 	struct getwordstruct gwarea;
+	struct tm t;
 
 	getperiod_torange(&period,&dfrom,&duntil);
 
-	format_path(__FILE__, __LINE__, guard_in, sizeof(guard_in), "%s/dansguardian.int_unsort", tmp);
-	format_path(__FILE__, __LINE__, guard_ou, sizeof(guard_ou), "%s/dansguardian.int_log", tmp);
-
 	if (access(DansGuardianConf, R_OK) != 0) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),DansGuardianConf,strerror(errno));
 		exit(EXIT_FAILURE);
@@ -60,11 +59,6 @@ void dansguardian_log(const struct ReadLogDataStruct *ReadFilter)
 		exit(EXIT_FAILURE);
 	}
 
-	if ((fp_ou=MY_FOPEN(guard_in,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
 	while(fgets(buf,sizeof(buf),fp_guard)!=NULL) {
 		fixendofline(buf);
 		if (buf[0]=='#')
@@ -93,6 +87,7 @@ void dansguardian_log(const struct ReadLogDataStruct *ReadFilter)
 		exit(EXIT_FAILURE);
 	}
 
+	dansguardian_events=EventList_Create("dansguardian",EVENTSORT_UserDateIp);
 	while(fgets(buf,sizeof(buf),fp_in) != NULL) {
 		if (strstr(buf," *DENIED* ") == 0)
 			continue;
@@ -145,7 +140,12 @@ void dansguardian_log(const struct ReadLogDataStruct *ReadFilter)
 			strcpy(user,ip);
 			ip[0]='\0';
 		}
-		fprintf(fp_ou,"%s\t%d\t%02d:%02d:%02d\t%s\t%s\t%s\t%s\n",user,idata,hour,min,sec,ip,url,code1,code2);
+		snprintf(rule,sizeof(rule),"%s\t%s",code1,code2);
+		computedate(year,mon,day,&t);
+		t.tm_hour=hour;
+		t.tm_min=min;
+		t.tm_sec=sec;
+		EventList_AddRule(dansguardian_events,&t,user,ip,url,rule);
 		dansguardian_count++;
 	}
 
@@ -153,27 +153,5 @@ void dansguardian_log(const struct ReadLogDataStruct *ReadFilter)
 		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),loglocation,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	if (fclose(fp_ou)==EOF) {
-		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	if (debug)
-		debuga(__FILE__,__LINE__,_("Sorting file \"%s\"\n"),guard_ou);
-
-	if (snprintf(tmp6, sizeof(tmp6), "sort -t \"\t\" -k 1,1 -k 2,2 -k 4,4 \"%s\" -o \"%s\"", guard_in, guard_ou) >= sizeof(tmp6)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"), guard_in, guard_ou);
-		debuga_more("sort -t \"\t\" -k 1,1 -k 2,2 -k 4,4 \"%s\" -o \"%s\"", guard_in, guard_ou);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(tmp6);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),tmp6);
-		exit(EXIT_FAILURE);
-	}
-	if (!KeepTempLog && unlink(guard_in)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Close(dansguardian_events);
 }
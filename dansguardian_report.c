@@ -26,6 +26,9 @@
 
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/eventlist.h"
+
+extern EventListObject dansguardian_events;
 
 static void show_ignored_dansguardian(FILE *fp_ou,int count)
 {
@@ -37,43 +40,33 @@ static void show_ignored_dansguardian(FILE *fp_ou,int count)
 
 void dansguardian_report(void)
 {
-	FILE *fp_in = NULL, *fp_ou = NULL;
+	FILE *fp_ou = NULL;
 
-	char buf[MAXLEN];
-	char *url;
-	char dansguardian_in[MAXLEN];
 	char report[MAXLEN];
 	char ip[MAXLEN];
-	char rule[255];
 	char oip[MAXLEN];
 	char user[MAXLEN];
 	char ouser[MAXLEN];
 	char date[15];
-	char date2[15];
-	char hour[15];
 	char ouser2[255];
 	int  z=0;
 	int  count=0;
-	struct getwordstruct gwarea;
+	struct EventStruct event;
 
 	ouser[0]='\0';
+	ouser2[0]='\0';
 
-	format_path(__FILE__, __LINE__, dansguardian_in, sizeof(dansguardian_in), "%s/dansguardian.int_log", tmp);
 	if (!dansguardian_count) {
-		if (!KeepTempLog && unlink(dansguardian_in))
-			debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),dansguardian_in,strerror(errno));
+		EventList_Destroy(&dansguardian_events);
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Dansguardian report not generated because it is empty\n"));
 		return;
 	}
 
 	format_path(__FILE__, __LINE__, report, sizeof(report), "%s/dansguardian.html", outdirname);
 
-	if ((fp_in=MY_FOPEN(dansguardian_in,"r"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),dansguardian_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Sort(dansguardian_events);
 
-	if ((fp_ou=MY_FOPEN(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -88,39 +81,14 @@ void dansguardian_report(void)
 	fputs("<div class=\"report\"><table cellpadding=\"1\" cellspacing=\"2\">\n",fp_ou);
 	fprintf(fp_ou,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("IP/NAME"),_("DATE/TIME"),_("ACCESSED SITE"),_("CAUSE"));
 
-	while(fgets(buf,sizeof(buf),fp_in)!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(user,sizeof(user),&gwarea,'\t')<0 || getword(date2,sizeof(date2),&gwarea,'\t')<0 ||
-		    getword(hour,sizeof(hour),&gwarea,'\t')<0 || getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),dansguardian_in);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),dansguardian_in);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(rule,sizeof(rule),&gwarea,'\n')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid rule in file \"%s\"\n"),dansguardian_in);
-			exit(EXIT_FAILURE);
-		}
+	while (EventList_Read(dansguardian_events,&event)) {
+		safe_strcpy(user,(UserIp) ? event.Ip : event.User,sizeof(user));
+		safe_strcpy(ip,event.Ip,sizeof(ip));
 
-		if (UserIp)
-			strcpy(user,ip);
-
-		memset(date,0,sizeof(date));
-		if (df!='u') {
-			strncpy(date,date2+6,2);
-			strcat(date,"/");
-			strncat(date,date2+4,2);
-			strcat(date,"/");
-			strncat(date,date2,4);
-		} else {
-			strncpy(date,date2+4,2);
-			strcat(date,"/");
-			strncat(date,date2+6,2);
-			strcat(date,"/");
-			strncat(date,date2,4);
-		}
+		if (df!='u')
+			snprintf(date,sizeof(date),"%02d/%02d/%04d",event.Day,event.Month,event.Year);
+		else
+			snprintf(date,sizeof(date),"%02d/%02d/%04d",event.Month,event.Day,event.Year);
 
 		if (Ip2Name)
 			ip2name(ip,sizeof(ip));
@@ -155,13 +123,9 @@ void dansguardian_report(void)
 				continue;
 		}
 
-		fprintf(fp_ou,"<tr><td class=\"data2\">%s</td><td class=\"data2\">%s</td><td class=\"data2\">%s-%s</td><td class=\"data2\">",name,ip,date,hour);
-		output_html_link(fp_ou,url,100);
-		fprintf(fp_ou,"</td><td class=\"data2\">%s</td></tr>\n",rule);
-	}
-	if (fclose(fp_in)==EOF) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),dansguardian_in,strerror(errno));
-		exit(EXIT_FAILURE);
+		fprintf(fp_ou,"<tr><td class=\"data2\">%s</td><td class=\"data2\">%s</td><td class=\"data2\">%s-%s</td><td class=\"data2\">",name,ip,date,event.Time);
+		output_html_link(fp_ou,event.Url,100);
+		fprintf(fp_ou,"</td><td class=\"data2\">%s</td></tr>\n",event.Rule);
 	}
 
 	if (count>DansGuardianReportLimit && DansGuardianReportLimit>0)
@@ -174,10 +138,7 @@ void dansguardian_report(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(dansguardian_in)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),dansguardian_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Destroy(&dansguardian_events);
 
 	return;
 }
@@ -35,6 +35,12 @@
 #ifdef HAVE_LZMA_H
 #include "lzma.h"
 #endif
+#ifdef HAVE_ZSTD_H
+#include "zstd.h"
+#endif
+#ifdef HAVE_LZ4FRAME_H
+#include "lz4frame.h"
+#endif
 
 #ifdef HAVE_ZLIB_H
 /*!
@@ -73,6 +79,18 @@ static void Gzip_Rewind(void *Data)
 	gzrewind((gzFile)Data);
 }
 
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int Gzip_Offset(void *Data)
+{
+	return((long long int)gzoffset((gzFile)Data));
+}
+
 /*!
  * Close the file.
  *
@@ -137,6 +155,7 @@ static FileObject *Gzip_Open(int fd)
 	File->Eof=Gzip_Eof;
 	File->Rewind=Gzip_Rewind;
 	File->Close=Gzip_Close;
+	File->Offset=Gzip_Offset;
 	return(File);
 }
 #endif
@@ -211,6 +230,19 @@ static void Bzip_Rewind(void *Data)
 	BData->Eof=false;
 }
 
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int Bzip_Offset(void *Data)
+{
+	struct BzlibInternalFile *BData=(struct BzlibInternalFile *)Data;
+	return((long long int)ftello(BData->File));
+}
+
 /*!
  * Close the file.
  *
@@ -276,6 +308,7 @@ static FileObject *Bzip_Open(int fd)
 	File->Eof=Bzip_Eof;
 	File->Rewind=Bzip_Rewind;
 	File->Close=Bzip_Close;
+	File->Offset=Bzip_Offset;
 	return(File);
 }
 #endif
@@ -286,8 +319,10 @@ struct LzmaInternalFile
 {
 	//! Lzma stream.
 	lzma_stream Stream;
-	//! \c True if end of file is reached.
+	//! \c True if the end of the decompressed data is reached.
 	bool Eof;
+	//! \c True if the whole compressed file was read.
+	bool InputEof;
 	//! Original file in case a rewind is necessary.
 	FILE *File;
 	//! Input buffer to store data read from the log file.
@@ -312,18 +347,27 @@ static int Lzma_Read(void *Data,void *Buffer,int Size)
 	BData->Stream.avail_out=Size;
 	while (BData->Stream.avail_out>0 && !BData->Eof)
 	{
-		if (BData->Stream.avail_in==0 && !BData->Eof)
+		if (BData->Stream.avail_in==0 && !BData->InputEof)
 		{
 			BData->Stream.next_in=BData->InputBuffer;
 			BData->Stream.avail_in=fread(BData->InputBuffer,1,sizeof(BData->InputBuffer),BData->File);
 			if (feof(BData->File))
-				BData->Eof=true;
+				BData->InputEof=true;
 		}
-		zerr=lzma_code(&BData->Stream,(BData->Eof) ? LZMA_FINISH : LZMA_RUN);
+		/*
+		 * The decoder may still have data to output after the whole input was read.
+		 * Only the end of the stream marks the end of the decompressed data.
+		 */
+		zerr=lzma_code(&BData->Stream,(BData->InputEof) ? LZMA_FINISH : LZMA_RUN);
 		if (zerr==LZMA_STREAM_END)
 		{
 			BData->Eof=true;
 		}
+		else if (zerr==LZMA_BUF_ERROR && BData->InputEof)
+		{
+			debuga(__FILE__,__LINE__,_("Truncated xz file\n"));
+			BData->Eof=true;
+		}
 		else if (zerr!=LZMA_OK)
 		{
 			debuga(__FILE__,__LINE__,_("Error decompressiong xz file (lzma library returned error %d)"),zerr);
@@ -394,6 +438,7 @@ static void Lzma_Rewind(void *Data)
 
 	rewind(BData->File);
 	BData->Eof=false;
+	BData->InputEof=false;
 	memset(&BData->Stream,0,sizeof(BData->Stream));
 	if (Lzma_InitDecoder(&BData->Stream)<0)
 	{
@@ -402,6 +447,19 @@ static void Lzma_Rewind(void *Data)
 	}
 }
 
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int Lzma_Offset(void *Data)
+{
+	struct LzmaInternalFile *BData=(struct LzmaInternalFile *)Data;
+	return((long long int)ftello(BData->File));
+}
+
 /*!
  * Close the file.
  *
@@ -463,27 +521,783 @@ static FileObject *Lzma_Open(int fd)
 	File->Eof=Lzma_Eof;
 	File->Rewind=Lzma_Rewind;
 	File->Close=Lzma_Close;
+	File->Offset=Lzma_Offset;
 	return(File);
 }
 #endif
 
+#ifdef HAVE_ZSTD_H
+
+struct ZstdInternalFile
+{
+	//! Zstd decompression context.
+	ZSTD_DCtx *Ctx;
+	//! The compressed data not decoded yet.
+	ZSTD_inBuffer Input;
+	//! The last hint returned by the decoder. It is 0 when a frame is complete.
+	size_t LastHint;
+	//! \c True if the end of the decompressed data is reached.
+	bool Eof;
+	//! \c True if the whole compressed file was read.
+	bool InputEof;
+	//! Original file in case a rewind is necessary.
+	FILE *File;
+	//! Input buffer to store data read from the log file.
+	unsigned char InputBuffer[128*1024];
+};
+
+/*!
+ * Read from zstd file.
+ *
+ * A file made of several frames, such as the one produced by the seekable
+ * format, is decoded as the concatenation of its frames.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int Zstd_Read(void *Data,void *Buffer,int Size)
+{
+	struct ZstdInternalFile *ZData=(struct ZstdInternalFile *)Data;
+	ZSTD_outBuffer Output;
+	size_t Hint;
+
+	Output.dst=Buffer;
+	Output.size=Size;
+	Output.pos=0;
+	while (Output.pos<Output.size && !ZData->Eof)
+	{
+		if (ZData->Input.pos>=ZData->Input.size && !ZData->InputEof)
+		{
+			ZData->Input.src=ZData->InputBuffer;
+			ZData->Input.size=fread(ZData->InputBuffer,1,sizeof(ZData->InputBuffer),ZData->File);
+			ZData->Input.pos=0;
+			if (feof(ZData->File))
+				ZData->InputEof=true;
+		}
+		Hint=ZSTD_decompressStream(ZData->Ctx,&Output,&ZData->Input);
+		if (ZSTD_isError(Hint))
+		{
+			debuga(__FILE__,__LINE__,_("Error decompressing zstd file (zstd library returned error: %s)\n"),ZSTD_getErrorName(Hint));
+			ZData->Eof=true;
+			break;
+		}
+		ZData->LastHint=Hint;
+		// the decoder can't produce more data once the whole input is consumed and the output isn't full
+		if (ZData->InputEof && ZData->Input.pos>=ZData->Input.size && Output.pos<Output.size)
+		{
+			if (Hint!=0)
+				debuga(__FILE__,__LINE__,_("Truncated zstd file\n"));
+			ZData->Eof=true;
+		}
+	}
+	return(Output.pos);
+}
+
+/*!
+ * Check if end of file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int Zstd_Eof(void *Data)
+{
+	struct ZstdInternalFile *ZData=(struct ZstdInternalFile *)Data;
+	return(ZData->Eof);
+}
+
+/*!
+ * Return to the beginnig of the file.
+ *
+ * \param Data The file object.
+ */
+static void Zstd_Rewind(void *Data)
+{
+	struct ZstdInternalFile *ZData=(struct ZstdInternalFile *)Data;
+
+	rewind(ZData->File);
+	ZSTD_DCtx_reset(ZData->Ctx,ZSTD_reset_session_only);
+	ZData->Input.src=ZData->InputBuffer;
+	ZData->Input.size=0;
+	ZData->Input.pos=0;
+	ZData->LastHint=0;
+	ZData->Eof=false;
+	ZData->InputEof=false;
+}
+
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int Zstd_Offset(void *Data)
+{
+	struct ZstdInternalFile *ZData=(struct ZstdInternalFile *)Data;
+	return((long long int)ftello(ZData->File));
+}
+
+/*!
+ * Close the file.
+ *
+ * \param Data File to close.
+ *
+ * \return 0 on success or -1 on error.
+ */
+static int Zstd_Close(void *Data)
+{
+	struct ZstdInternalFile *ZData=(struct ZstdInternalFile *)Data;
+
+	fclose(ZData->File);
+	ZSTD_freeDCtx(ZData->Ctx);
+	free(ZData);
+	return(0);
+}
+
+/*!
+ * Open a file object to read from a zstd file.
+ *
+ * \return The object to pass to other function in this module.
+ */
+static FileObject *Zstd_Open(int fd)
+{
+	FileObject *File;
+	struct ZstdInternalFile *ZData;
+
+	FileObject_SetLastOpenError(NULL);
+	File=calloc(1,sizeof(*File));
+	if (!File)
+	{
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	ZData=calloc(1,sizeof(*ZData));
+	if (!ZData)
+	{
+		free(File);
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	ZData->Ctx=ZSTD_createDCtx();
+	if (!ZData->Ctx)
+	{
+		free(ZData);
+		free(File);
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	ZData->File=fdopen(fd,"rb");
+	if (ZData->File==NULL)
+	{
+		ZSTD_freeDCtx(ZData->Ctx);
+		free(ZData);
+		free(File);
+		FileObject_SetLastOpenError(_("Error duplicating file descriptor"));
+		return(NULL);
+	}
+	ZData->Input.src=ZData->InputBuffer;
+	File->Data=ZData;
+	File->Read=Zstd_Read;
+	File->Eof=Zstd_Eof;
+	File->Rewind=Zstd_Rewind;
+	File->Close=Zstd_Close;
+	File->Offset=Zstd_Offset;
+	return(File);
+}
+#endif
+
+#ifdef HAVE_LZ4FRAME_H
+
+struct Lz4InternalFile
+{
+	//! Lz4 decompression context.
+	LZ4F_dctx *Ctx;
+	//! Position of the first byte not decoded yet in the input buffer.
+	size_t InputPos;
+	//! Number of bytes stored in the input buffer.
+	size_t InputSize;
+	//! The last hint returned by the decoder. It is 0 when a frame is complete.
+	size_t LastHint;
+	//! \c True if the end of the decompressed data is reached.
+	bool Eof;
+	//! \c True if the whole compressed file was read.
+	bool InputEof;
+	//! Original file in case a rewind is necessary.
+	FILE *File;
+	//! Input buffer to store data read from the log file.
+	unsigned char InputBuffer[128*1024];
+};
+
+/*!
+ * Read from lz4 file.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int Lz4_Read(void *Data,void *Buffer,int Size)
+{
+	struct Lz4InternalFile *LData=(struct Lz4InternalFile *)Data;
+	size_t OutPos=0;
+	size_t OutSize;
+	size_t InSize;
+	size_t Hint;
+
+	while (OutPos<(size_t)Size && !LData->Eof)
+	{
+		if (LData->InputPos>=LData->InputSize && !LData->InputEof)
+		{
+			LData->InputSize=fread(LData->InputBuffer,1,sizeof(LData->InputBuffer),LData->File);
+			LData->InputPos=0;
+			if (feof(LData->File))
+				LData->InputEof=true;
+		}
+		OutSize=Size-OutPos;
+		InSize=LData->InputSize-LData->InputPos;
+		Hint=LZ4F_decompress(LData->Ctx,(char *)Buffer+OutPos,&OutSize,LData->InputBuffer+LData->InputPos,&InSize,NULL);
+		if (LZ4F_isError(Hint))
+		{
+			debuga(__FILE__,__LINE__,_("Error decompressing lz4 file (lz4 library returned error: %s)\n"),LZ4F_getErrorName(Hint));
+			LData->Eof=true;
+			break;
+		}
+		LData->LastHint=Hint;
+		LData->InputPos+=InSize;
+		OutPos+=OutSize;
+		// the decoder can't produce more data once the whole input is consumed and the output isn't full
+		if (LData->InputEof && LData->InputPos>=LData->InputSize && OutPos<(size_t)Size)
+		{
+			if (Hint!=0)
+				debuga(__FILE__,__LINE__,_("Truncated lz4 file\n"));
+			LData->Eof=true;
+		}
+	}
+	return(OutPos);
+}
+
+/*!
+ * Check if end of file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int Lz4_Eof(void *Data)
+{
+	struct Lz4InternalFile *LData=(struct Lz4InternalFile *)Data;
+	return(LData->Eof);
+}
+
+/*!
+ * Return to the beginnig of the file.
+ *
+ * \param Data The file object.
+ */
+static void Lz4_Rewind(void *Data)
+{
+	struct Lz4InternalFile *LData=(struct Lz4InternalFile *)Data;
+
+	rewind(LData->File);
+	LZ4F_freeDecompressionContext(LData->Ctx);
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&LData->Ctx,LZ4F_VERSION)))
+	{
+		debuga(__FILE__,__LINE__,_("Cannot rewind lz4 file\n"));
+		exit(EXIT_FAILURE);
+	}
+	LData->InputPos=0;
+	LData->InputSize=0;
+	LData->LastHint=0;
+	LData->Eof=false;
+	LData->InputEof=false;
+}
+
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int Lz4_Offset(void *Data)
+{
+	struct Lz4InternalFile *LData=(struct Lz4InternalFile *)Data;
+	return((long long int)ftello(LData->File));
+}
+
+/*!
+ * Close the file.
+ *
+ * \param Data File to close.
+ *
+ * \return 0 on success or -1 on error.
+ */
+static int Lz4_Close(void *Data)
+{
+	struct Lz4InternalFile *LData=(struct Lz4InternalFile *)Data;
+
+	fclose(LData->File);
+	LZ4F_freeDecompressionContext(LData->Ctx);
+	free(LData);
+	return(0);
+}
+
+/*!
+ * Open a file object to read from a lz4 file.
+ *
+ * \return The object to pass to other function in this module.
+ */
+static FileObject *Lz4_Open(int fd)
+{
+	FileObject *File;
+	struct Lz4InternalFile *LData;
+
+	FileObject_SetLastOpenError(NULL);
+	File=calloc(1,sizeof(*File));
+	if (!File)
+	{
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	LData=calloc(1,sizeof(*LData));
+	if (!LData)
+	{
+		free(File);
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	if (LZ4F_isError(LZ4F_createDecompressionContext(&LData->Ctx,LZ4F_VERSION)))
+	{
+		free(LData);
+		free(File);
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	LData->File=fdopen(fd,"rb");
+	if (LData->File==NULL)
+	{
+		LZ4F_freeDecompressionContext(LData->Ctx);
+		free(LData);
+		free(File);
+		FileObject_SetLastOpenError(_("Error duplicating file descriptor"));
+		return(NULL);
+	}
+	File->Data=LData;
+	File->Read=Lz4_Read;
+	File->Eof=Lz4_Eof;
+	File->Rewind=Lz4_Rewind;
+	File->Close=Lz4_Close;
+	File->Offset=Lz4_Offset;
+	return(File);
+}
+#endif
+
+
+#ifdef HAVE_FORK
+//! The size of the buffer the decompression process fills before sending it to the parser.
+#define READAHEAD_BUFFER_SIZE (256*1024)
+//! The size requested for the pipe between the decompression process and the parser.
+#define READAHEAD_PIPE_SIZE (1024*1024)
+
+//! Data of a compressed file decompressed ahead of the parser by a child process.
+struct ReadAheadStruct
+{
+	//! The file object decompressing the file in the child process.
+	FileObject *Inner;
+	//! The name of the file for the messages.
+	char *FileName;
+	//! The size of the compressed file or -1 if it is unknown.
+	long long int CompressedSize;
+	//! The descriptor of the compressed file shared with the child process.
+	int Fd;
+	//! The end of the pipe the decompressed data are read from.
+	int Pipe;
+	//! The process decompressing the file or 0 if it isn't running.
+	pid_t Pid;
+	//! \c True if the end of the decompressed data was read.
+	bool Eof;
+};
+
+/*!
+ * Decompress the whole file in the child process and send the data
+ * to the parent through the pipe.
+ *
+ * This function doesn't return.
+ *
+ * \param RData The read ahead data.
+ * \param Output The end of the pipe to write the data to.
+ */
+static void ReadAhead_Child(struct ReadAheadStruct *RData,int Output)
+{
+	char *Buffer;
+	int nread;
+	int nwritten;
+	int pos;
+	long long int Total=0;
+	struct timeval Start,End;
+	double Elapsed;
+
+	Buffer=malloc(READAHEAD_BUFFER_SIZE);
+	if (!Buffer) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to decompress file \"%s\"\n"),RData->FileName);
+		_exit(EXIT_FAILURE);
+	}
+	gettimeofday(&Start,NULL);
+	while ((nread=FileObject_Read(RData->Inner,Buffer,READAHEAD_BUFFER_SIZE))>0) {
+		for (pos=0 ; pos<nread ; pos+=nwritten) {
+			nwritten=write(Output,Buffer+pos,nread-pos);
+			if (nwritten<0) {
+				if (errno==EINTR) {
+					nwritten=0;
+					continue;
+				}
+				// the parent stopped reading the file
+				if (errno==EPIPE) _exit(EXIT_SUCCESS);
+				debuga(__FILE__,__LINE__,_("Cannot send the decompressed data of file \"%s\": %s\n"),RData->FileName,strerror(errno));
+				_exit(EXIT_FAILURE);
+			}
+		}
+		Total+=nread;
+	}
+	gettimeofday(&End,NULL);
+	free(Buffer);
+	if (nread<0 || FileObject_Close(RData->Inner)) {
+		debuga(__FILE__,__LINE__,_("Error while decompressing file \"%s\": %s\n"),RData->FileName,
+			   (nread<0) ? strerror(errno) : FileObject_GetLastCloseError());
+		_exit(EXIT_FAILURE);
+	}
+	if (debugz>=LogLevel_Process) {
+		Elapsed=(End.tv_sec-Start.tv_sec)+(End.tv_usec-Start.tv_usec)/1000000.;
+		if (Elapsed<=0.) Elapsed=0.000001;
+		/* TRANSLATORS: The first %lld is the number of decompressed bytes, the second %lld is the size of the
+		 compressed file, %.3f is the time in seconds and %.1f is the throughput in MB/s. */
+		debugaz(__FILE__,__LINE__,_("Decompressed %lld bytes from %lld bytes of \"%s\" in %.3f seconds (%.1f MB/s)\n"),
+				Total,RData->CompressedSize,RData->FileName,Elapsed,(double)Total/(1024.*1024.)/Elapsed);
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*!
+ * Start the process decompressing the file.
+ *
+ * \param RData The read ahead data.
+ *
+ * \return \c False if the process couldn't be started.
+ */
+static bool ReadAhead_Start(struct ReadAheadStruct *RData)
+{
+	int Pipe[2];
+	pid_t Pid;
+
+	if (pipe(Pipe)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot create a pipe to decompress file \"%s\": %s\n"),RData->FileName,strerror(errno));
+		return(false);
+	}
+#ifdef F_SETPIPE_SZ
+	// a larger pipe lets the child decompress further ahead of the parser
+	fcntl(Pipe[1],F_SETPIPE_SZ,READAHEAD_PIPE_SIZE);
+#endif
+	// don't let the child flush the pending output of the parent a second time
+	fflush(NULL);
+	Pid=fork();
+	if (Pid==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot start a process to decompress file \"%s\": %s\n"),RData->FileName,strerror(errno));
+		close(Pipe[0]);
+		close(Pipe[1]);
+		return(false);
+	}
+	if (Pid==0) {
+		close(Pipe[0]);
+		ReadAhead_Child(RData,Pipe[1]);
+	}
+	close(Pipe[1]);
+	RData->Pipe=Pipe[0];
+	RData->Pid=Pid;
+	RData->Eof=false;
+	return(true);
+}
+
+/*!
+ * Stop the decompression process and check how it terminated.
+ *
+ * \param RData The read ahead data.
+ *
+ * \return 0 on success or -1 if the decompression failed.
+ */
+static int ReadAhead_Stop(struct ReadAheadStruct *RData)
+{
+	int RetCode=0;
+	int Status;
+	bool Killed=false;
+
+	if (RData->Pid==0) return(0);
+	if (!RData->Eof) {
+		kill(RData->Pid,SIGKILL);
+		Killed=true;
+	}
+	close(RData->Pipe);
+	RData->Pipe=-1;
+	while (waitpid(RData->Pid,&Status,0)==-1) {
+		if (errno==EINTR) continue;
+		debuga(__FILE__,__LINE__,_("Failed to wait for the process decompressing file \"%s\": %s\n"),RData->FileName,strerror(errno));
+		Status=1;
+		break;
+	}
+	RData->Pid=0;
+	if (!Killed && (!WIFEXITED(Status) || WEXITSTATUS(Status)!=EXIT_SUCCESS)) {
+		FileObject_SetLastCloseError(_("The decompression process failed"));
+		RetCode=-1;
+	}
+	return(RetCode);
+}
+
+/*!
+ * Read the data decompressed by the child process.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int ReadAhead_Read(void *Data,void *Buffer,int Size)
+{
+	struct ReadAheadStruct *RData=(struct ReadAheadStruct *)Data;
+	ssize_t nread;
+
+	if (RData->Eof) return(0);
+	while ((nread=read(RData->Pipe,Buffer,Size))==-1) {
+		if (errno!=EINTR) {
+			debuga(__FILE__,__LINE__,_("Cannot read the decompressed data of file \"%s\": %s\n"),RData->FileName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (nread==0) RData->Eof=true;
+	return((int)nread);
+}
+
+/*!
+ * Check if end of file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int ReadAhead_Eof(void *Data)
+{
+	struct ReadAheadStruct *RData=(struct ReadAheadStruct *)Data;
+	return(RData->Eof);
+}
+
+/*!
+ * Return to the beginnig of the file.
+ *
+ * The decompression process is stopped and a new one is started
+ * from the beginning of the file.
+ *
+ * \param Data The file object.
+ */
+static void ReadAhead_Rewind(void *Data)
+{
+	struct ReadAheadStruct *RData=(struct ReadAheadStruct *)Data;
+
+	ReadAhead_Stop(RData);
+	// the parent never read from the inner file so rewinding it only moves the shared descriptor back
+	FileObject_Rewind(RData->Inner);
+	if (!ReadAhead_Start(RData)) {
+		debuga(__FILE__,__LINE__,_("Cannot rewind file \"%s\"\n"),RData->FileName);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * The child process shares the file descriptor so its position tells how
+ * far the decompression progressed. It is slightly ahead of the parser.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int ReadAhead_Offset(void *Data)
+{
+	struct ReadAheadStruct *RData=(struct ReadAheadStruct *)Data;
+	return((long long int)lseek(RData->Fd,0,SEEK_CUR));
+}
+
+/*!
+ * Close the file.
+ *
+ * \param Data File to close.
+ *
+ * \return 0 on success or -1 on error.
+ */
+static int ReadAhead_Close(void *Data)
+{
+	struct ReadAheadStruct *RData=(struct ReadAheadStruct *)Data;
+	int RetCode;
+
+	/*
+	 * The decompression errors are reported by the child. Closing the
+	 * unused inner object only releases the resources held by the parent.
+	 */
+	FileObject_Close(RData->Inner);
+	RetCode=ReadAhead_Stop(RData);
+	free(RData->FileName);
+	free(RData);
+	return(RetCode);
+}
+
+/*!
+ * Decompress a file in a child process running ahead of the parser.
+ *
+ * The parser then only waits for the decompression if it consumes the data
+ * faster than they are produced.
+ *
+ * \param FileName The name of the file for the messages.
+ * \param fd The descriptor of the compressed file.
+ * \param Inner The file object decompressing the file.
+ *
+ * \return The object to pass to other function in this module. If the
+ * child process can't be started, \a Inner is returned and the file is
+ * decompressed by the calling process.
+ */
+static FileObject *ReadAhead_Open(const char *FileName,int fd,FileObject *Inner)
+{
+	FileObject *File;
+	struct ReadAheadStruct *RData;
+	struct stat st;
+
+	File=calloc(1,sizeof(*File));
+	if (!File)
+		return(Inner);
+	RData=calloc(1,sizeof(*RData));
+	if (!RData) {
+		free(File);
+		return(Inner);
+	}
+	RData->FileName=strdup(FileName);
+	if (!RData->FileName) {
+		free(RData);
+		free(File);
+		return(Inner);
+	}
+	RData->Inner=Inner;
+	RData->Fd=fd;
+	RData->CompressedSize=(fstat(fd,&st)==0) ? (long long int)st.st_size : -1LL;
+	RData->Pipe=-1;
+	if (!ReadAhead_Start(RData)) {
+		free(RData->FileName);
+		free(RData);
+		free(File);
+		return(Inner);
+	}
+	File->Data=RData;
+	File->Read=ReadAhead_Read;
+	File->Eof=ReadAhead_Eof;
+	File->Rewind=ReadAhead_Rewind;
+	File->Close=ReadAhead_Close;
+	File->Offset=ReadAhead_Offset;
+	return(File);
+}
+#endif
+
+/*!
+ * Decompress a file opened by another module in a child process running
+ * ahead of the parser.
+ *
+ * \param arq The name of the file for the messages.
+ * \param fd The descriptor of the compressed file.
+ * \param fi The file object decompressing the file.
+ *
+ * \return The object to read the decompressed data from.
+ */
+FileObject *decomp_readahead(const char *arq,int fd,FileObject *fi)
+{
+#ifdef HAVE_FORK
+	if (fi)
+		fi=ReadAhead_Open(arq,fd,fi);
+#endif
+	return(fi);
+}
+
+/*!
+Find the end of the last complete line of a plain file.
+
+\param arq The name of the file for the error messages.
+\param fd The file to search.
+
+\return The offset of the byte following the last end of line or 0
+if the file contains no complete line.
+*/
+static long long int decomp_last_line_end(const char *arq,int fd)
+{
+	char buf[4096];
+	struct stat st;
+	long long int Pos;
+	ssize_t nread;
+	int i;
+
+	if (fstat(fd,&st)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot get the size of file \"%s\": %s\n"),arq,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	Pos=(long long int)st.st_size;
+	while (Pos>0) {
+		nread=(Pos>(long long int)sizeof(buf)) ? (ssize_t)sizeof(buf) : (ssize_t)Pos;
+		Pos-=nread;
+		if (pread(fd,buf,nread,(off_t)Pos)!=nread) {
+			debuga(__FILE__,__LINE__,_("Error while reading \"%s\": %s\n"),arq,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		for (i=nread-1 ; i>=0 ; i--)
+			if (buf[i]=='\n') return(Pos+i+1);
+	}
+	return(0);
+}
 
 /*!
 Open the log file. If it is compressed, uncompress it with the proper library.
 
-Log files compressed with gzip, bzip2 can be uncompressed if sarg is compiled with
-the proper library.
+Log files compressed with gzip, bzip2, xz, zstd or lz4 can be uncompressed if sarg is compiled with
+the proper library. The decompression runs in a child process ahead of the
+parser when the system can fork.
 
 If the log file does not exist, the process terminates with an error message.
 
 \param arq The log file to process.
 */
 FileObject *decomp(const char *arq)
+{
+	return(decomp_range(arq,0,NULL));
+}
+
+/*!
+Open the log file to read only a part of it if it isn't compressed.
+
+It is used to read the lines appended to a log since it was last read.
+
+\param arq The log file to process.
+\param Start The offset of the first byte to read from a plain file.
+\param End If it isn't NULL, it points to the offset of the byte following
+the last one to read from a plain file. If the offset is negative, the file is
+read up to the end of its last complete line. The variable receives the offset
+following the last byte that will be read or -1 if the file is compressed in which
+case it is read whole regardless of \a Start.
+*/
+FileObject *decomp_range(const char *arq,long long int Start,long long int *End)
 {
 	int fd;
 	FileObject *fi;
 	unsigned char buf[5];
 	ssize_t nread;
+	bool compressed=true;
 
 	// guess file type
 	fd=open(arq,O_RDONLY | O_LARGEFILE);
@@ -530,6 +1344,24 @@ FileObject *decomp(const char *arq)
 #else
 		debuga(__FILE__,__LINE__,_("Sarg was not compiled with xz support to read file \"%s\"\n"),arq);
 		exit(EXIT_FAILURE);
+#endif
+	}
+	else if (buf[0]==0x28 && buf[1]==0xB5 && buf[2]==0x2F && buf[3]==0xFD)//zstd file
+	{
+#ifdef HAVE_ZSTD_H
+		fi=Zstd_Open(fd);
+#else
+		debuga(__FILE__,__LINE__,_("Sarg was not compiled with zstd support to read file \"%s\"\n"),arq);
+		exit(EXIT_FAILURE);
+#endif
+	}
+	else if (buf[0]==0x04 && buf[1]==0x22 && buf[2]==0x4D && buf[3]==0x18)//lz4 file
+	{
+#ifdef HAVE_LZ4FRAME_H
+		fi=Lz4_Open(fd);
+#else
+		debuga(__FILE__,__LINE__,_("Sarg was not compiled with lz4 support to read file \"%s\"\n"),arq);
+		exit(EXIT_FAILURE);
 #endif
 	}
 	else if (buf[0]==0x1F && (buf[1]==0x9D || buf[1]==0xA0))//LZW and LZH compressed file
@@ -543,7 +1375,18 @@ FileObject *decomp(const char *arq)
 	}
 	else //normal file
 	{
-		fi=FileObject_FdOpen(fd);
+		if (End) {
+			if (*End<0) *End=decomp_last_line_end(arq,fd);
+			fi=FileObject_FdOpenRange(fd,Start,*End);
+		} else {
+			fi=FileObject_FdOpen(fd);
+		}
+		compressed=false;
 	}
+	if (compressed && End) *End=-1;
+#ifdef HAVE_FORK
+	if (compressed && fi)
+		fi=ReadAhead_Open(arq,fd,fi);
+#endif
 	return(fi);
 }
@@ -27,21 +27,19 @@
 #include "include/conf.h"
 #include "include/defs.h"
 #include "include/readlog.h"
+#include "include/eventlist.h"
 
-//! Name of the file containing the unsorted denied entries.
-static char denied_unsort[MAXLEN]="";
-//! The file handle to write the entries.
-static FILE *fp_denied=NULL;
+//! The denied entries.
+static EventListObject denied_events=NULL;
 //! \c True if at least one denied entry exists.
 static bool denied_exists=false;
 
 /*!
-Open a file to store the denied accesses.
-
-\return The file handle or NULL if no file is necessary.
+Prepare the list to store the denied accesses.
 */
 void denied_open(void)
 {
+	if (denied_events) return;
 	if ((ReportType & REPORT_TYPE_DENIED) == 0) {
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Denied report not produced as it is not requested\n"));
 		return;
@@ -51,42 +49,30 @@ void denied_open(void)
 		return;
 	}
 
-	format_path(__FILE__, __LINE__, denied_unsort, sizeof(denied_unsort), "%s/denied.int_unsort", tmp);
-	if ((fp_denied=MY_FOPEN(denied_unsort,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),denied_unsort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	denied_events=EventList_Create("denied",EVENTSORT_UserUrl);
 	return;
 }
 
 /*!
-Write one entry in the unsorted denied file provided that it is required.
+Store one denied entry provided that it is required.
 
-\param log_entry The entry to write into the log file.
+\param log_entry The entry to store.
 */
 void denied_write(const struct ReadLogStruct *log_entry)
 {
-	char date[80];
-
-	if (fp_denied && strstr(log_entry->HttpCode,"DENIED/403") != 0) {
-		strftime(date,sizeof(date),"%d/%m/%Y\t%H:%M:%S",&log_entry->EntryTime);
-		fprintf(fp_denied, "%s\t%s\t%s\t%s\n",date,log_entry->User,log_entry->Ip,log_entry->Url);
+	if (denied_events && strstr(log_entry->HttpCode,"DENIED/403") != 0) {
+		EventList_Add(denied_events,&log_entry->EntryTime,log_entry->User,log_entry->Ip,log_entry->Url);
 		denied_exists=true;
 	}
 }
 
 /*!
-Close the file opened by denied_open().
+Stop storing the denied entries.
 */
 void denied_close(void)
 {
-	if (fp_denied) {
-		if (fclose(fp_denied)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),denied_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_denied=NULL;
-	}
+	if (denied_events)
+		EventList_Close(denied_events);
 }
 
 /*!
@@ -113,69 +99,33 @@ Generate a report containing the denied accesses.
 */
 void gen_denied_report(void)
 {
-	FileObject *fp_in = NULL;
 	FILE *fp_ou = NULL;
 
-	char *buf;
-	char *url;
-	char denied_sort[MAXLEN];
 	char report[MAXLEN];
-	char ip[MAXLEN];
 	char oip[MAXLEN];
-	char user[MAXLEN];
 	char ouser[MAXLEN]="";
 	char ouser2[MAXLEN]="";
 	char data[15];
-	char hora[15];
-	char csort[4098];
 	bool z=false;
 	int  count=0;
-	int day,month,year;
-	int cstatus;
 	bool new_user;
-	struct getwordstruct gwarea;
-	longline line;
+	struct EventStruct event;
 	struct userinfostruct *uinfo;
 	struct tm t;
 
 	if (!denied_exists) {
-		if (!KeepTempLog && denied_unsort[0]!='\0' && unlink(denied_unsort))
-			debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),denied_unsort,strerror(errno));
-		denied_unsort[0]='\0';
+		EventList_Destroy(&denied_events);
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Denied report not produced because it is empty\n"));
 		return;
 	}
 	if (debugz>=LogLevel_Process)
 		debuga(__FILE__,__LINE__,_("Creating denied accesses report...\n"));
 
-	if (snprintf(denied_sort,sizeof(denied_sort),"%s/denied.int_log",tmp)>=sizeof(denied_sort)) {
-		debuga(__FILE__,__LINE__,_("Temporary directory path too long to sort the denied accesses\n"));
-		exit(EXIT_FAILURE);
-	}
-	if (snprintf(csort,sizeof(csort),"sort -T \"%s\" -t \"\t\" -k 3,3 -k 5,5 -o \"%s\" \"%s\"",tmp,denied_sort,denied_unsort)>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),denied_unsort,denied_sort);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if (unlink(denied_unsort)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),denied_unsort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	denied_unsort[0]='\0';
+	EventList_Sort(denied_events);
 
 	format_path(__FILE__, __LINE__, report, sizeof(report), "%s/denied.html", outdirname);
 
-	if ((fp_in=FileObject_Open(denied_sort))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),denied_sort,FileObject_GetLastOpenError());
-		exit(EXIT_FAILURE);
-	}
-
-	if ((fp_ou=MY_FOPEN(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -190,45 +140,29 @@ void gen_denied_report(void)
 	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\">\n",fp_ou);
 	fprintf(fp_ou,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("IP/NAME"),_("DATE/TIME"),_("ACCESSED SITE"));
 
-	if ((line=longline_create())==NULL) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),denied_sort);
-		exit(EXIT_FAILURE);
-	}
-
-	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(data,sizeof(data),&gwarea,'\t')<0 || getword(hora,sizeof(hora),&gwarea,'\t')<0 ||
-		    getword(user,sizeof(user),&gwarea,'\t')<0 || getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),denied_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),denied_sort);
-			exit(EXIT_FAILURE);
-		}
-		if (sscanf(data,"%d/%d/%d",&day,&month,&year)!=3) continue;
-		computedate(year,month,day,&t);
+	while (EventList_Read(denied_events,&event)) {
+		computedate(event.Year,event.Month,event.Day,&t);
 		strftime(data,sizeof(data),"%x",&t);
 
-		uinfo=userinfo_find_from_id(user);
+		uinfo=userinfo_find_from_id(event.User);
 		if (!uinfo) {
-			debuga(__FILE__,__LINE__,_("Unknown user ID %s in file \"%s\"\n"),user,denied_sort);
+			debuga(__FILE__,__LINE__,_("Unknown user ID %s in the denied accesses\n"),event.User);
 			exit(EXIT_FAILURE);
 		}
 
 		new_user=false;
 		if (!z) {
-			strcpy(ouser,user);
-			strcpy(oip,ip);
+			safe_strcpy(ouser,event.User,sizeof(ouser));
+			safe_strcpy(oip,event.Ip,sizeof(oip));
 			z=true;
 			new_user=true;
 		} else {
-			if (strcmp(ouser,user) != 0) {
-				strcpy(ouser,user);
+			if (strcmp(ouser,event.User) != 0) {
+				safe_strcpy(ouser,event.User,sizeof(ouser));
 				new_user=true;
 			}
-			if (strcmp(oip,ip) != 0) {
-				strcpy(oip,ip);
+			if (strcmp(oip,event.Ip) != 0) {
+				safe_strcpy(oip,event.Ip,sizeof(oip));
 				new_user=true;
 			}
 		}
@@ -249,25 +183,20 @@ void gen_denied_report(void)
 		fputs("<tr>",fp_ou);
 		if (new_user) {
 			if (uinfo->topuser)
-				fprintf(fp_ou,"<td class=\"data\"><a href=\"%s/%s.html\">%s</a></td><td class=\"data\">%s</td>",uinfo->filename,uinfo->filename,uinfo->label,ip);
+				fprintf(fp_ou,"<td class=\"data\"><a href=\"%s/%s.html\">%s</a></td><td class=\"data\">%s</td>",uinfo->filename,uinfo->filename,uinfo->label,event.Ip);
 			else
-				fprintf(fp_ou,"<td class=\"data\">%s</td><td class=\"data\">%s</td>",uinfo->label,ip);
+				fprintf(fp_ou,"<td class=\"data\">%s</td><td class=\"data\">%s</td>",uinfo->label,event.Ip);
 		} else
 			fputs("<td class=\"data\"></td><td class=\"data\"></td>",fp_ou);
-		fprintf(fp_ou,"<td class=\"data\">%s-%s</td><td class=\"data2\">",data,hora);
-		if (BlockIt[0] != '\0' && url[0]!=ALIAS_PREFIX) {
+		fprintf(fp_ou,"<td class=\"data\">%s-%s</td><td class=\"data2\">",data,event.Time);
+		if (BlockIt[0] != '\0' && event.Url[0]!=ALIAS_PREFIX) {
 			fprintf(fp_ou,"<a href=\"%s%s?url=",wwwDocumentRoot,BlockIt);
-			output_html_url(fp_ou,url);
+			output_html_url(fp_ou,event.Url);
 			fprintf(fp_ou,"\"><img src=\"%s/sarg-squidguard-block.png\"></a>&nbsp;",ImageFile);
 		}
-		output_html_link(fp_ou,url,100);
+		output_html_link(fp_ou,event.Url,100);
 		fputs("</td></tr>\n",fp_ou);
 	}
-	if (FileObject_Close(fp_in)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),denied_sort,FileObject_GetLastCloseError());
-		exit(EXIT_FAILURE);
-	}
-	longline_destroy(&line);
 
 	if (count>DeniedReportLimit && DeniedReportLimit>0)
 		show_ignored_denied(fp_ou,count-DeniedReportLimit);
@@ -279,26 +208,13 @@ void gen_denied_report(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(denied_sort)==-1)
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),denied_sort,strerror(errno));
-
 	return;
 }
 
 /*!
-Remove any temporary file left by the denied module.
+Free the denied entries and remove any temporary file left by the denied module.
 */
 void denied_cleanup(void)
 {
-	if (fp_denied){
-		if (fclose(fp_denied)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),denied_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_denied=NULL;
-	}
-	if (!KeepTempLog && denied_unsort[0]) {
-		if (unlink(denied_unsort)==-1)
-			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),denied_unsort,strerror(errno));
-	}
+	EventList_Destroy(&denied_events);
 }
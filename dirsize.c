@@ -0,0 +1,301 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "include/conf.h"
+#include "include/defs.h"
+
+/*!\file
+\brief Account for the disk space occupied by the report directories.
+
+The index of the date tree displays the size of every report. Walking the
+whole report directory each time the index is rebuilt is slow when there are
+many reports with many users. Instead, the size is computed once when the
+report is complete and stored in a file inside the report directory. The
+directory is only walked when that file is missing or older than the
+directory.
+*/
+
+/*!
+ * Get the effective size of a regular file or directory.
+ *
+ * \param statb The structure filled by lstat(2).
+ *
+ * \return The size occupied on the disk (more or less).
+ *
+ * The actual size occupied on disk by a file or a directory table is not a
+ * trivial computation. It must take into account sparse files, compression,
+ * deduplication and probably many more.
+ *
+ * Here, we assume the file takes a whole number of blocks (which is not the
+ * case of ReiserFS); the block size is constant (which is not the case of
+ * ZFS); every data block is stored in one individal block (no deduplication as
+ * is done by btrfs); data are not compressed (unlike ReiserFS and ZFS).
+ *
+ * As we are dealing with directories containing mostly text and a few
+ * compressed pictures, we don't worry about sparse files with lot of zeros
+ * that would take less blocks than the actual file size.
+ */
+long long int get_file_size(const struct stat *statb)
+{
+#ifdef __linux__
+	long long int blocks;
+
+	//return(statb->st_size);//the size of the file content
+	//return(statb->st_blocks*512);//what is the purpose of this size?
+	if (statb->st_blksize==0) return(statb->st_size);
+	blocks=(statb->st_size+statb->st_blksize-1)/statb->st_blksize;
+	return(blocks*statb->st_blksize);//how many bytes occupied on disk
+#else
+	return(statb->st_size);
+#endif
+}
+
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+/*!
+ * Get the size of a directory.
+ *
+ * The size is the size of the directory content excluding the directory table.
+ * The "du" tool on Linux returns the content size including the directory
+ * table.
+ *
+ * The entries are looked up relative to the descriptor of the directory
+ * containing them so that no path has to be built for every entry.
+ *
+ * \param parentfd The descriptor of the directory containing the directory
+ * to measure or AT_FDCWD.
+ * \param name The name of the directory to measure relative to \a parentfd.
+ *
+ * \return The number of bytes occupied by the directory content.
+ */
+static long long int dir_size_walk(int parentfd,const char *name)
+{
+	int dirfd;
+	DIR *dirp;
+	struct dirent *direntp;
+	struct stat statb;
+	long long int total_size=0;
+
+	dirfd=openat(parentfd,name,O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+	if (dirfd==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if ((dirp=fdopendir(dirfd))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((direntp=readdir(dirp))!=NULL) {
+		if (direntp->d_name[0]=='.' && (direntp->d_name[1]=='\0' || (direntp->d_name[1]=='.' && direntp->d_name[2]=='\0'))) continue;
+		if (fstatat(dirfd,direntp->d_name,&statb,AT_SYMLINK_NOFOLLOW)==-1) {
+			debuga(__FILE__,__LINE__,_("Failed to get the statistics of file \"%s/%s\": %s\n"),name,direntp->d_name,strerror(errno));
+			continue;
+		}
+		if (S_ISDIR(statb.st_mode))
+		{
+			total_size+=get_file_size(&statb);
+			total_size+=dir_size_walk(dirfd,direntp->d_name);
+		}
+		else if (S_ISREG(statb.st_mode))
+		{
+			total_size+=get_file_size(&statb);
+		}
+	}
+	closedir(dirp);//closes dirfd too
+	return (total_size);
+}
+
+#else //the fd relative functions are not available
+
+/*!
+ * Get the size of a directory.
+ *
+ * The size is the size of the directory content excluding the directory table.
+ * The "du" tool on Linux returns the content size including the directory
+ * table.
+ *
+ * \param path The directory whose size is computed. This is a buffer that must be
+ * big enough to contains the deepest path as directory entries are appended to
+ * the string this buffer contains.
+ * \param path_size The number of bytes available in the \a path buffer.
+ *
+ * \return The number of bytes occupied by the directory content.
+ */
+static long long int dir_size_walk(char *path,int path_size)
+{
+	int path_len;
+	DIR *dirp;
+	struct dirent *direntp;
+	struct stat statb;
+	int name_len;
+	long long int total_size=0;
+	char *dir_list=NULL;
+	int dir_filled=0;
+	int dir_allocated=0;
+
+	path_len=strlen(path);
+	if (path_len+2>=path_size) {
+		debuga(__FILE__,__LINE__,_("Path too long: "));
+		debuga_more("%s\n",path);
+		exit(EXIT_FAILURE);
+	}
+	if ((dirp=opendir(path))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),path,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	path[path_len++]='/';
+	while ((direntp=readdir(dirp))!=NULL) {
+		if (direntp->d_name[0]=='.' && (direntp->d_name[1]=='\0' || (direntp->d_name[1]=='.' && direntp->d_name[2]=='\0'))) continue;
+		name_len=strlen(direntp->d_name);
+		if (path_len+name_len+1>=path_size) {
+			debuga(__FILE__,__LINE__,_("Path too long: "));
+			debuga_more("%s%s\n",path,direntp->d_name);
+			exit(EXIT_FAILURE);
+		}
+		strcpy(path+path_len,direntp->d_name);
+		if (MY_LSTAT(path,&statb) == -1) {
+			debuga(__FILE__,__LINE__,_("Failed to get the statistics of file \"%s\": %s\n"),path,strerror(errno));
+			continue;
+		}
+		if (S_ISDIR(statb.st_mode))
+		{
+			if (!dir_list || dir_filled+name_len>=dir_allocated)
+			{
+				int size=3*(name_len+1);//make room for three file names like this one
+				if (size<256) size=256;
+				dir_allocated+=size;
+				dir_list=realloc(dir_list,dir_allocated);
+				if (!dir_list) {
+					debuga(__FILE__,__LINE__,_("Not enough memory to recurse into subdirectory \"%s\"\n"),path);
+					exit(EXIT_FAILURE);
+				}
+			}
+			strcpy(dir_list+dir_filled,direntp->d_name);
+			dir_filled+=name_len+1;
+			total_size+=get_file_size(&statb);
+		}
+		else if (S_ISREG(statb.st_mode))
+		{
+			total_size+=get_file_size(&statb);
+		}
+	}
+	closedir(dirp);
+
+	if (dir_list)
+	{
+		int start=0;
+
+		while (start<dir_filled)
+		{
+			name_len=strlen(dir_list+start);
+			strcpy(path+path_len,dir_list+start);
+			total_size+=dir_size_walk(path,path_size);
+			start+=name_len+1;
+		}
+		free(dir_list);
+	}
+
+	path[path_len-1]='\0';//restore original string
+	return (total_size);
+}
+
+#endif
+
+/*!
+ * Compute the size of a directory by walking through its content.
+ *
+ * \param path The directory to measure.
+ *
+ * \return The number of bytes occupied by the directory content.
+ */
+static long long int dir_size_compute(const char *path)
+{
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+	return(dir_size_walk(AT_FDCWD,path));
+#else
+	char dirpath[MAXLEN];
+
+	format_path(__FILE__, __LINE__, dirpath, sizeof(dirpath), "%s", path);
+	return(dir_size_walk(dirpath,sizeof(dirpath)));
+#endif
+}
+
+/*!
+ * Get the size of a report directory.
+ *
+ * The size recorded by dir_size_record() is returned if it is still up to
+ * date. Otherwise, the directory is walked to compute it.
+ *
+ * \param path The report directory.
+ *
+ * \return The number of bytes occupied by the directory content.
+ */
+long long int dir_size(const char *path)
+{
+	char filename[MAXLEN];
+	FILE *fp_in;
+	struct stat dirstat;
+	struct stat filestat;
+	long long int size;
+	bool valid=false;
+
+	format_path(__FILE__, __LINE__, filename, sizeof(filename), "%s/"DIR_SIZE_FILE, path);
+	if ((fp_in=fopen(filename,"r"))!=NULL) {
+		// a file added to the directory after the size was recorded makes it stale
+		if (fstat(fileno(fp_in),&filestat)==0 && stat(path,&dirstat)==0 && filestat.st_mtime>=dirstat.st_mtime &&
+		    fscanf(fp_in,"%lld",&size)==1 && size>=0)
+			valid=true;
+		fclose(fp_in);
+		if (valid) return(size);
+	}
+	return(dir_size_compute(path));
+}
+
+/*!
+ * Record the size of a report directory once it is complete.
+ *
+ * The size is stored in a file in the directory itself so that it follows
+ * the report if it is moved or deleted.
+ *
+ * \param path The report directory.
+ */
+void dir_size_record(const char *path)
+{
+	char filename[MAXLEN];
+	FILE *fp_ou;
+	long long int size;
+
+	size=dir_size_compute(path);
+	format_path(__FILE__, __LINE__, filename, sizeof(filename), "%s/"DIR_SIZE_FILE, path);
+	if ((fp_ou=fopen(filename,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),filename,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fp_ou,"%lld\n",size);
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),filename,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
@@ -27,39 +27,51 @@
 #include "include/conf.h"
 #include "include/defs.h"
 #include "include/readlog.h"
+#include "include/eventlist.h"
 
 /*!
-The buffer to store the list of the suffixes to take into account when generating
-the report of the downloaded files. The suffixes in the list are separated by the ASCII
-null.
+One node of the tree of the download suffixes. The suffixes are stored reversed and
+in lower case so that the tree is walked from the end of the URL toward the dot.
 */
-/*@null@*/static char *DownloadSuffix=NULL;
+struct DownloadSuffixNodeStruct
+{
+	//! The character, in lower case, leading to this node from its parent.
+	unsigned char Char;
+	//! \c True if a suffix is complete when this node is reached.
+	bool Suffix;
+	//! The index of the first child of this node or zero if it has no child.
+	int Child;
+	//! The index of the next node having the same parent or zero if it is the last one.
+	int Next;
+};
 
 /*!
-The index of all the suffixes stored in ::DownloadSuffix. The list is sorted alphabetically.
-to speed up the search.
+The tree of the suffixes to take into account when generating the report of the
+downloaded files. The first node is the root of the tree.
 */
-/*@null@*/static char **DownloadSuffixIndex=NULL;
+/*@null@*/static struct DownloadSuffixNodeStruct *DownloadSuffixTree=NULL;
 
 /*!
-The number of suffixes in ::DownloadSuffixIndex.
+The number of nodes used in ::DownloadSuffixTree.
 */
-static int NDownloadSuffix=0;
+static int NDownloadSuffixNodes=0;
 
-//! Name of the file containing the unsorted downloaded entries.
-static char download_unsort[MAXLEN]="";
-//! The file handle to write the entries.
-static FILE *fp_download=NULL;
+/*!
+The number of nodes allocated in ::DownloadSuffixTree.
+*/
+static int NDownloadSuffixAllocated=0;
+
+//! The downloaded entries.
+static EventListObject download_events=NULL;
 //! \c True if at least one downloaded entry exists.
 static bool download_exists=false;
 
 /*!
-Open a file to store the denied accesses.
-
-\return The file handle or NULL if no file is necessary.
+Prepare the list to store the downloaded files.
 */
 void download_open(void)
 {
+	if (download_events) return;
 	if ((ReportType & REPORT_TYPE_DOWNLOADS) == 0) {
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("Download report not produced as it is not requested\n"));
 		return;
@@ -69,44 +81,36 @@ void download_open(void)
 		return;
 	}
 
-	format_path(__FILE__, __LINE__, download_unsort, sizeof(download_unsort), "%s/download.int_unsort", tmp);
-	if ((fp_download=MY_FOPEN(download_unsort,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),download_unsort,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	download_events=EventList_Create("download",EVENTSORT_UserTime);
 	return;
 }
 
 /*!
-Write one entry in the unsorted downloaded file provided that it is required.
+Store one downloaded file provided that it is required.
 
-\param log_entry The entry to write into the log file.
+\param log_entry The entry to store.
 \param url The URL of the downloaded file.
 */
 void download_write(const struct ReadLogStruct *log_entry,const char *url)
 {
-	char date[80];
+	char trimmed_url[MAXLEN];
+	int i;
 
-	if (fp_download && strstr(log_entry->HttpCode,"DENIED") == 0) {
-		strftime(date,sizeof(date),"%d/%m/%Y\t%H:%M:%S",&log_entry->EntryTime);
-		fprintf(fp_download,"%s\t%s\t%s\t%s\n",date,log_entry->User,log_entry->Ip,url);
+	if (download_events && strstr(log_entry->HttpCode,"DENIED") == 0) {
+		safe_strcpy(trimmed_url,url,sizeof(trimmed_url));
+		for (i=strlen(trimmed_url)-1 ; i>=0 && (unsigned char)trimmed_url[i]<' ' ; i--) trimmed_url[i]=0;
+		EventList_Add(download_events,&log_entry->EntryTime,log_entry->User,log_entry->Ip,trimmed_url);
 		download_exists=true;
 	}
 }
 
 /*!
-Close the file opened by denied_open().
+Stop storing the downloaded files.
 */
 void download_close(void)
 {
-	if (fp_download)
-	{
-		if (fclose(fp_download)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),download_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_download=NULL;
-	}
+	if (download_events)
+		EventList_Close(download_events);
 }
 
 /*!
@@ -120,75 +124,28 @@ bool is_download(void)
 	return(download_exists);
 }
 
-/*!
-Sort the raw log file with the downloaded files.
-
-\param report_in The name of the file where to store the sorted entries.
-
-The file is sorted by columns 3, 1, 2 and 5 that are the columns of the user's ID, the
-date, the time and the URL.
-*/
-static void download_sort(const char *report_in)
-{
-	int clen;
-	char csort[MAXLEN];
-	int cstatus;
-
-	clen=snprintf(csort,sizeof(csort),"sort -T \"%s\" -t \"\t\" -k 3,3 -k 1,1 -k 2,2 -k 5,5 -o \"%s\" \"%s\"",
-			tmp, report_in, download_unsort);
-	if (clen>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Path too long to sort file \"%s\"\n"),download_unsort);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if (!KeepTempLog) {
-		if (unlink(download_unsort)) {
-			debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),download_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		download_unsort[0]='\0';
-	}
-}
-
 /*!
 Generate the report of the downloaded files. The list of the suffixes to take into account
 is set with set_download_suffix().
 */
 void download_report(void)
 {
-	FileObject *fp_in = NULL;
 	FILE *fp_ou = NULL;
 
-	char *buf;
-	char *url;
-	char report_in[MAXLEN];
 	char report[MAXLEN];
-	char ip[MAXLEN];
 	char oip[MAXLEN];
-	char user[MAXLEN];
 	char ouser[MAXLEN];
 	char ouser2[MAXLEN];
 	char data[15];
-	char hora[15];
 	int  z=0;
 	int  count=0;
-	int i;
-	int day,month,year;
 	bool new_user;
-	struct getwordstruct gwarea;
-	longline line;
+	struct EventStruct event;
 	struct userinfostruct *uinfo;
 	struct tm t;
 
 	if (!download_exists) {
-		if (!KeepTempLog && download_unsort[0]!='\0' && unlink(download_unsort))
-			debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),download_unsort,strerror(errno));
-		download_unsort[0]='\0';
+		EventList_Destroy(&download_events);
 		if (debugz>=LogLevel_Process) debugaz(__FILE__,__LINE__,_("No downloaded files to report\n"));
 		return;
 	}
@@ -198,19 +155,13 @@ void download_report(void)
 	ouser[0]='\0';
 	ouser2[0]='\0';
 
-	// sort the raw file
-	format_path(__FILE__, __LINE__, report_in, sizeof(report_in), "%s/download.int_log", tmp);
-	download_sort(report_in);
+	// sort the entries by user, date, time and URL
+	EventList_Sort(download_events);
 
 	// produce the report.
 	format_path(__FILE__, __LINE__, report, sizeof(report), "%s/download.html", outdirname);
 
-	if ((fp_in=FileObject_Open(report_in))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report_in,FileObject_GetLastOpenError());
-		exit(EXIT_FAILURE);
-	}
-
-	if ((fp_ou=MY_FOPEN(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -225,44 +176,28 @@ void download_report(void)
 	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\">\n",fp_ou);
 	fprintf(fp_ou,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("IP/NAME"),_("DATE/TIME"),_("ACCESSED SITE"));
 
-	if ((line=longline_create())==NULL) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),report_in);
-		exit(EXIT_FAILURE);
-	}
-
-	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(data,sizeof(data),&gwarea,'\t')<0 || getword(hora,sizeof(hora),&gwarea,'\t')<0 ||
-		    getword(user,sizeof(user),&gwarea,'\t')<0 || getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),report_in);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),report_in);
-			exit(EXIT_FAILURE);
-		}
-		if (sscanf(data,"%d/%d/%d",&day,&month,&year)!=3) continue;
-		computedate(year,month,day,&t);
+	while (EventList_Read(download_events,&event)) {
+		computedate(event.Year,event.Month,event.Day,&t);
 		strftime(data,sizeof(data),"%x",&t);
 
-		uinfo=userinfo_find_from_id(user);
+		uinfo=userinfo_find_from_id(event.User);
 		if (!uinfo) {
-			debuga(__FILE__,__LINE__,_("Unknown user ID %s in file \"%s\"\n"),user,report_in);
+			debuga(__FILE__,__LINE__,_("Unknown user ID %s in the downloaded files\n"),event.User);
 			exit(EXIT_FAILURE);
 		}
 		new_user=false;
 		if (!z) {
-			strcpy(ouser,user);
-			strcpy(oip,ip);
+			safe_strcpy(ouser,event.User,sizeof(ouser));
+			safe_strcpy(oip,event.Ip,sizeof(oip));
 			z++;
 			new_user=true;
 		} else {
-			if (strcmp(ouser,user) != 0) {
-				strcpy(ouser,user);
+			if (strcmp(ouser,event.User) != 0) {
+				safe_strcpy(ouser,event.User,sizeof(ouser));
 				new_user=true;
 			}
-			if (strcmp(oip,ip) != 0) {
-				strcpy(oip,ip);
+			if (strcmp(oip,event.Ip) != 0) {
+				safe_strcpy(oip,event.Ip,sizeof(oip));
 				new_user=true;
 			}
 		}
@@ -278,30 +213,23 @@ void download_report(void)
 				continue;
 		}
 
-		for (i=strlen(url)-1 ; i>=0 && (unsigned char)url[i]<' ' ; i--) url[i]=0;
-
 		fputs("<tr>",fp_ou);
 		if (new_user) {
 			if (uinfo->topuser)
-				fprintf(fp_ou,"<td class=\"data\"><a href=\"%s/%s.html\">%s</a></td><td class=\"data\">%s</td>",uinfo->filename,uinfo->filename,uinfo->label,ip);
+				fprintf(fp_ou,"<td class=\"data\"><a href=\"%s/%s.html\">%s</a></td><td class=\"data\">%s</td>",uinfo->filename,uinfo->filename,uinfo->label,event.Ip);
 			else
-				fprintf(fp_ou,"<td class=\"data\">%s</td><td class=\"data\">%s</td>",uinfo->label,ip);
+				fprintf(fp_ou,"<td class=\"data\">%s</td><td class=\"data\">%s</td>",uinfo->label,event.Ip);
 		} else
 			fputs("<td class=\"data\"></td><td class=\"data\"></td>",fp_ou);
-		fprintf(fp_ou,"<td class=\"data\">%s-%s</td><td class=\"data2\">",data,hora);
-		if (BlockIt[0]!='\0' && url[0]!=ALIAS_PREFIX) {
+		fprintf(fp_ou,"<td class=\"data\">%s-%s</td><td class=\"data2\">",data,event.Time);
+		if (BlockIt[0]!='\0' && event.Url[0]!=ALIAS_PREFIX) {
 			fprintf(fp_ou,"<a href=\"%s%s?url=\"",wwwDocumentRoot,BlockIt);
-			output_html_url(fp_ou,url);
+			output_html_url(fp_ou,event.Url);
 			fprintf(fp_ou,"\"><img src=\"%s/sarg-squidguard-block.png\"></a>&nbsp;",ImageFile);
 		}
-		output_html_link(fp_ou,url,100);
+		output_html_link(fp_ou,event.Url,100);
 		fputs("</td></tr>\n",fp_ou);
 	}
-	if (FileObject_Close(fp_in)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),report_in,FileObject_GetLastCloseError());
-		exit(EXIT_FAILURE);
-	}
-	longline_destroy(&line);
 
 	fputs("</table></div>\n",fp_ou);
 	write_html_trailer(fp_ou);
@@ -310,11 +238,6 @@ void download_report(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(report_in)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),report_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
 	return;
 }
 
@@ -323,84 +246,94 @@ Free the memory allocated by set_download_suffix().
 */
 void free_download(void)
 {
-	if (DownloadSuffix) {
-		free(DownloadSuffix);
-		DownloadSuffix=NULL;
+	if (DownloadSuffixTree) {
+		free(DownloadSuffixTree);
+		DownloadSuffixTree=NULL;
 	}
-	if (DownloadSuffixIndex) {
-		free(DownloadSuffixIndex);
-		DownloadSuffixIndex=NULL;
+	NDownloadSuffixNodes=0;
+	NDownloadSuffixAllocated=0;
+}
+
+/*!
+Store one suffix in the tree of the download suffixes.
+
+\param suffix The suffix to store.
+\param len The number of characters in the suffix.
+*/
+static void add_download_suffix(const char *suffix,int len)
+{
+	int node;
+	int child;
+	unsigned char c;
+
+	node=0;
+	while (--len>=0) {
+		c=(unsigned char)tolower((unsigned char)suffix[len]);
+		for (child=DownloadSuffixTree[node].Child ; child && DownloadSuffixTree[child].Char!=c ; child=DownloadSuffixTree[child].Next);
+		if (!child) {
+			if (NDownloadSuffixNodes>=NDownloadSuffixAllocated) {
+				struct DownloadSuffixNodeStruct *Tree;
+				int Size=2*NDownloadSuffixAllocated;
+
+				Tree=realloc(DownloadSuffixTree,Size*sizeof(*Tree));
+				if (!Tree) {
+					debuga(__FILE__,__LINE__,_("Too many download suffixes\n"));
+					exit(EXIT_FAILURE);
+				}
+				DownloadSuffixTree=Tree;
+				NDownloadSuffixAllocated=Size;
+			}
+			child=NDownloadSuffixNodes++;
+			DownloadSuffixTree[child].Char=c;
+			DownloadSuffixTree[child].Suffix=false;
+			DownloadSuffixTree[child].Child=0;
+			DownloadSuffixTree[child].Next=DownloadSuffixTree[node].Child;
+			DownloadSuffixTree[node].Child=child;
+		}
+		node=child;
 	}
-	NDownloadSuffix=0;
+	DownloadSuffixTree[node].Suffix=true;
 }
 
 /*!
 Set the list of the suffixes corresponding to the download of files you want to detect with
-is_download_suffix(). The list is sorted to make the search faster.
+is_download_suffix(). The suffixes are stored reversed in a tree to check a URL in a single
+pass starting from its end.
 
-\param list A comma separated list of the suffixes to set in ::DownloadSuffix.
+\param list A comma separated list of the suffixes to detect.
 
 \note The memory allocated by this function must be freed by free_download().
 */
 void set_download_suffix(const char *list)
 {
-	char *str;
-	int i, j, k;
-	int cmp;
+	int i;
 
 	free_download();
 
-	DownloadSuffix=strdup(list);
-	if (!DownloadSuffix) {
-		debuga(__FILE__,__LINE__,_("Download suffix list too long\n"));
-		exit(EXIT_FAILURE);
-	}
-	j = 1;
-	for (i=0 ; list[i] ; i++)
-		if (list[i] == ',') j++;
-	DownloadSuffixIndex=malloc(j*sizeof(char *));
-	if (!DownloadSuffixIndex) {
+	NDownloadSuffixAllocated=64;
+	DownloadSuffixTree=malloc(NDownloadSuffixAllocated*sizeof(*DownloadSuffixTree));
+	if (!DownloadSuffixTree) {
 		debuga(__FILE__,__LINE__,_("Too many download suffixes\n"));
 		exit(EXIT_FAILURE);
 	}
-
-	str = DownloadSuffix;
-	for (i=0 ; DownloadSuffix[i] ; i++) {
-		if (DownloadSuffix[i] == ',') {
-			DownloadSuffix[i] = '\0';
-			if (*str) {
-				cmp = -1;
-				for (j=0 ; j<NDownloadSuffix && (cmp=strcasecmp(str,DownloadSuffixIndex[j]))>0 ; j++);
-				if (cmp != 0) {
-					for (k=NDownloadSuffix ; k>j ; k--)
-						DownloadSuffixIndex[k]=DownloadSuffixIndex[k-1];
-					NDownloadSuffix++;
-					DownloadSuffixIndex[j]=str;
-				}
-			}
-			str=DownloadSuffix+i+1;
-		}
-	}
-
-	if (*str) {
-		cmp = -1;
-		for (j=0 ; j<NDownloadSuffix && (cmp=strcasecmp(str,DownloadSuffixIndex[j]))>0 ; j++);
-		if (cmp != 0) {
-			for (k=NDownloadSuffix ; k>j ; k--)
-				DownloadSuffixIndex[k]=DownloadSuffixIndex[k-1];
-			NDownloadSuffix++;
-			DownloadSuffixIndex[j]=str;
-		}
+	memset(DownloadSuffixTree,0,sizeof(*DownloadSuffixTree));
+	NDownloadSuffixNodes=1;
+
+	while (*list) {
+		for (i=0 ; list[i] && list[i]!=',' ; i++);
+		if (i>0) add_download_suffix(list,i);
+		list+=i;
+		if (*list==',') list++;
 	}
 }
 
 /*!
-Tell if the URL correspond to a downloaded file. The function takes the extension at the end of the
-URL with a maximum of 9 characters and compare it to the list of the download suffix in
-::DownloadSuffix. If the suffix is found in the list, the function reports the URL as the download
-of a file.
+Tell if the URL correspond to a downloaded file. The function walks the URL backward from its end
+up to the last dot through the tree of the suffixes set by set_download_suffix(). If the characters
+after the dot form one of the suffixes, the function reports the URL as the download of a file.
 
-\param url The URL to test.
+\param url The URL to test without the scheme as returned by skip_scheme().
+\param end The end of the URL. It points to the terminating null of the string.
 
 \retval 1 The URL matches a suffix of a download.
 \retval 0 The URL is not a known download.
@@ -409,58 +342,38 @@ of a file.
 that ends with the file name can be detected.
 
 \note A URL embedding another web site's address ending by .com at the end of the URL will match the download
-extension com if it is defined in the ::DownloadSuffix.
+extension com if it is defined in the list of the suffixes.
 */
-bool is_download_suffix(const char *url)
+bool is_download_suffix(const char *url,const char *end)
 {
-	int urllen;
-	int i;
-	int down, up, center;
-	const char *suffix;
-	int cmp;
-	const int max_suffix=10;
-
-	if (DownloadSuffix == NULL || NDownloadSuffix == 0) return(false);
-
-	urllen=strlen(url)-1;
-	if (urllen<=0) return(false);
-	if (url[urllen] == '.') return(false); //reject a single trailing dot
-	for (i=0 ; i<urllen && (url[i]!='/' || url[i+1]=='/') && url[i]!='?' ; i++);
-	if (i>=urllen) return(false); // url is a hostname without any path or file to download
-
-	for (i=0 ; i<=max_suffix && i<urllen && url[urllen-i]!='.' ; i++)
-		if (url[urllen-i] == '/' || url[urllen-i] == '?') return(false);
-	if (i>max_suffix || i>=urllen) return(false);
-
-	suffix=url+urllen-i+1;
-	down=0;
-	up=NDownloadSuffix-1;
-	while (down<=up) {
-		center=(down+up)/2;
-		cmp=strcasecmp(suffix,DownloadSuffixIndex[center]);
-		if (cmp == 0) return(true);
-		if (cmp < 0)
-			up = center-1;
-		else
-			down = center+1;
+	const struct DownloadSuffixNodeStruct *node;
+	const char *str;
+	int child;
+	unsigned char c;
+
+	if (DownloadSuffixTree == NULL || DownloadSuffixTree->Child == 0) return(false);
+
+	node=DownloadSuffixTree;
+	for (str=end-1 ; str>url ; str--) {
+		if (*str == '.') break;
+		if (*str == '/' || *str == '?') return(false);
+		c=(unsigned char)tolower((unsigned char)*str);
+		for (child=node->Child ; child && DownloadSuffixTree[child].Char!=c ; child=DownloadSuffixTree[child].Next);
+		if (!child) return(false);
+		node=DownloadSuffixTree+child;
 	}
+	if (str<=url || !node->Suffix) return(false);
+
+	// the suffix must be in the path, not in the host name
+	while (--str>=url)
+		if (*str == '/' || *str == '?') return(true);
 	return(false);
 }
 
 /*!
-Remove any temporary file left by the download module.
+Free the downloaded files and remove any temporary file left by the download module.
 */
 void download_cleanup(void)
 {
-	if (fp_download) {
-		if (fclose(fp_download)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),download_unsort,strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-		fp_download=NULL;
-	}
-	if (download_unsort[0]) {
-		if (unlink(download_unsort)==-1)
-			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),download_unsort,strerror(errno));
-	}
+	EventList_Destroy(&download_events);
 }
@@ -31,12 +31,51 @@
 extern struct globalstatstruct globstat;
 #endif
 
+//! The number of seconds to wait before the first retry of a failed delivery.
+#define EMAIL_RETRY_DELAY 5
+
+//! One e-mail waiting to be delivered.
+struct EmailJobStruct
+{
+	//! The next e-mail in the queue.
+	struct EmailJobStruct *Next;
+	//! The file containing the message.
+	char *MessageFile;
+	//! The file storing the recipient and the subject in the queue directory or NULL.
+	char *EnvelopeFile;
+	//! The subject of the e-mail.
+	char *Subject;
+	//! The recipient of the e-mail.
+	char *Recipient;
+	//! How many deliveries failed during this run.
+	int Attempts;
+	//! The process delivering the e-mail or 0 if it isn't running.
+	pid_t Pid;
+	//! When to start the next delivery.
+	time_t NextTry;
+};
+
 //! Name of the file containing the e-mail to send.
 static char EmailFileName[MAXLEN]="";
+//! The e-mails waiting to be delivered.
+static struct EmailJobStruct *EmailQueue=NULL;
+//! How many mailer processes are running.
+static int EmailRunning=0;
+//! How many e-mails were delivered.
+static int EmailSent=0;
+//! How many e-mails could not be delivered.
+static int EmailFailed=0;
+//! The number of e-mails generated by this run to make the file names unique.
+static int EmailSerial=0;
+//! \c True once the e-mails left in the queue directory by a previous run are queued.
+static bool EmailQueueLoaded=false;
 
 /*!
  * Generate a file name to write the e-mail and open the file.
  *
+ * If a mail queue directory is configured, the file is written in that directory
+ * so that it survives the run if it can't be delivered.
+ *
  * \param Module The module for which the e-mail is generated.
  *
  * \return The file to which the e-mail can be written.
@@ -50,7 +89,11 @@ FILE *Email_OutputFile(const char *Module)
 		return(stdout);
 	}
 
-	format_path(__FILE__, __LINE__, EmailFileName, sizeof(EmailFileName), "%s/%s.int_unsort", tmp, Module);
+	if (MailQueueDir[0]) {
+		if (access(MailQueueDir,R_OK)!=0) my_mkdir(MailQueueDir);
+		format_path(__FILE__, __LINE__, EmailFileName, sizeof(EmailFileName), "%s/%ld-%d-%d-%s.msg", MailQueueDir, (long int)time(NULL), (int)getpid(), ++EmailSerial, Module);
+	} else
+		format_path(__FILE__, __LINE__, EmailFileName, sizeof(EmailFileName), "%s/%s.int_unsort", tmp, Module);
 	if ((fp=fopen(EmailFileName,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),EmailFileName,strerror(errno));
 		exit(EXIT_FAILURE);
@@ -59,14 +102,335 @@ FILE *Email_OutputFile(const char *Module)
 }
 
 /*!
- * Send the e-mail.
+ * Duplicate a string or abort if there is not enough memory.
+ */
+static char *Email_StrDup(const char *Str)
+{
+	char *Copy;
+
+	Copy=strdup(Str);
+	if (!Copy) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to queue the e-mail\n"));
+		exit(EXIT_FAILURE);
+	}
+	return(Copy);
+}
+
+/*!
+ * Append an e-mail at the end of the delivery queue.
+ *
+ * \param MessageFile The file containing the message.
+ * \param EnvelopeFile The file storing the recipient and the subject or NULL.
+ * \param Subject The subject of the e-mail.
+ * \param Recipient The recipient of the e-mail.
+ *
+ * \return The queued e-mail.
+ */
+static struct EmailJobStruct *Email_AddJob(const char *MessageFile,const char *EnvelopeFile,const char *Subject,const char *Recipient)
+{
+	struct EmailJobStruct *Job;
+	struct EmailJobStruct **Last;
+
+	Job=calloc(1,sizeof(*Job));
+	if (!Job) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to queue the e-mail\n"));
+		exit(EXIT_FAILURE);
+	}
+	Job->MessageFile=Email_StrDup(MessageFile);
+	Job->EnvelopeFile=(EnvelopeFile) ? Email_StrDup(EnvelopeFile) : NULL;
+	Job->Subject=Email_StrDup(Subject);
+	Job->Recipient=Email_StrDup(Recipient);
+	for (Last=&EmailQueue ; *Last ; Last=&(*Last)->Next);
+	*Last=Job;
+	return(Job);
+}
+
+/*!
+ * Remove an e-mail from the queue and free it.
+ */
+static void Email_RemoveJob(struct EmailJobStruct *Job)
+{
+	struct EmailJobStruct **Prev;
+
+	for (Prev=&EmailQueue ; *Prev && *Prev!=Job ; Prev=&(*Prev)->Next);
+	if (*Prev) *Prev=Job->Next;
+	free(Job->MessageFile);
+	if (Job->EnvelopeFile) free(Job->EnvelopeFile);
+	free(Job->Subject);
+	free(Job->Recipient);
+	free(Job);
+}
+
+/*!
+ * Write the recipient and the subject of the e-mail next to the message in
+ * the queue directory.
+ *
+ * The envelope is written last and renamed into place so that a message
+ * is only picked up by a later run once it is complete.
+ */
+static void Email_WriteEnvelope(const char *MessageFile,const char *Subject,char *EnvelopeFile,int EnvelopeSize)
+{
+	char TmpFile[MAXLEN];
+	FILE *fp;
+	int len;
+
+	len=strlen(MessageFile);
+	if (len<4 || len>=EnvelopeSize) {
+		debuga(__FILE__,__LINE__,_("Path too long: "));
+		debuga_more("%s\n",MessageFile);
+		exit(EXIT_FAILURE);
+	}
+	strcpy(EnvelopeFile,MessageFile);
+	strcpy(EnvelopeFile+len-4,".env");
+	format_path(__FILE__, __LINE__, TmpFile, sizeof(TmpFile), "%s.tmp", EnvelopeFile);
+	if ((fp=fopen(TmpFile,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TmpFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fp,"%s\n%s\n",email,Subject);
+	if (fclose(fp)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TmpFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TmpFile,EnvelopeFile)) {
+		debuga(__FILE__,__LINE__,_("Cannot rename \"%s\" to \"%s\": %s\n"),TmpFile,EnvelopeFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Queue the e-mails left in the queue directory by a previous run.
+ */
+static void Email_LoadQueue(void)
+{
+	DIR *dirp;
+	struct dirent *direntp;
+	struct EmailJobStruct *Job;
+	char EnvelopeFile[MAXLEN];
+	char MessageFile[MAXLEN];
+	char Recipient[MAXLEN];
+	char Subject[MAXLEN];
+	FILE *fp;
+	int len;
+
+	EmailQueueLoaded=true;
+	if (!MailQueueDir[0]) return;
+	if ((dirp=opendir(MailQueueDir))==NULL) {
+		if (errno==ENOENT) return;
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),MailQueueDir,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((direntp=readdir(dirp))!=NULL) {
+		len=strlen(direntp->d_name);
+		if (len<=4 || strcmp(direntp->d_name+len-4,".env")!=0) continue;
+		format_path(__FILE__, __LINE__, EnvelopeFile, sizeof(EnvelopeFile), "%s/%s", MailQueueDir, direntp->d_name);
+		for (Job=EmailQueue ; Job && (!Job->EnvelopeFile || strcmp(Job->EnvelopeFile,EnvelopeFile)!=0) ; Job=Job->Next);
+		if (Job) continue;
+		format_path(__FILE__, __LINE__, MessageFile, sizeof(MessageFile), "%s/%.*s.msg", MailQueueDir, len-4, direntp->d_name);
+		if ((fp=fopen(EnvelopeFile,"r"))==NULL) {
+			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),EnvelopeFile,strerror(errno));
+			continue;
+		}
+		if (!fgets(Recipient,sizeof(Recipient),fp) || !fgets(Subject,sizeof(Subject),fp)) {
+			debuga(__FILE__,__LINE__,_("Invalid e-mail envelope in \"%s\"\n"),EnvelopeFile);
+			fclose(fp);
+			continue;
+		}
+		fclose(fp);
+		fixendofline(Recipient);
+		fixendofline(Subject);
+		if (debug)
+			debuga(__FILE__,__LINE__,_("Queuing the e-mail to \"%s\" left in \"%s\"\n"),Recipient,MessageFile);
+		Email_AddJob(MessageFile,EnvelopeFile,Subject,Recipient);
+	}
+	closedir(dirp);
+}
+
+/*!
+ * Format the command delivering an e-mail. The message is read from the
+ * standard input of the command.
+ */
+static void Email_Command(const struct EmailJobStruct *Job,char *Command,int CommandSize)
+{
+	format_path(__FILE__, __LINE__, Command, CommandSize, "%s -s \"%s\" \"%s\"", MailUtility, Job->Subject, Job->Recipient);
+}
+
+/*!
+ * Delete a file of a delivered e-mail.
+ */
+static void Email_DeleteFile(const char *FileName)
+{
+	if (unlink(FileName) && errno!=ENOENT) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),FileName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Account for the end of a delivery.
+ *
+ * A delivered e-mail is removed from the queue. A failed delivery is
+ * scheduled again after a delay doubling after each attempt until
+ * mail_retries is exhausted.
+ *
+ * \param Job The e-mail.
+ * \param Status The exit status of the mailer.
+ */
+static void Email_Done(struct EmailJobStruct *Job,int Status)
+{
+	char Command[MAXLEN];
+
+	if (WIFEXITED(Status) && WEXITSTATUS(Status)==0) {
+		EmailSent++;
+		if (debug)
+			debuga(__FILE__,__LINE__,_("E-mail \"%s\" sent to \"%s\"\n"),Job->Subject,Job->Recipient);
+		if (Job->EnvelopeFile) {
+			Email_DeleteFile(Job->EnvelopeFile);
+			Email_DeleteFile(Job->MessageFile);
+		} else if (!KeepTempLog)
+			Email_DeleteFile(Job->MessageFile);
+		Email_RemoveJob(Job);
+		return;
+	}
+
+	Email_Command(Job,Command,sizeof(Command));
+	debuga(__FILE__,__LINE__,_("command return status %d\n"),WEXITSTATUS(Status));
+	debuga(__FILE__,__LINE__,_("command: %s <\"%s\"\n"),Command,Job->MessageFile);
+	Job->Attempts++;
+	if (Job->Attempts<=MailRetries) {
+		int Delay=EMAIL_RETRY_DELAY<<(Job->Attempts-1);
+
+		debuga(__FILE__,__LINE__,_("Retrying the e-mail to \"%s\" in %d seconds\n"),Job->Recipient,Delay);
+		Job->NextTry=time(NULL)+Delay;
+		return;
+	}
+	EmailFailed++;
+	if (Job->EnvelopeFile)
+		debuga(__FILE__,__LINE__,_("The e-mail to \"%s\" is kept in \"%s\" for the next run\n"),Job->Recipient,Job->MessageFile);
+	Email_RemoveJob(Job);
+}
+
+/*!
+ * Start the delivery of an e-mail.
+ *
+ * The mailer runs in a child process reading the message on its standard
+ * input so that sarg can go on with the report while the e-mail is sent.
+ */
+static void Email_Start(struct EmailJobStruct *Job)
+{
+	char Command[MAXLEN];
+#ifdef HAVE_FORK
+	pid_t Pid;
+	int fd;
+#else
+	char warea[MAXLEN];
+#endif
+
+	Email_Command(Job,Command,sizeof(Command));
+	if (debug)
+		debuga(__FILE__,__LINE__,_("Sending mail with command: %s <\"%s\"\n"),Command,Job->MessageFile);
+#ifdef HAVE_FORK
+	// don't let the child flush the pending output of the parent a second time
+	fflush(NULL);
+	Pid=fork();
+	if (Pid==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot start a process to send the e-mail \"%s\": %s\n"),Job->MessageFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (Pid==0) {
+		fd=open(Job->MessageFile,O_RDONLY);
+		if (fd==-1 || dup2(fd,STDIN_FILENO)==-1) _exit(127);
+		close(fd);
+		execl("/bin/sh","sh","-c",Command,(char *)NULL);
+		_exit(127);
+	}
+	Job->Pid=Pid;
+	EmailRunning++;
+#else
+	format_path(__FILE__, __LINE__, warea, sizeof(warea), "%s <\"%s\"", Command, Job->MessageFile);
+	Email_Done(Job,system(warea));
+#endif
+}
+
+#ifdef HAVE_FORK
+/*!
+ * Collect the mailer processes that terminated.
+ *
+ * \return \c True if at least one process terminated.
+ */
+static bool Email_Reap(void)
+{
+	struct EmailJobStruct *Job;
+	struct EmailJobStruct *Next;
+	pid_t Pid;
+	int Status;
+	bool Reaped=false;
+
+	for (Job=EmailQueue ; Job ; Job=Next) {
+		Next=Job->Next;
+		if (!Job->Pid) continue;
+		Pid=waitpid(Job->Pid,&Status,WNOHANG);
+		if (Pid==0) continue;
+		if (Pid==-1) {
+			if (errno==EINTR) continue;
+			debuga(__FILE__,__LINE__,_("Failed to wait for the process sending the e-mail \"%s\": %s\n"),Job->MessageFile,strerror(errno));
+			// the outcome is unknown so the e-mail is handled as not sent
+			Status=-1;
+		}
+		Job->Pid=0;
+		EmailRunning--;
+		Reaped=true;
+		Email_Done(Job,Status);
+	}
+	return(Reaped);
+}
+#endif
+
+/*!
+ * Collect the terminated mailers and start the e-mails due for delivery
+ * without exceeding mail_workers processes.
+ *
+ * \return The number of seconds until the next pending e-mail is due or
+ * zero if an e-mail is being sent or ready to be sent.
+ */
+static int Email_Dispatch(void)
+{
+	struct EmailJobStruct *Job;
+	struct EmailJobStruct *Next;
+	time_t Now;
+	int Wait=0;
+
+	if (!EmailQueueLoaded) Email_LoadQueue();
+#ifdef HAVE_FORK
+	Email_Reap();
+#endif
+	Now=time(NULL);
+	for (Job=EmailQueue ; Job ; Job=Next) {
+		Next=Job->Next;
+		if (Job->Pid) continue;
+		if (Job->NextTry>Now) {
+			if (Wait==0 || Job->NextTry-Now<Wait) Wait=Job->NextTry-Now;
+			continue;
+		}
+		if (EmailRunning>0 && EmailRunning>=MailWorkers) break;
+		Email_Start(Job);
+	}
+	if (EmailRunning>0) return(0);
+	return(Wait);
+}
+
+/*!
+ * Queue the e-mail for delivery.
+ *
+ * The e-mail is sent in the background by a pool of mailer processes. Call
+ * Email_Flush() to wait until every e-mail is delivered.
  *
  * \param fp The file opened by Email_OutputFile().
+ * \param Subject The subject of the e-mail.
  */
 void Email_Send(FILE *fp,const char *Subject)
 {
-	char warea[MAXLEN];
-	int cstatus;
+	char EnvelopeFile[MAXLEN];
 
 	if (fp==stdout) return;//to stdout
 
@@ -75,17 +439,44 @@ void Email_Send(FILE *fp,const char *Subject)
 		exit(EXIT_FAILURE);
 	}
 
-	format_path(__FILE__, __LINE__, warea, sizeof(warea), "%s -s \"%s\" \"%s\" <\"%s\"", MailUtility, Subject, email, EmailFileName);
-	if (debug)
-		debuga(__FILE__,__LINE__,_("Sending mail with command: %s\n"),warea);
-	cstatus=system(warea);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("command: %s\n"),warea);
-		exit(EXIT_FAILURE);
+	if (MailQueueDir[0]) {
+		Email_WriteEnvelope(EmailFileName,Subject,EnvelopeFile,sizeof(EnvelopeFile));
+		Email_AddJob(EmailFileName,EnvelopeFile,Subject,email);
+	} else
+		Email_AddJob(EmailFileName,NULL,Subject,email);
+	Email_Dispatch();
+}
+
+/*!
+ * Wait until every queued e-mail is delivered or failed and report the
+ * outcome.
+ *
+ * Without a mail queue directory, sarg exits with an error if an e-mail
+ * could not be sent. Otherwise, the failed e-mails remain in the queue
+ * directory and are sent again by the next run.
+ */
+void Email_Flush(void)
+{
+	int Wait;
+
+	if (!MailQueueDir[0] && !EmailQueue) return;
+	if (!EmailQueueLoaded) Email_LoadQueue();
+	while (EmailQueue) {
+		Wait=Email_Dispatch();
+		if (!EmailQueue) break;
+#ifdef HAVE_FORK
+		if (Wait==0) {
+			// poll the running mailers
+			usleep(100000);
+			continue;
+		}
+#endif
+		if (Wait>0) sleep(Wait);
 	}
-	if (!KeepTempLog && unlink(EmailFileName)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),EmailFileName,strerror(errno));
-		exit(EXIT_FAILURE);
+	if (debug && EmailSent>0)
+		debuga(__FILE__,__LINE__,ngettext("%d e-mail sent\n","%d e-mails sent\n",EmailSent),EmailSent);
+	if (EmailFailed>0) {
+		debuga(__FILE__,__LINE__,ngettext("%d e-mail could not be sent\n","%d e-mails could not be sent\n",EmailFailed),EmailFailed);
+		if (!MailQueueDir[0]) exit(EXIT_FAILURE);
 	}
 }
@@ -0,0 +1,592 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Collect the events reported by the denied, authentication failures and
+downloads reports as well as the accesses blocked by the redirector, DansGuardian
+and SmartFilter.
+
+The events are kept in memory with the user, IP address and URL stored only
+once in a pool of strings. The reports read them back sorted without going
+through a temporary file. If the memory exceeds the limit set by
+::EventMemoryLimit, the events are written to a temporary file sorted with
+the sort command like sarg used to do.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+#include "include/eventlist.h"
+
+//! The memory, in megabytes, one list may use before it is written to a file.
+int EventMemoryLimit=64;
+
+//! One event stored in memory.
+struct EventEntryStruct
+{
+	//! The position of the user ID in the pool of strings.
+	int User;
+	//! The position of the IP address in the pool of strings.
+	int Ip;
+	//! The position of the URL in the pool of strings.
+	int Url;
+	//! The position of the rule in the pool of strings.
+	int Rule;
+	//! The date as year*10000+month*100+day.
+	int Date;
+	//! The time as hour*10000+minute*100+second.
+	int Time;
+};
+
+struct EventListStruct
+{
+	//! The name of the list used to name the temporary files.
+	char Name[40];
+	//! How to sort the events.
+	enum EventSortEnum Sort;
+	//! The strings referenced by the events. Each string is stored once.
+	char *Pool;
+	//! The number of bytes used in the pool.
+	int PoolSize;
+	//! The number of bytes allocated for the pool.
+	int PoolAllocated;
+	//! The hash table to find a string in the pool. A slot contains the position in the pool plus one or zero if it is free.
+	int *Hash;
+	//! The number of slots in the hash table. It is always a power of two.
+	int HashSize;
+	//! The number of slots used in the hash table.
+	int HashUsed;
+	//! The events.
+	struct EventEntryStruct *Entry;
+	//! The number of events stored.
+	int NEntries;
+	//! The number of events allocated.
+	int NAllocated;
+	//! The next event to return from memory.
+	int ReadIndex;
+	//! \c True if the events were written to a file because they took too much memory.
+	bool Spilled;
+	//! The file containing the unsorted events once they are spilled.
+	char UnsortName[MAXLEN];
+	//! The file containing the sorted events once they are spilled.
+	char SortedName[MAXLEN];
+	//! The file to write the unsorted events into.
+	FILE *fp_spill;
+	//! The file to read the sorted events from.
+	FileObject *fp_sorted;
+	//! The buffer to read the sorted file.
+	longline line;
+	//! The user ID read from the sorted file.
+	char User[MAXLEN];
+	//! The IP address read from the sorted file.
+	char Ip[MAXLEN];
+};
+
+//! The pool of strings of the list being sorted by qsort.
+static const char *SortPool;
+
+/*!
+Build the names of the temporary files of the list in the current temporary directory.
+
+The daemon mode generates the reports in a child process working in its own
+temporary directory where the files of the list are linked.
+*/
+static void EventList_FileNames(EventListObject List)
+{
+	format_path(__FILE__, __LINE__, List->UnsortName, sizeof(List->UnsortName), "%s/%s.int_unsort", tmp, List->Name);
+	format_path(__FILE__, __LINE__, List->SortedName, sizeof(List->SortedName), "%s/%s.int_log", tmp, List->Name);
+}
+
+/*!
+Create an empty list of events.
+
+\param Name The name of the list used to name the temporary files if the events don't fit
+in memory.
+\param Sort The order in which the events are read back.
+
+\return The list to destroy with EventList_Destroy().
+*/
+EventListObject EventList_Create(const char *Name,enum EventSortEnum Sort)
+{
+	EventListObject List;
+
+	List=calloc(1,sizeof(*List));
+	if (!List) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the %s events\n"),Name);
+		exit(EXIT_FAILURE);
+	}
+	safe_strcpy(List->Name,Name,sizeof(List->Name));
+	List->Sort=Sort;
+	EventList_FileNames(List);
+	return(List);
+}
+
+/*!
+Free the memory used by the events stored in memory.
+*/
+static void EventList_FreeMemory(EventListObject List)
+{
+	if (List->Pool) free(List->Pool);
+	List->Pool=NULL;
+	List->PoolSize=0;
+	List->PoolAllocated=0;
+	if (List->Hash) free(List->Hash);
+	List->Hash=NULL;
+	List->HashSize=0;
+	List->HashUsed=0;
+	if (List->Entry) free(List->Entry);
+	List->Entry=NULL;
+	List->NEntries=0;
+	List->NAllocated=0;
+}
+
+/*!
+Destroy a list of events and delete its temporary files.
+
+\param ListPtr A pointer to the list to destroy. It is reset to NULL.
+*/
+void EventList_Destroy(EventListObject *ListPtr)
+{
+	EventListObject List;
+
+	if (!ListPtr || !*ListPtr) return;
+	List=*ListPtr;
+	*ListPtr=NULL;
+
+	if (List->fp_spill && fclose(List->fp_spill)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),List->UnsortName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (List->fp_sorted) FileObject_Close(List->fp_sorted);
+	if (List->line) longline_destroy(&List->line);
+	if (List->Spilled && !KeepTempLog) {
+		EventList_FileNames(List);
+		if (unlink(List->UnsortName)==-1 && errno!=ENOENT)
+			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),List->UnsortName,strerror(errno));
+		if (unlink(List->SortedName)==-1 && errno!=ENOENT)
+			debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),List->SortedName,strerror(errno));
+	}
+	EventList_FreeMemory(List);
+	free(List);
+}
+
+/*!
+Compute the hash of a string for the hash table of the pool.
+*/
+static unsigned int EventList_HashString(const char *String)
+{
+	unsigned int Hash=2166136261U;
+
+	for ( ; *String ; String++)
+		Hash=(Hash ^ (unsigned char)*String)*16777619U;
+	return(Hash);
+}
+
+/*!
+Double the size of the hash table of the pool.
+*/
+static void EventList_GrowHash(EventListObject List)
+{
+	int *Hash;
+	int HashSize;
+	int i;
+	int j;
+
+	HashSize=(List->HashSize>0) ? 2*List->HashSize : 1024;
+	Hash=calloc(HashSize,sizeof(*Hash));
+	if (!Hash) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the %s events\n"),List->Name);
+		exit(EXIT_FAILURE);
+	}
+	for (i=0 ; i<List->HashSize ; i++) {
+		if (List->Hash[i]==0) continue;
+		j=EventList_HashString(List->Pool+List->Hash[i]-1) & (HashSize-1);
+		while (Hash[j]!=0) j=(j+1) & (HashSize-1);
+		Hash[j]=List->Hash[i];
+	}
+	if (List->Hash) free(List->Hash);
+	List->Hash=Hash;
+	List->HashSize=HashSize;
+}
+
+/*!
+Store a string in the pool unless it is already there.
+
+\return The position of the string in the pool.
+*/
+static int EventList_Intern(EventListObject List,const char *String)
+{
+	int i;
+	int Len;
+	int Offset;
+
+	if (List->HashUsed*2>=List->HashSize) EventList_GrowHash(List);
+	i=EventList_HashString(String) & (List->HashSize-1);
+	while (List->Hash[i]!=0) {
+		if (strcmp(List->Pool+List->Hash[i]-1,String)==0) return(List->Hash[i]-1);
+		i=(i+1) & (List->HashSize-1);
+	}
+
+	Len=strlen(String)+1;
+	if (List->PoolSize+Len>List->PoolAllocated) {
+		char *Pool;
+		int Size=List->PoolAllocated+((Len>65536) ? Len : 65536);
+
+		Pool=realloc(List->Pool,Size);
+		if (!Pool) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the %s events\n"),List->Name);
+			exit(EXIT_FAILURE);
+		}
+		List->Pool=Pool;
+		List->PoolAllocated=Size;
+	}
+	Offset=List->PoolSize;
+	memcpy(List->Pool+Offset,String,Len);
+	List->PoolSize+=Len;
+	List->Hash[i]=Offset+1;
+	List->HashUsed++;
+	return(Offset);
+}
+
+/*!
+Write one event in the unsorted file.
+*/
+static void EventList_WriteEvent(EventListObject List,int Date,int Time,const char *User,const char *Ip,const char *Url,const char *Rule)
+{
+	fprintf(List->fp_spill,"%02d/%02d/%04d\t%02d:%02d:%02d\t%s\t%s\t%s",Date%100,(Date/100)%100,Date/10000,
+			Time/10000,(Time/100)%100,Time%100,User,Ip,Url);
+	if (Rule[0])
+		fprintf(List->fp_spill,"\t%s\n",Rule);
+	else
+		fputc('\n',List->fp_spill);
+}
+
+/*!
+Move the events stored in memory to the unsorted file because they take
+more memory than allowed.
+*/
+static void EventList_Spill(EventListObject List)
+{
+	int i;
+	const struct EventEntryStruct *Entry;
+
+	if (debugz>=LogLevel_Process)
+		debugaz(__FILE__,__LINE__,_("Too many %s events to keep them in memory, writing them to \"%s\"\n"),List->Name,List->UnsortName);
+	if ((List->fp_spill=MY_FOPEN(List->UnsortName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),List->UnsortName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	List->Spilled=true;
+	for (i=0 ; i<List->NEntries ; i++) {
+		Entry=List->Entry+i;
+		EventList_WriteEvent(List,Entry->Date,Entry->Time,List->Pool+Entry->User,List->Pool+Entry->Ip,List->Pool+Entry->Url,List->Pool+Entry->Rule);
+	}
+	EventList_FreeMemory(List);
+}
+
+/*!
+Add one event to the list.
+
+\param List The list to store the event into.
+\param Time The date and time of the event.
+\param User The ID of the user.
+\param Ip The IP address of the user.
+\param Url The URL accessed by the user.
+*/
+void EventList_Add(EventListObject List,const struct tm *Time,const char *User,const char *Ip,const char *Url)
+{
+	EventList_AddRule(List,Time,User,Ip,Url,"");
+}
+
+/*!
+Add one event blocked by a rule to the list.
+
+\param List The list to store the event into.
+\param Time The date and time of the event.
+\param User The ID of the user.
+\param Ip The IP address of the user.
+\param Url The URL accessed by the user.
+\param Rule The rule or category that blocked the access.
+*/
+void EventList_AddRule(EventListObject List,const struct tm *Time,const char *User,const char *Ip,const char *Url,const char *Rule)
+{
+	struct EventEntryStruct *Entry;
+	int Date;
+	int Hour;
+	long long int Memory;
+
+	Date=(Time->tm_year+1900)*10000+(Time->tm_mon+1)*100+Time->tm_mday;
+	Hour=Time->tm_hour*10000+Time->tm_min*100+Time->tm_sec;
+	if (List->Spilled) {
+		if (!List->fp_spill) {
+			// the list was closed by a previous pass of the daemon mode over the logs
+			if ((List->fp_spill=MY_FOPEN(List->UnsortName,"a"))==NULL) {
+				debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),List->UnsortName,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+		}
+		EventList_WriteEvent(List,Date,Hour,User,Ip,Url,Rule);
+		return;
+	}
+
+	if (List->NEntries>=List->NAllocated) {
+		int Size=(List->NAllocated>0) ? 2*List->NAllocated : 1024;
+
+		Entry=realloc(List->Entry,Size*sizeof(*Entry));
+		if (!Entry) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the %s events\n"),List->Name);
+			exit(EXIT_FAILURE);
+		}
+		List->Entry=Entry;
+		List->NAllocated=Size;
+	}
+	Entry=List->Entry+List->NEntries++;
+	Entry->User=EventList_Intern(List,User);
+	Entry->Ip=EventList_Intern(List,Ip);
+	Entry->Url=EventList_Intern(List,Url);
+	Entry->Rule=EventList_Intern(List,Rule);
+	Entry->Date=Date;
+	Entry->Time=Hour;
+
+	Memory=(long long int)List->PoolAllocated+(long long int)List->HashSize*sizeof(*List->Hash)+
+			(long long int)List->NAllocated*sizeof(*List->Entry);
+	if (Memory>(long long int)EventMemoryLimit*1024*1024)
+		EventList_Spill(List);
+}
+
+/*!
+Close the file the events are written to, if any. The file is opened again
+if more events are added.
+*/
+void EventList_Close(EventListObject List)
+{
+	if (List->fp_spill) {
+		if (fclose(List->fp_spill)==EOF) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),List->UnsortName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		List->fp_spill=NULL;
+	}
+}
+
+/*!
+Compare the dates the way the sort command compares the dd/mm/yyyy strings.
+*/
+static int EventList_CompareDate(int Date1,int Date2)
+{
+	if (Date1%100!=Date2%100) return((Date1%100<Date2%100) ? -1 : 1);
+	if ((Date1/100)%100!=(Date2/100)%100) return(((Date1/100)%100<(Date2/100)%100) ? -1 : 1);
+	if (Date1/10000!=Date2/10000) return((Date1/10000<Date2/10000) ? -1 : 1);
+	return(0);
+}
+
+/*!
+Sort the events by user and URL for qsort.
+*/
+static int EventList_CompareUserUrl(const void *Ptr1,const void *Ptr2)
+{
+	const struct EventEntryStruct *Entry1=(const struct EventEntryStruct *)Ptr1;
+	const struct EventEntryStruct *Entry2=(const struct EventEntryStruct *)Ptr2;
+	int Cmp;
+
+	if (Entry1->User!=Entry2->User && (Cmp=strcoll(SortPool+Entry1->User,SortPool+Entry2->User))!=0) return(Cmp);
+	if (Entry1->Url!=Entry2->Url && (Cmp=strcoll(SortPool+Entry1->Url,SortPool+Entry2->Url))!=0) return(Cmp);
+	if ((Cmp=EventList_CompareDate(Entry1->Date,Entry2->Date))!=0) return(Cmp);
+	if (Entry1->Time!=Entry2->Time) return((Entry1->Time<Entry2->Time) ? -1 : 1);
+	if (Entry1->Ip!=Entry2->Ip) return(strcoll(SortPool+Entry1->Ip,SortPool+Entry2->Ip));
+	return(0);
+}
+
+/*!
+Sort the events by user, date, time and URL for qsort.
+*/
+static int EventList_CompareUserTime(const void *Ptr1,const void *Ptr2)
+{
+	const struct EventEntryStruct *Entry1=(const struct EventEntryStruct *)Ptr1;
+	const struct EventEntryStruct *Entry2=(const struct EventEntryStruct *)Ptr2;
+	int Cmp;
+
+	if (Entry1->User!=Entry2->User && (Cmp=strcoll(SortPool+Entry1->User,SortPool+Entry2->User))!=0) return(Cmp);
+	if ((Cmp=EventList_CompareDate(Entry1->Date,Entry2->Date))!=0) return(Cmp);
+	if (Entry1->Time!=Entry2->Time) return((Entry1->Time<Entry2->Time) ? -1 : 1);
+	if (Entry1->Url!=Entry2->Url && (Cmp=strcoll(SortPool+Entry1->Url,SortPool+Entry2->Url))!=0) return(Cmp);
+	if (Entry1->Ip!=Entry2->Ip) return(strcoll(SortPool+Entry1->Ip,SortPool+Entry2->Ip));
+	return(0);
+}
+
+/*!
+Sort the events by user, date in chronological order, IP address, time, URL and rule for qsort.
+*/
+static int EventList_CompareUserDateIp(const void *Ptr1,const void *Ptr2)
+{
+	const struct EventEntryStruct *Entry1=(const struct EventEntryStruct *)Ptr1;
+	const struct EventEntryStruct *Entry2=(const struct EventEntryStruct *)Ptr2;
+	int Cmp;
+
+	if (Entry1->User!=Entry2->User && (Cmp=strcoll(SortPool+Entry1->User,SortPool+Entry2->User))!=0) return(Cmp);
+	if (Entry1->Date!=Entry2->Date) return((Entry1->Date<Entry2->Date) ? -1 : 1);
+	if (Entry1->Ip!=Entry2->Ip && (Cmp=strcoll(SortPool+Entry1->Ip,SortPool+Entry2->Ip))!=0) return(Cmp);
+	if (Entry1->Time!=Entry2->Time) return((Entry1->Time<Entry2->Time) ? -1 : 1);
+	if (Entry1->Url!=Entry2->Url && (Cmp=strcoll(SortPool+Entry1->Url,SortPool+Entry2->Url))!=0) return(Cmp);
+	if (Entry1->Rule!=Entry2->Rule) return(strcoll(SortPool+Entry1->Rule,SortPool+Entry2->Rule));
+	return(0);
+}
+
+/*!
+Sort the events before reading them with EventList_Read().
+*/
+void EventList_Sort(EventListObject List)
+{
+	char csort[4098];
+	const char *keys;
+	int cstatus;
+	int (*Compare)(const void *,const void *);
+
+	EventList_Close(List);
+	EventList_FileNames(List);
+	List->ReadIndex=0;
+	if (!List->Spilled) {
+		switch (List->Sort)
+		{
+			case EVENTSORT_UserTime:
+				Compare=EventList_CompareUserTime;
+				break;
+			case EVENTSORT_UserDateIp:
+				Compare=EventList_CompareUserDateIp;
+				break;
+			default:
+				Compare=EventList_CompareUserUrl;
+				break;
+		}
+		SortPool=List->Pool;
+		if (List->NEntries>1)
+			qsort(List->Entry,List->NEntries,sizeof(*List->Entry),Compare);
+		SortPool=NULL;
+		return;
+	}
+
+	switch (List->Sort)
+	{
+		case EVENTSORT_UserTime:
+			keys="-k 3,3 -k 1,1 -k 2,2 -k 5,5";
+			break;
+		case EVENTSORT_UserDateIp:
+			keys="-k 3,3 -k 1.7,1.10 -k 1.4,1.5 -k 1.1,1.2 -k 4,4";
+			break;
+		default:
+			keys="-k 3,3 -k 5,5";
+			break;
+	}
+	if (snprintf(csort,sizeof(csort),"sort -T \"%s\" -t \"\t\" %s -o \"%s\" \"%s\"",tmp,keys,List->SortedName,List->UnsortName)>=sizeof(csort)) {
+		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),List->UnsortName,List->SortedName);
+		exit(EXIT_FAILURE);
+	}
+	cstatus=system(csort);
+	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
+		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
+		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
+		exit(EXIT_FAILURE);
+	}
+	if (!KeepTempLog && unlink(List->UnsortName)) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),List->UnsortName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if ((List->fp_sorted=FileObject_Open(List->SortedName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),List->SortedName,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	if ((List->line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),List->SortedName);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+Read the next event sorted by EventList_Sort().
+
+\param List The list to read.
+\param Event The structure to fill with the event. The strings it points to
+remain valid until the next event is read.
+
+\return \c True if an event is returned or \c false at the end of the list.
+*/
+bool EventList_Read(EventListObject List,struct EventStruct *Event)
+{
+	char *buf;
+	char *url;
+	char *rule;
+	char data[15];
+	struct getwordstruct gwarea;
+
+	if (!List->Spilled) {
+		const struct EventEntryStruct *Entry;
+
+		if (List->ReadIndex>=List->NEntries) return(false);
+		Entry=List->Entry+List->ReadIndex++;
+		Event->User=List->Pool+Entry->User;
+		Event->Ip=List->Pool+Entry->Ip;
+		Event->Url=List->Pool+Entry->Url;
+		Event->Rule=List->Pool+Entry->Rule;
+		Event->Day=Entry->Date%100;
+		Event->Month=(Entry->Date/100)%100;
+		Event->Year=Entry->Date/10000;
+		snprintf(Event->Time,sizeof(Event->Time),"%02d:%02d:%02d",Entry->Time/10000,(Entry->Time/100)%100,Entry->Time%100);
+		return(true);
+	}
+
+	if (!List->fp_sorted) return(false);
+	while ((buf=longline_read(List->fp_sorted,List->line))!=NULL) {
+		getword_start(&gwarea,buf);
+		if (getword(data,sizeof(data),&gwarea,'\t')<0 || getword(Event->Time,sizeof(Event->Time),&gwarea,'\t')<0 ||
+		    getword(List->User,sizeof(List->User),&gwarea,'\t')<0 || getword(List->Ip,sizeof(List->Ip),&gwarea,'\t')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),List->SortedName);
+			exit(EXIT_FAILURE);
+		}
+		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),List->SortedName);
+			exit(EXIT_FAILURE);
+		}
+		if (getword_ptr(buf,&rule,&gwarea,'\n')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid rule in file \"%s\"\n"),List->SortedName);
+			exit(EXIT_FAILURE);
+		}
+		if (sscanf(data,"%d/%d/%d",&Event->Day,&Event->Month,&Event->Year)!=3) continue;
+		Event->User=List->User;
+		Event->Ip=List->Ip;
+		Event->Url=url;
+		Event->Rule=rule;
+		return(true);
+	}
+
+	if (FileObject_Close(List->fp_sorted)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),List->SortedName,FileObject_GetLastCloseError());
+		exit(EXIT_FAILURE);
+	}
+	List->fp_sorted=NULL;
+	longline_destroy(&List->line);
+	if (!KeepTempLog && unlink(List->SortedName)==-1)
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),List->SortedName,strerror(errno));
+	return(false);
+}
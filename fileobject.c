@@ -75,6 +75,18 @@ static void Standard_Rewind(void *Data)
 	rewind((FILE *)Data);
 }
 
+/*!
+ * Get the position in the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The number of bytes consumed from the file.
+ */
+static long long int Standard_Offset(void *Data)
+{
+	return((long long int)ftello((FILE *)Data));
+}
+
 /*!
  * Close a file using the standard C api.
  *
@@ -123,6 +135,7 @@ FileObject *FileObject_Open(const char *FileName)
 	File->Eof=Standard_Eof;
 	File->Rewind=Standard_Rewind;
 	File->Close=Standard_Close;
+	File->Offset=Standard_Offset;
 	return(File);
 }
 
@@ -155,6 +168,144 @@ FileObject *FileObject_FdOpen(int fd)
 	File->Eof=Standard_Eof;
 	File->Rewind=Standard_Rewind;
 	File->Close=Standard_Close;
+	File->Offset=Standard_Offset;
+	return(File);
+}
+
+//! A part of a file read by a file object.
+struct RangeFileStruct
+{
+	//! The file to read.
+	FILE *File;
+	//! The offset of the first byte to read.
+	long long int Start;
+	//! The offset of the byte after the last one to read.
+	long long int End;
+	//! The offset of the next byte to read.
+	long long int Pos;
+};
+
+/*!
+ * Read a part of a file using the standard C api.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int Range_Read(void *Data,void *Buffer,int Size)
+{
+	struct RangeFileStruct *Range=(struct RangeFileStruct *)Data;
+	int nread;
+
+	if (Range->Pos>=Range->End) return(0);
+	if ((long long int)Size>Range->End-Range->Pos)
+		Size=(int)(Range->End-Range->Pos);
+	nread=fread(Buffer,1,Size,Range->File);
+	Range->Pos+=nread;
+	return(nread);
+}
+
+/*!
+ * Check if the end of the part of the file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int Range_Eof(void *Data)
+{
+	struct RangeFileStruct *Range=(struct RangeFileStruct *)Data;
+
+	return(Range->Pos>=Range->End || feof(Range->File));
+}
+
+/*!
+ * Return to the beginning of the part of the file.
+ *
+ * \param Data The file object.
+ */
+static void Range_Rewind(void *Data)
+{
+	struct RangeFileStruct *Range=(struct RangeFileStruct *)Data;
+
+	if (fseeko(Range->File,(off_t)Range->Start,SEEK_SET)==0)
+		Range->Pos=Range->Start;
+}
+
+/*!
+ * Get the offset of the next byte to read in the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The offset from the beginning of the file.
+ */
+static long long int Range_Offset(void *Data)
+{
+	return(((struct RangeFileStruct *)Data)->Pos);
+}
+
+/*!
+ * Close a part of a file.
+ *
+ * \param Data File to close.
+ *
+ * \return EOF on error.
+ */
+static int Range_Close(void *Data)
+{
+	struct RangeFileStruct *Range=(struct RangeFileStruct *)Data;
+	int RetCode;
+
+	RetCode=Standard_Close(Range->File);
+	free(Range);
+	return(RetCode);
+}
+
+/*!
+ * Open a part of a file for reading using the standard C api.
+ *
+ * The bytes after \a End are not returned even if the file is longer. It
+ * is meant to read the lines fully written in a log that is still growing.
+ *
+ * \param fd The file to read.
+ * \param Start The offset of the first byte to read.
+ * \param End The offset of the byte after the last one to read.
+ *
+ * \return The object to pass to other function in this module.
+ */
+FileObject *FileObject_FdOpenRange(int fd,long long int Start,long long int End)
+{
+	FileObject *File;
+	struct RangeFileStruct *Range;
+
+	LastOpenErrorString[0]='\0';
+	File=malloc(sizeof(*File));
+	Range=calloc(1,sizeof(*Range));
+	if (!File || !Range)
+	{
+		if (File) free(File);
+		if (Range) free(Range);
+		FileObject_SetLastOpenError(_("Not enough memory"));
+		return(NULL);
+	}
+	if (lseek(fd,(off_t)Start,SEEK_SET)==-1 || (Range->File=fdopen(fd,"r"))==NULL)
+	{
+		free(Range);
+		free(File);
+		FileObject_SetLastOpenError(strerror(errno));
+		return(NULL);
+	}
+	Range->Start=Start;
+	Range->End=(End<Start) ? Start : End;
+	Range->Pos=Start;
+	File->Data=Range;
+	File->Read=Range_Read;
+	File->Eof=Range_Eof;
+	File->Rewind=Range_Rewind;
+	File->Close=Range_Close;
+	File->Offset=Range_Offset;
 	return(File);
 }
 
@@ -195,6 +346,23 @@ void FileObject_Rewind(FileObject *File)
 	File->Rewind(File->Data);
 }
 
+/*!
+ * Get how far the reading progressed in the underlying file.
+ *
+ * For a compressed file, it is the number of compressed bytes consumed
+ * so far. It can be compared to the size of the file to estimate the
+ * progress without reading the file twice.
+ *
+ * \param File The file object.
+ *
+ * \return The number of bytes consumed or -1 if it is unknown.
+ */
+long long int FileObject_Offset(FileObject *File)
+{
+	if (!File->Offset) return(-1);
+	return(File->Offset(File->Data));
+}
+
 /*!
  * Close the file opened. The memory is freed. The object
  * cannot be reused after this function returns.
@@ -46,6 +46,12 @@ extern FileListObject UserAgentLog;
 extern bool UserAgentFromCmdLine;
 extern char StripUserSuffix[MAX_USER_LEN];
 extern int StripSuffixLen;
+extern int ReportJobs;
+extern enum TimeDatePageEnum TimeDatePages;
+extern enum HtmlCompressionEnum HtmlCompression;
+extern enum StreamCompressionEnum SplitCompression;
+extern bool IndexManifest;
+extern int EventMemoryLimit;
 
 struct param_list
 {
@@ -217,6 +223,26 @@ static struct select_list per_user_limit_create_file[]=
 	{"as_required",PUFC_AsRequired}, //create the file if necessary (no empty file is created)
 };
 
+static struct select_list site_user_time_date_type_values[]=
+{
+	{"html",TDP_Html}, //one complete page per user
+	{"lazy",TDP_Lazy}, //one data file per user and a shared viewer
+};
+
+static struct select_list html_compression_values[]=
+{
+	{"none",HTMLCOMP_None}, //uncompressed pages
+	{"gzip",HTMLCOMP_Gzip}, //pages compressed with gzip
+	{"both",HTMLCOMP_Both}, //uncompressed and compressed pages
+};
+
+static struct select_list split_compression_values[]=
+{
+	{"none",STREAMCOMP_None}, //uncompressed daily files
+	{"gzip",STREAMCOMP_Gzip}, //daily files compressed with gzip
+	{"zstd",STREAMCOMP_Zstd}, //daily files compressed with zstd
+};
+
 static int is_param(const char *param,const char *buf)
 {
 	int plen;
@@ -731,6 +757,21 @@ static void parmtest(char *buf,const char *File)
 		return;
 	}
 
+	if (getparam_select("site_user_time_date_type",SET_LIST(site_user_time_date_type_values),buf,&iVal)>0) {
+		TimeDatePages=(enum TimeDatePageEnum)iVal;
+		return;
+	}
+
+	if (getparam_select("html_compression",SET_LIST(html_compression_values),buf,&iVal)>0) {
+		HtmlCompression=(enum HtmlCompressionEnum)iVal;
+		return;
+	}
+
+	if (getparam_select("split_compression",SET_LIST(split_compression_values),buf,&iVal)>0) {
+		SplitCompression=(enum StreamCompressionEnum)iVal;
+		return;
+	}
+
 	if (getparam_int("lastlog",buf,&LastLog)>0) return;
 
 	if (getparam_bool("remove_temp_files",buf,&RemoveTempFiles)>0) return;
@@ -743,6 +784,8 @@ static void parmtest(char *buf,const char *File)
 
 	if (getparam_list("index_fields",SET_LIST(indexfields_values),buf,&IndexFields)>0) return;
 
+	if (getparam_bool("index_manifest",buf,&IndexManifest)>0) return;
+
 	if (getparam_bool("overwrite_report",buf,&OverwriteReport)>0) return;
 
 	if (getparam_list("records_without_userid",SET_LIST(recnouser_values),buf,&RecordsWithoutUser)>0) return;
@@ -751,6 +794,12 @@ static void parmtest(char *buf,const char *File)
 
 	if (getparam_string("mail_utility",buf,MailUtility,sizeof(MailUtility))>0) return;
 
+	if (getparam_string("mail_queue_dir",buf,MailQueueDir,sizeof(MailQueueDir))>0) return;
+
+	if (getparam_int("mail_workers",buf,&MailWorkers)>0) return;
+
+	if (getparam_int("mail_retries",buf,&MailRetries)>0) return;
+
 	if (getparam_int("topsites_num",buf,&TopSitesNum)>0) return;
 
 	if (getparam_int("topuser_num",buf,&TopUsersNum)>0) return;
@@ -830,6 +879,22 @@ static void parmtest(char *buf,const char *File)
 
 	if (getparam_int("download_report_limit",buf,&DownloadReportLimit)>0) return;
 
+	if (getparam_int("event_memory_limit",buf,&EventMemoryLimit)>0) {
+		if (EventMemoryLimit<0 || EventMemoryLimit>1024) {
+			debuga(__FILE__,__LINE__,_("The memory limit of the denied, authentication failures and downloads events must be between 0 and 1024 MB\n"));
+			exit(EXIT_FAILURE);
+		}
+		return;
+	}
+
+	if (getparam_int("report_jobs",buf,&ReportJobs)>0) {
+		if (ReportJobs<1) {
+			debuga(__FILE__,__LINE__,_("The number of report jobs must be at least 1\n"));
+			exit(EXIT_FAILURE);
+		}
+		return;
+	}
+
 	if (getparam_string("www_document_root",buf,wwwDocumentRoot,sizeof(wwwDocumentRoot))>0) return;
 
 	if (getparam_string("block_it",buf,BlockIt,sizeof(BlockIt))>0) return;
@@ -922,6 +987,20 @@ static void parmtest(char *buf,const char *File)
 
 	if (getparam_int("realtime_access_log_lines",buf,&realtime_access_log_lines)>0) return;
 
+	if (getparam_bool("realtime_follow",buf,&RealtimeFollow)>0) return;
+
+	if (getparam_int("daemon_interval",buf,&DaemonInterval)>0) return;
+
+	if (getparam_string("daemon_state_file",buf,DaemonStateFile,sizeof(DaemonStateFile))>0) return;
+
+	if (getparam_string("aggregate_dir",buf,AggregateDir,sizeof(AggregateDir))>0) return;
+
+	if (getparam_string("log_catalog_file",buf,LogCatalogFile,sizeof(LogCatalogFile))>0) return;
+
+	if (getparam_string("log_index_dir",buf,LogIndexDir,sizeof(LogIndexDir))>0) return;
+
+	if (getparam_string("parse_cache_dir",buf,ParseCacheDir,sizeof(ParseCacheDir))>0) return;
+
 	if (getparam_string("LDAPHost",buf,LDAPHost,sizeof(LDAPHost))>0) return;
 
 	if (getparam_int("LDAPPort",buf,&LDAPPort)>0) return;
@@ -1015,6 +1094,7 @@ void getconf(const char *File)
 		if (debugz>=LogLevel_Data)
 			printf("SYSCONFDIR %s\n",buf);
 
+		ParseCache_AddConfig(buf);
 		parmtest(buf,File);
 	}
 
@@ -734,7 +734,7 @@ void greport_day(const struct userinfostruct *uinfo)
 		debuga_more("%s/%s/%s\n",outdirname,uinfo->filename,"graph.html");
 		exit(EXIT_FAILURE);
 	}
-	if ((fp_ou=fopen(wdirname,"wt"))==NULL) {
+	if ((fp_ou=open_html_file(wdirname,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),wdirname,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
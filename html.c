@@ -35,6 +35,7 @@ struct PerUserLimitStruct PerUserLimits[MAX_USER_LIMITS];
 enum PerUserFileCreationEnum PerUserFileCreation=PUFC_Always;
 
 extern struct globalstatstruct globstat;
+extern enum TimeDatePageEnum TimeDatePages;
 
 void htmlrel(void)
 {
@@ -62,6 +63,7 @@ void htmlrel(void)
 	int count;
 	int cstatus;
 	int i;
+	int ret;
 	unsigned int user_limit[(MAX_USER_LIMITS+sizeof(unsigned int)-1)/sizeof(unsigned int)];
 	bool have_denied_report;
 	const char *sort_field;
@@ -164,10 +166,7 @@ void htmlrel(void)
 			debuga_more("%s/denied_%s.html\n",outdirname,uinfo->filename);
 			exit(EXIT_FAILURE);
 		}
-		if (access(duser, R_OK) != 0)
-			have_denied_report=false;
-		else
-			have_denied_report=true;
+		have_denied_report=html_file_exists(duser);
 
 		if ((line=longline_create())==NULL) {
 			debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),arqin);
@@ -221,7 +220,7 @@ void htmlrel(void)
 
 		FileObject_Rewind(fp_in);
 
-		if ((fp_ou = fopen(arqou, "w")) == 0){
+		if ((fp_ou = open_html_file(arqou,"w")) == 0){
 			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arqou,strerror(errno));
 			exit(EXIT_FAILURE);
 		}
@@ -313,7 +312,13 @@ void htmlrel(void)
 
 				if ((ReportType & REPORT_TYPE_SITE_USER_TIME_DATE) != 0) {
 					url_to_anchor(url,siteind,sizeof(siteind));
-					fprintf(fp_ou,"<td class=\"data\"><a href=\"tt.html#%s\"><img src=\"%s/datetime.png\" title=\"%s\" alt=\"T\"></a></td>",siteind,tmp6,_("date/time report"));
+					if (TimeDatePages==TDP_Lazy) {
+						fputs("<td class=\"data\"><a href=\"../"TT_VIEWER_FILE"?u=",fp_ou);
+						output_html_url(fp_ou,uinfo->filename);
+						fprintf(fp_ou,"#%s\">",siteind);
+					} else
+						fprintf(fp_ou,"<td class=\"data\"><a href=\"tt.html#%s\">",siteind);
+					fprintf(fp_ou,"<img src=\"%s/datetime.png\" title=\"%s\" alt=\"T\"></a></td>",tmp6,_("date/time report"));
 				} else {
 					fprintf(fp_ou,"<td class=\"data\"></td>");
 				}
@@ -371,8 +376,14 @@ void htmlrel(void)
 				fputs("</tr>\n",fp_ou);
 				count++;
 			} else if ((ReportType & REPORT_TYPE_SITE_USER_TIME_DATE) != 0) {
-				format_path(__FILE__, __LINE__, warea,sizeof(warea), "%s/%s/tt.html", outdirname, uinfo->filename);
-				if (unlink(warea)!=0) {
+				if (TimeDatePages==TDP_Lazy) {
+					format_path(__FILE__, __LINE__, warea,sizeof(warea), "%s/%s/"TT_DATA_FILE, outdirname, uinfo->filename);
+					ret=unlink(warea);
+				} else {
+					format_path(__FILE__, __LINE__, warea,sizeof(warea), "%s/%s/tt.html", outdirname, uinfo->filename);
+					ret=unlink_html_file(warea);
+				}
+				if (ret!=0) {
 					debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),warea,strerror(errno));
 				}
 			}
@@ -0,0 +1,212 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Write the HTML pages of the report.
+
+The pages can be compressed with gzip as they are written so that a web server
+can send them without compressing them again on every request.
+*/
+
+// fopencookie() is a GNU extension
+#define _GNU_SOURCE
+#include "include/conf.h"
+#include "include/defs.h"
+#ifdef HAVE_ZLIB_H
+#include "zlib.h"
+#endif
+
+//! How to write the HTML pages.
+enum HtmlCompressionEnum HtmlCompression=HTMLCOMP_None;
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_FOPENCOOKIE)
+/*!
+ * \brief State of a HTML page written through zlib.
+ */
+struct HtmlGzStruct
+{
+	//! The compressed file.
+	gzFile Gz;
+	//! The uncompressed copy of the page if both are written.
+	FILE *Plain;
+};
+
+/*!
+ * Write the data to the compressed page and, if requested, to
+ * the uncompressed copy.
+ *
+ * \param Cookie The HtmlGzStruct of the file.
+ * \param Buffer The data to write.
+ * \param Size The number of bytes to write.
+ *
+ * \return The number of bytes written or -1 on error.
+ */
+static ssize_t HtmlGz_Write(void *Cookie,const char *Buffer,size_t Size)
+{
+	struct HtmlGzStruct *Html=(struct HtmlGzStruct *)Cookie;
+	size_t Written;
+	int Chunk;
+
+	if (Html->Plain && fwrite(Buffer,1,Size,Html->Plain)!=Size)
+		return(-1);
+	for (Written=0 ; Written<Size ; Written+=Chunk) {
+		Chunk=(Size-Written>0x10000000) ? 0x10000000 : (int)(Size-Written);
+		if (gzwrite(Html->Gz,Buffer+Written,Chunk)!=Chunk) {
+			errno=EIO;
+			return(-1);
+		}
+	}
+	return(Size);
+}
+
+/*!
+ * Close the compressed page and the uncompressed copy.
+ *
+ * \param Cookie The HtmlGzStruct of the file.
+ *
+ * \return 0 on success or EOF on error.
+ */
+static int HtmlGz_Close(void *Cookie)
+{
+	struct HtmlGzStruct *Html=(struct HtmlGzStruct *)Cookie;
+	int RetCode=0;
+
+	if (Html->Plain && fclose(Html->Plain)==EOF)
+		RetCode=EOF;
+	if (gzclose(Html->Gz)!=Z_OK) {
+		if (RetCode==0) errno=EIO;
+		RetCode=EOF;
+	}
+	free(Html);
+	return(RetCode);
+}
+#endif
+
+/*!
+ * Open a HTML page of the report for writing.
+ *
+ * Depending on html_compression, the page is written as is, compressed
+ * with gzip in a file with the .gz suffix or both. The returned
+ * stream is used and closed like any other FILE.
+ *
+ * \param FileName The name of the uncompressed HTML page.
+ * \param Mode The open mode. It must be "w" or "a".
+ *
+ * \return The stream or NULL on error with errno set.
+ */
+FILE *open_html_file(const char *FileName,const char *Mode)
+{
+#if defined(HAVE_ZLIB_H) && defined(HAVE_FOPENCOOKIE)
+	struct HtmlGzStruct *Html;
+	char GzName[MAXLEN];
+	cookie_io_functions_t Functions;
+	FILE *fp;
+#endif
+
+	if (HtmlCompression==HTMLCOMP_None || email[0]!='\0')
+		return(fopen(FileName,Mode));
+
+#if defined(HAVE_ZLIB_H) && defined(HAVE_FOPENCOOKIE)
+	if (snprintf(GzName,sizeof(GzName),"%s.gz",FileName)>=sizeof(GzName)) {
+		errno=ENAMETOOLONG;
+		return(NULL);
+	}
+	Html=(struct HtmlGzStruct *)calloc(1,sizeof(*Html));
+	if (!Html) return(NULL);
+	if (HtmlCompression==HTMLCOMP_Both) {
+		Html->Plain=fopen(FileName,Mode);
+		if (!Html->Plain) {
+			free(Html);
+			return(NULL);
+		}
+	}
+	Html->Gz=gzopen(GzName,(Mode[0]=='a') ? "ab" : "wb");
+	if (!Html->Gz) {
+		if (errno==0) errno=ENOMEM;
+		if (Html->Plain) fclose(Html->Plain);
+		free(Html);
+		return(NULL);
+	}
+	memset(&Functions,0,sizeof(Functions));
+	Functions.write=HtmlGz_Write;
+	Functions.close=HtmlGz_Close;
+	fp=fopencookie(Html,"w",Functions);
+	if (!fp) {
+		gzclose(Html->Gz);
+		if (Html->Plain) fclose(Html->Plain);
+		free(Html);
+		return(NULL);
+	}
+	return(fp);
+#else
+	debuga(__FILE__,__LINE__,_("Compressed HTML pages are not supported by this build of sarg\n"));
+	exit(EXIT_FAILURE);
+#endif
+}
+
+/*!
+ * Check if a HTML page exists either compressed or not.
+ *
+ * \param FileName The name of the uncompressed HTML page.
+ *
+ * \return \c True if the page exists.
+ */
+bool html_file_exists(const char *FileName)
+{
+	char GzName[MAXLEN];
+
+	if (access(FileName,R_OK)==0) return(true);
+	if (snprintf(GzName,sizeof(GzName),"%s.gz",FileName)>=sizeof(GzName)) return(false);
+	return(access(GzName,R_OK)==0);
+}
+
+/*!
+ * Delete a HTML page and its compressed version.
+ *
+ * \param FileName The name of the uncompressed HTML page.
+ *
+ * \return 0 if at least one file was deleted or -1 with errno set.
+ */
+int unlink_html_file(const char *FileName)
+{
+	char GzName[MAXLEN];
+	int Deleted=0;
+	int Error=ENOENT;
+
+	if (unlink(FileName)==0)
+		Deleted++;
+	else if (errno!=ENOENT)
+		Error=errno;
+	if (snprintf(GzName,sizeof(GzName),"%s.gz",FileName)<sizeof(GzName)) {
+		if (unlink(GzName)==0)
+			Deleted++;
+		else if (errno!=ENOENT)
+			Error=errno;
+	}
+	if (Deleted>0) return(0);
+	errno=Error;
+	return(-1);
+}
@@ -129,6 +129,12 @@ typedef int bool;
 #define MY_FOPEN fopen
 #endif
 
+#ifdef HAVE_LSTAT
+#define MY_LSTAT lstat
+#else
+#define MY_LSTAT stat
+#endif
+
 #if !defined(HAVE_BZERO)
 #define bzero(mem,size) memset(mem,0,size)
 #endif
@@ -295,6 +301,14 @@ Sarg will complain that there are too many days in the files if this limit is ov
 //! Name of the html file containing the index of a report file.
 #define INDEX_HTML_FILE "index.html"
 
+//! Name of the page displaying the site, user, time and date data of any user.
+#define TT_VIEWER_FILE "tt.html"
+//! Name of the file containing the site, user, time and date data of one user.
+#define TT_DATA_FILE "tt.js"
+
+//! Name of the file storing the size of a report directory.
+#define DIR_SIZE_FILE "sarg-size"
+
 struct periodstruct
 {
    //! The first date of the period.
@@ -325,6 +339,9 @@ bool OverwriteReport;
 unsigned long int RecordsWithoutUser;
 bool UseComma;
 char MailUtility[PATH_MAX];
+char MailQueueDir[MAXLEN];
+int MailWorkers;
+int MailRetries;
 int TopSitesNum;
 int TopUsersNum;
 char ExcludeCodes[256];
@@ -442,6 +459,14 @@ char RealtimeTypes[1024];
 char cmd[255];
 char ImageFile[255];
 unsigned long int RealtimeUnauthRec;
+bool RealtimeFollow;
+bool DaemonMode;
+int DaemonInterval;
+char DaemonStateFile[MAXLEN];
+char AggregateDir[MAXLEN];
+char LogCatalogFile[MAXLEN];
+char LogIndexDir[MAXLEN];
+char ParseCacheDir[MAXLEN];
 char LDAPHost[255];
 char LDAPBindDN[512];
 char LDAPBindPW[255];
@@ -161,6 +161,43 @@ enum PerUserFileCreationEnum
 	PUFC_AsRequired
 };
 
+/*!
+\brief How to write the site, user, time and date report.
+*/
+enum TimeDatePageEnum
+{
+	//! Write one complete HTML page per user.
+	TDP_Html,
+	//! Write one compact data file per user rendered by a shared page when it is opened.
+	TDP_Lazy
+};
+
+/*!
+\brief How to write the HTML pages of the report.
+*/
+enum HtmlCompressionEnum
+{
+	//! Write uncompressed pages.
+	HTMLCOMP_None,
+	//! Write the pages compressed with gzip only.
+	HTMLCOMP_Gzip,
+	//! Write the uncompressed and the compressed pages.
+	HTMLCOMP_Both
+};
+
+/*!
+\brief How to compress a file as it is written.
+*/
+enum StreamCompressionEnum
+{
+	//! Write the file uncompressed.
+	STREAMCOMP_None,
+	//! Compress the file with gzip.
+	STREAMCOMP_Gzip,
+	//! Compress the file with zstd.
+	STREAMCOMP_Zstd
+};
+
 /*!
 \brief What to write into the per_user_limit file.
 */
@@ -183,6 +220,31 @@ struct PerUserLimitStruct
 	enum PerUserOutputEnum Output;
 };
 
+/*!
+\brief The day of the last time converted by localtime_cached().
+
+It must be zeroed before the first conversion.
+*/
+struct LocalTimeCacheStruct
+{
+	//! The first second of the day.
+	time_t Start;
+	//! The first second of the next day.
+	time_t End;
+	//! \c True if the time of the day is the number of seconds elapsed since \a Start.
+	bool Linear;
+	//! The day at midnight.
+	struct tm Day;
+	//! The day as YYYYMMDD.
+	int Date;
+};
+
+// aggregate.c
+void aggregate_add(const struct tm *Time,const char *User,const char *Ip,const char *Url,const char *Code,long long int Bytes,long long int Elapsed);
+void aggregate_save(const struct ReadLogDataStruct *Filter);
+void aggregate_free(void);
+int aggregate_load(const struct ReadLogDataStruct *Filter);
+
 // auth.c
 void htaccess(const struct userinfostruct *uinfo);
 
@@ -194,13 +256,21 @@ bool is_authfail(void);
 void authfail_report(void);
 void authfail_cleanup(void);
 
+// compfile.c
+const char *compressed_file_suffix(enum StreamCompressionEnum Method);
+FILE *open_compressed_file(const char *FileName,enum StreamCompressionEnum Method,bool Append);
+
 // convlog.c
-void convlog(const char* arq, char df, const struct ReadLogDataStruct *ReadFilter);
+void convlog(char df, const struct ReadLogDataStruct *ReadFilter, const char *prefix);
 
 // css.c
 void css_content(FILE *fp_css);
 void css(FILE *fp_css);
 
+// daemon.c
+void daemon_run(struct ReadLogDataStruct *Filter,void (*Report)(struct ReadLogDataStruct *Filter));
+void daemon_replace_report(const char *ReportDir);
+
 // dansguardian_log.c
 void dansguardian_log(const struct ReadLogDataStruct *ReadFilter);
 
@@ -212,6 +282,8 @@ void data_file(char *tmp);
 
 // decomp.c
 FileObject *decomp(const char *arq);
+FileObject *decomp_range(const char *arq,long long int Start,long long int *End);
+FileObject *decomp_readahead(const char *arq,int fd,FileObject *fi);
 
 // denied.c
 void denied_open(void);
@@ -221,6 +293,11 @@ bool is_denied(void);
 void gen_denied_report(void);
 void denied_cleanup(void);
 
+// dirsize.c
+long long int get_file_size(const struct stat *statb);
+long long int dir_size(const char *path);
+void dir_size_record(const char *path);
+
 // download.c
 void download_open(void);
 void download_write(const struct ReadLogStruct *log_entry,const char *url);
@@ -229,12 +306,13 @@ bool is_download(void);
 void download_report(void);
 void free_download(void);
 void set_download_suffix(const char *list);
-bool is_download_suffix(const char *url);
+bool is_download_suffix(const char *url,const char *end);
 void download_cleanup(void);
 
 // email.c
 FILE *Email_OutputFile(const char *Module);
 void Email_Send(FILE *fp,const char *Subject);
+void Email_Flush(void);
 
 // exclude.c
 void gethexclude(const char *hexfile, int debug);
@@ -260,6 +338,11 @@ void greport_cleanup(void);
 // html.c
 void htmlrel(void);
 
+// htmlfile.c
+FILE *open_html_file(const char *FileName,const char *Mode);
+bool html_file_exists(const char *FileName);
+int unlink_html_file(const char *FileName);
+
 // indexonly.c
 void index_only(const char *dirname,int debug);
 
@@ -272,6 +355,18 @@ void name2ip(char *name,int name_size);
 
 // lastlog.c
 void mklastlog(const char *outdir);
+void lastlog_register(const char *ReportDir,time_t CreationTime);
+void lastlog_reset(void);
+
+// logcatalog.c
+long long int LogCatalog_Stamp(const struct tm *t);
+bool LogCatalog_Find(const char *FileName,const struct stat *st,int *MinDate,int *MaxDate,long long int *Disorder);
+void LogCatalog_Store(const char *FileName,const struct stat *st,int MinDate,int MaxDate,long long int Disorder);
+void LogCatalog_Save(void);
+void LogCatalog_Free(void);
+
+// logindex.c
+FileObject *LogIndex_Open(const char *FileName,const struct stat *st,long long int Target,long long int (*Stamp)(void *Data,char *Line),void *StampData,long long int *Offset);
 
 // longline.c
 __attribute__((warn_unused_result)) /*@null@*//*@only@*/longline longline_create(void);
@@ -282,6 +377,10 @@ void longline_destroy(/*@out@*//*@only@*//*@null@*/longline *line_ptr);
 // index.c
 void make_index(void);
 
+// parsecache.c
+void ParseCache_AddConfig(const char *Line);
+void ParseCache_Fingerprint(const struct ReadLogDataStruct *Filter,const char *HostExclude);
+
 // readlog.c
 int ReadLogFile(struct ReadLogDataStruct *Filter);
 bool GetLogPeriod(struct tm *Start,struct tm *End);
@@ -305,6 +404,7 @@ void totalger(FILE *fp_gen,const char *filename);
 void siteuser(void);
 
 // smartfilter.c
+void smartfilter_write(const char *user, const char *ip, const char *data, const char *hora, const char *url, const char *smart);
 void smartfilter_report(void);
 
 // sort.c
@@ -314,6 +414,7 @@ void sort_labels(const char **label,const char **order);
 
 // splitlog.c
 void splitlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilter, int convert, const char *splitprefix);
+void splitlog_close(void);
 
 // topsites.c
 void topsites(void);
@@ -334,14 +435,15 @@ void read_hostalias(const char *Filename);
 void free_hostalias(void);
 const char *skip_scheme(const char *url);
 const char *process_url(const char *url,bool full_url);
+const char *process_schemeless_url(const char *start,bool full_url);
 void url_hostname(const char *url,char *hostname,int hostsize);
 
 // usage.c
 void usage(const char *prog);
 
 // useragent.c
-FILE *UserAgent_Open(void);
-void UserAgent_Write(FILE *fp,const struct tm *Time,const char *Ip,const char *User,const char *Agent);
+void UserAgent_Open(void);
+void UserAgent_Write(const struct ReadLogStruct *log_entry);
 void UserAgent_Readlog(const struct ReadLogDataStruct *ReadFilter);
 void UserAgent(void);
 
@@ -400,6 +502,7 @@ void write_html_trailer(FILE *fp_ou);
 void output_html_string(FILE *fp_ou,const char *str,int maxlen);
 void output_html_url(FILE *fp_ou,const char *url);
 void output_html_link(FILE *fp_ou,const char *url,int maxlen);
+void output_js_string(FILE *fp_ou,const char *str);
 void debuga(const char *File, int Line, const char *msg,...) __attribute__((format(printf,3,4)));
 void debuga_more(const char *msg,...) __attribute__((format(printf,1,2)));
 void debugaz(const char *File,int Line,const char *msg,...) __attribute__((format(printf,3,4)));
@@ -412,6 +515,7 @@ char *buildtime(long long int elap);
 int obtdate(const char *dirname, const char *name, char *data);
 void formatdate(char *date,int date_size,int year,int month,int day,int hour,int minute,int second,int dst);
 void computedate(int year,int month,int day,struct tm *t);
+void localtime_cached(struct LocalTimeCacheStruct *Cache,time_t tt,struct tm *t);
 int obtuser(const char *dirname, const char *name);
 void obttotal(const char *dirname, const char *name, int nuser, long long int *tbytes, long long int *media);
 void version(void);
@@ -0,0 +1,48 @@
+#ifndef EVENTLIST_HEADER
+#define EVENTLIST_HEADER
+
+//! A list of events (denied accesses, authentication failures, downloads, blocked accesses...) collected from the logs.
+typedef struct EventListStruct *EventListObject;
+
+//! The order in which the events are returned by EventList_Read().
+enum EventSortEnum
+{
+	//! Sort by user then URL.
+	EVENTSORT_UserUrl,
+	//! Sort by user, date, time and URL.
+	EVENTSORT_UserTime,
+	//! Sort by user, date in chronological order and IP address then by time, URL and rule.
+	EVENTSORT_UserDateIp
+};
+
+//! One event read from the list.
+struct EventStruct
+{
+	//! The ID of the user.
+	const char *User;
+	//! The IP address of the user.
+	const char *Ip;
+	//! The URL accessed by the user.
+	const char *Url;
+	//! The day of the event.
+	int Day;
+	//! The month of the event (1 to 12).
+	int Month;
+	//! The year of the event.
+	int Year;
+	//! The time of the event formatted as HH:MM:SS.
+	char Time[15];
+	//! The rule or category that blocked the access. It is an empty string if the event has none.
+	const char *Rule;
+};
+
+EventListObject EventList_Create(const char *Name,enum EventSortEnum Sort);
+void EventList_Destroy(EventListObject *ListPtr);
+
+void EventList_Add(EventListObject List,const struct tm *Time,const char *User,const char *Ip,const char *Url);
+void EventList_AddRule(EventListObject List,const struct tm *Time,const char *User,const char *Ip,const char *Url,const char *Rule);
+void EventList_Close(EventListObject List);
+void EventList_Sort(EventListObject List);
+bool EventList_Read(EventListObject List,struct EventStruct *Event);
+
+#endif //EVENTLIST_HEADER
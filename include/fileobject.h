@@ -8,13 +8,17 @@ typedef struct FileObjectStruct
 	int (*Eof)(void *Data);
 	void (*Rewind)(void *Data);
 	int (*Close)(void *Data);
+	//! Return how many bytes of the underlying file were consumed. May be NULL.
+	long long int (*Offset)(void *Data);
 } FileObject;
 
 FileObject *FileObject_Open(const char *FileName);
 FileObject *FileObject_FdOpen(int fd);
+FileObject *FileObject_FdOpenRange(int fd,long long int Start,long long int End);
 int FileObject_Read(FileObject *File,void *Buffer,int Size);
 int FileObject_Eof(FileObject *File);
 void FileObject_Rewind(FileObject *File);
+long long int FileObject_Offset(FileObject *File);
 int FileObject_Close(FileObject *File);
 
 void FileObject_SetLastOpenError(const char *Message);
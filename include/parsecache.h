@@ -0,0 +1,47 @@
+#ifndef PARSECACHE_HEADER
+#define PARSECACHE_HEADER
+
+//! The cache of the entries read from one access log.
+typedef struct ParseCacheStruct *ParseCacheObject;
+
+//! The kind of record stored in the cache.
+enum ParseCacheKindEnum
+{
+	//! A line excluded before it was parsed.
+	PCK_Skipped,
+	//! An entry excluded by the filters.
+	PCK_Excluded,
+	//! An entry kept by the filters.
+	PCK_Kept
+};
+
+//! One line of an access log as stored in the cache.
+struct ParseCacheEntryStruct
+{
+	//! What the record contains.
+	enum ParseCacheKindEnum Kind;
+	//! Why the line or entry was excluded.
+	int Reason;
+	//! The index of the log format of the entry.
+	int Format;
+	//! The entry with the user ID and the URL processed by the filters.
+	struct ReadLogStruct Entry;
+	//! The URL without the scheme as written in the reports.
+	const char *Url;
+	//! The SmartFilter tag of the line formatted for the temporary files.
+	const char *SmartFilter;
+	//! The URL of the downloaded file or NULL if the entry isn't a download.
+	const char *DownloadUrl;
+	//! \c True if the user is identified by the IP address.
+	bool IdIsIp;
+};
+
+ParseCacheObject ParseCache_Open(const char *FileName,const struct stat *st);
+ParseCacheObject ParseCache_Create(const char *FileName,const struct stat *st);
+void ParseCache_Skip(ParseCacheObject Cache,int Reason);
+void ParseCache_Write(ParseCacheObject Cache,const struct ParseCacheEntryStruct *Rec);
+bool ParseCache_Read(ParseCacheObject Cache,struct ParseCacheEntryStruct *Rec);
+void ParseCache_Close(ParseCacheObject *CachePtr,bool Complete);
+void ParseCache_Purge(void);
+
+#endif //PARSECACHE_HEADER
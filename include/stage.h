@@ -0,0 +1,26 @@
+#ifndef STAGE_HEADER
+#define STAGE_HEADER
+
+//! The maximum number of stages a list can hold.
+#define MAX_STAGES 32
+
+//! The stage must run in the main process because it changes the memory shared with the later stages.
+#define STAGEF_MAIN_PROCESS 0x0001
+
+//! A list of report stages with their dependencies.
+typedef struct StageListStruct *StageListObject;
+
+//! The function producing one stage of the report.
+typedef void (*StageFunction)(void);
+//! The function producing one stage working on the part of the data identified by its argument.
+typedef void (*StageArgFunction)(int Arg);
+
+StageListObject Stage_Create(void);
+void Stage_Destroy(StageListObject *ListPtr);
+
+void Stage_Add(StageListObject List,const char *Name,StageFunction Run,const char *Inputs,const char *Outputs,int Flags);
+void Stage_AddArg(StageListObject List,const char *Name,StageArgFunction Run,int Arg,const char *Inputs,const char *Outputs,int Flags);
+void Stage_Run(StageListObject List,int Jobs);
+void Stage_Summary(StageListObject List);
+
+#endif //STAGE_HEADER
@@ -27,18 +27,283 @@
 #include "include/conf.h"
 #include "include/defs.h"
 
-#ifdef HAVE_LSTAT
-#define MY_LSTAT lstat
-#else
-#define MY_LSTAT stat
-#endif
+//! Name of the file, in the output directory, caching the summary of every report directory.
+#define INDEX_MANIFEST_FILE "sargindex"
+
+//! \c True to keep the summary of the report directories in the index manifest.
+bool IndexManifest=true;
+
+/*!
+ * \brief Summary of one report directory stored in the index manifest.
+ */
+struct IndexManifestEntry
+{
+	//! Path of the directory relative to the output directory.
+	char *Path;
+	//! Inode of the directory when the summary was computed.
+	long long int Inode;
+	//! Modification time of the directory when the summary was computed.
+	long long int Mtime;
+	//! Size occupied by the directory content or -1 if it is unknown.
+	long long int Size;
+	//! Number of users in the report or -1 if it is unknown.
+	int Users;
+	//! Total number of bytes in the report.
+	long long int Bytes;
+	//! Average number of bytes per user.
+	long long int Average;
+	//! Content of the sarg-date file or NULL if it is unknown.
+	char *Date;
+	//! \c True if the directory still exists.
+	bool Seen;
+};
 
+/*!
+ * \brief The index manifest.
+ */
+struct IndexManifestStruct
+{
+	//! The summary of the directories. The entries are allocated one by one so that they don't move.
+	struct IndexManifestEntry **Entry;
+	//! Number of entries stored.
+	int NEntries;
+	//! Number of entries allocated.
+	int NAllocated;
+	//! \c True if the entries are sorted by path.
+	bool Sorted;
+	//! \c True if the manifest must be written.
+	bool Modified;
+};
+
+//! The manifest of the report directories.
+static struct IndexManifestStruct Manifest;
 
 static void make_date_index(void);
 static void make_file_index(void);
 static void file_index_to_date_index(const char *entry);
 static void date_index_to_file_index(const char *entry);
 
+/*!
+ * Compare two manifest entries by path.
+ */
+static int manifest_compare(const void *a,const void *b)
+{
+	return(strcmp((*(struct IndexManifestEntry * const *)a)->Path,(*(struct IndexManifestEntry * const *)b)->Path));
+}
+
+/*!
+ * Add an empty entry at the end of the manifest.
+ *
+ * \param Path The directory path relative to the output directory.
+ *
+ * \return The new entry.
+ */
+static struct IndexManifestEntry *manifest_append(const char *Path)
+{
+	struct IndexManifestEntry *Entry;
+	struct IndexManifestEntry **EntryList;
+
+	if (Manifest.NEntries>=Manifest.NAllocated) {
+		Manifest.NAllocated+=64;
+		EntryList=realloc(Manifest.Entry,Manifest.NAllocated*sizeof(*EntryList));
+		if (!EntryList) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the index manifest\n"));
+			exit(EXIT_FAILURE);
+		}
+		Manifest.Entry=EntryList;
+	}
+	Entry=calloc(1,sizeof(*Entry));
+	if (!Entry) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the index manifest\n"));
+		exit(EXIT_FAILURE);
+	}
+	Manifest.Entry[Manifest.NEntries]=Entry;
+	Entry->Path=strdup(Path);
+	if (!Entry->Path) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the index manifest\n"));
+		exit(EXIT_FAILURE);
+	}
+	Entry->Size=-1;
+	Entry->Users=-1;
+	Manifest.NEntries++;
+	Manifest.Sorted=false;
+	return(Entry);
+}
+
+/*!
+ * Load the manifest of the report directories written by the previous run.
+ *
+ * The file contains one line per directory with the following tab separated
+ * columns: path, inode, modification time, size, users, bytes, average and date.
+ * A missing or invalid file is not an error. The summaries are computed again.
+ */
+static void manifest_load(void)
+{
+	FileObject *fp_in;
+	char filename[MAXLEN];
+	char *buf;
+	char *path;
+	char *date;
+	longline line;
+	struct getwordstruct gwarea;
+	struct IndexManifestEntry *Entry;
+	long long int Inode,Mtime,Size,Users,Bytes,Average;
+
+	memset(&Manifest,0,sizeof(Manifest));
+	if (!IndexManifest) return;
+	format_path(__FILE__, __LINE__, filename, sizeof(filename), "%s"INDEX_MANIFEST_FILE, outdir);
+	if (access(filename,R_OK)!=0) return;
+	if ((fp_in=FileObject_Open(filename))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),filename,FileObject_GetLastOpenError());
+		return;
+	}
+	if ((line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),filename);
+		exit(EXIT_FAILURE);
+	}
+	while ((buf=longline_read(fp_in,line))!=NULL) {
+		if (buf[0]=='#') continue;
+		getword_start(&gwarea,buf);
+		if (getword_ptr(buf,&path,&gwarea,'\t')<0 || getword_atoll(&Inode,&gwarea,'\t')<0 ||
+		    getword_atoll(&Mtime,&gwarea,'\t')<0 || getword_atoll(&Size,&gwarea,'\t')<0 ||
+		    getword_atoll(&Users,&gwarea,'\t')<0 || getword_atoll(&Bytes,&gwarea,'\t')<0 ||
+		    getword_atoll(&Average,&gwarea,'\t')<0 || getword_ptr(buf,&date,&gwarea,'\n')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\". The index manifest is rebuilt\n"),filename);
+			while (Manifest.NEntries>0) {
+				Entry=Manifest.Entry[--Manifest.NEntries];
+				free(Entry->Path);
+				if (Entry->Date) free(Entry->Date);
+				free(Entry);
+			}
+			break;
+		}
+		Entry=manifest_append(path);
+		Entry->Inode=Inode;
+		Entry->Mtime=Mtime;
+		Entry->Size=Size;
+		Entry->Users=(int)Users;
+		Entry->Bytes=Bytes;
+		Entry->Average=Average;
+		if (date[0]) {
+			Entry->Date=strdup(date);
+			if (!Entry->Date) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to store the index manifest\n"));
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+	longline_destroy(&line);
+	if (FileObject_Close(fp_in)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),filename,FileObject_GetLastCloseError());
+		exit(EXIT_FAILURE);
+	}
+	Manifest.Modified=false;
+	if (debugz>=LogLevel_Process)
+		debugaz(__FILE__,__LINE__,_("%d report directories loaded from the index manifest\n"),Manifest.NEntries);
+}
+
+/*!
+ * Find the summary of a report directory in the manifest.
+ *
+ * If the directory changed since the summary was stored, the summary is
+ * cleared so that it is computed again.
+ *
+ * \param Dir The full path of the report directory.
+ * \param statb The status of the directory obtained by lstat.
+ *
+ * \return The entry of the directory or NULL if the manifest is disabled.
+ */
+static struct IndexManifestEntry *manifest_get(const char *Dir,const struct stat *statb)
+{
+	struct IndexManifestEntry Key;
+	struct IndexManifestEntry *KeyPtr=&Key;
+	struct IndexManifestEntry **Found;
+	struct IndexManifestEntry *Entry;
+	int outdir_len;
+	bool current;
+
+	if (!IndexManifest) return(NULL);
+	// the report produced by this run is always summarized again
+	current=(strcmp(Dir,outdirname)==0);
+	outdir_len=strlen(outdir);
+	if (strncmp(Dir,outdir,outdir_len)==0) Dir+=outdir_len;
+	if (!Manifest.Sorted) {
+		if (Manifest.NEntries>1)
+			qsort(Manifest.Entry,Manifest.NEntries,sizeof(*Manifest.Entry),manifest_compare);
+		Manifest.Sorted=true;
+	}
+	Key.Path=(char *)Dir;
+	Found=bsearch(&KeyPtr,Manifest.Entry,Manifest.NEntries,sizeof(*Manifest.Entry),manifest_compare);
+	Entry=(Found) ? *Found : NULL;
+	if (!Entry) {
+		Entry=manifest_append(Dir);
+		Manifest.Modified=true;
+	} else if (current || Entry->Inode!=(long long int)statb->st_ino || Entry->Mtime!=(long long int)statb->st_mtime) {
+		Entry->Size=-1;
+		Entry->Users=-1;
+		if (Entry->Date) {
+			free(Entry->Date);
+			Entry->Date=NULL;
+		}
+		Manifest.Modified=true;
+	}
+	Entry->Inode=(long long int)statb->st_ino;
+	Entry->Mtime=(long long int)statb->st_mtime;
+	Entry->Seen=true;
+	return(Entry);
+}
+
+/*!
+ * Write the manifest of the report directories and free the memory.
+ *
+ * The directories not seen while building the index have been deleted and
+ * are not written.
+ */
+static void manifest_save(void)
+{
+	FILE *fp_ou;
+	char filename[MAXLEN];
+	char tmpname[MAXLEN];
+	int i;
+	const struct IndexManifestEntry *Entry;
+
+	if (IndexManifest) {
+		for (i=0 ; i<Manifest.NEntries && Manifest.Entry[i]->Seen ; i++);
+		if (i<Manifest.NEntries) Manifest.Modified=true;
+	}
+	if (IndexManifest && Manifest.Modified) {
+		format_path(__FILE__, __LINE__, filename, sizeof(filename), "%s"INDEX_MANIFEST_FILE, outdir);
+		format_path(__FILE__, __LINE__, tmpname, sizeof(tmpname), "%s.tmp", filename);
+		if ((fp_ou=fopen(tmpname,"w"))==NULL) {
+			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),tmpname,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		fputs("# path\tinode\tmtime\tsize\tusers\tbytes\taverage\tdate\n",fp_ou);
+		for (i=0 ; i<Manifest.NEntries ; i++) {
+			Entry=Manifest.Entry[i];
+			if (!Entry->Seen) continue;
+			fprintf(fp_ou,"%s\t%"PRId64"\t%"PRId64"\t%"PRId64"\t%d\t%"PRId64"\t%"PRId64"\t%s\n",Entry->Path,
+			        (int64_t)Entry->Inode,(int64_t)Entry->Mtime,(int64_t)Entry->Size,Entry->Users,
+			        (int64_t)Entry->Bytes,(int64_t)Entry->Average,(Entry->Date) ? Entry->Date : "");
+		}
+		if (fclose(fp_ou)==EOF) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),tmpname,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (rename(tmpname,filename)==-1) {
+			debuga(__FILE__,__LINE__,_("Cannot rename \"%s\" to \"%s\": %s\n"),tmpname,filename,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	for (i=0 ; i<Manifest.NEntries ; i++) {
+		free(Manifest.Entry[i]->Path);
+		if (Manifest.Entry[i]->Date) free(Manifest.Entry[i]->Date);
+		free(Manifest.Entry[i]);
+	}
+	if (Manifest.Entry) free(Manifest.Entry);
+	memset(&Manifest,0,sizeof(Manifest));
+}
+
 void make_index(void)
 {
 	DIR *dirp;
@@ -53,8 +318,8 @@ void make_index(void)
 			debuga_more("%s"INDEX_HTML_FILE,outdir);
 			exit(EXIT_FAILURE);
 		}
-		if (access(wdir, R_OK) == 0) {
-			if (unlink(wdir)) {
+		if (html_file_exists(wdir)) {
+			if (unlink_html_file(wdir)) {
 				debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),wdir,strerror(errno));
 				exit(EXIT_FAILURE);
 			}
@@ -82,138 +347,13 @@ void make_index(void)
 	}
 	closedir(dirp);
 
+	manifest_load();
 	if (IndexTree == INDEX_TREE_DATE) {
 		make_date_index();
 	} else {
 		make_file_index();
 	}
-}
-
-/*!
- * Get the effective size of a regular file or directory.
- *
- * \param statb The structure filled by lstat(2).
- *
- * \return The size occupied on the disk (more or less).
- *
- * The actual size occupied on disk by a file or a directory table is not a
- * trivial computation. It must take into account sparse files, compression,
- * deduplication and probably many more.
- *
- * Here, we assume the file takes a whole number of blocks (which is not the
- * case of ReiserFS); the block size is constant (which is not the case of
- * ZFS); every data block is stored in one individal block (no deduplication as
- * is done by btrfs); data are not compressed (unlike ReiserFS and ZFS).
- *
- * As we are dealing with directories containing mostly text and a few
- * compressed pictures, we don't worry about sparse files with lot of zeros
- * that would take less blocks than the actual file size.
- */
-static long long int get_file_size(struct stat *statb)
-{
-#ifdef __linux__
-	long long int blocks;
-
-	//return(statb->st_size);//the size of the file content
-	//return(statb->st_blocks*512);//what is the purpose of this size?
-	if (statb->st_blksize==0) return(statb->st_size);
-	blocks=(statb->st_size+statb->st_blksize-1)/statb->st_blksize;
-	return(blocks*statb->st_blksize);//how many bytes occupied on disk
-#else
-	return(statb->st_size);
-#endif
-}
-
-/*!
- * Get the size of a directory.
- *
- * The size is the size of the directory content excluding the directory table.
- * The "du" tool on Linux returns the content size including the directory
- * table.
- *
- * \param path The directory whose size is computed. This is a buffer that must be
- * big enough to contains the deepest path as directory entries are appended to
- * the string this buffer contains.
- * \param path_size The number of bytes available in the \a path buffer.
- *
- * \return The number of bytes occupied by the directory content.
- */
-static long long int get_size(char *path,int path_size)
-{
-	int path_len;
-	DIR *dirp;
-	struct dirent *direntp;
-	struct stat statb;
-	int name_len;
-	long long int total_size=0;
-	char *dir_list=NULL;
-	int dir_filled=0;
-	int dir_allocated=0;
-
-	path_len=strlen(path);
-	if (path_len+2>=path_size) {
-		debuga(__FILE__,__LINE__,_("Path too long: "));
-		debuga_more("%s\n",path);
-		exit(EXIT_FAILURE);
-	}
-	if ((dirp=opendir(path))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),path,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	path[path_len++]='/';
-	while ((direntp=readdir(dirp))!=NULL) {
-		if (direntp->d_name[0]=='.' && (direntp->d_name[1]=='\0' || (direntp->d_name[1]=='.' && direntp->d_name[2]=='\0'))) continue;
-		name_len=strlen(direntp->d_name);
-		if (path_len+name_len+1>=path_size) {
-			debuga(__FILE__,__LINE__,_("Path too long: "));
-			debuga_more("%s%s\n",path,direntp->d_name);
-			exit(EXIT_FAILURE);
-		}
-		strcpy(path+path_len,direntp->d_name);
-		if (MY_LSTAT(path,&statb) == -1) {
-			debuga(__FILE__,__LINE__,_("Failed to get the statistics of file \"%s\": %s\n"),path,strerror(errno));
-			continue;
-		}
-		if (S_ISDIR(statb.st_mode))
-		{
-			if (!dir_list || dir_filled+name_len>=dir_allocated)
-			{
-				int size=3*(name_len+1);//make room for three file names like this one
-				if (size<256) size=256;
-				dir_allocated+=size;
-				dir_list=realloc(dir_list,dir_allocated);
-				if (!dir_list) {
-					debuga(__FILE__,__LINE__,_("Not enough memory to recurse into subdirectory \"%s\"\n"),path);
-					exit(EXIT_FAILURE);
-				}
-			}
-			strcpy(dir_list+dir_filled,direntp->d_name);
-			dir_filled+=name_len+1;
-			total_size+=get_file_size(&statb);
-		}
-		else if (S_ISREG(statb.st_mode))
-		{
-			total_size+=get_file_size(&statb);
-		}
-	}
-	closedir(dirp);
-
-	if (dir_list)
-	{
-		int start=0;
-
-		while (start<dir_filled)
-		{
-			name_len=strlen(dir_list+start);
-			strcpy(path+path_len,dir_list+start);
-			total_size+=get_size(path,path_size);
-			start+=name_len+1;
-		}
-		free(dir_list);
-	}
-
-	path[path_len-1]='\0';//restore original string
-	return (total_size);
+	manifest_save();
 }
 
 /*!
@@ -247,6 +387,7 @@ static long long int make_date_index_day(char *monthdir,int monthdir_size,int or
 	long long int total_size=0;
 	long long int sub_size;
 	int name_len;
+	struct IndexManifestEntry *entry;
 
 	ndays=0;
 	if ((dirp3 = opendir(monthdir)) == NULL) {
@@ -305,7 +446,7 @@ static long long int make_date_index_day(char *monthdir,int monthdir_size,int or
 	closedir(dirp3);
 
 	strcpy(monthdir+monthdir_len,INDEX_HTML_FILE);
-	if ((fp_ou=fopen(monthdir,"w"))==NULL) {
+	if ((fp_ou=open_html_file(monthdir,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),monthdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -330,7 +471,18 @@ static long long int make_date_index_day(char *monthdir,int monthdir_size,int or
 			snprintf(daynum,sizeof(daynum),"%02d",d1);
 		}
 		strcpy(monthdir+monthdir_len,daynum);
-		sub_size=get_size(monthdir,monthdir_size);
+		entry=NULL;
+		if (IndexManifest && MY_LSTAT(monthdir,&statb)==0)
+			entry=manifest_get(monthdir,&statb);
+		if (entry && entry->Size>=0) {
+			sub_size=entry->Size;
+		} else {
+			sub_size=dir_size(monthdir);
+			if (entry) {
+				entry->Size=sub_size;
+				Manifest.Modified=true;
+			}
+		}
 
 		fprintf(fp_ou,"<tr><td class=\"data2\"><a href=\"%s/%s\">%s %s %s</a></td>",daynum,INDEX_HTML_FILE,yearnum,monthnum,daynum);
 		if (IndexFields & INDEXFIELDS_DIRSIZE)
@@ -465,7 +617,7 @@ static long long int make_date_index_month(char *yeardir,int yeardir_size,int or
 	closedir(dirp2);
 
 	strcpy(yeardir+yeardir_len,INDEX_HTML_FILE);
-	if ((fp_ou=fopen(yeardir,"w"))==NULL) {
+	if ((fp_ou=open_html_file(yeardir,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),yeardir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -591,7 +743,7 @@ static void make_date_index(void)
 		debuga(__FILE__,__LINE__,_("Resulting index file name too long. File name is \"%s/%s\""),outdir,INDEX_HTML_FILE);
 		exit(EXIT_FAILURE);
 	}
-	if ((fp_ou=fopen(yearindex,"w"))==NULL) {
+	if ((fp_ou=open_html_file(yearindex,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),yearindex,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -668,7 +820,12 @@ static void make_file_index(void)
 		char creationdate[MAX_CREATION_DATE];
 		char *dirname;
 		char date[60];
+		//! Summary of the directory in the index manifest or NULL.
+		struct IndexManifestEntry *manifest;
 	} **sortlist, *item, **tempsort;
+	struct IndexManifestEntry *entry;
+	struct stat statb;
+	char path[MAXLEN];
 
 	if (snprintf(wdir,sizeof(wdir),"%s"INDEX_HTML_FILE,outdir)>=sizeof(wdir)) {
 		debuga(__FILE__,__LINE__,_("Path too long: "));
@@ -688,9 +845,27 @@ static void make_file_index(void)
 	sortlist=NULL;
 	while ((direntp = readdir( dirp )) != NULL) {
 		if (strchr(direntp->d_name,'-') == 0) continue;
-		if (obtdate(outdir,direntp->d_name,data)<0) {
-			debuga(__FILE__,__LINE__,_("The directory \"%s%s\" looks like a report directory but doesn't contain a sarg-date file. You should delete it\n"),outdir,direntp->d_name);
-			continue;
+		entry=NULL;
+		if (IndexManifest) {
+			format_path(__FILE__, __LINE__, path, sizeof(path), "%s%s", outdir, direntp->d_name);
+			if (MY_LSTAT(path,&statb)==0)
+				entry=manifest_get(path,&statb);
+		}
+		if (entry && entry->Date) {
+			safe_strcpy(data,entry->Date,sizeof(data));
+		} else {
+			if (obtdate(outdir,direntp->d_name,data)<0) {
+				debuga(__FILE__,__LINE__,_("The directory \"%s%s\" looks like a report directory but doesn't contain a sarg-date file. You should delete it\n"),outdir,direntp->d_name);
+				continue;
+			}
+			if (entry) {
+				entry->Date=strdup(data);
+				if (!entry->Date) {
+					debuga(__FILE__,__LINE__,_("Not enough memory to store the index manifest\n"));
+					exit(EXIT_FAILURE);
+				}
+				Manifest.Modified=true;
+			}
 		}
 		item=malloc(sizeof(*item));
 		if (!item) {
@@ -750,6 +925,7 @@ static void make_file_index(void)
 			exit(EXIT_FAILURE);
 		}
 		safe_strcpy(item->date,data,sizeof(item->date));
+		item->manifest=entry;
 		if (nsort+1>nallocated) {
 			nallocated+=10;
 			tempsort=realloc(sortlist,nallocated*sizeof(*item));
@@ -772,7 +948,7 @@ static void make_file_index(void)
 
 	closedir( dirp );
 
-	if ((fp_ou=fopen(wdir,"w"))==NULL) {
+	if ((fp_ou=open_html_file(wdir,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),wdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -788,8 +964,21 @@ static void make_file_index(void)
 			item=sortlist[i];
 		else
 			item=sortlist[nsort-i-1];
-		tuser=obtuser(outdir,item->dirname);
-		obttotal(outdir,item->dirname,tuser,&tbytes,&media);
+		entry=item->manifest;
+		if (entry && entry->Users>=0) {
+			tuser=entry->Users;
+			tbytes=entry->Bytes;
+			media=entry->Average;
+		} else {
+			tuser=obtuser(outdir,item->dirname);
+			obttotal(outdir,item->dirname,tuser,&tbytes,&media);
+			if (entry) {
+				entry->Users=tuser;
+				entry->Bytes=tbytes;
+				entry->Average=media;
+				Manifest.Modified=true;
+			}
+		}
 		fputs("<tr><td class=\"data2\"",fp_ou);
 		if (SortTableJs[0]) fprintf(fp_ou," sorttable_customkey=\"%d\"",item->sortnum);
 		fprintf(fp_ou,"><a href='%s/%s'>%s</a></td>",item->dirname,ReplaceIndex,item->dirname);
@@ -932,6 +1121,7 @@ static void file_index_to_date_index(const char *entry)
 		debuga(__FILE__,__LINE__,_("Error renaming \"%s\" to \"%s\": %s\n"),olddir,newdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
+	lastlog_reset();
 
 	strcpy(newdir+monthlen,"/images");
 	if (access(newdir, R_OK) != 0) {
@@ -1038,6 +1228,7 @@ static void date_index_to_file_index(const char *entry)
 				debuga(__FILE__,__LINE__,_("Error renaming \"%s\" to \"%s\": %s\n"),olddir,newdir,strerror(errno));
 				exit(EXIT_FAILURE);
 			}
+			lastlog_reset();
 		}
 		closedir(dirp3);
 	}
@@ -39,7 +39,8 @@ void index_only(const char *dirname,int debug)
 		exit(EXIT_FAILURE);
 	}
 	while ( (direntp = readdir( dirp )) != NULL ){
-		if (strcmp(direntp->d_name,".") == 0 || strcmp(direntp->d_name,"..") == 0 || strcmp(direntp->d_name, INDEX_HTML_FILE) == 0)
+		if (strcmp(direntp->d_name,".") == 0 || strcmp(direntp->d_name,"..") == 0 || strcmp(direntp->d_name, INDEX_HTML_FILE) == 0 ||
+		    strcmp(direntp->d_name, INDEX_HTML_FILE".gz") == 0)
 			continue;
 
 		if (snprintf(remove,sizeof(remove),"%s/%s",dirname,direntp->d_name)>=sizeof(remove)) {
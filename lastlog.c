@@ -24,79 +24,95 @@
  *
  */
 
+/*!\file
+\brief Delete the oldest reports to keep only the number requested by \c lastlog.
+
+The report directories are listed in a catalog stored in the output directory
+together with their creation time. The catalog is extended every time a report
+directory is created. The output directory is only walked to rebuild the
+catalog when it doesn't exist. Delete the catalog to force a new walk after
+report directories were added or moved by hand.
+*/
+
 #include "include/conf.h"
 #include "include/defs.h"
 
+//! The name of the catalog of the report directories in the output directory.
+#define LASTLOG_CATALOG "sargreports"
+
+//! A report directory.
 struct DirEntry
 {
-	struct DirEntry *Next;
+	//! The creation time of the report.
 	time_t Time;
+	//! The path of the directory relative to the output directory or NULL if the directory is gone.
 	char *Name;
 };
 
-static void DeleteDirList(struct DirEntry *List)
+//! The report directories found in the output directory.
+struct DirListStruct
 {
-	struct DirEntry *Next;
+	//! The report directories.
+	struct DirEntry *Entry;
+	//! The number of report directories stored in the list.
+	int NEntries;
+	//! The number of entries allocated.
+	int NAllocated;
+};
 
-	while (List)
-	{
-		Next=List->Next;
-		if (List->Name) free(List->Name);
-		free(List);
-		List=Next;
-	}
+static void DeleteDirList(struct DirListStruct *List)
+{
+	int i;
+
+	for (i=0 ; i<List->NEntries ; i++)
+		if (List->Entry[i].Name) free(List->Entry[i].Name);
+	if (List->Entry) free(List->Entry);
+	memset(List,0,sizeof(*List));
 }
 
-static struct DirEntry *AppendDirEntry(struct DirEntry *List,time_t CreationTime,const char *Name,int NameLen)
+static bool AppendDirEntry(struct DirListStruct *List,time_t CreationTime,const char *Name,int NameLen)
 {
 	struct DirEntry *entry;
-	struct DirEntry *prev;
-	struct DirEntry *ptr;
 
-	entry=malloc(sizeof(*entry));
-	if (!entry) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to store a report to purge\n"));
-		DeleteDirList(List);
-		return(NULL);
+	if (List->NEntries>=List->NAllocated) {
+		int NAllocated=(List->NAllocated>0) ? 2*List->NAllocated : 64;
+
+		entry=realloc(List->Entry,NAllocated*sizeof(*entry));
+		if (!entry) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store a report to purge\n"));
+			DeleteDirList(List);
+			return(false);
+		}
+		List->Entry=entry;
+		List->NAllocated=NAllocated;
 	}
+	entry=List->Entry+List->NEntries;
 	entry->Name=malloc((NameLen+1)*sizeof(char));
 	if (!entry->Name) {
-		free(entry);
 		debuga(__FILE__,__LINE__,_("Not enough memory to store a report to purge\n"));
 		DeleteDirList(List);
-		return(NULL);
+		return(false);
 	}
 	entry->Time=CreationTime;
-	strcpy(entry->Name,Name);
-
-	// store most recent file first
-	prev=NULL;
-	for (ptr=List ; ptr ; ptr=ptr->Next)
-	{
-		if (ptr->Time>CreationTime) break;
-		prev=ptr;
-	}
-	entry->Next=ptr;
-	if (prev)
-		prev->Next=entry;
-	else
-		List=entry;
-
-	return(List);
+	memcpy(entry->Name,Name,NameLen);
+	entry->Name[NameLen]='\0';
+	List->NEntries++;
+	return(true);
 }
 
-static struct DirEntry *BuildDirDateList(struct DirEntry *List,char *Path,int PathSize,int RootPos,int Length,int Level)
+static bool BuildDirDateList(struct DirListStruct *List,char *Path,int PathSize,int RootPos,int Length,int Level)
 {
 	DIR *dirp;
 	struct dirent *direntp;
 	struct stat statb;
 	int name_len;
+	bool Success=true;
 
 	if ((dirp = opendir(Path)) == NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),Path,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	while ((direntp = readdir( dirp )) != NULL )
+	while (Success && (direntp = readdir( dirp )) != NULL )
 	{
 		name_len=strlen(direntp->d_name);
 		if (RootPos+name_len+1>=PathSize) {
@@ -115,33 +131,21 @@ static struct DirEntry *BuildDirDateList(struct DirEntry *List,char *Path,int Pa
 			{
 				Path[Length+name_len]='/';
 				Path[Length+name_len+1]='\0';
-				List=BuildDirDateList(List,Path,PathSize,RootPos,Length+name_len+1,1);
-				if (!List)
-				{
-					debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
-					break;
-				}
+				Success=BuildDirDateList(List,Path,PathSize,RootPos,Length+name_len+1,1);
 			}
 		}
 		else if (Level==1)
 		{
 			if (IsTreeDayFileName(direntp->d_name))
-			{
-				List=AppendDirEntry(List,statb.st_mtime,Path+RootPos,Length-RootPos+name_len);
-				if (!List)
-				{
-					debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
-					break;
-				}
-			}
+				Success=AppendDirEntry(List,statb.st_mtime,Path+RootPos,Length-RootPos+name_len);
 		}
 	}
 
 	closedir(dirp);
-	return(List);
+	return(Success);
 }
 
-static struct DirEntry *BuildDirList(const char *Path)
+static bool BuildDirList(struct DirListStruct *List,const char *Path)
 {
 	DIR *dirp;
 	struct dirent *direntp;
@@ -149,7 +153,7 @@ static struct DirEntry *BuildDirList(const char *Path)
 	char warea[MAXLEN];
 	int name_pos;
 	int name_len;
-	struct DirEntry *List=NULL;
+	bool Success=true;
 
 	name_pos=strlen(Path);
 	if (name_pos>=sizeof(warea)) {
@@ -161,7 +165,7 @@ static struct DirEntry *BuildDirList(const char *Path)
 		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),outdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	while ((direntp = readdir( dirp )) != NULL )
+	while (Success && (direntp = readdir( dirp )) != NULL )
 	{
 		name_len=strlen(direntp->d_name);
 		if (name_pos+name_len+1>=sizeof(warea)) {
@@ -176,29 +180,241 @@ static struct DirEntry *BuildDirList(const char *Path)
 		if (!S_ISDIR(statb.st_mode)) continue;
 		if (IsTreeFileDirName(direntp->d_name))
 		{
-			List=AppendDirEntry(List,statb.st_mtime,direntp->d_name,name_len);
-			if (!List)
-			{
-				debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
-				break;
-			}
+			Success=AppendDirEntry(List,statb.st_mtime,direntp->d_name,name_len);
 		}
 		else if (IsTreeYearFileName(direntp->d_name))
 		{
 			warea[name_pos+name_len]='/';
 			warea[name_pos+name_len+1]='\0';
-			List=BuildDirDateList(List,warea,sizeof(warea),name_pos,name_pos+name_len+1,0);
-			if (!List)
-			{
-				debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
-				break;
-			}
+			Success=BuildDirDateList(List,warea,sizeof(warea),name_pos,name_pos+name_len+1,0);
+		}
+	}
+
+	closedir(dirp);
+	if (!Success)
+		debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
+	return(Success);
+}
+
+/*!
+ * Read the catalog of the report directories.
+ *
+ * \param List The list to fill.
+ * \param Path The output directory.
+ *
+ * \return \c True if the catalog was read or \c false if it doesn't exist and
+ * the output directory must be walked.
+ */
+static bool ReadCatalog(struct DirListStruct *List,const char *Path)
+{
+	char CatalogName[MAXLEN];
+	char buf[MAXLEN];
+	char *Name;
+	char *End;
+	long long int CreationTime;
+	FILE *fp_in;
+	int len;
+
+	format_path(__FILE__, __LINE__, CatalogName, sizeof(CatalogName), "%s"LASTLOG_CATALOG, Path);
+	if ((fp_in=fopen(CatalogName,"r"))==NULL) return(false);
+	while (fgets(buf,sizeof(buf),fp_in)!=NULL) {
+		fixendofline(buf);
+		CreationTime=strtoll(buf,&End,10);
+		if (End==buf || *End!='\t' || End[1]=='\0') {
+			debuga(__FILE__,__LINE__,_("Invalid line in the catalog of the reports \"%s\", the output directory is walked instead\n"),CatalogName);
+			fclose(fp_in);
+			DeleteDirList(List);
+			return(false);
+		}
+		Name=End+1;
+		len=strlen(Name);
+		if (!AppendDirEntry(List,(time_t)CreationTime,Name,len)) {
+			fclose(fp_in);
+			debuga(__FILE__,__LINE__,_("Old reports deletion not undertaken due to previous error\n"));
+			exit(EXIT_FAILURE);
 		}
 	}
+	fclose(fp_in);
+	return(true);
+}
+
+/*!
+ * Write the catalog of the report directories.
+ *
+ * \param List The list of the report directories.
+ * \param Path The output directory.
+ */
+static void WriteCatalog(const struct DirListStruct *List,const char *Path)
+{
+	char CatalogName[MAXLEN];
+	char TempName[MAXLEN];
+	FILE *fp_ou;
+	int i;
+
+	format_path(__FILE__, __LINE__, CatalogName, sizeof(CatalogName), "%s"LASTLOG_CATALOG, Path);
+	format_path(__FILE__, __LINE__, TempName, sizeof(TempName), "%s.tmp", CatalogName);
+	if ((fp_ou=fopen(TempName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	for (i=0 ; i<List->NEntries ; i++)
+		if (List->Entry[i].Name)
+			fprintf(fp_ou,"%lld\t%s\n",(long long int)List->Entry[i].Time,List->Entry[i].Name);
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TempName,CatalogName)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot rename \"%s\" to \"%s\": %s\n"),TempName,CatalogName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Sort the report directories by name.
+ */
+static int CompareDirName(const void *A,const void *B)
+{
+	const struct DirEntry *EntryA=(const struct DirEntry *)A;
+	const struct DirEntry *EntryB=(const struct DirEntry *)B;
+
+	return(strcmp(EntryA->Name,EntryB->Name));
+}
+
+/*!
+ * Sort the report directories by creation time then name.
+ */
+static int CompareDirTime(const void *A,const void *B)
+{
+	const struct DirEntry *EntryA=(const struct DirEntry *)A;
+	const struct DirEntry *EntryB=(const struct DirEntry *)B;
+
+	if (EntryA->Time<EntryB->Time) return(-1);
+	if (EntryA->Time>EntryB->Time) return(1);
+	return(strcmp(EntryA->Name,EntryB->Name));
+}
+
+/*!
+ * Sort the report directories from the oldest to the most recent.
+ *
+ * A directory listed more than once in the catalog was replaced by a more
+ * recent report. Only the latest creation time is kept.
+ *
+ * \param List The list to sort.
+ */
+static void SortDirList(struct DirListStruct *List)
+{
+	int i;
+	int j;
+
+	if (List->NEntries<2) return;
+	qsort(List->Entry,List->NEntries,sizeof(*List->Entry),CompareDirName);
+	for (i=0, j=1 ; j<List->NEntries ; j++) {
+		if (strcmp(List->Entry[i].Name,List->Entry[j].Name)==0) {
+			if (List->Entry[j].Time>List->Entry[i].Time) List->Entry[i].Time=List->Entry[j].Time;
+			free(List->Entry[j].Name);
+		} else {
+			List->Entry[++i]=List->Entry[j];
+		}
+	}
+	List->NEntries=i+1;
+	qsort(List->Entry,List->NEntries,sizeof(*List->Entry),CompareDirTime);
+}
+
+/*!
+ * Add a report directory to the catalog of the output directory.
+ *
+ * Nothing is done if the catalog doesn't exist. It is created by walking
+ * the output directory the next time old reports are purged.
+ *
+ * \param ReportDir The path of the report directory. It must be in ::outdir.
+ * \param CreationTime The creation time of the report.
+ */
+void lastlog_register(const char *ReportDir,time_t CreationTime)
+{
+	char CatalogName[MAXLEN];
+	FILE *fp_ou;
+	int name_pos;
+
+	name_pos=strlen(outdir);
+	if (strncmp(ReportDir,outdir,name_pos)!=0) return;
+	format_path(__FILE__, __LINE__, CatalogName, sizeof(CatalogName), "%s"LASTLOG_CATALOG, outdir);
+	if (access(CatalogName,F_OK)!=0) return;
+	if ((fp_ou=fopen(CatalogName,"a"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),CatalogName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fp_ou,"%lld\t%s\n",(long long int)CreationTime,ReportDir+name_pos);
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),CatalogName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
 
+/*!
+ * Delete the catalog of the output directory after report directories were
+ * moved. It is rebuilt the next time old reports are purged.
+ */
+void lastlog_reset(void)
+{
+	char CatalogName[MAXLEN];
+
+	format_path(__FILE__, __LINE__, CatalogName, sizeof(CatalogName), "%s"LASTLOG_CATALOG, outdir);
+	if (unlink(CatalogName)==-1 && errno!=ENOENT) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),CatalogName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+/*!
+ * Delete a directory and its content.
+ *
+ * The entries are deleted relative to the descriptor of the directory
+ * containing them so that no path has to be built for every file.
+ *
+ * \param parentfd The descriptor of the directory containing the directory
+ * to delete.
+ * \param name The name of the directory to delete relative to \a parentfd.
+ */
+static void PurgeDirAt(int parentfd,const char *name)
+{
+	int dirfd;
+	DIR *dirp;
+	struct dirent *direntp;
+	struct stat statb;
+	int err;
+
+	dirfd=openat(parentfd,name,O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+	if (dirfd==-1) {
+		// the report was deleted by hand
+		if (errno==ENOENT) return;
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if ((dirp=fdopendir(dirfd))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((direntp=readdir(dirp))!=NULL) {
+		if (direntp->d_name[0]=='.' && (direntp->d_name[1]=='\0' || (direntp->d_name[1]=='.' && direntp->d_name[2]=='\0'))) continue;
+		// most entries are files, only stat what can't be unlinked
+		if (unlinkat(dirfd,direntp->d_name,0)==0) continue;
+		err=errno;
+		if (fstatat(dirfd,direntp->d_name,&statb,AT_SYMLINK_NOFOLLOW)==0 && S_ISDIR(statb.st_mode)) {
+			PurgeDirAt(dirfd,direntp->d_name);
+			continue;
+		}
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s/%s\": %s\n"),name,direntp->d_name,strerror(err));
+		exit(EXIT_FAILURE);
+	}
 	closedir(dirp);
-	return(List);
+	if (unlinkat(parentfd,name,AT_REMOVEDIR)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
 }
+#endif
 
 static void DeleteEmptyDirs(char *Path,int PathSize,int BasePos)
 {
@@ -219,7 +435,7 @@ static void DeleteEmptyDirs(char *Path,int PathSize,int BasePos)
 		while ((direntp = readdir( dirp )) != NULL )
 		{
 			if (direntp->d_name[0]=='.' && (direntp->d_name[1]=='\0' || (direntp->d_name[1]=='.' && direntp->d_name[2]=='\0'))) continue;
-			if (!strcmp(direntp->d_name,INDEX_HTML_FILE))
+			if (!strcmp(direntp->d_name,INDEX_HTML_FILE) || !strcmp(direntp->d_name,INDEX_HTML_FILE".gz"))
 			{
 				index=true;
 				continue;
@@ -239,7 +455,7 @@ static void DeleteEmptyDirs(char *Path,int PathSize,int BasePos)
 				exit(EXIT_FAILURE);
 			}
 			strcat(Path,"/"INDEX_HTML_FILE);
-			if (unlink(Path)==-1) {
+			if (unlink_html_file(Path)==-1) {
 				debuga(__FILE__,__LINE__,_("Failed to delete \"%s\": %s\n"),Path,strerror(errno));
 				exit(EXIT_FAILURE);
 			}
@@ -253,60 +469,131 @@ static void DeleteEmptyDirs(char *Path,int PathSize,int BasePos)
 	//! \todo Rebuild the surviving index file
 }
 
+/*!
+ * Tell if two report directories are in the same parent directory.
+ *
+ * \param Name1 The path of the first directory relative to the output directory.
+ * \param Name2 The path of the second directory relative to the output directory.
+ *
+ * \return \c True if the parent directories are the same.
+ */
+static bool SameParentDir(const char *Name1,const char *Name2)
+{
+	const char *Slash1=strrchr(Name1,'/');
+	const char *Slash2=strrchr(Name2,'/');
+	int len1=(Slash1) ? Slash1-Name1 : 0;
+	int len2=(Slash2) ? Slash2-Name2 : 0;
+
+	return(len1==len2 && strncmp(Name1,Name2,len1)==0);
+}
+
 void mklastlog(const char *outdir)
 {
 	char warea[MAXLEN];
 	int name_pos;
-	int  ftot=0;
-	struct DirEntry *List;
-	struct DirEntry *ptr;
+	int ftot;
+	int first;
+	int keep;
+	int i;
+	bool walked=false;
+	struct DirListStruct List;
+	struct stat statb;
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+	int outfd;
+#endif
 
 	if (LastLog <= 0)
 		return;
 
-	List=BuildDirList(outdir);
-	if (!List) return;
+	memset(&List,0,sizeof(List));
+	if (!ReadCatalog(&List,outdir)) {
+		if (debug)
+			debuga(__FILE__,__LINE__,_("Building the catalog of the reports in \"%s\"\n"),outdir);
+		if (!BuildDirList(&List,outdir)) return;
+		walked=true;
+	}
+	SortDirList(&List);
 
-	for (ptr=List ; ptr ; ptr=ptr->Next) ftot++;
+	name_pos=strlen(outdir);
+	if (name_pos>=sizeof(warea)) {
+		DeleteDirList(&List);
+		debuga(__FILE__,__LINE__,_("The directory name \"%s\" containing the old reports to purge is too long\n"),outdir);
+		exit(EXIT_FAILURE);
+	}
+	strcpy(warea,outdir);
+
+	ftot=List.NEntries;
 	if (debug)
 		debuga(__FILE__,__LINE__,ngettext("%d report directory found\n","%d report directories found\n",ftot),ftot);
 
-	if (ftot<=LastLog) {
-		DeleteDirList(List);
+	// keep the most recent reports still present in the output directory
+	first=List.NEntries;
+	for (keep=0 ; first>0 && keep<LastLog ; ) {
+		first--;
+		if (!walked) {
+			if (name_pos+strlen(List.Entry[first].Name)+1>=sizeof(warea)) {
+				DeleteDirList(&List);
+				debuga(__FILE__,__LINE__,_("Path too long: "));
+				debuga_more("%s%s\n",outdir,List.Entry[first].Name);
+				exit(EXIT_FAILURE);
+			}
+			strcpy(warea+name_pos,List.Entry[first].Name);
+			if (stat(warea,&statb)==-1 || !S_ISDIR(statb.st_mode)) {
+				free(List.Entry[first].Name);
+				List.Entry[first].Name=NULL;
+				continue;
+			}
+		}
+		keep++;
+	}
+
+	if (first==0) {
 		if (debug) {
 			debuga(__FILE__,__LINE__,ngettext("No old reports to delete as only %d report currently exists\n",
-						"No old reports to delete as only %d reports currently exist\n",ftot),ftot);
+						"No old reports to delete as only %d reports currently exist\n",keep),keep);
 		}
+		WriteCatalog(&List,outdir);
+		DeleteDirList(&List);
 		return;
 	}
 
-	ftot-=LastLog;
+	ftot=first;
 	if (debug)
 		debuga(__FILE__,__LINE__,ngettext("%d old report to delete\n","%d old reports to delete\n",ftot),ftot);
 
-	name_pos=strlen(outdir);
-	if (name_pos>=sizeof(warea)) {
-		DeleteDirList(List);
-		debuga(__FILE__,__LINE__,_("The directory name \"%s\" containing the old reports to purge is too long\n"),outdir);
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+	if ((outfd=open(outdir,O_RDONLY | O_DIRECTORY))==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open directory \"%s\": %s\n"),outdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
-	strcpy(warea,outdir);
-	for (ptr=List ; ptr && ftot>0 ; ptr=ptr->Next)
+#endif
+	for (i=0 ; i<first ; i++)
 	{
 		if (debug)
-			debuga(__FILE__,__LINE__,_("Removing old report file %s\n"),ptr->Name);
-		if (name_pos+strlen(ptr->Name)+1>=sizeof(warea)) {
-			DeleteDirList(List);
+			debuga(__FILE__,__LINE__,_("Removing old report file %s\n"),List.Entry[i].Name);
+		if (name_pos+strlen(List.Entry[i].Name)+1>=sizeof(warea)) {
+			DeleteDirList(&List);
 			debuga(__FILE__,__LINE__,_("Path too long: "));
-			debuga_more("%s%s\n",outdir,ptr->Name);
+			debuga_more("%s%s\n",outdir,List.Entry[i].Name);
 			exit(EXIT_FAILURE);
 		}
-		strcpy(warea+name_pos,ptr->Name);
+		strcpy(warea+name_pos,List.Entry[i].Name);
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+		PurgeDirAt(outfd,List.Entry[i].Name);
+#else
 		unlinkdir(warea,0);
-		DeleteEmptyDirs(warea,sizeof(warea),name_pos);
-		ftot--;
+#endif
+		// the parent directories are only checked once all their old reports are gone
+		if (i+1>=first || !SameParentDir(List.Entry[i].Name,List.Entry[i+1].Name))
+			DeleteEmptyDirs(warea,sizeof(warea),name_pos);
+		free(List.Entry[i].Name);
+		List.Entry[i].Name=NULL;
 	}
+#if defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) && defined(HAVE_FDOPENDIR)
+	close(outfd);
+#endif
 
-	DeleteDirList(List);
+	WriteCatalog(&List,outdir);
+	DeleteDirList(&List);
 	return;
 }
@@ -47,9 +47,14 @@ char *CurrentLocale=NULL;
 bool UserAgentFromCmdLine=false;
 
 extern FileListObject UserAgentLog;
+extern bool ShowStages;
+
+//! The process that must delete the temporary directory.
+static pid_t MainPid;
 
 static void getusers(const char *pwdfile, int debug);
 static void CleanTemporaryDir();
+static void GenerateReport(struct ReadLogDataStruct *Filter);
 
 int main(int argc,char *argv[])
 {
@@ -80,18 +85,24 @@ int main(int argc,char *argv[])
 	static int split=0;
 	static int convert=0;
 	static int output_css=0;
+	static int daemon_mode=0;
+	static int from_aggregates=0;
 	static int show_statis=0;
+	static int show_stages=0;
 	static int show_version=0;
 	int option_index;
 	static struct option long_options[]=
 	{
 		{"convert",no_argument,&convert,1},
 		{"css",no_argument,&output_css,1},
+		{"daemon",no_argument,&daemon_mode,1},
+		{"from-aggregates",no_argument,&from_aggregates,1},
 		{"help",no_argument,NULL,'h'},
 		{"lastlog",required_argument,NULL,2},
 		{"keeplogs",no_argument,NULL,3},
 		{"split",no_argument,&split,1},
 		{"splitprefix",required_argument,NULL,'P'},
+		{"stages",no_argument,&show_stages,1},
 		{"statistics",no_argument,&show_statis,1},
 		{"version",no_argument,&show_version,'V'},
 		{0,0,0,0}
@@ -162,6 +173,9 @@ int main(int argc,char *argv[])
 	RecordsWithoutUser=RECORDWITHOUTUSER_IP;
 	UseComma=0;
 	strcpy(MailUtility,"mailx");
+	MailQueueDir[0]='\0';
+	MailWorkers=4;
+	MailRetries=3;
 	TopSitesNum=100;
 	TopUsersNum=0;
 	UserIp=0;
@@ -210,6 +224,14 @@ int main(int argc,char *argv[])
 	IndexFields=INDEXFIELDS_DIRSIZE;
 	strcpy(RealtimeTypes,"GET,PUT,CONNECT,POST");
 	RealtimeUnauthRec=REALTIME_UNAUTH_REC_SHOW;
+	RealtimeFollow=false;
+	DaemonMode=false;
+	DaemonInterval=300;
+	DaemonStateFile[0]='\0';
+	AggregateDir[0]='\0';
+	LogCatalogFile[0]='\0';
+	LogIndexDir[0]='\0';
+	ParseCacheDir[0]='\0';
 	RedirectorFilterOutDate=true;
 	DansguardianFilterOutDate=true;
 	DataFileUrl=DATAFILEURL_IP;
@@ -432,6 +454,8 @@ int main(int argc,char *argv[])
 	if (show_version) {
 		version();
 	}
+	ShowStages=(show_stages!=0);
+	DaemonMode=(daemon_mode!=0);
 
 	if (output_css) {
 		css_content(stdout);
@@ -501,15 +525,11 @@ int main(int argc,char *argv[])
 		while ((file=FileListIter_Next(FIter))!=NULL)
 			splitlog(file, df, &ReadFilter, convert, splitprefix);
 		FileListIter_Close(FIter);
+		splitlog_close();
 		exit(EXIT_SUCCESS);
 	}
 	if (convert) {
-		const char *file;
-
-		FIter=FileListIter_Open(AccessLog);
-		while ((file=FileListIter_Next(FIter))!=NULL)
-			convlog(file, df, &ReadFilter);
-		FileListIter_Close(FIter);
+		convlog(df, &ReadFilter, splitprefix);
 		exit(EXIT_SUCCESS);
 	}
 
@@ -564,6 +584,9 @@ int main(int argc,char *argv[])
 	else
 		ReadFilter.max_elapsed=0;
 
+	if (ParseCacheDir[0] != '\0')
+		ParseCache_Fingerprint(&ReadFilter,hexclude);
+
 	if (tmp[0] == '\0') strcpy(tmp,TempDir);
 	else strcpy(TempDir,tmp);
 	/*
@@ -588,6 +611,7 @@ int main(int argc,char *argv[])
 		debuga(__FILE__,__LINE__,_("The output directory \"%s\" must be outside of the temporary directory \"%s\"\n"),outdir,tmp);
 		exit(EXIT_FAILURE);
 	}
+	MainPid=getpid();
 	atexit(CleanTemporaryDir);
 
 	if (email[0] == '\0' && OutputEmail[0] != '\0') strcpy(email,OutputEmail);
@@ -681,8 +705,14 @@ int main(int argc,char *argv[])
 	}
 #endif
 
+	if (DaemonMode)
+		daemon_run(&ReadFilter,GenerateReport);
+
 	read_start_time=time(NULL);
-	LogStatus=ReadLogFile(&ReadFilter);
+	if (from_aggregates)
+		LogStatus=aggregate_load(&ReadFilter);
+	else
+		LogStatus=ReadLogFile(&ReadFilter);
 	read_end_time=time(NULL);
 	read_elapsed=(double)read_end_time-(double)read_start_time;
 
@@ -690,6 +720,8 @@ int main(int argc,char *argv[])
 	free_download();
 	free_excludecodes();
 	free_exclude();
+	aggregate_free();
+	LogCatalog_Free();
 
 	if (debug) {
 		char date0[30], date1[30];
@@ -712,27 +744,9 @@ int main(int argc,char *argv[])
 		exit(EXIT_SUCCESS);
 	}
 
-	if (debug) {
-		char date0[30], date1[30];
-
-		strftime(date0,sizeof(date0),"%x",&period.start);
-		strftime(date1,sizeof(date1),"%x",&period.end);
-		// TRANSLATORS: The %s are the start and end dates in locale format.
-		debuga(__FILE__,__LINE__,_("Period extracted from log files: %s-%s\n"),date0,date1);
-	}
-	if (ReadFilter.DateRange[0] != '\0') {
-		getperiod_fromrange(&period,&ReadFilter);
-	}
-	if (getperiod_buildtext(&period)<0) {
-		debuga(__FILE__,__LINE__,_("Failed to build the string representation of the date range\n"));
-		exit(EXIT_FAILURE);
-	}
-
 	process_start_time=time(NULL);
-	if (DataFile[0] != '\0')
-		data_file(tmp);
-	else
-		gerarel(&ReadFilter);
+	GenerateReport(&ReadFilter);
+	Email_Flush();
 	process_end_time=time(NULL);
 	process_elapsed=(double)process_end_time-(double)process_start_time;
 
@@ -770,6 +784,35 @@ int main(int argc,char *argv[])
 	exit(EXIT_SUCCESS);
 }
 
+/*!
+ * Produce the reports from the data read in the access logs.
+ *
+ * \param Filter The filtering parameters.
+ */
+static void GenerateReport(struct ReadLogDataStruct *Filter)
+{
+	if (debug) {
+		char date0[30], date1[30];
+
+		strftime(date0,sizeof(date0),"%x",&period.start);
+		strftime(date1,sizeof(date1),"%x",&period.end);
+		// TRANSLATORS: The %s are the start and end dates in locale format.
+		debuga(__FILE__,__LINE__,_("Period extracted from log files: %s-%s\n"),date0,date1);
+	}
+	if (Filter->DateRange[0] != '\0') {
+		getperiod_fromrange(&period,Filter);
+	}
+	if (getperiod_buildtext(&period)<0) {
+		debuga(__FILE__,__LINE__,_("Failed to build the string representation of the date range\n"));
+		exit(EXIT_FAILURE);
+	}
+
+	if (DataFile[0] != '\0')
+		data_file(tmp);
+	else
+		gerarel(Filter);
+}
+
 static void getusers(const char *pwdfile, int debug)
 {
 	FILE *fp_usr;
@@ -828,6 +871,8 @@ static void getusers(const char *pwdfile, int debug)
 
 static void CleanTemporaryDir()
 {
+	// a report stage running in a child process must not delete the files of the other stages
+	if (getpid()!=MainPid) return;
 	if (!KeepTempLog && strcmp(tmp,"/tmp") != 0) {
 		unlinkdir(tmp,0);
 	}
@@ -0,0 +1,298 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Remember the range of dates stored in each access log.
+
+The catalog lets sarg skip the logs whose dates are outside of the range
+requested with -d without reading them. A log is identified by its device,
+inode, size and modification time so that a log renamed by a log rotation
+is still recognized and a log that was changed is read again.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+
+//! The first line of the catalog file.
+#define LOGCATALOG_HEADER "SARG log catalog 1"
+
+/*!
+ * \brief The dates stored in one access log.
+ */
+struct LogCatalogStruct
+{
+	//! The next entry in the list.
+	struct LogCatalogStruct *Next;
+	//! The name of the log when it was last read.
+	char *FileName;
+	//! The device containing the file.
+	unsigned long long int Dev;
+	//! The inode of the file.
+	unsigned long long int Inode;
+	//! The size of the file.
+	long long int Size;
+	//! The modification time of the file.
+	long long int Mtime;
+	//! The earliest date in the log as YYYYMMDD.
+	int MinDate;
+	//! The latest date in the log as YYYYMMDD.
+	int MaxDate;
+	//! How many seconds a line may be older than a line written before it.
+	long long int Disorder;
+	//! \c True if the entry was used or stored during this run.
+	bool Used;
+};
+
+//! The logs in the catalog.
+static struct LogCatalogStruct *FirstLogCatalog=NULL;
+//! \c True once the catalog file is loaded.
+static bool LogCatalogLoaded=false;
+//! \c True if the catalog must be saved.
+static bool LogCatalogChanged=false;
+
+/*!
+ * Convert a date and time into a number of seconds suitable to compare two
+ * times. It ignores the time zone and the daylight saving time.
+ *
+ * \param t The date and time.
+ *
+ * \return The number of seconds since the 1st of March of year 0.
+ */
+long long int LogCatalog_Stamp(const struct tm *t)
+{
+	long long int Year=t->tm_year+1900;
+	int Month=t->tm_mon+1;
+	long long int Days;
+
+	// the year starts in March to put the leap day at the end of the year
+	if (Month<=2) {
+		Year--;
+		Month+=12;
+	}
+	Days=Year*365+Year/4-Year/100+Year/400+(153*(Month-3)+2)/5+t->tm_mday-1;
+	return(Days*86400LL+t->tm_hour*3600+t->tm_min*60+t->tm_sec);
+}
+
+/*!
+ * Read the catalog file named by \c log_catalog_file.
+ */
+static void LogCatalog_Load(void)
+{
+	FileObject *fp_in;
+	struct LogCatalogStruct *Entry;
+	struct getwordstruct gwarea;
+	longline line;
+	char *buf;
+	long long int Dev,Inode;
+
+	LogCatalogLoaded=true;
+	if (LogCatalogFile[0]=='\0' || access(LogCatalogFile,R_OK)!=0) return;
+	if ((fp_in=FileObject_Open(LogCatalogFile))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),LogCatalogFile,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	if ((line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),LogCatalogFile);
+		exit(EXIT_FAILURE);
+	}
+	buf=longline_read(fp_in,line);
+	if (buf && strcmp(buf,LOGCATALOG_HEADER)==0) {
+		while ((buf=longline_read(fp_in,line))!=NULL) {
+			Entry=calloc(1,sizeof(*Entry));
+			if (!Entry) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),LogCatalogFile);
+				exit(EXIT_FAILURE);
+			}
+			getword_start(&gwarea,buf);
+			if (getword_atoll(&Dev,&gwarea,'\t')<0 || getword_atoll(&Inode,&gwarea,'\t')<0 ||
+			    getword_atoll(&Entry->Size,&gwarea,'\t')<0 || getword_atoll(&Entry->Mtime,&gwarea,'\t')<0 ||
+			    getword_atoi(&Entry->MinDate,&gwarea,'\t')<0 || getword_atoi(&Entry->MaxDate,&gwarea,'\t')<0 ||
+			    getword_atoll(&Entry->Disorder,&gwarea,'\t')<0) {
+				debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),LogCatalogFile);
+				exit(EXIT_FAILURE);
+			}
+			Entry->Dev=(unsigned long long int)Dev;
+			Entry->Inode=(unsigned long long int)Inode;
+			if ((Entry->FileName=strdup(gwarea.current))==NULL) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),LogCatalogFile);
+				exit(EXIT_FAILURE);
+			}
+			Entry->Next=FirstLogCatalog;
+			FirstLogCatalog=Entry;
+		}
+	} else if (debug) {
+		debuga(__FILE__,__LINE__,_("Ignoring the log catalog \"%s\" written by another version of sarg\n"),LogCatalogFile);
+	}
+	longline_destroy(&line);
+	if (FileObject_Close(fp_in)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),LogCatalogFile,FileObject_GetLastCloseError());
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Find the entry of a log in the catalog.
+ *
+ * \param st The status of the log file.
+ *
+ * \return The entry or NULL if the log isn't in the catalog or it changed.
+ */
+static struct LogCatalogStruct *LogCatalog_Get(const struct stat *st)
+{
+	struct LogCatalogStruct *Entry;
+
+	if (!LogCatalogLoaded) LogCatalog_Load();
+	for (Entry=FirstLogCatalog ; Entry ; Entry=Entry->Next)
+		if (Entry->Inode==(unsigned long long int)st->st_ino && Entry->Dev==(unsigned long long int)st->st_dev &&
+		    Entry->Size==(long long int)st->st_size && Entry->Mtime==(long long int)st->st_mtime)
+			return(Entry);
+	return(NULL);
+}
+
+/*!
+ * Get the range of dates stored in a log.
+ *
+ * \param FileName The name of the log.
+ * \param st The status of the log file.
+ * \param MinDate Set to the earliest date in the log as YYYYMMDD.
+ * \param MaxDate Set to the latest date in the log as YYYYMMDD.
+ * \param Disorder Set to the number of seconds a line may be older than a line
+ * written before it.
+ *
+ * \return \c True if the log is in the catalog.
+ */
+bool LogCatalog_Find(const char *FileName,const struct stat *st,int *MinDate,int *MaxDate,long long int *Disorder)
+{
+	struct LogCatalogStruct *Entry;
+
+	if (LogCatalogFile[0]=='\0') return(false);
+	Entry=LogCatalog_Get(st);
+	if (!Entry) return(false);
+	Entry->Used=true;
+	*MinDate=Entry->MinDate;
+	*MaxDate=Entry->MaxDate;
+	*Disorder=Entry->Disorder;
+	return(true);
+}
+
+/*!
+ * Record the range of dates found in a log read completely.
+ *
+ * \param FileName The name of the log.
+ * \param st The status of the log file before it was read.
+ * \param MinDate The earliest date in the log as YYYYMMDD.
+ * \param MaxDate The latest date in the log as YYYYMMDD.
+ * \param Disorder The number of seconds a line may be older than a line
+ * written before it.
+ */
+void LogCatalog_Store(const char *FileName,const struct stat *st,int MinDate,int MaxDate,long long int Disorder)
+{
+	struct LogCatalogStruct *Entry;
+
+	if (LogCatalogFile[0]=='\0') return;
+	Entry=LogCatalog_Get(st);
+	if (!Entry) {
+		Entry=calloc(1,sizeof(*Entry));
+		if (!Entry) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the dates of log file \"%s\"\n"),FileName);
+			exit(EXIT_FAILURE);
+		}
+		Entry->Dev=(unsigned long long int)st->st_dev;
+		Entry->Inode=(unsigned long long int)st->st_ino;
+		Entry->Size=(long long int)st->st_size;
+		Entry->Mtime=(long long int)st->st_mtime;
+		Entry->Next=FirstLogCatalog;
+		FirstLogCatalog=Entry;
+	}
+	if (!Entry->FileName || strcmp(Entry->FileName,FileName)!=0) {
+		free(Entry->FileName);
+		if ((Entry->FileName=strdup(FileName))==NULL) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the dates of log file \"%s\"\n"),FileName);
+			exit(EXIT_FAILURE);
+		}
+	}
+	Entry->MinDate=MinDate;
+	Entry->MaxDate=MaxDate;
+	Entry->Disorder=Disorder;
+	Entry->Used=true;
+	LogCatalogChanged=true;
+}
+
+/*!
+ * Write the catalog if it changed.
+ *
+ * The entries not used during this run are kept as long as their log still
+ * exists under the same name. The file is written under a temporary name and
+ * renamed so that it is never seen partially written.
+ */
+void LogCatalog_Save(void)
+{
+	char TempName[MAXLEN];
+	FILE *fp_ou;
+	struct LogCatalogStruct *Entry;
+	struct stat st;
+
+	if (LogCatalogFile[0]=='\0' || !LogCatalogChanged) return;
+	format_path(__FILE__, __LINE__, TempName, sizeof(TempName), "%s.tmp", LogCatalogFile);
+	if ((fp_ou=MY_FOPEN(TempName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fputs(LOGCATALOG_HEADER"\n",fp_ou);
+	for (Entry=FirstLogCatalog ; Entry ; Entry=Entry->Next) {
+		if (!Entry->Used && (stat(Entry->FileName,&st)==-1 || (unsigned long long int)st.st_ino!=Entry->Inode ||
+		    (unsigned long long int)st.st_dev!=Entry->Dev))
+			continue;
+		fprintf(fp_ou,"%llu\t%llu\t%lld\t%lld\t%d\t%d\t%lld\t%s\n",Entry->Dev,Entry->Inode,Entry->Size,Entry->Mtime,
+				Entry->MinDate,Entry->MaxDate,Entry->Disorder,Entry->FileName);
+	}
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TempName,LogCatalogFile)==-1) {
+		debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),TempName,LogCatalogFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	LogCatalogChanged=false;
+}
+
+/*!
+ * Free the memory used by the catalog.
+ */
+void LogCatalog_Free(void)
+{
+	struct LogCatalogStruct *Entry;
+	struct LogCatalogStruct *Next;
+
+	for (Entry=FirstLogCatalog ; Entry ; Entry=Next) {
+		Next=Entry->Next;
+		free(Entry->FileName);
+		free(Entry);
+	}
+	FirstLogCatalog=NULL;
+	LogCatalogLoaded=false;
+}
@@ -0,0 +1,1177 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Index the compressed access logs to read them from near a date.
+
+A gzip or xz log must be decompressed from its beginning to reach the lines
+of a given date. The index records the points where the decompression can be
+restarted in the middle of the log together with the latest time found in the
+lines preceding each point. A report restricted to a range of dates with -d
+then only decompresses the log from the last point preceding the first
+requested date.
+
+The decompression of a gzip log restarts at the boundary of any deflate block
+provided the last 32KB of decompressed data are known. The decompression of a
+xz log can only restart at the beginning of a block. A xz log compressed in a
+single block, as xz does unless it runs multithreaded, has no restart point.
+
+The index of a log is stored in \c log_index_dir under a name made of the
+device and inode of the log so that it is still found after a log rotation.
+It is rebuilt if the size or modification time of the log changed. The index
+is written in the native byte order of the computer.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+#ifdef HAVE_ZLIB_H
+#include "zlib.h"
+#endif
+#ifdef HAVE_LZMA_H
+#include "lzma.h"
+#endif
+
+//! The first bytes of an index file.
+#define LOGINDEX_MAGIC "SARG log index 1"
+//! How many decompressed bytes to leave at least between two restart points.
+#define LOGINDEX_SPAN (1024*1024)
+//! The size of the history needed to restart a gzip decompression.
+#define LOGINDEX_WINDOW 32768
+//! The size of the buffer to read the compressed log.
+#define LOGINDEX_CHUNK (128*1024)
+
+//! The compression of an indexed log.
+enum LogIndexTypeEnum
+{
+	//! The log is compressed with gzip.
+	LOGINDEX_Gzip=1,
+	//! The log is compressed with xz.
+	LOGINDEX_Xz=2
+};
+
+/*!
+ * \brief The fixed size part of a restart point as stored in the index file.
+ */
+struct LogIndexRecordStruct
+{
+	//! The offset in the compressed log where the decompression restarts.
+	long long int In;
+	//! The offset in the decompressed data of the restart point.
+	long long int Out;
+	//! How many bytes to skip after the restart point to reach the beginning of a line.
+	long long int Skip;
+	//! The latest time of the lines before the line the point leads to or -1 if there is none.
+	long long int MaxBefore;
+	//! The offset of the stream following the xz stream containing the point.
+	long long int StreamEnd;
+	//! The number of bits of the byte preceding \a In used by a gzip block or the check of a xz stream.
+	int Bits;
+	//! The size of the compressed gzip window following the record.
+	int WindowSize;
+};
+
+/*!
+ * \brief A point where the decompression of a log can restart.
+ */
+struct LogIndexPointStruct
+{
+	//! The position of the point.
+	struct LogIndexRecordStruct Rec;
+	//! The last 32KB of data decompressed before a gzip point compressed with zlib.
+	unsigned char *Window;
+};
+
+/*!
+ * \brief The index of a log.
+ */
+struct LogIndexStruct
+{
+	//! The name of the log for the messages.
+	const char *FileName;
+	//! The compression of the log.
+	enum LogIndexTypeEnum Type;
+	//! The size of the log when it was indexed.
+	long long int Size;
+	//! The modification time of the log when it was indexed.
+	long long int Mtime;
+	//! The restart points sorted by offset.
+	struct LogIndexPointStruct *Points;
+	//! The number of restart points.
+	int NPoints;
+	//! The number of points allocated.
+	int NAllocated;
+	//! The first point waiting for the end of the current line.
+	int FirstPending;
+	//! The number of bytes decompressed so far while the index is built.
+	long long int Out;
+	//! The latest time found so far while the index is built.
+	long long int MaxStamp;
+	//! The beginning of the current line.
+	char *Line;
+	//! The length of the current line.
+	size_t LineLen;
+	//! The size allocated for the line.
+	size_t LineSize;
+	//! The function returning the time of a line.
+	long long int (*Stamp)(void *Data,char *Line);
+	//! The data to pass to the function returning the time of a line.
+	void *StampData;
+};
+
+/*!
+ * Free the memory used by an index.
+ *
+ * \param Index The index.
+ */
+static void LogIndex_Free(struct LogIndexStruct *Index)
+{
+	int i;
+
+	for (i=0 ; i<Index->NPoints ; i++)
+		if (Index->Points[i].Window) free(Index->Points[i].Window);
+	if (Index->Points) free(Index->Points);
+	if (Index->Line) free(Index->Line);
+	Index->Points=NULL;
+	Index->NPoints=0;
+	Index->NAllocated=0;
+	Index->Line=NULL;
+}
+
+#if defined(HAVE_ZLIB_H) || defined(HAVE_LZMA_H)
+/*!
+ * Add a restart point at the current position of the decompressed data.
+ *
+ * If the point is in the middle of a line, its distance to the next line
+ * and the latest time preceding it are only known at the end of the line.
+ *
+ * \param Index The index being built.
+ * \param In The offset of the point in the compressed log.
+ * \param Bits The number of bits of the previous byte used by a gzip point
+ * or the check of a xz stream.
+ * \param StreamEnd The offset of the stream following a xz point.
+ *
+ * \return The point added.
+ */
+static struct LogIndexPointStruct *LogIndex_AddPoint(struct LogIndexStruct *Index,long long int In,int Bits,long long int StreamEnd)
+{
+	struct LogIndexPointStruct *Point;
+
+	if (Index->NPoints>=Index->NAllocated) {
+		int NAllocated=(Index->NAllocated>0) ? 2*Index->NAllocated : 64;
+
+		Point=realloc(Index->Points,NAllocated*sizeof(*Point));
+		if (!Point) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+			exit(EXIT_FAILURE);
+		}
+		Index->Points=Point;
+		Index->NAllocated=NAllocated;
+	}
+	Point=Index->Points+Index->NPoints++;
+	memset(Point,0,sizeof(*Point));
+	Point->Rec.In=In;
+	Point->Rec.Out=Index->Out;
+	Point->Rec.Bits=Bits;
+	Point->Rec.StreamEnd=StreamEnd;
+	if (Index->LineLen==0) {
+		Point->Rec.MaxBefore=Index->MaxStamp;
+		Index->FirstPending=Index->NPoints;
+	}
+	return(Point);
+}
+
+/*!
+ * Process a complete line of the decompressed log.
+ *
+ * \param Index The index being built.
+ */
+static void LogIndex_EndLine(struct LogIndexStruct *Index)
+{
+	long long int Stamp;
+	int i;
+
+	if (Index->LineLen>0 && Index->Line[Index->LineLen-1]=='\r') Index->LineLen--;
+	if (Index->LineLen>0) {
+		Index->Line[Index->LineLen]='\0';
+		Stamp=Index->Stamp(Index->StampData,Index->Line);
+		if (Stamp>Index->MaxStamp) Index->MaxStamp=Stamp;
+	}
+	Index->LineLen=0;
+	for (i=Index->FirstPending ; i<Index->NPoints ; i++) {
+		Index->Points[i].Rec.Skip=Index->Out-Index->Points[i].Rec.Out;
+		Index->Points[i].Rec.MaxBefore=Index->MaxStamp;
+	}
+	Index->FirstPending=Index->NPoints;
+}
+
+/*!
+ * Split the decompressed data into lines.
+ *
+ * \param Index The index being built.
+ * \param Data The decompressed data.
+ * \param Size The number of bytes in \a Data.
+ */
+static void LogIndex_Feed(struct LogIndexStruct *Index,const unsigned char *Data,size_t Size)
+{
+	const unsigned char *Eol;
+	size_t Len;
+
+	while (Size>0) {
+		Eol=memchr(Data,'\n',Size);
+		Len=(Eol) ? (size_t)(Eol-Data) : Size;
+		if (Index->LineLen+Len>=Index->LineSize) {
+			size_t LineSize=Index->LineLen+Len+1024;
+			char *Line=realloc(Index->Line,LineSize);
+
+			if (!Line) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+				exit(EXIT_FAILURE);
+			}
+			Index->Line=Line;
+			Index->LineSize=LineSize;
+		}
+		memcpy(Index->Line+Index->LineLen,Data,Len);
+		Index->LineLen+=Len;
+		Index->Out+=Len;
+		if (!Eol) break;
+		Data+=Len+1;
+		Size-=Len+1;
+		Index->Out++;
+		LogIndex_EndLine(Index);
+	}
+}
+
+#endif
+
+/*!
+ * Terminate the index once the whole log was decompressed.
+ *
+ * The points leading to the last line are dropped if it has no end of line.
+ *
+ * \param Index The index being built.
+ */
+static void LogIndex_Finish(struct LogIndexStruct *Index)
+{
+	int i;
+
+	for (i=Index->FirstPending ; i<Index->NPoints ; i++)
+		if (Index->Points[i].Window) free(Index->Points[i].Window);
+	Index->NPoints=Index->FirstPending;
+}
+
+#ifdef HAVE_ZLIB_H
+/*!
+ * Decompress a gzip log and record a restart point at the end of a deflate
+ * block every LOGINDEX_SPAN bytes of decompressed data.
+ *
+ * \param Index The index to build.
+ * \param File The compressed log.
+ *
+ * \return \c True if the whole log was decompressed.
+ */
+static bool LogIndex_BuildGzip(struct LogIndexStruct *Index,FILE *File)
+{
+	z_stream Stream;
+	unsigned char *Input;
+	unsigned char *Window;
+	unsigned char *Dict;
+	struct LogIndexPointStruct *Point;
+	long long int In=0;
+	long long int Last=0;
+	unsigned int Before;
+	unsigned int Produced;
+	unsigned int WinPos=0;
+	uLongf WindowSize;
+	int Status;
+
+	Input=malloc(LOGINDEX_CHUNK);
+	Window=calloc(2,LOGINDEX_WINDOW);
+	Dict=malloc(compressBound(LOGINDEX_WINDOW));
+	if (!Input || !Window || !Dict) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+		exit(EXIT_FAILURE);
+	}
+	memset(&Stream,0,sizeof(Stream));
+	// accept a gzip or zlib header
+	if (inflateInit2(&Stream,47)!=Z_OK) {
+		debuga(__FILE__,__LINE__,_("Cannot initialize zlib to index file \"%s\"\n"),Index->FileName);
+		exit(EXIT_FAILURE);
+	}
+	for (;;) {
+		if (Stream.avail_in==0) {
+			Stream.avail_in=fread(Input,1,LOGINDEX_CHUNK,File);
+			Stream.next_in=Input;
+			if (Stream.avail_in==0) {
+				Status=Z_DATA_ERROR;
+				break;
+			}
+		}
+		if (WinPos==LOGINDEX_WINDOW) WinPos=0;
+		Stream.next_out=Window+WinPos;
+		Stream.avail_out=LOGINDEX_WINDOW-WinPos;
+		Before=Stream.avail_in;
+		Produced=Stream.avail_out;
+		// stop at the end of each deflate block
+		Status=inflate(&Stream,Z_BLOCK);
+		In+=Before-Stream.avail_in;
+		Produced-=Stream.avail_out;
+		LogIndex_Feed(Index,Window+WinPos,Produced);
+		WinPos+=Produced;
+		if (Status==Z_STREAM_END) {
+			// another gzip member may follow
+			if (Stream.avail_in==0) {
+				Stream.avail_in=fread(Input,1,LOGINDEX_CHUNK,File);
+				Stream.next_in=Input;
+				if (Stream.avail_in==0) break;
+			}
+			// gzread ignores the trailing garbage
+			if (Stream.next_in[0]!=0x1F) break;
+			inflateReset(&Stream);
+			continue;
+		}
+		if (Status!=Z_OK) break;
+		if ((Stream.data_type & 128)!=0 && (Stream.data_type & 64)==0 && Index->Out-Last>=LOGINDEX_SPAN) {
+			Point=LogIndex_AddPoint(Index,In,Stream.data_type & 7,0);
+			// the history must be in chronological order
+			memcpy(Window+LOGINDEX_WINDOW,Window,WinPos);
+			WindowSize=compressBound(LOGINDEX_WINDOW);
+			if (compress(Dict,&WindowSize,Window+WinPos,LOGINDEX_WINDOW)!=Z_OK ||
+			    (Point->Window=malloc(WindowSize))==NULL) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+				exit(EXIT_FAILURE);
+			}
+			memcpy(Point->Window,Dict,WindowSize);
+			Point->Rec.WindowSize=(int)WindowSize;
+			Last=Index->Out;
+		}
+	}
+	inflateEnd(&Stream);
+	free(Dict);
+	free(Window);
+	free(Input);
+	if (ferror(File)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),Index->FileName,strerror(errno));
+		return(false);
+	}
+	if (Status!=Z_STREAM_END) {
+		debuga(__FILE__,__LINE__,_("Cannot index the corrupted or truncated file \"%s\"\n"),Index->FileName);
+		return(false);
+	}
+	return(true);
+}
+
+/*!
+ * \brief The state of a gzip log decompressed from a restart point.
+ */
+struct LogIndexGzipStruct
+{
+	//! The zlib stream.
+	z_stream Stream;
+	//! The compressed log.
+	FILE *File;
+	//! The name of the log for the messages.
+	const char *FileName;
+	//! \c True while the raw deflate data of the first member are decompressed.
+	bool Raw;
+	//! \c True if the end of the decompressed data is reached.
+	bool Eof;
+	//! The buffer to read the compressed log.
+	unsigned char Input[LOGINDEX_CHUNK];
+};
+
+/*!
+ * Make sure the compressed data contain at least one byte.
+ *
+ * \param GData The state of the decompression.
+ *
+ * \return \c False if the end of the file is reached.
+ */
+static bool LogIndex_GzipFill(struct LogIndexGzipStruct *GData)
+{
+	if (GData->Stream.avail_in>0) return(true);
+	GData->Stream.avail_in=fread(GData->Input,1,sizeof(GData->Input),GData->File);
+	GData->Stream.next_in=GData->Input;
+	return(GData->Stream.avail_in>0);
+}
+
+/*!
+ * Start the next gzip member after the end of a member.
+ *
+ * \param GData The state of the decompression.
+ *
+ * \return \c False if no member follows.
+ */
+static bool LogIndex_GzipNextMember(struct LogIndexGzipStruct *GData)
+{
+	int Trailer;
+
+	if (GData->Raw) {
+		// skip the CRC and size zlib doesn't read from a raw deflate stream
+		for (Trailer=8 ; Trailer>0 ; ) {
+			unsigned int Len;
+
+			if (!LogIndex_GzipFill(GData)) return(false);
+			Len=(GData->Stream.avail_in<(unsigned int)Trailer) ? GData->Stream.avail_in : (unsigned int)Trailer;
+			GData->Stream.next_in+=Len;
+			GData->Stream.avail_in-=Len;
+			Trailer-=Len;
+		}
+		GData->Raw=false;
+		if (inflateReset2(&GData->Stream,47)!=Z_OK) return(false);
+	} else {
+		inflateReset(&GData->Stream);
+	}
+	if (!LogIndex_GzipFill(GData)) return(false);
+	return(GData->Stream.next_in[0]==0x1F);
+}
+
+/*!
+ * Read from a gzip log decompressed from a restart point.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int LogIndex_GzipRead(void *Data,void *Buffer,int Size)
+{
+	struct LogIndexGzipStruct *GData=(struct LogIndexGzipStruct *)Data;
+	int Status;
+
+	GData->Stream.next_out=Buffer;
+	GData->Stream.avail_out=Size;
+	while (GData->Stream.avail_out>0 && !GData->Eof) {
+		if (!LogIndex_GzipFill(GData)) {
+			debuga(__FILE__,__LINE__,_("Truncated gzip file \"%s\"\n"),GData->FileName);
+			GData->Eof=true;
+			break;
+		}
+		Status=inflate(&GData->Stream,Z_NO_FLUSH);
+		if (Status==Z_STREAM_END) {
+			if (!LogIndex_GzipNextMember(GData)) GData->Eof=true;
+		} else if (Status!=Z_OK) {
+			debuga(__FILE__,__LINE__,_("Error decompressing file \"%s\" (zlib returned error %d)\n"),GData->FileName,Status);
+			return(0);
+		}
+	}
+	return(Size-GData->Stream.avail_out);
+}
+
+/*!
+ * Check if end of file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int LogIndex_GzipEof(void *Data)
+{
+	struct LogIndexGzipStruct *GData=(struct LogIndexGzipStruct *)Data;
+	return(GData->Eof);
+}
+
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int LogIndex_GzipOffset(void *Data)
+{
+	struct LogIndexGzipStruct *GData=(struct LogIndexGzipStruct *)Data;
+	return((long long int)ftello(GData->File));
+}
+
+/*!
+ * Close the file.
+ *
+ * \param Data File to close.
+ *
+ * \return 0 on success or -1 on error.
+ */
+static int LogIndex_GzipClose(void *Data)
+{
+	struct LogIndexGzipStruct *GData=(struct LogIndexGzipStruct *)Data;
+
+	fclose(GData->File);
+	inflateEnd(&GData->Stream);
+	free(GData);
+	return(0);
+}
+
+/*!
+ * Decompress a gzip log from a restart point.
+ *
+ * \param FileName The name of the log for the messages.
+ * \param File The log.
+ * \param Point The restart point.
+ *
+ * \return The object to read the data from or NULL if the point is invalid.
+ */
+static FileObject *LogIndex_GzipOpen(const char *FileName,FILE *File,const struct LogIndexPointStruct *Point)
+{
+	struct LogIndexGzipStruct *GData;
+	FileObject *fi;
+	unsigned char *Dict;
+	uLongf DictSize=LOGINDEX_WINDOW;
+	int Byte=0;
+
+	GData=calloc(1,sizeof(*GData));
+	fi=calloc(1,sizeof(*fi));
+	Dict=malloc(LOGINDEX_WINDOW);
+	if (!GData || !fi || !Dict) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),FileName);
+		exit(EXIT_FAILURE);
+	}
+	GData->File=File;
+	GData->FileName=FileName;
+	GData->Raw=true;
+	if (fseeko(File,(off_t)(Point->Rec.In-(Point->Rec.Bits ? 1 : 0)),SEEK_SET)!=0 ||
+	    (Point->Rec.Bits && (Byte=getc(File))==EOF) ||
+	    uncompress(Dict,&DictSize,Point->Window,Point->Rec.WindowSize)!=Z_OK || DictSize!=LOGINDEX_WINDOW ||
+	    inflateInit2(&GData->Stream,-15)!=Z_OK) {
+		free(Dict);
+		free(fi);
+		free(GData);
+		return(NULL);
+	}
+	if ((Point->Rec.Bits && inflatePrime(&GData->Stream,Point->Rec.Bits,Byte>>(8-Point->Rec.Bits))!=Z_OK) ||
+	    inflateSetDictionary(&GData->Stream,Dict,LOGINDEX_WINDOW)!=Z_OK) {
+		inflateEnd(&GData->Stream);
+		free(Dict);
+		free(fi);
+		free(GData);
+		return(NULL);
+	}
+	free(Dict);
+	fi->Data=GData;
+	fi->Read=LogIndex_GzipRead;
+	fi->Eof=LogIndex_GzipEof;
+	fi->Close=LogIndex_GzipClose;
+	fi->Offset=LogIndex_GzipOffset;
+	return(fi);
+}
+#endif
+
+#ifdef HAVE_LZMA_H
+/*!
+ * Read the indexes of every stream of a xz log.
+ *
+ * The streams are read from the end of the file as xz does to list the
+ * content of a file.
+ *
+ * \param File The log.
+ * \param Size The size of the log.
+ *
+ * \return The combined index or NULL if it couldn't be read.
+ */
+static lzma_index *LogIndex_XzReadIndex(FILE *File,long long int Size)
+{
+	lzma_index *Combined=NULL;
+	lzma_index *This;
+	lzma_stream_flags Footer;
+	lzma_stream_flags Header;
+	uint8_t Buffer[LZMA_STREAM_HEADER_SIZE];
+	uint8_t *IndexData;
+	uint64_t MemLimit;
+	size_t InPos;
+	long long int Pos=Size;
+	long long int Padding;
+	long long int StreamStart;
+	int fd=fileno(File);
+
+	while (Pos>0) {
+		// skip the stream padding
+		for (Padding=0 ; Pos>=LZMA_STREAM_HEADER_SIZE ; Pos-=4,Padding+=4) {
+			if (pread(fd,Buffer,4,(off_t)(Pos-4))!=4) goto Error;
+			if (Buffer[0] || Buffer[1] || Buffer[2] || Buffer[3]) break;
+		}
+		if (Pos<2*LZMA_STREAM_HEADER_SIZE) goto Error;
+		if (pread(fd,Buffer,LZMA_STREAM_HEADER_SIZE,(off_t)(Pos-LZMA_STREAM_HEADER_SIZE))!=LZMA_STREAM_HEADER_SIZE ||
+		    lzma_stream_footer_decode(&Footer,Buffer)!=LZMA_OK)
+			goto Error;
+		if ((long long int)Footer.backward_size>Pos-2*LZMA_STREAM_HEADER_SIZE) goto Error;
+		if ((IndexData=malloc(Footer.backward_size))==NULL) goto Error;
+		if (pread(fd,IndexData,Footer.backward_size,(off_t)(Pos-LZMA_STREAM_HEADER_SIZE-Footer.backward_size))!=(ssize_t)Footer.backward_size) {
+			free(IndexData);
+			goto Error;
+		}
+		MemLimit=UINT64_MAX;
+		InPos=0;
+		if (lzma_index_buffer_decode(&This,&MemLimit,NULL,IndexData,&InPos,Footer.backward_size)!=LZMA_OK) {
+			free(IndexData);
+			goto Error;
+		}
+		free(IndexData);
+		StreamStart=Pos-(long long int)lzma_index_stream_size(This);
+		if (StreamStart<0 ||
+		    pread(fd,Buffer,LZMA_STREAM_HEADER_SIZE,(off_t)StreamStart)!=LZMA_STREAM_HEADER_SIZE ||
+		    lzma_stream_header_decode(&Header,Buffer)!=LZMA_OK ||
+		    lzma_stream_flags_compare(&Header,&Footer)!=LZMA_OK ||
+		    lzma_index_stream_flags(This,&Footer)!=LZMA_OK ||
+		    lzma_index_stream_padding(This,Padding)!=LZMA_OK) {
+			lzma_index_end(This,NULL);
+			goto Error;
+		}
+		if (Combined && lzma_index_cat(This,Combined,NULL)!=LZMA_OK) {
+			lzma_index_end(This,NULL);
+			goto Error;
+		}
+		Combined=This;
+		Pos=StreamStart;
+	}
+	return(Combined);
+
+Error:
+	if (Combined) lzma_index_end(Combined,NULL);
+	return(NULL);
+}
+
+/*!
+ * Decompress a xz log and record a restart point at the beginning of a block
+ * every LOGINDEX_SPAN bytes of decompressed data.
+ *
+ * The log isn't decompressed if it contains a single block.
+ *
+ * \param Index The index to build.
+ * \param File The compressed log.
+ *
+ * \return \c True if the index was built.
+ */
+static bool LogIndex_BuildXz(struct LogIndexStruct *Index,FILE *File)
+{
+	lzma_index *XzIndex;
+	lzma_index_iter Iter;
+	lzma_stream Stream=LZMA_STREAM_INIT;
+	struct LogIndexRecordStruct *Blocks=NULL;
+	int NBlocks=0;
+	int Next=0;
+	long long int Last=0;
+	unsigned char *Input;
+	unsigned char *Output;
+	size_t Len;
+	lzma_ret zerr;
+
+	if ((XzIndex=LogIndex_XzReadIndex(File,Index->Size))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot index the corrupted or truncated file \"%s\"\n"),Index->FileName);
+		return(false);
+	}
+	if ((Blocks=calloc(lzma_index_block_count(XzIndex),sizeof(*Blocks)))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+		exit(EXIT_FAILURE);
+	}
+	lzma_index_iter_init(&Iter,XzIndex);
+	while (!lzma_index_iter_next(&Iter,LZMA_INDEX_ITER_NONEMPTY_BLOCK)) {
+		if ((long long int)Iter.block.uncompressed_file_offset-Last<LOGINDEX_SPAN) continue;
+		Blocks[NBlocks].In=Iter.block.compressed_file_offset;
+		Blocks[NBlocks].Out=Iter.block.uncompressed_file_offset;
+		Blocks[NBlocks].Bits=(int)Iter.stream.flags->check;
+		Blocks[NBlocks].StreamEnd=Iter.stream.compressed_offset+Iter.stream.compressed_size+Iter.stream.padding;
+		Last=Blocks[NBlocks].Out;
+		NBlocks++;
+	}
+	lzma_index_end(XzIndex,NULL);
+	if (NBlocks==0) {
+		// there is nothing to record
+		free(Blocks);
+		return(true);
+	}
+
+	Input=malloc(LOGINDEX_CHUNK);
+	Output=malloc(LOGINDEX_CHUNK);
+	if (!Input || !Output) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to index file \"%s\"\n"),Index->FileName);
+		exit(EXIT_FAILURE);
+	}
+	if (lzma_stream_decoder(&Stream,UINT64_MAX,LZMA_CONCATENATED)!=LZMA_OK) {
+		debuga(__FILE__,__LINE__,_("Cannot initialize the LZMA decoder to index file \"%s\"\n"),Index->FileName);
+		exit(EXIT_FAILURE);
+	}
+	do {
+		if (Stream.avail_in==0 && !feof(File)) {
+			Stream.next_in=Input;
+			Stream.avail_in=fread(Input,1,LOGINDEX_CHUNK,File);
+		}
+		Stream.next_out=Output;
+		Stream.avail_out=LOGINDEX_CHUNK;
+		zerr=lzma_code(&Stream,feof(File) ? LZMA_FINISH : LZMA_RUN);
+		Len=LOGINDEX_CHUNK-Stream.avail_out;
+		// record the points as the decompression reaches them
+		while (Next<NBlocks && Index->Out+(long long int)Len>=Blocks[Next].Out) {
+			size_t Part=(size_t)(Blocks[Next].Out-Index->Out);
+
+			LogIndex_Feed(Index,Output+(LOGINDEX_CHUNK-Stream.avail_out-Len),Part);
+			Len-=Part;
+			LogIndex_AddPoint(Index,Blocks[Next].In,Blocks[Next].Bits,Blocks[Next].StreamEnd);
+			Next++;
+		}
+		LogIndex_Feed(Index,Output+(LOGINDEX_CHUNK-Stream.avail_out-Len),Len);
+	} while (zerr==LZMA_OK);
+	lzma_end(&Stream);
+	free(Output);
+	free(Input);
+	free(Blocks);
+	if (ferror(File)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),Index->FileName,strerror(errno));
+		return(false);
+	}
+	if (zerr!=LZMA_STREAM_END) {
+		debuga(__FILE__,__LINE__,_("Cannot index the corrupted or truncated file \"%s\"\n"),Index->FileName);
+		return(false);
+	}
+	return(true);
+}
+
+/*!
+ * \brief The state of a xz log decompressed from a restart point.
+ */
+struct LogIndexXzStruct
+{
+	//! The lzma stream.
+	lzma_stream Stream;
+	//! The compressed log.
+	FILE *File;
+	//! The name of the log for the messages.
+	const char *FileName;
+	//! The check of the stream containing the blocks.
+	lzma_check Check;
+	//! The options of the block being decompressed. The block decoder keeps a pointer to it.
+	lzma_block Block;
+	//! The offset of the stream following the blocks.
+	long long int StreamEnd;
+	//! The size of the log.
+	long long int Size;
+	//! \c True while the blocks of the first stream are decompressed one by one.
+	bool Blocks;
+	//! \c True if the end of the decompressed data is reached.
+	bool Eof;
+	//! \c True if the whole compressed file was read.
+	bool InputEof;
+	//! The buffer to read the compressed log.
+	unsigned char Input[LOGINDEX_CHUNK];
+};
+
+/*!
+ * Make sure the input buffer contains at least a given number of bytes.
+ *
+ * \param XData The state of the decompression.
+ * \param Size The number of bytes needed.
+ *
+ * \return \c False if the end of the file is reached before.
+ */
+static bool LogIndex_XzFill(struct LogIndexXzStruct *XData,size_t Size)
+{
+	size_t nread;
+
+	if (XData->Stream.avail_in>=Size) return(true);
+	memmove(XData->Input,XData->Stream.next_in,XData->Stream.avail_in);
+	XData->Stream.next_in=XData->Input;
+	nread=fread(XData->Input+XData->Stream.avail_in,1,sizeof(XData->Input)-XData->Stream.avail_in,XData->File);
+	XData->Stream.avail_in+=nread;
+	if (feof(XData->File)) XData->InputEof=true;
+	return(XData->Stream.avail_in>=Size);
+}
+
+/*!
+ * Start decompressing the next block of the stream.
+ *
+ * Once the index of the stream is reached, the following streams are
+ * decompressed sequentially.
+ *
+ * \param XData The state of the decompression.
+ *
+ * \return \c False if the block header is invalid.
+ */
+static bool LogIndex_XzNextBlock(struct LogIndexXzStruct *XData)
+{
+	lzma_filter Filters[LZMA_FILTERS_MAX+1];
+	lzma_block *Block=&XData->Block;
+	lzma_ret zerr;
+	int i;
+
+	if (!LogIndex_XzFill(XData,1)) return(false);
+	if (XData->Stream.next_in[0]==0x00) {
+		// the index of the stream is reached
+		XData->Blocks=false;
+		if (XData->StreamEnd>=XData->Size) {
+			XData->Eof=true;
+			return(true);
+		}
+		if (fseeko(XData->File,(off_t)XData->StreamEnd,SEEK_SET)!=0) return(false);
+		XData->Stream.avail_in=0;
+		XData->InputEof=false;
+		return(lzma_stream_decoder(&XData->Stream,UINT64_MAX,LZMA_CONCATENATED)==LZMA_OK);
+	}
+	memset(Block,0,sizeof(*Block));
+	Block->version=0;
+	Block->check=XData->Check;
+	Block->filters=Filters;
+	Block->header_size=lzma_block_header_size_decode(XData->Stream.next_in[0]);
+	if (!LogIndex_XzFill(XData,Block->header_size)) return(false);
+	if (lzma_block_header_decode(Block,NULL,XData->Stream.next_in)!=LZMA_OK) return(false);
+	XData->Stream.next_in+=Block->header_size;
+	XData->Stream.avail_in-=Block->header_size;
+	zerr=lzma_block_decoder(&XData->Stream,Block);
+	Block->filters=NULL;
+	// the decoder keeps a copy of the options
+	for (i=0 ; Filters[i].id!=LZMA_VLI_UNKNOWN ; i++)
+		free(Filters[i].options);
+	return(zerr==LZMA_OK);
+}
+
+/*!
+ * Read from a xz log decompressed from a restart point.
+ *
+ * \param Data The file object.
+ * \param Buffer The boffer to store the data read.
+ * \param Size How many bytes to read.
+ *
+ * \return The number of bytes read.
+ */
+static int LogIndex_XzRead(void *Data,void *Buffer,int Size)
+{
+	struct LogIndexXzStruct *XData=(struct LogIndexXzStruct *)Data;
+	lzma_ret zerr;
+
+	XData->Stream.next_out=Buffer;
+	XData->Stream.avail_out=Size;
+	while (XData->Stream.avail_out>0 && !XData->Eof) {
+		if (XData->Stream.avail_in==0 && !XData->InputEof)
+			LogIndex_XzFill(XData,1);
+		zerr=lzma_code(&XData->Stream,(XData->InputEof) ? LZMA_FINISH : LZMA_RUN);
+		if (zerr==LZMA_STREAM_END) {
+			if (!XData->Blocks) {
+				XData->Eof=true;
+			} else if (!LogIndex_XzNextBlock(XData)) {
+				debuga(__FILE__,__LINE__,_("Invalid block in xz file \"%s\"\n"),XData->FileName);
+				return(0);
+			}
+		} else if (zerr==LZMA_BUF_ERROR && XData->InputEof) {
+			debuga(__FILE__,__LINE__,_("Truncated xz file \"%s\"\n"),XData->FileName);
+			XData->Eof=true;
+		} else if (zerr!=LZMA_OK) {
+			debuga(__FILE__,__LINE__,_("Error decompressiong xz file (lzma library returned error %d)"),zerr);
+			return(0);
+		}
+	}
+	return(Size-XData->Stream.avail_out);
+}
+
+/*!
+ * Check if end of file is reached.
+ *
+ * \param Data The file object.
+ *
+ * \return \c True if end of file is reached.
+ */
+static int LogIndex_XzEof(void *Data)
+{
+	struct LogIndexXzStruct *XData=(struct LogIndexXzStruct *)Data;
+	return(XData->Eof);
+}
+
+/*!
+ * Get the number of compressed bytes read from the file.
+ *
+ * \param Data The file object.
+ *
+ * \return The position in the compressed file.
+ */
+static long long int LogIndex_XzOffset(void *Data)
+{
+	struct LogIndexXzStruct *XData=(struct LogIndexXzStruct *)Data;
+	return((long long int)ftello(XData->File));
+}
+
+/*!
+ * Close the file.
+ *
+ * \param Data File to close.
+ *
+ * \return 0 on success or -1 on error.
+ */
+static int LogIndex_XzClose(void *Data)
+{
+	struct LogIndexXzStruct *XData=(struct LogIndexXzStruct *)Data;
+
+	fclose(XData->File);
+	lzma_end(&XData->Stream);
+	free(XData);
+	return(0);
+}
+
+/*!
+ * Decompress a xz log from the beginning of a block.
+ *
+ * \param FileName The name of the log for the messages.
+ * \param File The log.
+ * \param Size The size of the log.
+ * \param Point The restart point.
+ *
+ * \return The object to read the data from or NULL if the point is invalid.
+ */
+static FileObject *LogIndex_XzOpen(const char *FileName,FILE *File,long long int Size,const struct LogIndexPointStruct *Point)
+{
+	struct LogIndexXzStruct *XData;
+	FileObject *fi;
+	lzma_stream Init=LZMA_STREAM_INIT;
+
+	XData=calloc(1,sizeof(*XData));
+	fi=calloc(1,sizeof(*fi));
+	if (!XData || !fi) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),FileName);
+		exit(EXIT_FAILURE);
+	}
+	XData->Stream=Init;
+	XData->File=File;
+	XData->FileName=FileName;
+	XData->Check=(lzma_check)Point->Rec.Bits;
+	XData->StreamEnd=Point->Rec.StreamEnd;
+	XData->Size=Size;
+	XData->Blocks=true;
+	if (fseeko(File,(off_t)Point->Rec.In,SEEK_SET)!=0 || !LogIndex_XzNextBlock(XData)) {
+		lzma_end(&XData->Stream);
+		free(fi);
+		free(XData);
+		return(NULL);
+	}
+	fi->Data=XData;
+	fi->Read=LogIndex_XzRead;
+	fi->Eof=LogIndex_XzEof;
+	fi->Close=LogIndex_XzClose;
+	fi->Offset=LogIndex_XzOffset;
+	return(fi);
+}
+#endif
+
+/*!
+ * Read the index of a log.
+ *
+ * \param Index The index to fill.
+ * \param IndexName The name of the index file.
+ *
+ * \return \c True if the index exists and matches the log.
+ */
+static bool LogIndex_Load(struct LogIndexStruct *Index,const char *IndexName)
+{
+	FILE *fi;
+	char Magic[sizeof(LOGINDEX_MAGIC)];
+	long long int Header[4];
+	struct LogIndexPointStruct *Point;
+	int i;
+
+	if ((fi=MY_FOPEN(IndexName,"rb"))==NULL) return(false);
+	if (fread(Magic,1,sizeof(Magic),fi)!=sizeof(Magic) || memcmp(Magic,LOGINDEX_MAGIC,sizeof(Magic))!=0 ||
+	    fread(Header,sizeof(Header),1,fi)!=1 || Header[0]!=Index->Type || Header[1]!=Index->Size ||
+	    Header[2]!=Index->Mtime || Header[3]<0) {
+		fclose(fi);
+		return(false);
+	}
+	if (Header[3]>0 && (Index->Points=calloc(Header[3],sizeof(*Index->Points)))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),IndexName);
+		exit(EXIT_FAILURE);
+	}
+	Index->NAllocated=(int)Header[3];
+	for (i=0 ; i<Index->NAllocated ; i++) {
+		Point=Index->Points+i;
+		if (fread(&Point->Rec,sizeof(Point->Rec),1,fi)!=1 || Point->Rec.WindowSize<0) break;
+		if (Point->Rec.WindowSize>0) {
+			if ((Point->Window=malloc(Point->Rec.WindowSize))==NULL) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),IndexName);
+				exit(EXIT_FAILURE);
+			}
+			Index->NPoints++;
+			if (fread(Point->Window,Point->Rec.WindowSize,1,fi)!=1) break;
+		} else {
+			Index->NPoints++;
+		}
+	}
+	fclose(fi);
+	if (i<Index->NAllocated) {
+		debuga(__FILE__,__LINE__,_("Ignoring the truncated index file \"%s\"\n"),IndexName);
+		LogIndex_Free(Index);
+		return(false);
+	}
+	return(true);
+}
+
+/*!
+ * Write the index of a log.
+ *
+ * The file is written under a temporary name and renamed so that it is never
+ * seen partially written.
+ *
+ * \param Index The index to write.
+ * \param IndexName The name of the index file.
+ */
+static void LogIndex_Save(const struct LogIndexStruct *Index,const char *IndexName)
+{
+	char TempName[MAXLEN];
+	FILE *fo;
+	long long int Header[4];
+	int i;
+
+	format_path(__FILE__, __LINE__, TempName, sizeof(TempName), "%s.tmp", IndexName);
+	if ((fo=MY_FOPEN(TempName,"wb"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	Header[0]=Index->Type;
+	Header[1]=Index->Size;
+	Header[2]=Index->Mtime;
+	Header[3]=Index->NPoints;
+	fwrite(LOGINDEX_MAGIC,1,sizeof(LOGINDEX_MAGIC),fo);
+	fwrite(Header,sizeof(Header),1,fo);
+	for (i=0 ; i<Index->NPoints ; i++) {
+		fwrite(&Index->Points[i].Rec,sizeof(Index->Points[i].Rec),1,fo);
+		if (Index->Points[i].Rec.WindowSize>0)
+			fwrite(Index->Points[i].Window,Index->Points[i].Rec.WindowSize,1,fo);
+	}
+	if (fclose(fo)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TempName,IndexName)==-1) {
+		debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),TempName,IndexName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Open a compressed log from the last restart point preceding a time.
+ *
+ * The log is indexed if its index doesn't exist or is outdated. Every line
+ * preceding the returned position is older than \a Target.
+ *
+ * \param FileName The name of the log.
+ * \param st The status of the log file.
+ * \param Target The earliest time to read as returned by LogCatalog_Stamp().
+ * \param Stamp The function returning the time of a line as returned by
+ * LogCatalog_Stamp() or -1 if the line can't be parsed.
+ * \param StampData The data to pass to \a Stamp.
+ * \param Offset Set to the offset in the decompressed data of the first line read.
+ *
+ * \return The file positioned at the beginning of a line or NULL if the log
+ * isn't a gzip or xz file or it must be read from its beginning.
+ */
+FileObject *LogIndex_Open(const char *FileName,const struct stat *st,long long int Target,long long int (*Stamp)(void *Data,char *Line),void *StampData,long long int *Offset)
+{
+	struct LogIndexStruct Index;
+	char IndexName[MAXLEN];
+	unsigned char Magic[6];
+	FileObject *fi=NULL;
+	const struct LogIndexPointStruct *Point;
+	FILE *File;
+	bool Built;
+	int i;
+
+	if (LogIndexDir[0]=='\0') return(NULL);
+	if ((File=MY_FOPEN(FileName,"rb"))==NULL) return(NULL);
+	memset(&Index,0,sizeof(Index));
+	Index.FileName=FileName;
+	Index.Size=(long long int)st->st_size;
+	Index.Mtime=(long long int)st->st_mtime;
+	Index.MaxStamp=-1;
+	Index.Stamp=Stamp;
+	Index.StampData=StampData;
+	if (fread(Magic,1,sizeof(Magic),File)!=sizeof(Magic)) {
+		fclose(File);
+		return(NULL);
+	}
+#ifdef HAVE_ZLIB_H
+	if (Magic[0]==0x1F && Magic[1]==0x8B && Magic[2]==0x08)
+		Index.Type=LOGINDEX_Gzip;
+#endif
+#ifdef HAVE_LZMA_H
+	if (Magic[0]==0xFD && Magic[1]=='7' && Magic[2]=='z' && Magic[3]=='X' && Magic[4]=='Z' && Magic[5]==0x00)
+		Index.Type=LOGINDEX_Xz;
+#endif
+	if (Index.Type==0) {
+		fclose(File);
+		return(NULL);
+	}
+
+	format_path(__FILE__, __LINE__, IndexName, sizeof(IndexName), "%s/%llx-%llx.idx", LogIndexDir,
+				(unsigned long long int)st->st_dev,(unsigned long long int)st->st_ino);
+	if (!LogIndex_Load(&Index,IndexName)) {
+		if (debug) debuga(__FILE__,__LINE__,_("Indexing compressed log file \"%s\"\n"),FileName);
+		Built=false;
+		rewind(File);
+#ifdef HAVE_ZLIB_H
+		if (Index.Type==LOGINDEX_Gzip) Built=LogIndex_BuildGzip(&Index,File);
+#endif
+#ifdef HAVE_LZMA_H
+		if (Index.Type==LOGINDEX_Xz) Built=LogIndex_BuildXz(&Index,File);
+#endif
+		if (!Built) {
+			LogIndex_Free(&Index);
+			fclose(File);
+			return(NULL);
+		}
+		LogIndex_Finish(&Index);
+		if (access(LogIndexDir,R_OK)!=0 && !my_mkdir(LogIndexDir)) {
+			debuga(__FILE__,__LINE__,_("Cannot create directory \"%s\"\n"),LogIndexDir);
+			exit(EXIT_FAILURE);
+		}
+		LogIndex_Save(&Index,IndexName);
+	}
+
+	// the latest time before a point never decreases
+	Point=NULL;
+	for (i=0 ; i<Index.NPoints && Index.Points[i].Rec.MaxBefore<Target ; i++)
+		Point=Index.Points+i;
+	if (Point) {
+#ifdef HAVE_ZLIB_H
+		if (Index.Type==LOGINDEX_Gzip) fi=LogIndex_GzipOpen(FileName,File,Point);
+#endif
+#ifdef HAVE_LZMA_H
+		if (Index.Type==LOGINDEX_Xz) fi=LogIndex_XzOpen(FileName,File,Index.Size,Point);
+#endif
+	}
+	if (fi) {
+		char *Skip;
+		long long int Remain=Point->Rec.Skip;
+		int nread;
+
+		// go to the beginning of the first line after the point
+		if ((Skip=malloc(LOGINDEX_CHUNK))==NULL) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),FileName);
+			exit(EXIT_FAILURE);
+		}
+		while (Remain>0 && (nread=FileObject_Read(fi,Skip,(Remain<LOGINDEX_CHUNK) ? (int)Remain : LOGINDEX_CHUNK))>0)
+			Remain-=nread;
+		free(Skip);
+		*Offset=Point->Rec.Out+Point->Rec.Skip;
+		fi=decomp_readahead(FileName,fileno(File),fi);
+	} else {
+		if (Point) debuga(__FILE__,__LINE__,_("Invalid restart point in the index of file \"%s\"\n"),FileName);
+		fclose(File);
+	}
+	LogIndex_Free(&Index);
+	return(fi);
+}
@@ -0,0 +1,550 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+/*!\file
+\brief Cache the entries parsed from the access logs.
+
+A rotated log doesn't change but it is decompressed, parsed and filtered again
+every time a report covering its dates is produced. The cache stores, for each
+line of such a log, the outcome of the filters that don't depend on the date
+range requested with -d: the reason why the line was excluded or the entry with
+the user ID and URL as written in the temporary files. Later runs replay the
+cache and only apply the date, week day and hour filters.
+
+The cache of a log is stored in \c parse_cache_dir under a name made of the
+device and inode of the log so that it is still found after a log rotation.
+It is discarded if the size or modification time of the log changed or if
+the fingerprint of the configuration differs. The fingerprint covers the
+configuration files, the command line options filtering the entries and the
+content of the exclusion, alias and system users files. The cache is written
+in the native byte order of the computer.
+*/
+
+#include "include/conf.h"
+#include "include/defs.h"
+#include "include/readlog.h"
+#include "include/parsecache.h"
+
+//! The first bytes of a cache file.
+#define PARSECACHE_MAGIC "SARG parse cache 1"
+//! The suffix of the cache files.
+#define PARSECACHE_SUFFIX ".pc"
+//! The size of the stdio buffer of a cache file.
+#define PARSECACHE_BUFFER (1024*1024)
+//! How many days a cache file is kept after it was last used.
+#define PARSECACHE_KEEP_DAYS 31
+
+//! The entry identifies the user by the IP address.
+#define PCF_IdIsIp 0x01
+//! The entry is a download.
+#define PCF_Download 0x02
+//! The entry has a user agent.
+#define PCF_UserAgent 0x04
+
+//! The number of strings stored with a kept entry.
+#define PARSECACHE_NSTRINGS 8
+
+/*!
+ * \brief The cache of one access log being read or written.
+ */
+struct ParseCacheStruct
+{
+	//! The cache file.
+	FILE *File;
+	//! The buffer of the cache file.
+	char *IoBuffer;
+	//! The name of the cache file.
+	char FileName[MAXLEN];
+	//! The temporary name of the file being written or an empty string if the cache is read.
+	char TempName[MAXLEN];
+	//! The buffer storing the strings of the last record read.
+	char *Strings;
+	//! The size of the buffer storing the strings.
+	size_t StringsSize;
+};
+
+//! The fingerprint of the configuration.
+static unsigned long long int Fingerprint=0xcbf29ce484222325ULL;
+
+/*!
+ * Add data to the fingerprint of the configuration.
+ *
+ * \param Data The data to add.
+ * \param Size The size of the data.
+ */
+static void ParseCache_Hash(const void *Data,size_t Size)
+{
+	const unsigned char *Ptr=(const unsigned char *)Data;
+
+	while (Size-->0) {
+		Fingerprint^=*Ptr++;
+		Fingerprint*=0x100000001b3ULL;
+	}
+}
+
+/*!
+ * Add a string and its terminating zero to the fingerprint.
+ *
+ * \param String The string to add.
+ */
+static void ParseCache_HashString(const char *String)
+{
+	ParseCache_Hash(String,strlen(String)+1);
+}
+
+/*!
+ * Add the content of a file to the fingerprint.
+ *
+ * Nothing but the name is added if the file can't be read.
+ *
+ * \param FileName The name of the file.
+ */
+static void ParseCache_HashFile(const char *FileName)
+{
+	FILE *fi;
+	char Buffer[8192];
+	size_t nread;
+
+	ParseCache_HashString(FileName);
+	if (FileName[0]=='\0' || (fi=MY_FOPEN(FileName,"rb"))==NULL) return;
+	while ((nread=fread(Buffer,1,sizeof(Buffer),fi))>0)
+		ParseCache_Hash(Buffer,nread);
+	fclose(fi);
+}
+
+/*!
+ * Add a line of a configuration file to the fingerprint.
+ *
+ * \param Line The line read from the configuration file.
+ */
+void ParseCache_AddConfig(const char *Line)
+{
+	while (*Line==' ' || *Line=='\t') Line++;
+	if (*Line=='\0' || *Line=='#') return;
+	ParseCache_HashString(Line);
+}
+
+/*!
+ * Complete the fingerprint of the configuration with the options and files
+ * affecting how the entries are filtered.
+ *
+ * The date range and the week days and hours filters are left out as they are
+ * applied when the cache is replayed.
+ *
+ * \param Filter The filtering parameters.
+ * \param HostExclude The file listing the excluded hosts.
+ */
+void ParseCache_Fingerprint(const struct ReadLogDataStruct *Filter,const char *HostExclude)
+{
+	long long int Values[6];
+
+	ParseCache_HashString(VERSION);
+	Values[0]=Filter->HostFilter;
+	Values[1]=Filter->UserFilter;
+	Values[2]=Filter->SysUsers;
+	Values[3]=Filter->max_elapsed;
+	Values[4]=Filter->StartTime*10000LL+Filter->EndTime;
+	Values[5]=UserIp;
+	ParseCache_Hash(Values,sizeof(Values));
+	ParseCache_HashString(us);
+	ParseCache_HashString(addr);
+	ParseCache_HashString(site);
+	if (Filter->HostFilter) ParseCache_HashFile(HostExclude);
+	if (Filter->UserFilter) ParseCache_HashFile(ExcludeUsers);
+	if (Filter->SysUsers) ParseCache_HashFile(PasswdFile);
+	ParseCache_HashFile(ExcludeCodes);
+	ParseCache_HashFile(HostAliasFile);
+	ParseCache_HashFile(UserAliasFile);
+}
+
+/*!
+ * Build the name of the cache file of a log.
+ *
+ * \param Cache The cache whose file name is set.
+ * \param st The status of the log file.
+ */
+static void ParseCache_Name(struct ParseCacheStruct *Cache,const struct stat *st)
+{
+	format_path(__FILE__, __LINE__, Cache->FileName, sizeof(Cache->FileName), "%s/%llx-%llx"PARSECACHE_SUFFIX, ParseCacheDir,
+				(unsigned long long int)st->st_dev,(unsigned long long int)st->st_ino);
+}
+
+/*!
+ * Allocate a cache object.
+ *
+ * \param st The status of the log file.
+ *
+ * \return The cache object.
+ */
+static struct ParseCacheStruct *ParseCache_Alloc(const struct stat *st)
+{
+	struct ParseCacheStruct *Cache;
+
+	if ((Cache=calloc(1,sizeof(*Cache)))==NULL || (Cache->IoBuffer=malloc(PARSECACHE_BUFFER))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the parse cache\n"));
+		exit(EXIT_FAILURE);
+	}
+	ParseCache_Name(Cache,st);
+	return(Cache);
+}
+
+/*!
+ * Free a cache object.
+ *
+ * \param Cache The object to free.
+ */
+static void ParseCache_Free(struct ParseCacheStruct *Cache)
+{
+	if (Cache->Strings) free(Cache->Strings);
+	free(Cache->IoBuffer);
+	free(Cache);
+}
+
+/*!
+ * Open the cache of a log to replay it.
+ *
+ * \param FileName The name of the log.
+ * \param st The status of the log file.
+ *
+ * \return The cache or NULL if the log has no valid cache.
+ */
+ParseCacheObject ParseCache_Open(const char *FileName,const struct stat *st)
+{
+	struct ParseCacheStruct *Cache;
+	char Magic[sizeof(PARSECACHE_MAGIC)];
+	long long int Header[3];
+
+	if (ParseCacheDir[0]=='\0') return(NULL);
+	Cache=ParseCache_Alloc(st);
+	if ((Cache->File=MY_FOPEN(Cache->FileName,"rb"))==NULL) {
+		ParseCache_Free(Cache);
+		return(NULL);
+	}
+	setvbuf(Cache->File,Cache->IoBuffer,_IOFBF,PARSECACHE_BUFFER);
+	if (fread(Magic,1,sizeof(Magic),Cache->File)!=sizeof(Magic) || memcmp(Magic,PARSECACHE_MAGIC,sizeof(Magic))!=0 ||
+	    fread(Header,sizeof(Header),1,Cache->File)!=1 || Header[0]!=(long long int)st->st_size ||
+	    Header[1]!=(long long int)st->st_mtime || (unsigned long long int)Header[2]!=Fingerprint) {
+		if (debug) debuga(__FILE__,__LINE__,_("Ignoring the outdated parse cache of file \"%s\"\n"),FileName);
+		fclose(Cache->File);
+		ParseCache_Free(Cache);
+		return(NULL);
+	}
+	// the cache files not used for a while are purged
+	utimes(Cache->FileName,NULL);
+	return(Cache);
+}
+
+/*!
+ * Create the cache of a log.
+ *
+ * The cache is written under a temporary name until ParseCache_Close()
+ * tells that the whole log was read.
+ *
+ * \param FileName The name of the log.
+ * \param st The status of the log file.
+ *
+ * \return The cache to write the records of the log into.
+ */
+ParseCacheObject ParseCache_Create(const char *FileName,const struct stat *st)
+{
+	struct ParseCacheStruct *Cache;
+	long long int Header[3];
+
+	if (ParseCacheDir[0]=='\0') return(NULL);
+	if (access(ParseCacheDir,R_OK)!=0 && !my_mkdir(ParseCacheDir)) {
+		debuga(__FILE__,__LINE__,_("Cannot create directory \"%s\"\n"),ParseCacheDir);
+		exit(EXIT_FAILURE);
+	}
+	Cache=ParseCache_Alloc(st);
+	format_path(__FILE__, __LINE__, Cache->TempName, sizeof(Cache->TempName), "%s.tmp", Cache->FileName);
+	if ((Cache->File=MY_FOPEN(Cache->TempName,"wb"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),Cache->TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	setvbuf(Cache->File,Cache->IoBuffer,_IOFBF,PARSECACHE_BUFFER);
+	Header[0]=(long long int)st->st_size;
+	Header[1]=(long long int)st->st_mtime;
+	Header[2]=(long long int)Fingerprint;
+	fwrite(PARSECACHE_MAGIC,1,sizeof(PARSECACHE_MAGIC),Cache->File);
+	fwrite(Header,sizeof(Header),1,Cache->File);
+	if (debug) debuga(__FILE__,__LINE__,_("Storing the parse cache of file \"%s\"\n"),FileName);
+	return(Cache);
+}
+
+/*!
+ * Write a string to the cache.
+ *
+ * \param Cache The cache.
+ * \param String The string to write.
+ */
+static void ParseCache_PutString(struct ParseCacheStruct *Cache,const char *String)
+{
+	uint32_t Length=strlen(String);
+
+	fwrite(&Length,sizeof(Length),1,Cache->File);
+	fwrite(String,1,Length,Cache->File);
+}
+
+/*!
+ * Write the time of an entry to the cache.
+ *
+ * \param Cache The cache.
+ * \param Time The time to write.
+ */
+static void ParseCache_PutTime(struct ParseCacheStruct *Cache,const struct tm *Time)
+{
+	int16_t Packed[9];
+
+	Packed[0]=Time->tm_year;
+	Packed[1]=Time->tm_yday;
+	Packed[2]=Time->tm_mon;
+	Packed[3]=Time->tm_mday;
+	Packed[4]=Time->tm_hour;
+	Packed[5]=Time->tm_min;
+	Packed[6]=Time->tm_sec;
+	Packed[7]=Time->tm_wday;
+	Packed[8]=Time->tm_isdst;
+	fwrite(Packed,sizeof(Packed),1,Cache->File);
+}
+
+/*!
+ * Store a line excluded before it was parsed.
+ *
+ * \param Cache The cache.
+ * \param Reason Why the line was excluded.
+ */
+void ParseCache_Skip(ParseCacheObject Cache,int Reason)
+{
+	unsigned char Record[2];
+
+	Record[0]=PCK_Skipped;
+	Record[1]=(unsigned char)Reason;
+	fwrite(Record,sizeof(Record),1,Cache->File);
+}
+
+/*!
+ * Store a parsed entry.
+ *
+ * \param Cache The cache.
+ * \param Rec The entry and the outcome of the filters.
+ */
+void ParseCache_Write(ParseCacheObject Cache,const struct ParseCacheEntryStruct *Rec)
+{
+	unsigned char Record[3];
+	long long int Sizes[2];
+
+	Record[0]=Rec->Kind;
+	Record[1]=(unsigned char)Rec->Format;
+	fwrite(Record,2,1,Cache->File);
+	ParseCache_PutTime(Cache,&Rec->Entry.EntryTime);
+	if (Rec->Kind!=PCK_Kept) {
+		Record[0]=(unsigned char)Rec->Reason;
+		fwrite(Record,1,1,Cache->File);
+		return;
+	}
+	Record[0]=0;
+	if (Rec->IdIsIp) Record[0]|=PCF_IdIsIp;
+	if (Rec->DownloadUrl) Record[0]|=PCF_Download;
+	if (Rec->Entry.UserAgent) Record[0]|=PCF_UserAgent;
+	fwrite(Record,1,1,Cache->File);
+	Sizes[0]=Rec->Entry.ElapsedTime;
+	Sizes[1]=Rec->Entry.DataSize;
+	fwrite(Sizes,sizeof(Sizes),1,Cache->File);
+	ParseCache_PutString(Cache,Rec->Entry.User);
+	ParseCache_PutString(Cache,Rec->Entry.Ip);
+	ParseCache_PutString(Cache,Rec->Entry.Url);
+	ParseCache_PutString(Cache,Rec->Url);
+	ParseCache_PutString(Cache,Rec->Entry.HttpCode);
+	ParseCache_PutString(Cache,Rec->SmartFilter);
+	if (Rec->DownloadUrl) ParseCache_PutString(Cache,Rec->DownloadUrl);
+	if (Rec->Entry.UserAgent) ParseCache_PutString(Cache,Rec->Entry.UserAgent);
+}
+
+/*!
+ * Read the next record from the cache.
+ *
+ * The strings of the record remain valid until the next record is read.
+ *
+ * \param Cache The cache.
+ * \param Rec The structure to fill.
+ *
+ * \return \c False at the end of the cache.
+ */
+bool ParseCache_Read(ParseCacheObject Cache,struct ParseCacheEntryStruct *Rec)
+{
+	unsigned char Record[2];
+	int16_t Packed[9];
+	long long int Sizes[2];
+	uint32_t Length;
+	size_t Offsets[PARSECACHE_NSTRINGS];
+	size_t Used=0;
+	int NStrings;
+	int i;
+
+	if (fread(Record,1,1,Cache->File)!=1) return(false);
+	memset(Rec,0,sizeof(*Rec));
+	Rec->Kind=Record[0];
+	if (Rec->Kind==PCK_Skipped) {
+		if (fread(Record,1,1,Cache->File)!=1) goto Truncated;
+		Rec->Reason=Record[0];
+		return(true);
+	}
+	if (fread(Record,1,1,Cache->File)!=1 || fread(Packed,sizeof(Packed),1,Cache->File)!=1) goto Truncated;
+	Rec->Format=Record[0];
+	Rec->Entry.EntryTime.tm_year=Packed[0];
+	Rec->Entry.EntryTime.tm_yday=Packed[1];
+	Rec->Entry.EntryTime.tm_mon=Packed[2];
+	Rec->Entry.EntryTime.tm_mday=Packed[3];
+	Rec->Entry.EntryTime.tm_hour=Packed[4];
+	Rec->Entry.EntryTime.tm_min=Packed[5];
+	Rec->Entry.EntryTime.tm_sec=Packed[6];
+	Rec->Entry.EntryTime.tm_wday=Packed[7];
+	Rec->Entry.EntryTime.tm_isdst=Packed[8];
+	if (Rec->Kind!=PCK_Kept) {
+		if (fread(Record,1,1,Cache->File)!=1) goto Truncated;
+		Rec->Reason=Record[0];
+		return(true);
+	}
+	if (fread(Record,1,1,Cache->File)!=1 || fread(Sizes,sizeof(Sizes),1,Cache->File)!=1) goto Truncated;
+	Rec->IdIsIp=(Record[0] & PCF_IdIsIp)!=0;
+	Rec->Entry.ElapsedTime=(long int)Sizes[0];
+	Rec->Entry.DataSize=Sizes[1];
+	NStrings=6;
+	if (Record[0] & PCF_Download) NStrings++;
+	if (Record[0] & PCF_UserAgent) NStrings++;
+	for (i=0 ; i<NStrings ; i++) {
+		if (fread(&Length,sizeof(Length),1,Cache->File)!=1) goto Truncated;
+		if (Used+Length+1>Cache->StringsSize) {
+			char *Strings;
+			size_t Size=Cache->StringsSize;
+
+			do Size=(Size>0) ? 2*Size : 4096; while (Used+Length+1>Size);
+			if ((Strings=realloc(Cache->Strings,Size))==NULL) {
+				debuga(__FILE__,__LINE__,_("Not enough memory to store the parse cache\n"));
+				exit(EXIT_FAILURE);
+			}
+			Cache->Strings=Strings;
+			Cache->StringsSize=Size;
+		}
+		if (Length>0 && fread(Cache->Strings+Used,1,Length,Cache->File)!=Length) goto Truncated;
+		Offsets[i]=Used;
+		Used+=Length;
+		Cache->Strings[Used++]='\0';
+	}
+	Rec->Entry.User=Cache->Strings+Offsets[0];
+	Rec->Entry.Ip=Cache->Strings+Offsets[1];
+	Rec->Entry.Url=Cache->Strings+Offsets[2];
+	Rec->Url=Cache->Strings+Offsets[3];
+	Rec->Entry.HttpCode=Cache->Strings+Offsets[4];
+	Rec->SmartFilter=Cache->Strings+Offsets[5];
+	i=6;
+	if (Record[0] & PCF_Download) Rec->DownloadUrl=Cache->Strings+Offsets[i++];
+	if (Record[0] & PCF_UserAgent) Rec->Entry.UserAgent=Cache->Strings+Offsets[i++];
+	return(true);
+
+Truncated:
+	debuga(__FILE__,__LINE__,_("The parse cache file \"%s\" is truncated\n"),Cache->FileName);
+	exit(EXIT_FAILURE);
+}
+
+/*!
+ * Close the cache of a log.
+ *
+ * \param CachePtr The cache to close. It is set to NULL.
+ * \param Complete \c True if the whole log was read while the cache was
+ * written. The cache is discarded otherwise.
+ */
+void ParseCache_Close(ParseCacheObject *CachePtr,bool Complete)
+{
+	struct ParseCacheStruct *Cache=*CachePtr;
+
+	if (!Cache) return;
+	*CachePtr=NULL;
+	if (Cache->TempName[0]=='\0') {
+		fclose(Cache->File);
+	} else {
+		if (fclose(Cache->File)==EOF) {
+			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),Cache->TempName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (!Complete) {
+			if (unlink(Cache->TempName)==-1)
+				debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),Cache->TempName,strerror(errno));
+		} else if (rename(Cache->TempName,Cache->FileName)==-1) {
+			debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),Cache->TempName,Cache->FileName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+	ParseCache_Free(Cache);
+}
+
+/*!
+ * Check if a file name ends with a suffix.
+ *
+ * \param Name The file name.
+ * \param Suffix The suffix.
+ *
+ * \return \c True if the name ends with the suffix.
+ */
+static bool ParseCache_HasSuffix(const char *Name,const char *Suffix)
+{
+	size_t NameLen=strlen(Name);
+	size_t SuffixLen=strlen(Suffix);
+
+	return(NameLen>SuffixLen && strcmp(Name+NameLen-SuffixLen,Suffix)==0);
+}
+
+/*!
+ * Delete the cache files that weren't used for a while and the temporary
+ * files left behind by a run that was interrupted.
+ */
+void ParseCache_Purge(void)
+{
+	DIR *dirp;
+	struct dirent *direntp;
+	struct stat st;
+	char Name[MAXLEN];
+	time_t Limit;
+	time_t TempLimit;
+
+	if (ParseCacheDir[0]=='\0' || (dirp=opendir(ParseCacheDir))==NULL) return;
+	Limit=time(NULL)-PARSECACHE_KEEP_DAYS*24*60*60;
+	TempLimit=time(NULL)-24*60*60;
+	while ((direntp=readdir(dirp))!=NULL) {
+		if (ParseCache_HasSuffix(direntp->d_name,PARSECACHE_SUFFIX)) {
+			format_path(__FILE__, __LINE__, Name, sizeof(Name), "%s/%s", ParseCacheDir, direntp->d_name);
+			if (stat(Name,&st)==-1 || !S_ISREG(st.st_mode) || st.st_mtime>=Limit) continue;
+		} else if (ParseCache_HasSuffix(direntp->d_name,PARSECACHE_SUFFIX".tmp")) {
+			format_path(__FILE__, __LINE__, Name, sizeof(Name), "%s/%s", ParseCacheDir, direntp->d_name);
+			if (stat(Name,&st)==-1 || !S_ISREG(st.st_mode) || st.st_mtime>=TempLimit) continue;
+		} else
+			continue;
+		if (debug) debuga(__FILE__,__LINE__,_("Deleting unused parse cache file \"%s\"\n"),Name);
+		if (unlink(Name)==-1)
+			debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),Name,strerror(errno));
+	}
+	closedir(dirp);
+}
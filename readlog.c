@@ -28,9 +28,12 @@
 #include "include/defs.h"
 #include "include/readlog.h"
 #include "include/filelist.h"
+#include "include/parsecache.h"
 
 #define REPORT_EVERY_X_LINES 5000
 #define MAX_OPEN_USER_FILES 10
+//! Size of the blocks read to find the first line to read in a log.
+#define LOGSEARCH_BLOCK 65536
 
 struct userfilestruct
 {
@@ -114,6 +117,14 @@ static const struct ReadLogProcessStruct * const LogFormats[]=
 static char SargLogFile[4096]="";
 //! Handle to the sarg log file. NULL if not created.
 static FILE *fp_log=NULL;
+//! How sarg compresses the sarg log file as it is written.
+static enum StreamCompressionEnum SargLogCompression=STREAMCOMP_None;
+//! The number of records written in the sarg log file.
+static unsigned long int SargLogRecords=0;
+//! The date of the oldest record written in the sarg log file.
+static struct tm SargLogStart;
+//! The date of the newest record written in the sarg log file.
+static struct tm SargLogEnd;
 //! The number of records read from the input logs.
 static long int totregsl=0;
 //! The number of records kept.
@@ -138,6 +149,26 @@ static int LatestDate=-1;
 //! The latest date in time format.
 static struct tm LatestDateTime;
 
+//! How far an access log was read by the daemon mode.
+struct LogStateStruct
+{
+	//! The next entry in the list.
+	struct LogStateStruct *Next;
+	//! The name of the log file.
+	char *FileName;
+	//! The device containing the file.
+	dev_t Dev;
+	//! The inode of the file to detect a rotated log.
+	ino_t Inode;
+	//! The offset following the last line read from the file.
+	long long int Offset;
+	//! \c True if the file is compressed and was read whole.
+	bool Compressed;
+};
+
+//! The access logs read by the daemon mode.
+static struct LogStateStruct *FirstLogState=NULL;
+
 /*!
  * Read from standard input.
  *
@@ -295,9 +326,767 @@ enum ReadLogReturnCodeEnum LogLine_Parse(struct LogLineStruct *log_line,struct R
 	return(log_entry_status);
 }
 
+/*!
+ * Display how far the reading of a log file progressed.
+ *
+ * The progress is estimated from the position in the file, which is the
+ * compressed position for a compressed file, so the file doesn't have to
+ * be read once more to count its lines.
+ *
+ * \param fp_in The file being read.
+ * \param Records The number of records read so far.
+ * \param FileSize The size of the file or -1 if the percentage can't be computed.
+ * \param Start When the reading of the file started.
+ */
+static void ShowReadProgress(FileObject *fp_in,unsigned long int Records,long long int FileSize,const struct timeval *Start)
+{
+	long long int Offset;
+	struct timeval Now;
+	double Elapsed;
+	double perc;
+	long int Eta;
+
+	Offset=(FileSize>0) ? FileObject_Offset(fp_in) : -1;
+	if (Offset<0) {
+		printf(_("SARG: Records in file: %lu"),Records);
+	} else {
+		if (Offset>FileSize) Offset=FileSize;
+		perc=Offset*100./FileSize;
+		gettimeofday(&Now,NULL);
+		Elapsed=(Now.tv_sec-Start->tv_sec)+(Now.tv_usec-Start->tv_usec)/1000000.;
+		if (Elapsed<=0. || Offset==0) {
+			printf(_("SARG: Records in file: %lu, reading: %3.2lf%%"),Records,perc);
+		} else {
+			Eta=(long int)(Elapsed*(FileSize-Offset)/Offset+0.5);
+			/* TRANSLATORS: The %.0lf is the number of records read per second. The ETA is
+			 the estimated time left to read the file in minutes (%ld) and seconds (%02ld). */
+			printf(_("SARG: Records in file: %lu, reading: %3.2lf%%, %.0lf records/s, ETA %ld:%02ld "),
+				   Records,perc,Records/Elapsed,Eta/60,Eta%60);
+		}
+	}
+	putchar('\r');
+	fflush(stdout);
+}
+
+/*!
+ * Find how far the daemon mode read an access log.
+ *
+ * \param FileName The name of the log file.
+ *
+ * \return The state of the file. It is created if the file wasn't read yet.
+ */
+static struct LogStateStruct *LogState_Get(const char *FileName)
+{
+	struct LogStateStruct *State;
+
+	for (State=FirstLogState ; State ; State=State->Next)
+		if (strcmp(State->FileName,FileName)==0) return(State);
+
+	State=calloc(1,sizeof(*State));
+	if (!State || (State->FileName=strdup(FileName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the state of log file \"%s\"\n"),FileName);
+		exit(EXIT_FAILURE);
+	}
+	State->Next=FirstLogState;
+	FirstLogState=State;
+	return(State);
+}
+
+/*!
+ * Save how far the daemon mode read each access log in the file named by
+ * \c daemon_state_file.
+ *
+ * The file is written under a temporary name and renamed so that it is
+ * never seen partially written.
+ */
+static void LogState_Save(void)
+{
+	char TempName[MAXLEN];
+	FILE *fp_state;
+	const struct LogStateStruct *State;
+
+	if (DaemonStateFile[0]=='\0') return;
+	format_path(__FILE__, __LINE__, TempName, sizeof(TempName), "%s.tmp", DaemonStateFile);
+	if ((fp_state=MY_FOPEN(TempName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	for (State=FirstLogState ; State ; State=State->Next)
+		fprintf(fp_state,"%llu\t%llu\t%lld\t%d\t%s\n",(unsigned long long int)State->Dev,(unsigned long long int)State->Inode,
+				State->Offset,(State->Compressed) ? 1 : 0,State->FileName);
+	if (fclose(fp_state)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),TempName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (rename(TempName,DaemonStateFile)==-1) {
+		debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),TempName,DaemonStateFile,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Parse the first lines of an opened access log until one is recognized.
+ *
+ * \param log_line The log line parser.
+ * \param fp_in The log positioned at its beginning.
+ * \param arq The name of the log file.
+ */
+static void LogLine_PrimeFile(struct LogLineStruct *log_line,FileObject *fp_in,const char *arq)
+{
+	struct ReadLogStruct log_entry;
+	longline line;
+	char *linebuf;
+
+	if ((line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),arq);
+		exit(EXIT_FAILURE);
+	}
+	while ((linebuf=longline_read(fp_in,line))!=NULL)
+		if (LogLine_Parse(log_line,&log_entry,linebuf)==RLRC_NoError) break;
+	longline_destroy(&line);
+}
+
+/*!
+ * Parse the first lines of an access log to let the log format read the
+ * header it may need before the log is read from the middle.
+ *
+ * \param log_line The log line parser.
+ * \param arq The name of the log file.
+ * \param End The offset of the end of the lines to parse.
+ *
+ * \return \c False if the file is compressed and can't be read from the middle.
+ */
+static bool LogLine_Prime(struct LogLineStruct *log_line,const char *arq,long long int End)
+{
+	FileObject *fp_in;
+
+	if ((fp_in=decomp_range(arq,0,&End))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	if (End<0) {
+		FileObject_Close(fp_in);
+		return(false);
+	}
+	LogLine_PrimeFile(log_line,fp_in,arq);
+	FileObject_Close(fp_in);
+	return(true);
+}
+
+/*!
+ * Open the part of an access log the daemon mode didn't read yet.
+ *
+ * A plain file is read from the end of the last line read previously up to
+ * the end of its last complete line. The file is read from its beginning if it
+ * was rotated or truncated. A compressed file is read only once.
+ *
+ * If the reading doesn't start at the beginning of the file, the first lines are
+ * parsed to let the log format read the header it may need.
+ *
+ * \param log_line The log line parser.
+ * \param arq The name of the log file.
+ *
+ * \return The file to read or NULL if there is nothing new to read.
+ */
+static FileObject *LogState_Open(struct LogLineStruct *log_line,const char *arq)
+{
+	struct LogStateStruct *State;
+	struct stat logstat;
+	long long int Start=0;
+	long long int End;
+	FileObject *fp_in;
+
+	if (stat(arq,&logstat)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot get the size of file \"%s\": %s\n"),arq,strerror(errno));
+		return(NULL);
+	}
+	State=LogState_Get(arq);
+	if (State->Offset>0 && State->Dev==logstat.st_dev && State->Inode==logstat.st_ino) {
+		if (State->Compressed || State->Offset==(long long int)logstat.st_size) return(NULL);
+		if (State->Offset<(long long int)logstat.st_size) Start=State->Offset;
+	}
+	if (logstat.st_size<5) return(NULL); //not enough data to guess the file type
+
+	if (Start>0)
+		LogLine_Prime(log_line,arq,Start);
+
+	End=-1;
+	if ((fp_in=decomp_range(arq,Start,&End))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	State->Dev=logstat.st_dev;
+	State->Inode=logstat.st_ino;
+	State->Compressed=(End<0);
+	State->Offset=(End<0) ? (long long int)logstat.st_size : End;
+	if (debug) debuga(__FILE__,__LINE__,_("Reading access log file \"%s\" from offset %lld\n"),arq,Start);
+	return(fp_in);
+}
+
+/*!
+ * Get the time of the first line starting after an offset of a plain access log.
+ *
+ * \param log_line The log line parser.
+ * \param fd The descriptor of the log.
+ * \param Offset The offset to look at.
+ * \param Block A buffer of LOGSEARCH_BLOCK bytes.
+ *
+ * \return The time as returned by LogCatalog_Stamp() or -1 if no line could
+ * be parsed in the block following the offset.
+ */
+static long long int ReadLog_ProbeStamp(struct LogLineStruct *log_line,int fd,long long int Offset,char *Block)
+{
+	struct ReadLogStruct log_entry;
+	ssize_t nread;
+	char *Line;
+	char *Eol;
+
+	nread=pread(fd,Block,LOGSEARCH_BLOCK-1,(off_t)Offset);
+	if (nread<=0) return(-1);
+	Block[nread]='\0';
+	// the line containing the offset is incomplete
+	if ((Line=strchr(Block,'\n'))==NULL) return(-1);
+	Line++;
+	while ((Eol=strchr(Line,'\n'))!=NULL) {
+		*Eol='\0';
+		if (Eol>Line && Eol[-1]=='\r') Eol[-1]='\0';
+		if (LogLine_Parse(log_line,&log_entry,Line)==RLRC_NoError)
+			return(LogCatalog_Stamp(&log_entry.EntryTime));
+		Line=Eol+1;
+	}
+	return(-1);
+}
+
+/*!
+ * Find the offset of the first line of a plain access log that may be
+ * in the requested date range.
+ *
+ * The offset is searched by bisection assuming every line is at most
+ * \a Disorder seconds older than the lines written before it.
+ *
+ * \param log_line The log line parser. It is primed if the returned offset isn't 0.
+ * \param arq The name of the log file.
+ * \param Size The size of the log.
+ * \param StartDate The first date to read as YYYYMMDD.
+ * \param Disorder How many seconds a line may be older than the lines before it.
+ *
+ * \return The offset of the first line to read.
+ */
+static long long int ReadLog_FindStart(struct LogLineStruct *log_line,const char *arq,long long int Size,int StartDate,long long int Disorder)
+{
+	struct tm StartTime;
+	long long int Target;
+	long long int Low=0;
+	long long int High=Size;
+	long long int Mid;
+	long long int Stamp;
+	char *Block;
+	char *Eol;
+	ssize_t nread;
+	int fd;
+
+	if (Size<2*LOGSEARCH_BLOCK || !LogLine_Prime(log_line,arq,Size)) return(0);
+
+	computedate(StartDate/10000,(StartDate/100)%100,StartDate%100,&StartTime);
+	Target=LogCatalog_Stamp(&StartTime)-Disorder;
+	if ((Block=malloc(LOGSEARCH_BLOCK))==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),arq);
+		exit(EXIT_FAILURE);
+	}
+	if ((fd=open(arq,O_RDONLY | O_LARGEFILE))==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arq,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while (High-Low>LOGSEARCH_BLOCK) {
+		Mid=Low+(High-Low)/2;
+		Stamp=ReadLog_ProbeStamp(log_line,fd,Mid,Block);
+		// every line before the probed line is older than the requested date
+		if (Stamp>=0 && Stamp<Target)
+			Low=Mid;
+		else
+			High=Mid;
+	}
+	// start at the line following the one containing Low
+	while (Low>0 && Low<Size) {
+		nread=pread(fd,Block,LOGSEARCH_BLOCK,(off_t)(Low-1));
+		if (nread<=0) {
+			Low=0;
+			break;
+		}
+		if ((Eol=memchr(Block,'\n',nread))!=NULL) {
+			Low+=Eol-Block;
+			break;
+		}
+		Low+=nread;
+	}
+	close(fd);
+	free(Block);
+	return((Low<Size) ? Low : Size);
+}
+
+/*!
+ * Get the time of a line of a log being indexed.
+ *
+ * \param Data The log line parser.
+ * \param Line The line.
+ *
+ * \return The time as returned by LogCatalog_Stamp() or -1 if the line
+ * can't be parsed.
+ */
+static long long int ReadLog_LineStamp(void *Data,char *Line)
+{
+	struct ReadLogStruct log_entry;
+
+	if (LogLine_Parse((struct LogLineStruct *)Data,&log_entry,Line)!=RLRC_NoError) return(-1);
+	return(LogCatalog_Stamp(&log_entry.EntryTime));
+}
+
+/*!
+ * Open a compressed access log near the first requested date using its index.
+ *
+ * \param log_line The log line parser. It is primed if the log is opened.
+ * \param arq The name of the log file.
+ * \param StartDate The first date to read as YYYYMMDD.
+ *
+ * \return The log positioned at the beginning of a line or NULL if it must
+ * be read from its beginning.
+ */
+static FileObject *ReadLog_OpenIndexed(struct LogLineStruct *log_line,const char *arq,int StartDate)
+{
+	struct LogLineStruct stamp_line;
+	struct stat st;
+	struct tm StartTime;
+	long long int Offset;
+	FileObject *fp_in;
+	FileObject *fp_head;
+
+	if (stat(arq,&st)==-1) return(NULL);
+	LogLine_Init(&stamp_line);
+	LogLine_File(&stamp_line,arq);
+	computedate(StartDate/10000,(StartDate/100)%100,StartDate%100,&StartTime);
+	fp_in=LogIndex_Open(arq,&st,LogCatalog_Stamp(&StartTime),ReadLog_LineStamp,&stamp_line,&Offset);
+	if (!fp_in) return(NULL);
+	// the log format may need the header at the beginning of the log
+	if ((fp_head=decomp(arq))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	LogLine_PrimeFile(log_line,fp_head,arq);
+	FileObject_Close(fp_head);
+	if (debug) debuga(__FILE__,__LINE__,_("Reading access log file \"%s\" from decompressed offset %lld\n"),arq,Offset);
+	return(fp_in);
+}
+
+/*!
+ * Create the sarg log file if it is requested and not created yet.
+ */
+static void ReadLog_OpenSargLog(void)
+{
+	if (fp_log || !ParsedOutputLog[0]) return;
+	if (access(ParsedOutputLog,R_OK) != 0) {
+		my_mkdir(ParsedOutputLog);
+	}
+	// gzip and zstd without a path are compressed by sarg while the log is written
+	if (strcmp(ParsedOutputLogCompress,"gzip")==0)
+		SargLogCompression=STREAMCOMP_Gzip;
+	else if (strcmp(ParsedOutputLogCompress,"zstd")==0)
+		SargLogCompression=STREAMCOMP_Zstd;
+	else
+		SargLogCompression=STREAMCOMP_None;
+	if (snprintf(SargLogFile,sizeof(SargLogFile),"%s/sarg_temp.log%s",ParsedOutputLog,compressed_file_suffix(SargLogCompression))>=sizeof(SargLogFile)) {
+		debuga(__FILE__,__LINE__,_("Path too long: "));
+		debuga_more("%s/sarg_temp.log%s\n",ParsedOutputLog,compressed_file_suffix(SargLogCompression));
+		exit(EXIT_FAILURE);
+	}
+	if ((fp_log=open_compressed_file(SargLogFile,SargLogCompression,false))==NULL) {
+		exit(EXIT_FAILURE);
+	}
+	fputs("*** SARG Log ***\n",fp_log);
+	SargLogRecords=0;
+}
+
+/*!
+ * Count an excluded line or entry.
+ *
+ * \param Reason Why it was excluded.
+ */
+static void ReadLog_Exclude(enum ExcludeReasonEnum Reason)
+{
+	excluded_count[Reason]++;
+	if (Reason==ER_UserNameTooLong || Reason==ER_IgnoredUser || Reason==ER_HttpCode || Reason==ER_Url)
+		totregsx++;
+}
+
+/*!
+ * Count a line excluded before it was parsed and store it in the parse cache.
+ *
+ * \param Cache The parse cache being written or NULL.
+ * \param Reason Why the line was excluded.
+ */
+static void ReadLog_Skip(ParseCacheObject Cache,enum ExcludeReasonEnum Reason)
+{
+	ReadLog_Exclude(Reason);
+	if (Cache) ParseCache_Skip(Cache,Reason);
+}
+
+/*!
+ * Keep track of the dates found in the log and check if an entry is within
+ * the requested date range, week days and hours.
+ *
+ * \param Filter The filtering parameters.
+ * \param EntryTime The time of the entry.
+ * \param idata The date of the entry as returned by builddia().
+ *
+ * \return \c True if the entry is to be kept. The exclusion is counted if it
+ * is \c false.
+ */
+static bool ReadLog_CheckDate(const struct ReadLogDataStruct *Filter,const struct tm *EntryTime,int idata)
+{
+	if (debugz>=LogLevel_Data)
+		printf("DATE=%s IDATA=%d DFROM=%d DUNTIL=%d\n",Filter->DateRange,idata,Filter->StartDate,Filter->EndDate);
+
+	if (EarliestDate<0 || idata<EarliestDate) {
+		EarliestDate=idata;
+		memcpy(&EarliestDateTime,EntryTime,sizeof(struct tm));
+	}
+	if (LatestDate<0 || idata>LatestDate) {
+		LatestDate=idata;
+		memcpy(&LatestDateTime,EntryTime,sizeof(struct tm));
+	}
+	if (Filter->DateRange[0] != '\0'){
+		if (idata<Filter->StartDate || idata>Filter->EndDate) {
+			excluded_count[ER_OutOfDateRange]++;
+			return(false);
+		}
+	}
+
+	// Record only hours usage which is required
+	if (!numlistcontains(weekdays, 7, EntryTime->tm_wday))
+	{
+		excluded_count[ER_OutOfWDayRange]++;
+		return(false);
+	}
+
+	if (!numlistcontains(hours, 24, EntryTime->tm_hour))
+	{
+		excluded_count[ER_OutOfHourRange]++;
+		return(false);
+	}
+	return(true);
+}
+
+/*!
+ * Apply the filters that don't depend on the date to an entry.
+ *
+ * \param Filter The filtering parameters.
+ * \param SargFormat \c True if the entry comes from a sarg log.
+ * \param linebuf The line the entry was parsed from.
+ * \param Rec The entry to filter. The user ID, the URL and the sizes are
+ * updated. The kind of record is set to tell if the entry is kept and the
+ * reason is set if it isn't. The strings remain valid until the next entry
+ * is filtered.
+ */
+static void ReadLog_FilterEntry(const struct ReadLogDataStruct *Filter,bool SargFormat,char *linebuf,struct ParseCacheEntryStruct *Rec)
+{
+	static char download_url[MAXLEN];
+	static char smartfilter[MAXLEN];
+	struct ReadLogStruct *log_entry=&Rec->Entry;
+	char *str;
+	const char *url;
+	const char *url_start;
+	const char *url_end;
+	int hmr;
+
+	Rec->Kind=PCK_Excluded;
+	switch (process_user(&log_entry->User,log_entry->Ip,&Rec->IdIsIp))
+	{
+		case USERERR_NoError:
+			break;
+		case USERERR_NameTooLong:
+			if (debugz>=LogLevel_Process) debuga(__FILE__,__LINE__,_("User ID too long: %s\n"),log_entry->User);
+			Rec->Reason=ER_UserNameTooLong;
+			return;
+		case USERERR_Excluded:
+			Rec->Reason=ER_User;
+			return;
+		case USERERR_InvalidChar:
+			Rec->Reason=ER_InvalidUserChar;
+			return;
+		case USERERR_EmptyUser:
+			Rec->Reason=ER_NoUser;
+			return;
+		case USERERR_SysUser:
+			Rec->Reason=ER_SysUser;
+			return;
+		case USERERR_Ignored:
+			Rec->Reason=ER_IgnoredUser;
+			return;
+		case USERERR_Untracked:
+			Rec->Reason=ER_UntrackedUser;
+			return;
+	}
+
+	if (vercode(log_entry->HttpCode)) {
+		if (debugz>=LogLevel_Process) debuga(__FILE__,__LINE__,_("Excluded code: %s\n"),log_entry->HttpCode);
+		Rec->Reason=ER_HttpCode;
+		return;
+	}
+
+	// replace any tab by a single space
+	for (str=log_entry->Url ; *str ; str++)
+		if (*str=='\t') *str=' ';
+	url_end=str;
+	for (str=log_entry->HttpCode ; *str ; str++)
+		if (*str=='\t') *str=' ';
+
+	url_start=skip_scheme(log_entry->Url);
+	Rec->DownloadUrl=NULL;
+	/*
+	The full URL is not saved in sarg log. There is no point in testing the URL to detect
+	a downloaded file.
+	*/
+	if (!SargFormat && is_download_suffix(url_start,url_end)) {
+		safe_strcpy(download_url,log_entry->Url,sizeof(download_url));
+		Rec->DownloadUrl=download_url;
+	}
+
+	url=process_schemeless_url(url_start,LongUrl);
+	if (!url || url[0] == '\0') {
+		Rec->Reason=ER_NoUrl;
+		return;
+	}
+	Rec->Url=url;
+
+	if (addr[0] != '\0'){
+		if (strcmp(addr,log_entry->Ip)!=0) {
+			Rec->Reason=ER_UntrackedIpAddr;
+			return;
+		}
+	}
+	if (Filter->HostFilter) {
+		if (!vhexclude(url)) {
+			if (debugz>=LogLevel_Data) debuga(__FILE__,__LINE__,_("Excluded site: %s\n"),url);
+			Rec->Reason=ER_Url;
+			return;
+		}
+	}
+
+	if (Filter->StartTime >= 0 && Filter->EndTime >= 0) {
+		hmr=log_entry->EntryTime.tm_hour*100+log_entry->EntryTime.tm_min;
+		if (hmr < Filter->StartTime || hmr >= Filter->EndTime) {
+			Rec->Reason=ER_OutOfTimeRange;
+			return;
+		}
+	}
+
+	if (site[0] != '\0'){
+		if (strstr(url,site)==0) {
+			Rec->Reason=ER_UntrackedUrl;
+			return;
+		}
+	}
+
+	if (log_entry->DataSize<0) log_entry->DataSize=0;
+
+	if (log_entry->ElapsedTime<0) log_entry->ElapsedTime=0;
+	if (Filter->max_elapsed>0 && log_entry->ElapsedTime>Filter->max_elapsed) {
+		log_entry->ElapsedTime=0;
+	}
+
+	if ((str=(char *) strstr(linebuf, "[SmartFilter:")) != (char *) NULL ) {
+		fixendofline(str);
+		snprintf(smartfilter,sizeof(smartfilter),"\"%s\"",str+1);
+	} else strcpy(smartfilter,"\"\"");
+	Rec->SmartFilter=smartfilter;
+	Rec->Kind=PCK_Kept;
+}
+
+/*!
+ * Store an entry kept by the filters in the temporary files.
+ *
+ * \param Rec The entry to store.
+ * \param SargFormat \c True if the entry comes from a sarg log.
+ * \param idata The date of the entry as returned by builddia().
+ */
+static void ReadLog_KeepEntry(const struct ParseCacheEntryStruct *Rec,bool SargFormat,int idata)
+{
+	const struct ReadLogStruct *log_entry=&Rec->Entry;
+	const char *url=Rec->Url;
+	char hora[30];
+	char dia[128]="";
+	char tmp3[MAXLEN]="";
+	int x;
+	int nopen;
+	int maxopenfiles=MAX_OPEN_USER_FILES;
+	struct userfilestruct *prev_ufile;
+	struct userinfostruct *uinfo;
+	struct userfilestruct *ufile;
+	struct userfilestruct *ufile1;
+
+	nopen=0;
+	prev_ufile=NULL;
+	for (ufile=first_user_file ; ufile && strcmp(log_entry->User,ufile->user->id)!=0 ; ufile=ufile->next) {
+		prev_ufile=ufile;
+		if (ufile->file) nopen++;
+	}
+	if (!ufile) {
+		ufile=malloc(sizeof(*ufile));
+		if (!ufile) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the user %s\n"),log_entry->User);
+			exit(EXIT_FAILURE);
+		}
+		memset(ufile,0,sizeof(*ufile));
+		ufile->next=first_user_file;
+		first_user_file=ufile;
+		/*
+		 * This id_is_ip stuff is just to store the string only once if the user is
+		 * identified by its IP address instead of a distinct ID and IP address.
+		 */
+		uinfo=userinfo_create(log_entry->User,(Rec->IdIsIp) ? NULL : log_entry->Ip);
+		ufile->user=uinfo;
+		nusers++;
+	} else {
+		if (prev_ufile) {
+			prev_ufile->next=ufile->next;
+			ufile->next=first_user_file;
+			first_user_file=ufile;
+		}
+	}
+#ifdef ENABLE_DOUBLE_CHECK_DATA
+	if (strcmp(log_entry->HttpCode,"TCP_DENIED/407")!=0) {
+		ufile->user->nbytes+=log_entry->DataSize;
+		ufile->user->elap+=log_entry->ElapsedTime;
+	}
+#endif
+
+	if (ufile->file==NULL) {
+		if (nopen>=maxopenfiles) {
+			x=0;
+			for (ufile1=first_user_file ; ufile1 ; ufile1=ufile1->next) {
+				if (ufile1->file!=NULL) {
+					if (x>=maxopenfiles) {
+						if (fclose(ufile1->file)==EOF) {
+							debuga(__FILE__,__LINE__,_("Write error in log file of user %s: %s\n"),ufile1->user->id,strerror(errno));
+							exit(EXIT_FAILURE);
+						}
+						ufile1->file=NULL;
+					}
+					x++;
+				}
+			}
+		}
+		if (snprintf (tmp3, sizeof(tmp3), "%s/%s.user_unsort", tmp, ufile->user->filename)>=sizeof(tmp3)) {
+			debuga(__FILE__,__LINE__,_("Temporary user file name too long: %s/%s.user_unsort\n"), tmp, ufile->user->filename);
+			exit(EXIT_FAILURE);
+		}
+		if ((ufile->file = MY_FOPEN (tmp3, "a")) == NULL) {
+			debuga(__FILE__,__LINE__,_("(log) Cannot open temporary file %s: %s\n"), tmp3, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	strftime(dia, sizeof(dia), "%d/%m/%Y",&log_entry->EntryTime);
+	strftime(hora,sizeof(hora),"%H:%M:%S",&log_entry->EntryTime);
+
+	if (fprintf(ufile->file, "%s\t%s\t%s\t%s\t%"PRIu64"\t%s\t%ld\t%s\n",dia,hora,
+							log_entry->Ip,url,(uint64_t)log_entry->DataSize,
+							log_entry->HttpCode,log_entry->ElapsedTime,Rec->SmartFilter)<=0) {
+		debuga(__FILE__,__LINE__,_("Write error in the log file of user %s\n"),log_entry->User);
+		exit(EXIT_FAILURE);
+	}
+	records_kept++;
+	aggregate_add(&log_entry->EntryTime,log_entry->User,log_entry->Ip,url,log_entry->HttpCode,log_entry->DataSize,log_entry->ElapsedTime);
+
+	if (fp_log && !SargFormat) {
+		fprintf(fp_log, "%s\t%s\t%s\t%s\t%s\t%"PRIu64"\t%s\t%ld\t%s\n",dia,hora,
+						log_entry->User,log_entry->Ip,url,(uint64_t)log_entry->DataSize,
+						log_entry->HttpCode,log_entry->ElapsedTime,Rec->SmartFilter);
+		if (SargLogRecords==0 || compare_date(&SargLogStart,&log_entry->EntryTime)>0)
+			memcpy(&SargLogStart,&log_entry->EntryTime,sizeof(SargLogStart));
+		if (SargLogRecords==0 || compare_date(&SargLogEnd,&log_entry->EntryTime)<0)
+			memcpy(&SargLogEnd,&log_entry->EntryTime,sizeof(SargLogEnd));
+		SargLogRecords++;
+	}
+
+	totregsg++;
+
+	denied_write(log_entry);
+	authfail_write(log_entry);
+	if (Rec->DownloadUrl) download_write(log_entry,Rec->DownloadUrl);
+	UserAgent_Write(log_entry);
+
+	if (!SargFormat) {
+		if (period.start.tm_year==0 || idata<mindate || compare_date(&period.start,&log_entry->EntryTime)>0){
+			mindate=idata;
+			memcpy(&period.start,&log_entry->EntryTime,sizeof(log_entry->EntryTime));
+		}
+		if (period.end.tm_year==0 || idata>maxdate || compare_date(&period.end,&log_entry->EntryTime)<0) {
+			maxdate=idata;
+			memcpy(&period.end,&log_entry->EntryTime,sizeof(log_entry->EntryTime));
+		}
+	}
+
+	if (debugz>=LogLevel_Data){
+		printf("IP=\t%s\n",log_entry->Ip);
+		printf("USER=\t%s\n",log_entry->User);
+		printf("ELAP=\t%ld\n",log_entry->ElapsedTime);
+		printf("DATE=\t%s\n",dia);
+		printf("TIME=\t%s\n",hora);
+		//printf("FUNC=\t%s\n",fun);
+		printf("URL=\t%s\n",url);
+		printf("CODE=\t%s\n",log_entry->HttpCode);
+		printf("LEN=\t%"PRIu64"\n",(uint64_t)log_entry->DataSize);
+	}
+}
+
+/*!
+ * Replay the entries stored in the parse cache of a log.
+ *
+ * \param Filter The filtering parameters.
+ * \param Cache The cache to read.
+ *
+ * \return The number of lines of the log.
+ */
+static unsigned long int ReadLog_Replay(const struct ReadLogDataStruct *Filter,ParseCacheObject Cache)
+{
+	struct ParseCacheEntryStruct Rec;
+	unsigned long int recs2=0UL;
+	bool SargFormat;
+	int idata;
+
+	while (ParseCache_Read(Cache,&Rec)) {
+		lines_read++;
+		recs2++;
+		if (Rec.Kind==PCK_Skipped) {
+			// those lines were counted before they failed to be parsed
+			if (Rec.Reason==ER_UnknownFormat || Rec.Reason==ER_FormatData) totregsl++;
+			ReadLog_Exclude(Rec.Reason);
+			continue;
+		}
+		totregsl++;
+		if (Rec.Format<0 || Rec.Format>=sizeof(LogFormats)/sizeof(*LogFormats)) {
+			debuga(__FILE__,__LINE__,_("Invalid log format %d in the parse cache\n"),Rec.Format);
+			exit(EXIT_FAILURE);
+		}
+		format_count[Rec.Format]++;
+		SargFormat=(LogFormats[Rec.Format]==&ReadSargLog);
+		if (!SargFormat) ReadLog_OpenSargLog();
+
+		idata=builddia(Rec.Entry.EntryTime.tm_mday,Rec.Entry.EntryTime.tm_mon+1,Rec.Entry.EntryTime.tm_year+1900);
+		if (!ReadLog_CheckDate(Filter,&Rec.Entry.EntryTime,idata)) continue;
+		if (Rec.Kind!=PCK_Kept) {
+			ReadLog_Exclude(Rec.Reason);
+			continue;
+		}
+		ReadLog_KeepEntry(&Rec,SargFormat,idata);
+	}
+	return(recs2);
+}
+
 /*!
 Read a single log file.
 
+\param Filter The filtering parameters.
 \param arq The log file name to read.
 */
 static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
@@ -305,34 +1094,31 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 	longline line;
 	char *linebuf;
 	char *str;
-	char hora[30];
-	char dia[128]="";
-	char tmp3[MAXLEN]="";
-	char download_url[MAXLEN];
-	char smartfilter[MAXLEN];
-	const char *url;
 	int OutputNonZero = REPORT_EVERY_X_LINES ;
 	int idata=0;
 	int x;
-	int hmr;
-	int nopen;
-	int maxopenfiles=MAX_OPEN_USER_FILES;
-	unsigned long int recs1=0UL;
 	unsigned long int recs2=0UL;
+	long long int FileSize=-1;
+	struct timeval ReadStart;
 	FileObject *fp_in=NULL;
-	bool download_flag=false;
-	bool id_is_ip;
+	bool SargFormat;
 	enum ReadLogReturnCodeEnum log_entry_status;
-	enum UserProcessError PUser;
 	struct stat logstat;
 	struct getwordstruct gwarea;
-	struct userfilestruct *prev_ufile;
-	struct userinfostruct *uinfo;
-	struct userfilestruct *ufile;
-	struct userfilestruct *ufile1;
-	struct ReadLogStruct log_entry;
+	struct ParseCacheEntryStruct Rec;
 	struct LogLineStruct log_line;
-	FILE *UseragentLog=NULL;
+	struct stat CatalogStat;
+	struct stat CacheStat;
+	ParseCacheObject Cache=NULL;
+	bool Catalog=false;
+	int FileMinDate=-1;
+	int FileMaxDate=-1;
+	long long int Stamp;
+	long long int MaxStamp=0;
+	long long int Disorder=0;
+	long long int CatDisorder=0;
+	long long int Start=0;
+	bool Seek=false;
 
 	LogLine_Init(&log_line);
 	LogLine_File(&log_line,arq);
@@ -356,42 +1142,69 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 				}
 			}
 		}
-		fp_in=decomp(arq);
-		if (fp_in==NULL) {
-			debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
-			exit(EXIT_FAILURE);
+		if (LogCatalogFile[0] && !DaemonMode && stat(arq,&CatalogStat)==0) {
+			int CatMinDate,CatMaxDate;
+
+			if (!LogCatalog_Find(arq,&CatalogStat,&CatMinDate,&CatMaxDate,&CatDisorder)) {
+				// collect the dates stored in the log while it is read unless some lines are skipped unparsed
+				Catalog=(ExcludeString[0]=='\0');
+			} else if (Filter->DateRange[0]!='\0') {
+				if (CatMaxDate<Filter->StartDate || CatMinDate>Filter->EndDate) {
+					debuga(__FILE__,__LINE__,_("Ignoring log file %s whose dates are outside of the requested range\n"),arq);
+					return;
+				}
+				Seek=(CatMinDate<Filter->StartDate);
+			}
+		}
+		if (ParseCacheDir[0] && !DaemonMode && stat(arq,&CacheStat)==0) {
+			if ((Cache=ParseCache_Open(arq,&CacheStat))!=NULL) {
+				if (debug) debuga(__FILE__,__LINE__,_("Reading access log file \"%s\" from the parse cache\n"),arq);
+				recs2=ReadLog_Replay(Filter,Cache);
+				ParseCache_Close(&Cache,true);
+				if (ShowReadStatistics)
+					printf(_("SARG: Records in file: %lu\n"),recs2);
+				return;
+			}
+		} else {
+			CacheStat.st_size=-1;
+		}
+		if (Seek)
+			Start=ReadLog_FindStart(&log_line,arq,(long long int)CatalogStat.st_size,Filter->StartDate,CatDisorder);
+		if (DaemonMode) {
+			fp_in=LogState_Open(&log_line,arq);
+			if (fp_in==NULL) return;
+		} else if (Start>0) {
+			long long int End=(long long int)CatalogStat.st_size;
+
+			fp_in=decomp_range(arq,Start,&End);
+			if (fp_in==NULL) {
+				debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+				exit(EXIT_FAILURE);
+			}
+			if (debug) debuga(__FILE__,__LINE__,_("Reading access log file \"%s\" from offset %lld\n"),arq,Start);
+		} else if (Filter->DateRange[0]!='\0' && LogIndexDir[0] && (fp_in=ReadLog_OpenIndexed(&log_line,arq,Filter->StartDate))!=NULL) {
+			// the dates of the lines skipped are unknown
+			Catalog=false;
+		} else {
+			fp_in=decomp(arq);
+			if (fp_in==NULL) {
+				debuga(__FILE__,__LINE__,_("Cannot open input log file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+				exit(EXIT_FAILURE);
+			}
+			if (debug) debuga(__FILE__,__LINE__,_("Reading access log file: %s\n"),arq);
+			// only a log read from its beginning can be cached
+			if (CacheStat.st_size>=0)
+				Cache=ParseCache_Create(arq,&CacheStat);
 		}
-		if (debug) debuga(__FILE__,__LINE__,_("Reading access log file: %s\n"),arq);
 	}
 
-	download_flag=false;
-
-	recs1=0UL;
 	recs2=0UL;
 
-	// pre-read the file only if we have to show stats
-	if (ShowReadStatistics && ShowReadPercent && fp_in->Rewind) {
-		int nread,i;
-		bool skipcr=false;
-		char tmp4[MAXLEN];
-
-		while ((nread=FileObject_Read(fp_in,tmp4,sizeof(tmp4)))>0) {
-			for (i=0 ; i<nread ; i++)
-				if (skipcr) {
-					if (tmp4[i]!='\n' && tmp4[i]!='\r') {
-						skipcr=false;
-					}
-				} else {
-					if (tmp4[i]=='\n' || tmp4[i]=='\r') {
-						skipcr=true;
-						recs1++;
-					}
-				}
-		}
-		FileObject_Rewind(fp_in);
-		printf(_("SARG: Records in file: %lu, reading: %3.2f%%"),recs1,(float) 0);
-		putchar('\r');
-		fflush( stdout ) ;
+	if (ShowReadStatistics && ShowReadPercent && fp_in->Offset) {
+		if (stat(arq,&logstat)==0 && logstat.st_size>0)
+			FileSize=(long long int)logstat.st_size;
+		gettimeofday(&ReadStart,NULL);
+		ShowReadProgress(fp_in,0,FileSize,&ReadStart);
 	}
 
 	if ((line=longline_create())==NULL) {
@@ -404,14 +1217,7 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 
 		recs2++;
 		if (ShowReadStatistics && --OutputNonZero<=0) {
-			if (recs1>0) {
-				double perc = recs2 * 100. / recs1 ;
-				printf(_("SARG: Records in file: %lu, reading: %3.2lf%%"),recs2,perc);
-			} else {
-				printf(_("SARG: Records in file: %lu"),recs2);
-			}
-			putchar('\r');
-			fflush (stdout);
+			ShowReadProgress(fp_in,recs2,FileSize,&ReadStart);
 			OutputNonZero = REPORT_EVERY_X_LINES ;
 		}
 
@@ -421,11 +1227,11 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 		*/
 		//if (blen < 58) continue; //this test conflict with the reading of the sarg log header line
 		if (strstr(linebuf,"HTTP/0.0") != 0) {//recorded by squid when encountering an incomplete query
-			excluded_count[ER_IncompleteQuery]++;
+			ReadLog_Skip(Cache,ER_IncompleteQuery);
 			continue;
 		}
 		if (strstr(linebuf,"logfile turned over") != 0) {//reported by newsyslog
-			excluded_count[ER_LogfileTurnedOver]++;
+			ReadLog_Skip(Cache,ER_LogfileTurnedOver);
 			continue;
 		}
 
@@ -446,7 +1252,7 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 			if (!exstring && (str=(char *) strstr(linebuf,gwarea.current)) != (char *) NULL )
 				exstring=true;
 			if (exstring) {
-				excluded_count[ER_ExcludeString]++;
+				ReadLog_Skip(Cache,ER_ExcludeString);
 				continue;
 			}
 		}
@@ -456,304 +1262,68 @@ static void ReadOneLogFile(struct ReadLogDataStruct *Filter,const char *arq)
 			printf("BUF=%s\n",linebuf);
 
 		// process the line
-		log_entry_status=LogLine_Parse(&log_line,&log_entry,linebuf);
+		log_entry_status=LogLine_Parse(&log_line,&Rec.Entry,linebuf);
 		if (log_entry_status==RLRC_Unknown)
 		{
-			excluded_count[ER_UnknownFormat]++;
+			ReadLog_Skip(Cache,ER_UnknownFormat);
 			continue;
 		}
 		if (log_entry_status==RLRC_Ignore) {
-			excluded_count[ER_FormatData]++;
+			ReadLog_Skip(Cache,ER_FormatData);
 			continue;
 		}
 		format_count[log_line.current_format_idx]++;
+		SargFormat=(log_line.current_format==&ReadSargLog);
+		if (!SargFormat) ReadLog_OpenSargLog();
 
-		if (!fp_log && ParsedOutputLog[0] && log_line.current_format!=&ReadSargLog) {
-			if (access(ParsedOutputLog,R_OK) != 0) {
-				my_mkdir(ParsedOutputLog);
-			}
-			if (snprintf(SargLogFile,sizeof(SargLogFile),"%s/sarg_temp.log",ParsedOutputLog)>=sizeof(SargLogFile)) {
-				debuga(__FILE__,__LINE__,_("Path too long: "));
-				debuga_more("%s/sarg_temp.log\n",ParsedOutputLog);
-				exit(EXIT_FAILURE);
-			}
-			if ((fp_log=MY_FOPEN(SargLogFile,"w"))==NULL) {
-				debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),SargLogFile,strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-			fputs("*** SARG Log ***\n",fp_log);
-		}
-
-		if (log_entry.Ip==NULL) {
+		if (Rec.Entry.Ip==NULL) {
 			debuga(__FILE__,__LINE__,_("Unknown input log file format: no IP addresses\n"));
 			break;
 		}
-		if (log_entry.User==NULL) {
+		if (Rec.Entry.User==NULL) {
 			debuga(__FILE__,__LINE__,_("Unknown input log file format: no user\n"));
 			break;
 		}
-		if (log_entry.Url==NULL) {
+		if (Rec.Entry.Url==NULL) {
 			debuga(__FILE__,__LINE__,_("Unknown input log file format: no URL\n"));
 			break;
 		}
 
-		idata=builddia(log_entry.EntryTime.tm_mday,log_entry.EntryTime.tm_mon+1,log_entry.EntryTime.tm_year+1900);
-		if (debugz>=LogLevel_Data)
-			printf("DATE=%s IDATA=%d DFROM=%d DUNTIL=%d\n",Filter->DateRange,idata,Filter->StartDate,Filter->EndDate);
-
-		if (EarliestDate<0 || idata<EarliestDate) {
-			EarliestDate=idata;
-			memcpy(&EarliestDateTime,&log_entry.EntryTime,sizeof(struct tm));
-		}
-		if (LatestDate<0 || idata>LatestDate) {
-			LatestDate=idata;
-			memcpy(&LatestDateTime,&log_entry.EntryTime,sizeof(struct tm));
-		}
-		if (Filter->DateRange[0] != '\0'){
-			if (idata<Filter->StartDate || idata>Filter->EndDate) {
-				excluded_count[ER_OutOfDateRange]++;
-				continue;
-			}
-		}
-
-		// Record only hours usage which is required
-		if (!numlistcontains(weekdays, 7, log_entry.EntryTime.tm_wday))
-		{
-			excluded_count[ER_OutOfWDayRange]++;
-			continue;
-		}
-
-		if (!numlistcontains(hours, 24, log_entry.EntryTime.tm_hour))
-		{
-			excluded_count[ER_OutOfHourRange]++;
-			continue;
-		}
-
-		PUser=process_user(&log_entry.User,log_entry.Ip,&id_is_ip);
-		switch (PUser)
-		{
-			case USERERR_NoError:
-				break;
-			case USERERR_NameTooLong:
-				if (debugz>=LogLevel_Process) debuga(__FILE__,__LINE__,_("User ID too long: %s\n"),log_entry.User);
-				excluded_count[ER_UserNameTooLong]++;
-				totregsx++;
-				continue;
-			case USERERR_Excluded:
-				excluded_count[ER_User]++;
-				continue;
-			case USERERR_InvalidChar:
-				excluded_count[ER_InvalidUserChar]++;
-				continue;
-			case USERERR_EmptyUser:
-				excluded_count[ER_NoUser]++;
-				continue;
-			case USERERR_SysUser:
-				excluded_count[ER_SysUser]++;
-				continue;
-			case USERERR_Ignored:
-				excluded_count[ER_IgnoredUser]++;
-				totregsx++;
-				continue;
-			case USERERR_Untracked:
-				excluded_count[ER_UntrackedUser]++;
-				continue;
+		idata=builddia(Rec.Entry.EntryTime.tm_mday,Rec.Entry.EntryTime.tm_mon+1,Rec.Entry.EntryTime.tm_year+1900);
+		if (Catalog) {
+			if (FileMinDate<0 || idata<FileMinDate) FileMinDate=idata;
+			if (idata>FileMaxDate) FileMaxDate=idata;
+			Stamp=LogCatalog_Stamp(&Rec.Entry.EntryTime);
+			if (Stamp>MaxStamp)
+				MaxStamp=Stamp;
+			else if (MaxStamp-Stamp>Disorder)
+				Disorder=MaxStamp-Stamp;
 		}
-
-		if (vercode(log_entry.HttpCode)) {
-			if (debugz>=LogLevel_Process) debuga(__FILE__,__LINE__,_("Excluded code: %s\n"),log_entry.HttpCode);
-			excluded_count[ER_HttpCode]++;
-			totregsx++;
-			continue;
+		// the cache stores every entry whatever its date
+		if (Cache) {
+			Rec.Format=log_line.current_format_idx;
+			ReadLog_FilterEntry(Filter,SargFormat,linebuf,&Rec);
+			ParseCache_Write(Cache,&Rec);
 		}
-
-		// replace any tab by a single space
-		for (str=log_entry.Url ; *str ; str++)
-			if (*str=='\t') *str=' ';
-		for (str=log_entry.HttpCode ; *str ; str++)
-			if (*str=='\t') *str=' ';
-
-		if (log_line.current_format!=&ReadSargLog) {
-			/*
-			The full URL is not saved in sarg log. There is no point in testing the URL to detect
-			a downloaded file.
-			*/
-			download_flag=is_download_suffix(log_entry.Url);
-			if (download_flag) {
-				safe_strcpy(download_url,log_entry.Url,sizeof(download_url));
-			}
-		} else
-			download_flag=false;
-
-		url=process_url(log_entry.Url,LongUrl);
-		if (!url || url[0] == '\0') {
-			excluded_count[ER_NoUrl]++;
+		if (!ReadLog_CheckDate(Filter,&Rec.Entry.EntryTime,idata)) continue;
+		if (!Cache)
+			ReadLog_FilterEntry(Filter,SargFormat,linebuf,&Rec);
+		if (Rec.Kind!=PCK_Kept) {
+			ReadLog_Exclude(Rec.Reason);
 			continue;
 		}
-
-		if (addr[0] != '\0'){
-			if (strcmp(addr,log_entry.Ip)!=0) {
-				excluded_count[ER_UntrackedIpAddr]++;
-				continue;
-			}
-		}
-		if (Filter->HostFilter) {
-			if (!vhexclude(url)) {
-				if (debugz>=LogLevel_Data) debuga(__FILE__,__LINE__,_("Excluded site: %s\n"),url);
-				excluded_count[ER_Url]++;
-				totregsx++;
-				continue;
-			}
-		}
-
-		if (Filter->StartTime >= 0 && Filter->EndTime >= 0) {
-			hmr=log_entry.EntryTime.tm_hour*100+log_entry.EntryTime.tm_min;
-			if (hmr < Filter->StartTime || hmr >= Filter->EndTime) {
-				excluded_count[ER_OutOfTimeRange]++;
-				continue;
-			}
-		}
-
-		if (site[0] != '\0'){
-			if (strstr(url,site)==0) {
-				excluded_count[ER_UntrackedUrl]++;
-				continue;
-			}
-		}
-
-		if (log_entry.DataSize<0) log_entry.DataSize=0;
-
-		if (log_entry.ElapsedTime<0) log_entry.ElapsedTime=0;
-		if (Filter->max_elapsed>0 && log_entry.ElapsedTime>Filter->max_elapsed) {
-			log_entry.ElapsedTime=0;
-		}
-
-		if ((str=(char *) strstr(linebuf, "[SmartFilter:")) != (char *) NULL ) {
-			fixendofline(str);
-			snprintf(smartfilter,sizeof(smartfilter),"\"%s\"",str+1);
-		} else strcpy(smartfilter,"\"\"");
-
-		nopen=0;
-		prev_ufile=NULL;
-		for (ufile=first_user_file ; ufile && strcmp(log_entry.User,ufile->user->id)!=0 ; ufile=ufile->next) {
-			prev_ufile=ufile;
-			if (ufile->file) nopen++;
-		}
-		if (!ufile) {
-			ufile=malloc(sizeof(*ufile));
-			if (!ufile) {
-				debuga(__FILE__,__LINE__,_("Not enough memory to store the user %s\n"),log_entry.User);
-				exit(EXIT_FAILURE);
-			}
-			memset(ufile,0,sizeof(*ufile));
-			ufile->next=first_user_file;
-			first_user_file=ufile;
-			/*
-			 * This id_is_ip stuff is just to store the string only once if the user is
-			 * identified by its IP address instead of a distinct ID and IP address.
-			 */
-			uinfo=userinfo_create(log_entry.User,(id_is_ip) ? NULL : log_entry.Ip);
-			ufile->user=uinfo;
-			nusers++;
-		} else {
-			if (prev_ufile) {
-				prev_ufile->next=ufile->next;
-				ufile->next=first_user_file;
-				first_user_file=ufile;
-			}
-		}
-#ifdef ENABLE_DOUBLE_CHECK_DATA
-		if (strcmp(log_entry.HttpCode,"TCP_DENIED/407")!=0) {
-			ufile->user->nbytes+=log_entry.DataSize;
-			ufile->user->elap+=log_entry.ElapsedTime;
-		}
-#endif
-
-		if (ufile->file==NULL) {
-			if (nopen>=maxopenfiles) {
-				x=0;
-				for (ufile1=first_user_file ; ufile1 ; ufile1=ufile1->next) {
-					if (ufile1->file!=NULL) {
-						if (x>=maxopenfiles) {
-							if (fclose(ufile1->file)==EOF) {
-								debuga(__FILE__,__LINE__,_("Write error in log file of user %s: %s\n"),ufile1->user->id,strerror(errno));
-								exit(EXIT_FAILURE);
-							}
-							ufile1->file=NULL;
-						}
-						x++;
-					}
-				}
-			}
-			if (snprintf (tmp3, sizeof(tmp3), "%s/%s.user_unsort", tmp, ufile->user->filename)>=sizeof(tmp3)) {
-				debuga(__FILE__,__LINE__,_("Temporary user file name too long: %s/%s.user_unsort\n"), tmp, ufile->user->filename);
-				exit(EXIT_FAILURE);
-			}
-			if ((ufile->file = MY_FOPEN (tmp3, "a")) == NULL) {
-				debuga(__FILE__,__LINE__,_("(log) Cannot open temporary file %s: %s\n"), tmp3, strerror(errno));
-				exit(EXIT_FAILURE);
-			}
-		}
-
-		strftime(dia, sizeof(dia), "%d/%m/%Y",&log_entry.EntryTime);
-		strftime(hora,sizeof(hora),"%H:%M:%S",&log_entry.EntryTime);
-
-		if (fprintf(ufile->file, "%s\t%s\t%s\t%s\t%"PRIu64"\t%s\t%ld\t%s\n",dia,hora,
-								log_entry.Ip,url,(uint64_t)log_entry.DataSize,
-								log_entry.HttpCode,log_entry.ElapsedTime,smartfilter)<=0) {
-			debuga(__FILE__,__LINE__,_("Write error in the log file of user %s\n"),log_entry.User);
-			exit(EXIT_FAILURE);
-		}
-		records_kept++;
-
-		if (fp_log && log_line.current_format!=&ReadSargLog) {
-			fprintf(fp_log, "%s\t%s\t%s\t%s\t%s\t%"PRIu64"\t%s\t%ld\t%s\n",dia,hora,
-							log_entry.User,log_entry.Ip,url,(uint64_t)log_entry.DataSize,
-							log_entry.HttpCode,log_entry.ElapsedTime,smartfilter);
-		}
-
-		totregsg++;
-
-		denied_write(&log_entry);
-		authfail_write(&log_entry);
-		if (download_flag) download_write(&log_entry,download_url);
-		if (log_entry.UserAgent)
-		{
-			if (!UseragentLog)
-				UseragentLog=UserAgent_Open();
-			UserAgent_Write(UseragentLog,&log_entry.EntryTime,log_entry.Ip,log_entry.User,log_entry.UserAgent);
-		}
-
-		if (log_line.current_format!=&ReadSargLog) {
-			if (period.start.tm_year==0 || idata<mindate || compare_date(&period.start,&log_entry.EntryTime)>0){
-				mindate=idata;
-				memcpy(&period.start,&log_entry.EntryTime,sizeof(log_entry.EntryTime));
-			}
-			if (period.end.tm_year==0 || idata>maxdate || compare_date(&period.end,&log_entry.EntryTime)<0) {
-				maxdate=idata;
-				memcpy(&period.end,&log_entry.EntryTime,sizeof(log_entry.EntryTime));
-			}
-		}
-
-		if (debugz>=LogLevel_Data){
-			printf("IP=\t%s\n",log_entry.Ip);
-			printf("USER=\t%s\n",log_entry.User);
-			printf("ELAP=\t%ld\n",log_entry.ElapsedTime);
-			printf("DATE=\t%s\n",dia);
-			printf("TIME=\t%s\n",hora);
-			//printf("FUNC=\t%s\n",fun);
-			printf("URL=\t%s\n",url);
-			printf("CODE=\t%s\n",log_entry.HttpCode);
-			printf("LEN=\t%"PRIu64"\n",(uint64_t)log_entry.DataSize);
-		}
+		ReadLog_KeepEntry(&Rec,SargFormat,idata);
 	}
+	// the dates are only known if the whole log was read
+	if (Catalog && !linebuf && FileMinDate>=0)
+		LogCatalog_Store(arq,&CatalogStat,FileMinDate,FileMaxDate,Disorder);
 	longline_destroy(&line);
 
 	if (FileObject_Close(fp_in)) {
 		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),arq,FileObject_GetLastCloseError());
 		exit(EXIT_FAILURE);
 	}
-	if (UseragentLog) fclose(UseragentLog);
+	ParseCache_Close(&Cache,!linebuf);
 	if (ShowReadStatistics) {
 		if (ShowReadPercent)
 			printf(_("SARG: Records in file: %lu, reading: %3.2f%%\n"),recs2, (float) 100 );
@@ -794,7 +1364,6 @@ int ReadLogFile(struct ReadLogDataStruct *Filter)
 
 	for (x=0 ; x<sizeof(format_count)/sizeof(*format_count) ; x++) format_count[x]=0;
 	for (x=0 ; x<sizeof(excluded_count)/sizeof(*excluded_count) ; x++) excluded_count[x]=0;
-	first_user_file=NULL;
 
 	if (!dataonly) {
 		denied_open();
@@ -806,51 +1375,77 @@ int ReadLogFile(struct ReadLogDataStruct *Filter)
 	while ((file=FileListIter_Next(FIter))!=NULL)
 		ReadOneLogFile(Filter,file);
 	FileListIter_Close(FIter);
+	if (!DaemonMode)
+		ParseCache_Purge();
 
 	if (fp_log != NULL) {
 		char val2[40];
 		char val4[4096];//val4 must not be bigger than SargLogFile without fixing the strcpy below
+		int len;
+		int num;
 
 		if (fclose(fp_log)==EOF) {
 			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),SargLogFile,strerror(errno));
 			exit(EXIT_FAILURE);
 		}
-		strftime(val2,sizeof(val2),"%d%m%Y_%H%M",&period.start);
-		strftime(val1,sizeof(val1),"%d%m%Y_%H%M",&period.end);
-		if (snprintf(val4,sizeof(val4),"%s/sarg-%s-%s.log",ParsedOutputLog,val2,val1)>=sizeof(val4)) {
-			debuga(__FILE__,__LINE__,_("Path too long: "));
-			debuga_more("%s/sarg-%s-%s.log\n",ParsedOutputLog,val2,val1);
-			exit(EXIT_FAILURE);
-		}
-		if (rename(SargLogFile,val4)) {
-			debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),SargLogFile,val4,strerror(errno));
+		// the daemon mode creates a new sarg log on every pass
+		fp_log=NULL;
+		if (SargLogRecords==0) {
+			// don't replace the sarg log of a previous pass with an empty file
+			if (unlink(SargLogFile)==-1) {
+				debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),SargLogFile,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
 		} else {
-			strcpy(SargLogFile,val4);
-
-			if (strcmp(ParsedOutputLogCompress,"nocompress") != 0 && ParsedOutputLogCompress[0] != '\0') {
-				/*
-				No double quotes around ParsedOutputLogCompress because it may contain command line options. If double quotes are
-				necessary around the command name, put them in the configuration file.
-				*/
-				if (snprintf(val1,sizeof(val1),"%s \"%s\"",ParsedOutputLogCompress,SargLogFile)>=sizeof(val1)) {
-					debuga(__FILE__,__LINE__,_("Command too long: %s \"%s\"\n"),ParsedOutputLogCompress,SargLogFile);
+			// the file is named after the records it contains as the daemon only writes the records of its last pass
+			strftime(val2,sizeof(val2),"%d%m%Y_%H%M",&SargLogStart);
+			strftime(val1,sizeof(val1),"%d%m%Y_%H%M",&SargLogEnd);
+			len=snprintf(val4,sizeof(val4),"%s/sarg-%s-%s",ParsedOutputLog,val2,val1);
+			if (len>=sizeof(val4) || snprintf(val4+len,sizeof(val4)-len,".log%s",compressed_file_suffix(SargLogCompression))>=sizeof(val4)-len) {
+				debuga(__FILE__,__LINE__,_("Path too long: "));
+				debuga_more("%s/sarg-%s-%s.log%s\n",ParsedOutputLog,val2,val1,compressed_file_suffix(SargLogCompression));
+				exit(EXIT_FAILURE);
+			}
+			// successive passes of the daemon may cover the same minutes
+			for (num=1 ; DaemonMode && access(val4,F_OK)==0 ; num++) {
+				if (snprintf(val4+len,sizeof(val4)-len,".%d.log%s",num,compressed_file_suffix(SargLogCompression))>=sizeof(val4)-len) {
+					debuga(__FILE__,__LINE__,_("Path too long: "));
+					debuga_more("%s/sarg-%s-%s.%d.log%s\n",ParsedOutputLog,val2,val1,num,compressed_file_suffix(SargLogCompression));
 					exit(EXIT_FAILURE);
 				}
-				cstatus=system(val1);
-				if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-					debuga(__FILE__,__LINE__,_("command return status %d\n"),WEXITSTATUS(cstatus));
-					debuga(__FILE__,__LINE__,_("command: %s\n"),val1);
-					exit(EXIT_FAILURE);
+			}
+			if (rename(SargLogFile,val4)) {
+				debuga(__FILE__,__LINE__,_("failed to rename %s to %s - %s\n"),SargLogFile,val4,strerror(errno));
+			} else {
+				strcpy(SargLogFile,val4);
+
+				if (SargLogCompression==STREAMCOMP_None && strcmp(ParsedOutputLogCompress,"nocompress") != 0 && ParsedOutputLogCompress[0] != '\0') {
+					/*
+					No double quotes around ParsedOutputLogCompress because it may contain command line options. If double quotes are
+					necessary around the command name, put them in the configuration file.
+					*/
+					if (snprintf(val1,sizeof(val1),"%s \"%s\"",ParsedOutputLogCompress,SargLogFile)>=sizeof(val1)) {
+						debuga(__FILE__,__LINE__,_("Command too long: %s \"%s\"\n"),ParsedOutputLogCompress,SargLogFile);
+						exit(EXIT_FAILURE);
+					}
+					cstatus=system(val1);
+					if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
+						debuga(__FILE__,__LINE__,_("command return status %d\n"),WEXITSTATUS(cstatus));
+						debuga(__FILE__,__LINE__,_("command: %s\n"),val1);
+						exit(EXIT_FAILURE);
+					}
 				}
 			}
+			if (debug)
+				debuga(__FILE__,__LINE__,_("Sarg parsed log saved as %s\n"),SargLogFile);
 		}
-		if (debug)
-			debuga(__FILE__,__LINE__,_("Sarg parsed log saved as %s\n"),SargLogFile);
 	}
 
 	denied_close();
 	authfail_close();
 	download_close();
+	aggregate_save(Filter);
+	if (!DaemonMode) LogCatalog_Save();
 
 	for (ufile=first_user_file ; ufile ; ufile=ufile1) {
 		ufile1=ufile->next;
@@ -858,8 +1453,14 @@ int ReadLogFile(struct ReadLogDataStruct *Filter)
 			debuga(__FILE__,__LINE__,_("Write error in log file of user %s: %s\n"),ufile->user->id,strerror(errno));
 			exit(EXIT_FAILURE);
 		}
-		free(ufile);
+		ufile->file=NULL;
+		// the daemon mode appends to the same user files on the next pass
+		if (!DaemonMode) free(ufile);
 	}
+	if (!DaemonMode)
+		first_user_file=NULL;
+	else
+		LogState_Save();
 
 	if (debug) {
 		unsigned long int totalcount=0;
@@ -32,6 +32,9 @@
 //! Maximum length of the scheme plus host name from the url.
 #define MAX_URL_HOST_LEN 260
 
+//! The size of the blocks read from the end of the log file.
+#define REALTIME_BLOCK_SIZE 65536
+
 /*!
 \brief Data read from an input log file.
 */
@@ -53,6 +56,43 @@ struct RealtimeReadLogStruct
 	char HttpMethod[32];
 };
 
+/*!
+\brief The log file read one line at a time from its end or, when following
+it, from the last known position to its end.
+*/
+struct RealtimeFileStruct
+{
+	//! The name of the file.
+	const char *FileName;
+	//! The file descriptor.
+	int Fd;
+	//! The lowest position to read the file from when going backward.
+	off_t Start;
+	//! The position in the file of the first byte stored in the buffer.
+	off_t Pos;
+	//! The buffer containing the data not yet returned.
+	char *Buf;
+	//! The number of bytes stored in the buffer.
+	size_t Len;
+	//! The number of bytes allocated for the buffer.
+	size_t Size;
+};
+
+/*!
+\brief The last entries of the log.
+*/
+struct RealtimeListStruct
+{
+	//! The entries stored in a ring buffer.
+	struct RealtimeReadLogStruct *Entry;
+	//! The number of entries the list can hold.
+	int Size;
+	//! The number of entries stored.
+	int Count;
+	//! The index of the most recent entry.
+	int Newest;
+};
+
 extern FileListObject AccessLog;
 
 static bool GetLatestModified(char *file_name,int file_name_size)
@@ -112,16 +152,19 @@ static void StoreLogEntry(struct RealtimeReadLogStruct *Dest,struct ReadLogStruc
 		Dest->Url[i]='\0';
 	}
 	safe_strcpy(Dest->User,Entry->User,sizeof(Dest->User));
-	safe_strcpy(Dest->HttpMethod,Entry->HttpMethod,sizeof(Dest->HttpMethod));
+	if (Entry->HttpMethod)
+		safe_strcpy(Dest->HttpMethod,Entry->HttpMethod,sizeof(Dest->HttpMethod));
+	else
+		Dest->HttpMethod[0]='\0';
 }
 
-static void header(void)
+static void header(bool refresh)
 {
 	puts("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\"");
 	puts(" \"http://www.w3.org/TR/html4/loose.dtd\">\n");
 	puts("<html>\n");
 	puts("<head>\n");
-	if (realtime_refresh)
+	if (refresh && realtime_refresh)
 		printf("  <meta http-equiv=refresh content=\"%d\" url=\"sarg-php/sarg-realtime.php\"; charset=\"%s\">\n",realtime_refresh,CharSet);
 	else
 		printf("  <meta http-equiv=\"Content-Type\" content=\"text/html; charset=%s\">\n",CharSet);
@@ -130,125 +173,503 @@ static void header(void)
 	printf("<body style=\"font-family:%s;font-size:%s;background-color:%s;background-image:url(%s)\">\n",FontFace,TitleFontSize,BgColor,BgImage);
 	puts("<div align=\"center\"><table cellpadding=\"1\" cellspacing=\"1\">\n");
 	printf("<tr><th class=\"title_l\" colspan=\"10\">SARG %s</th></tr>\n",_("Realtime"));
-	printf("<tr><th class=\"text\" colspan=\"10\">%s: %d s</th></tr>\n",_("Auto refresh"),realtime_refresh);
+	if (refresh)
+		printf("<tr><th class=\"text\" colspan=\"10\">%s: %d s</th></tr>\n",_("Auto refresh"),realtime_refresh);
 	printf("<tr><th class=\"header_c\">%s</th><th class=\"header_c\">%s</th><th class=\"header_c\">%s</th><th class=\"header_c\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("DATE/TIME"),_("IP/NAME"),_("USERID"),_("TYPE"),_("ACCESSED SITE"));
 }
 
-static void datashow(struct RealtimeReadLogStruct *List,int Index,int Size)
+/*!
+ * \brief Write one entry of the report.
+ *
+ * \param entry The entry to write.
+ */
+static void datarow(const struct RealtimeReadLogStruct *entry)
 {
-	char tbuf[128];
+	char tbuf[128]="";
 	char user[MAX_USER_LEN];
 	char name[MAX_USER_LEN];
+
+	if (UserIp)
+		safe_strcpy(user,entry->Ip,sizeof(user));
+	else
+		safe_strcpy(user,entry->User,sizeof(user));
+	if (Ip2Name)
+		ip2name(user,sizeof(user));
+	user_find(name, sizeof(name), user);
+
+	if (df=='u')
+		strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M", &entry->EntryTime);
+	else if (df=='e')
+		strftime(tbuf, sizeof(tbuf), "%d-%m-%Y %H:%M", &entry->EntryTime);
+
+	printf("<tr><td class=\"data\">%s</td><td class=\"data3\">%s</td><td class=\"data3\">%s</td><td class=\"data3\">%s</td><td class=\"data2\"><a href=\"http://%s\">%s</td></tr>\n",
+		   tbuf,entry->Ip,name,entry->HttpMethod,entry->Url,entry->Url);
+}
+
+/*!
+ * \brief Write the report with the most recent entry first.
+ *
+ * \param List The entries to write.
+ */
+static void datashow(const struct RealtimeListStruct *List)
+{
 	int i;
-	struct RealtimeReadLogStruct *entry;
+	int Index;
 
-	header();
-	for (i=0 ; i<realtime_access_log_lines ; i++)
+	header(true);
+	Index=List->Newest;
+	for (i=0 ; i<List->Count ; i++)
 	{
-		entry=List+Index;
+		datarow(List->Entry+Index);
 		Index--;
-		if (Index<0) Index=Size-1;
+		if (Index<0) Index=List->Size-1;
+	}
 
-		if (UserIp)
-			strcpy(user,entry->Ip);
-		else
-			strcpy(user,entry->User);
-		if (Ip2Name)
-			ip2name(user,sizeof(user));
-		user_find(name, sizeof(name), user);
+	puts("</table>\n</div>\n</body>\n</html>\n");
+	fflush(NULL);
+}
 
-		if (df=='u')
-			strftime(tbuf, sizeof(tbuf), "%Y-%m-%d %H:%M", &entry->EntryTime);
-		else if (df=='e')
-			strftime(tbuf, sizeof(tbuf), "%d-%m-%Y %H:%M", &entry->EntryTime);
+/*!
+ * \brief Parse a log line and tell if it must be shown in the report.
+ *
+ * \param log_line The state of the log parser.
+ * \param Dest The structure to store the entry into.
+ * \param buf The line to parse. It is modified.
+ *
+ * \return \c True if the entry is stored in \a Dest or \c false if the line
+ * must be ignored.
+ */
+static bool ParseLogLine(struct LogLineStruct *log_line,struct RealtimeReadLogStruct *Dest,char *buf)
+{
+	struct ReadLogStruct log_entry;
+	enum ReadLogReturnCodeEnum log_entry_status;
+
+	log_entry_status=LogLine_Parse(log_line,&log_entry,buf);
+	if (log_entry_status==RLRC_Unknown)
+		return(false);
+	if (log_entry_status==RLRC_Ignore)
+		return(false);
+	if (log_entry.HttpMethod && strstr(RealtimeTypes,log_entry.HttpMethod)==0)
+		return(false);
+	if (RealtimeUnauthRec==REALTIME_UNAUTH_REC_IGNORE && log_entry.User[0]=='-' && log_entry.User[1]=='\0')
+		return(false);
+	StoreLogEntry(Dest,&log_entry);
+	return(true);
+}
 
-		printf("<tr><td class=\"data\">%s</td><td class=\"data3\">%s</td><td class=\"data3\">%s</td><td class=\"data3\">%s</td><td class=\"data2\"><a href=\"http://%s\">%s</td></tr>\n",
-			   tbuf,entry->Ip,name,entry->HttpMethod,entry->Url,entry->Url);
+/*!
+ * \brief Tell if two entries are about the same user and site.
+ */
+static bool SameUserUrl(const struct RealtimeReadLogStruct *Entry1,const struct RealtimeReadLogStruct *Entry2)
+{
+	return(strcmp(Entry1->User,Entry2->User)==0 && strcmp(Entry1->Url,Entry2->Url)==0);
+}
+
+/*!
+ * \brief Add an entry after the most recent one unless it is about the same user and site.
+ *
+ * \param List The list to store the entry into.
+ * \param Entry The entry to store.
+ *
+ * \return \c True if the entry was stored.
+ */
+static bool AddEntry(struct RealtimeListStruct *List,const struct RealtimeReadLogStruct *Entry)
+{
+	if (List->Size<=0) return(false);
+	if (List->Count>0 && SameUserUrl(List->Entry+List->Newest,Entry))
+		return(false);
+	List->Newest++;
+	if (List->Newest>=List->Size) List->Newest=0;
+	memcpy(List->Entry+List->Newest,Entry,sizeof(*Entry));
+	if (List->Count<List->Size) List->Count++;
+	return(true);
+}
+
+/*!
+ * \brief Make room in the buffer of the file.
+ *
+ * \param File The file whose buffer must be enlarged.
+ * \param Needed The number of bytes the buffer must be able to hold.
+ */
+static void RealtimeFile_Grow(struct RealtimeFileStruct *File,size_t Needed)
+{
+	char *Buf;
+	size_t Size;
+
+	if (Needed<=File->Size) return;
+	Size=(File->Size>0) ? File->Size : REALTIME_BLOCK_SIZE;
+	while (Size<Needed) Size*=2;
+	Buf=realloc(File->Buf,Size);
+	if (!Buf) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),File->FileName);
+		exit(EXIT_FAILURE);
 	}
+	File->Buf=Buf;
+	File->Size=Size;
+}
 
-	puts("</table>\n</div>\n</body>\n</html>\n");
-	fflush(NULL);
+/*!
+ * \brief Cut the line ending at the given position of the buffer.
+ *
+ * \param File The file containing the line.
+ * \param Begin The position of the first character of the line in the buffer.
+ * \param End The position of the end of line in the buffer.
+ *
+ * \return The line terminated by a null character.
+ */
+static char *RealtimeFile_Cut(struct RealtimeFileStruct *File,size_t Begin,size_t End)
+{
+	if (End>Begin && File->Buf[End-1]=='\r') End--;
+	File->Buf[End]='\0';
+	return(File->Buf+Begin);
+}
+
+/*!
+ * \brief Read the lines of the file from its end.
+ *
+ * \param File The file to read.
+ *
+ * \return The line preceding the one returned by the previous call or NULL
+ * once the beginning of the file is reached. Empty lines are skipped.
+ */
+static char *RealtimeFile_ReadPrev(struct RealtimeFileStruct *File)
+{
+	size_t i;
+	size_t n;
+	ssize_t nread;
+
+	while (true)
+	{
+		for (i=File->Len ; i>0 && File->Buf[i-1]!='\n' ; i--);
+		if (i>0)
+		{
+			char *line;
+			size_t End=File->Len;
+
+			File->Len=i-1;
+			if (End==i) continue;
+			line=RealtimeFile_Cut(File,i,End);
+			if (line[0]) return(line);
+			continue;
+		}
+		if (File->Pos<=File->Start)
+		{
+			if (File->Len==0) return(NULL);
+			n=File->Len;
+			File->Len=0;
+			return(RealtimeFile_Cut(File,0,n));
+		}
+
+		// read the previous block in front of the data left in the buffer
+		n=(File->Pos-File->Start>REALTIME_BLOCK_SIZE) ? REALTIME_BLOCK_SIZE : (size_t)(File->Pos-File->Start);
+		RealtimeFile_Grow(File,File->Len+n+1);
+		memmove(File->Buf+n,File->Buf,File->Len);
+		nread=pread(File->Fd,File->Buf,n,File->Pos-n);
+		if (nread!=(ssize_t)n) {
+			debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),File->FileName,(nread<0) ? strerror(errno) : _("Truncated file"));
+			exit(EXIT_FAILURE);
+		}
+		File->Pos-=n;
+		File->Len+=n;
+	}
+}
+
+/*!
+ * \brief Read the lines appended to the file since the last call.
+ *
+ * \param File The file to read. Its position is the end of the data in the buffer.
+ * \param log_line The state of the log parser.
+ * \param List The list to store the new entries into.
+ * \param show \c True to write the new entries in the report.
+ */
+static void RealtimeFile_ReadNew(struct RealtimeFileStruct *File,struct LogLineStruct *log_line,struct RealtimeListStruct *List,bool show)
+{
+	size_t Begin;
+	size_t i;
+	ssize_t nread;
+	struct RealtimeReadLogStruct Entry;
+
+	while (true)
+	{
+		RealtimeFile_Grow(File,File->Len+REALTIME_BLOCK_SIZE+1);
+		nread=pread(File->Fd,File->Buf+File->Len,REALTIME_BLOCK_SIZE,File->Pos+File->Len);
+		if (nread<0) {
+			debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),File->FileName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (nread==0) break;
+		File->Len+=nread;
+
+		// parse the complete lines and keep the last partial line for later
+		Begin=0;
+		for (i=0 ; i<File->Len ; i++)
+		{
+			if (File->Buf[i]!='\n') continue;
+			if (i>Begin && ParseLogLine(log_line,&Entry,RealtimeFile_Cut(File,Begin,i)) &&
+			    AddEntry(List,&Entry) && show)
+				datarow(&Entry);
+			Begin=i+1;
+		}
+		if (Begin>0)
+		{
+			memmove(File->Buf,File->Buf+Begin,File->Len-Begin);
+			File->Len-=Begin;
+			File->Pos+=Begin;
+		}
+	}
+}
+
+/*!
+ * \brief Find the first entry of the log file.
+ *
+ * The lines are parsed from the beginning of the file until one is recognized so that
+ * the format of the log and any header it may contain are known before the file is
+ * read backward.
+ *
+ * \param File The file to read.
+ * \param log_line The state of the log parser.
+ * \param FileSize The size of the file.
+ *
+ * \return The position of the first line containing an entry. It is the end of the file
+ * if there is no entry in the file.
+ */
+static off_t RealtimeFile_FindFirstEntry(struct RealtimeFileStruct *File,struct LogLineStruct *log_line,off_t FileSize)
+{
+	struct ReadLogStruct log_entry;
+	size_t Begin;
+	size_t i;
+	ssize_t nread;
+	off_t Pos=0;
+
+	File->Len=0;
+	while (Pos+(off_t)File->Len<FileSize)
+	{
+		RealtimeFile_Grow(File,File->Len+REALTIME_BLOCK_SIZE+1);
+		nread=pread(File->Fd,File->Buf+File->Len,REALTIME_BLOCK_SIZE,Pos+File->Len);
+		if (nread<0) {
+			debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),File->FileName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (nread==0) break;
+		File->Len+=nread;
+
+		Begin=0;
+		for (i=0 ; i<File->Len ; i++)
+		{
+			if (File->Buf[i]!='\n') continue;
+			if (i>Begin && LogLine_Parse(log_line,&log_entry,RealtimeFile_Cut(File,Begin,i))==RLRC_NoError)
+			{
+				File->Len=0;
+				return(Pos+Begin);
+			}
+			Begin=i+1;
+		}
+		memmove(File->Buf,File->Buf+Begin,File->Len-Begin);
+		File->Len-=Begin;
+		Pos+=Begin;
+	}
+	File->Len=0;
+	return((Pos<FileSize) ? Pos : FileSize);
+}
+
+/*!
+ * \brief Find the end of the last complete line of the log file.
+ *
+ * \param File The file to read. Its start must be set.
+ * \param FileSize The size of the file.
+ *
+ * \return The position following the last end of line or the start of the
+ * file if it contains no complete line.
+ */
+static off_t RealtimeFile_LastLineEnd(struct RealtimeFileStruct *File,off_t FileSize)
+{
+	off_t Pos=FileSize;
+	size_t n;
+	size_t i;
+	ssize_t nread;
+
+	RealtimeFile_Grow(File,REALTIME_BLOCK_SIZE);
+	while (Pos>File->Start)
+	{
+		n=(Pos-File->Start>REALTIME_BLOCK_SIZE) ? REALTIME_BLOCK_SIZE : (size_t)(Pos-File->Start);
+		nread=pread(File->Fd,File->Buf,n,Pos-n);
+		if (nread!=(ssize_t)n) {
+			debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),File->FileName,(nread<0) ? strerror(errno) : _("Truncated file"));
+			exit(EXIT_FAILURE);
+		}
+		for (i=n ; i>0 ; i--)
+			if (File->Buf[i-1]=='\n') return(Pos-n+i);
+		Pos-=n;
+	}
+	return(File->Start);
+}
+
+/*!
+ * \brief Open the most recent log file.
+ *
+ * \param File The structure to initialize.
+ * \param FileName The name of the file to open.
+ * \param st A variable to store the status of the file.
+ *
+ * \return \c True if the file was opened.
+ */
+static bool RealtimeFile_Open(struct RealtimeFileStruct *File,const char *FileName,struct stat *st)
+{
+	File->FileName=FileName;
+	File->Len=0;
+	File->Fd=open(FileName,O_RDONLY);
+	if (File->Fd==-1) return(false);
+	if (fstat(File->Fd,st)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot stat \"%s\": %s\n"),FileName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	return(true);
+}
+
+/*!
+ * \brief Keep reading the log file as new lines are appended to it.
+ *
+ * The file is checked every ::realtime_refresh seconds. If the file is truncated, it is
+ * read again from its beginning. If it is replaced by a new file, as it happens when
+ * the log is rotated, the new file is opened once the end of the old one is read.
+ */
+static void RealtimeFollow_Loop(struct RealtimeFileStruct *File,struct LogLineStruct *log_line,struct RealtimeListStruct *List)
+{
+	struct stat st;
+	struct stat st_name;
+	struct RealtimeFileStruct NewFile;
+
+	while (true)
+	{
+		sleep((realtime_refresh>0) ? realtime_refresh : 1);
+
+		if (fstat(File->Fd,&st)==-1) {
+			debuga(__FILE__,__LINE__,_("Cannot stat \"%s\": %s\n"),File->FileName,strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if (st.st_size<File->Pos+(off_t)File->Len)
+		{
+			// the file was truncated
+			File->Pos=0;
+			File->Len=0;
+		}
+		RealtimeFile_ReadNew(File,log_line,List,true);
+
+		if (stat(File->FileName,&st_name)==0 && (st_name.st_ino!=st.st_ino || st_name.st_dev!=st.st_dev))
+		{
+			if (RealtimeFile_Open(&NewFile,File->FileName,&st_name))
+			{
+				close(File->Fd);
+				File->Fd=NewFile.Fd;
+				File->Pos=0;
+				File->Len=0;
+				// identify the format of the new file
+				LogLine_Init(log_line);
+				LogLine_File(log_line,File->FileName);
+				RealtimeFile_ReadNew(File,log_line,List,true);
+			}
+		}
+		if (fflush(stdout)==EOF || ferror(stdout)) break;
+	}
 }
 
 void realtime(void)
 {
-	FileObject *fp;
 	char file_name[2048];
 	char *buf;
-	longline line;
-	struct ReadLogStruct log_entry;
-	enum ReadLogReturnCodeEnum log_entry_status;
 	struct LogLineStruct log_line;
-	struct RealtimeReadLogStruct *StoredLogEntries;
-	int StoreIndex=0;
-	int StoreSize=0;
-	int NextIndex=1;
+	struct RealtimeFileStruct File;
+	struct RealtimeListStruct List;
+	struct RealtimeReadLogStruct Entry;
+	struct stat st;
+	off_t End;
+	int i;
 
 	init_usertab(UserTabFile);
 	LogLine_Init(&log_line);
 
-	/*
-	 * Store one more entry to prepare the memory structure in place and reject it if
-	 * it is about the same user and url as the last stored one.
-	 */
-	StoredLogEntries=calloc(realtime_access_log_lines+1,sizeof(struct RealtimeReadLogStruct));
-	if (!StoredLogEntries)
+	List.Size=(realtime_access_log_lines>0) ? realtime_access_log_lines : 0;
+	List.Count=0;
+	List.Newest=0;
+	List.Entry=calloc(List.Size+1,sizeof(struct RealtimeReadLogStruct));
+	if (!List.Entry)
 	{
 		debuga(__FILE__,__LINE__,_("Not enough memory to store %d records"),realtime_access_log_lines);
 		exit(EXIT_FAILURE);
 	}
-	/*
-	 * Clear the url and user strings so that strcmp on the user and url are not
-	 * satisfied and the first entry can be stored.
-	 */
-	memset(StoredLogEntries,0,sizeof(struct RealtimeReadLogStruct));
 
 	if (!GetLatestModified(file_name,sizeof(file_name)))
 	{
 		debuga(__FILE__,__LINE__,_("No log file to read the last %d lines from\n"),realtime_access_log_lines);
 		exit(EXIT_FAILURE);
 	}
-	fp = FileObject_Open(file_name);
-	if (!fp) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),file_name,FileObject_GetLastOpenError());
+	memset(&File,0,sizeof(File));
+	if (!RealtimeFile_Open(&File,file_name,&st)) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),file_name,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
+	LogLine_File(&log_line,file_name);
 
-	if ((line=longline_create())==NULL) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),file_name);
-		exit(EXIT_FAILURE);
-	}
-
-	while((buf=longline_read(fp,line)) != NULL )
+	/*
+	 * Read the file backward from its end. The entries are collected from the most recent
+	 * to the oldest. Successive entries about the same user and site are shown once with
+	 * the data of the oldest one. Therefore, the entry stored last is replaced as long as
+	 * the same user and site are found.
+	 */
+	File.Start=RealtimeFile_FindFirstEntry(&File,&log_line,st.st_size);
+	/*
+	 * When the log is followed, a partial line at its end is still being written.
+	 * It is read with its continuation once it is complete.
+	 */
+	End=(RealtimeFollow) ? RealtimeFile_LastLineEnd(&File,st.st_size) : st.st_size;
+	File.Pos=End;
+	while ((buf=RealtimeFile_ReadPrev(&File))!=NULL)
 	{
-		log_entry_status=LogLine_Parse(&log_line,&log_entry,buf);
-		if (log_entry_status==RLRC_Unknown)
-		{
+		if (!ParseLogLine(&log_line,&Entry,buf))
 			continue;
-		}
-		if (log_entry_status==RLRC_Ignore)
+		if (List.Count>0 && SameUserUrl(List.Entry+List.Count-1,&Entry))
 		{
+			memcpy(List.Entry+List.Count-1,&Entry,sizeof(Entry));
 			continue;
 		}
-		if (log_entry.HttpMethod && strstr(RealtimeTypes,log_entry.HttpMethod)==0)
-			continue;
-		if (RealtimeUnauthRec==REALTIME_UNAUTH_REC_IGNORE && log_entry.User[0]=='-' && log_entry.User[1]=='\0')
-			continue;
-		StoreLogEntry(StoredLogEntries+NextIndex,&log_entry);
-		if (strcmp(StoredLogEntries[StoreIndex].User,StoredLogEntries[NextIndex].User)==0 && strcmp(StoredLogEntries[StoreIndex].Url,StoredLogEntries[NextIndex].Url)==0)
-			continue;
+		if (List.Count>=List.Size)
+			break;
+		memcpy(List.Entry+List.Count,&Entry,sizeof(Entry));
+		List.Count++;
+	}
 
-		StoreIndex=NextIndex;
-		NextIndex++;
-		if (NextIndex>StoreSize) StoreSize=NextIndex;
-		if (NextIndex>realtime_access_log_lines) NextIndex=0;
+	// put the entries in chronological order
+	for (i=0 ; i<List.Count/2 ; i++)
+	{
+		memcpy(&Entry,List.Entry+i,sizeof(Entry));
+		memcpy(List.Entry+i,List.Entry+List.Count-1-i,sizeof(Entry));
+		memcpy(List.Entry+List.Count-1-i,&Entry,sizeof(Entry));
 	}
-	if (FileObject_Close(fp)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),file_name,FileObject_GetLastCloseError());
-		exit(EXIT_FAILURE);
+	List.Newest=(List.Count>0) ? List.Count-1 : List.Size-1;
+
+	if (!RealtimeFollow)
+	{
+		close(File.Fd);
+		if (File.Buf) free(File.Buf);
+		datashow(&List);
+		free(List.Entry);
+		return;
 	}
-	longline_destroy(&line);
 
-	datashow(StoredLogEntries,StoreIndex,StoreSize);
-	free(StoredLogEntries);
+	/*
+	 * Show the entries from the oldest to the most recent one and append the new
+	 * entries as they are written in the log.
+	 */
+	header(false);
+	for (i=0 ; i<List.Count ; i++)
+		datarow(List.Entry+(List.Newest+List.Size-List.Count+1+i)%List.Size);
+	fflush(NULL);
+
+	File.Pos=End;
+	File.Len=0;
+	RealtimeFollow_Loop(&File,&log_line,&List);
+
+	close(File.Fd);
+	if (File.Buf) free(File.Buf);
+	free(List.Entry);
 }
@@ -26,122 +26,261 @@
 
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/eventlist.h"
 
 static char **files_done = NULL;
 static int nfiles_done = 0;
 
 //! The number of invalid lines found in the redirector report.
 static int RedirectorErrors=0;
-//! The file containing the sorted entries.
-static char redirector_sorted[MAXLEN]="";
+//! The accesses blocked by the redirector.
+static EventListObject redirector_events=NULL;
 
 extern char StripUserSuffix[MAX_USER_LEN];
 extern int StripSuffixLen;
 
-static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct ReadLogDataStruct *ReadFilter)
+//! The columns of the redirector log defined by redirector_log_format.
+enum RedirectorTagEnum
 {
-	char leks[5], sep[2], res[MAXLEN];
-	char hour[15];
-	char source[128], list[128];
+	//! A column to skip.
+	RDTAG_Ignore,
+	//! The year.
+	RDTAG_Year,
+	//! The month.
+	RDTAG_Mon,
+	//! The day.
+	RDTAG_Day,
+	//! The time.
+	RDTAG_Hour,
+	//! The banning source.
+	RDTAG_Source,
+	//! The banning list.
+	RDTAG_List,
+	//! The IP address of the user.
+	RDTAG_Ip,
+	//! The user ID.
+	RDTAG_User,
+	//! The URL.
+	RDTAG_Url
+};
+
+//! One column of the redirector log.
+struct RedirectorFieldStruct
+{
+	//! What the column contains.
+	enum RedirectorTagEnum Tag;
+	//! The character ending the column or zero if it extends up to the end of the line.
+	char Sep;
+};
+
+//! The maximum number of columns in redirector_log_format.
+#define REDIRECTOR_MAX_FIELDS 64
+
+//! The columns of redirector_log_format in the order they appear in a line.
+static struct RedirectorFieldStruct RedirectorFields[REDIRECTOR_MAX_FIELDS];
+//! The number of columns in RedirectorFields or -1 if redirector_log_format wasn't compiled.
+static int NRedirectorFields=-1;
+
+/*!
+ * Compile redirector_log_format into the list of columns to extract from
+ * every line of the redirector log.
+ *
+ * The format is a sequence of #tag#sep where tag is the name of the column
+ * and sep is the single character ending the column. It ends with #end#.
+ */
+static void compile_log_format(void)
+{
+	static const struct
+	{
+		const char *Name;
+		enum RedirectorTagEnum Tag;
+	} TagNames[]=
+	{
+		{"year",RDTAG_Year},
+		{"mon",RDTAG_Mon},
+		{"day",RDTAG_Day},
+		{"hour",RDTAG_Hour},
+		{"source",RDTAG_Source},
+		{"list",RDTAG_List},
+		{"ip",RDTAG_Ip},
+		{"user",RDTAG_User},
+		{"url",RDTAG_Url},
+	};
+	const char *ptr;
+	const char *tag;
+	int taglen;
+	int i;
+
+	NRedirectorFields=0;
+	ptr=strchr(RedirectorLogFormat,'#');
+	if (!ptr || ptr-RedirectorLogFormat>4) {
+		debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (too many characters before first tag)\n"));
+		exit(EXIT_FAILURE);
+	}
+	ptr++;
+	while (true) {
+		tag=ptr;
+		while (*ptr && *ptr!='#') ptr++;
+		if (*ptr!='#') {
+			debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (missing # at end of tag)\n"));
+			exit(EXIT_FAILURE);
+		}
+		taglen=ptr-tag;
+		ptr++;
+		if (taglen==3 && strncmp(tag,"end",3)==0) break;
+		if (NRedirectorFields>=REDIRECTOR_MAX_FIELDS) {
+			debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (more than %d tags)\n"),REDIRECTOR_MAX_FIELDS);
+			exit(EXIT_FAILURE);
+		}
+		RedirectorFields[NRedirectorFields].Tag=RDTAG_Ignore;
+		for (i=0 ; i<sizeof(TagNames)/sizeof(*TagNames) ; i++)
+			if (strncmp(tag,TagNames[i].Name,taglen)==0 && TagNames[i].Name[taglen]=='\0') {
+				RedirectorFields[NRedirectorFields].Tag=TagNames[i].Tag;
+				break;
+			}
+		// an empty separator extends the column up to the end of the line
+		RedirectorFields[NRedirectorFields].Sep=(*ptr=='#') ? '\0' : *ptr;
+		if (*ptr) {
+			if (*ptr!='#') ptr++;
+			if (*ptr!='#') {
+				debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (too many characters in column separator)\n"));
+				exit(EXIT_FAILURE);
+			}
+			ptr++;
+		}
+		NRedirectorFields++;
+		if (*ptr=='\0') {
+			debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (missing #end# tag)\n"));
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (debugz>=LogLevel_Process)
+		debugaz(__FILE__,__LINE__,_("redirector_log_format compiled into %d columns\n"),NRedirectorFields);
+}
+
+static void parse_log(char *buf,int dfrom,int duntil,const struct ReadLogDataStruct *ReadFilter)
+{
+	char hourbuf[15];
+	char sourcebuf[128], listbuf[128];
 	char full_url[MAX_URL_LEN];
 	const char *url;
 	char UserBuf[MAX_USER_LEN];
 	const char *user;
-	char ip[45];
+	char ipbuf[45];
+	const char *hour;
+	const char *source;
+	const char *list;
+	const char *ip;
+	const char *UserId;
 	char userlabel[MAX_USER_LEN];
 	char IpBuf[MAX_USER_LEN];
 	long long int lmon, lday, lyear;
 	int mon, day, year;
 	int  idata=0;
+	int h,m,sec;
 	bool id_is_ip;
+	struct tm t;
+	char rule[256];
 	struct getwordstruct gwarea;
-	struct getwordstruct gwarea1;
 	struct userinfostruct *uinfo;
 	enum UserProcessError PUser;
 
-	getword_start(&gwarea,buf);
 	if (RedirectorLogFormat[0] != '\0') {
-		getword_start(&gwarea1,RedirectorLogFormat);
-		leks[0]='\0';
-		if (getword(leks,sizeof(leks),&gwarea1,'#')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (too many characters before first tag)\n"));
-			exit(EXIT_FAILURE);
-		}
+		char *field;
+		char *ptr;
+		int i;
+		size_t len;
+
+		if (NRedirectorFields<0) compile_log_format();
 		year=0;
 		mon=0;
 		day=0;
-		hour[0]='\0';
-		source[0]='\0';
-		list[0]='\0';
-		ip[0]='\0';
-		UserBuf[0]='\0';
+		hour="";
+		source="";
+		list="";
+		ip="";
+		UserId="";
 		full_url[0]='\0';
-		while(strcmp(leks,"end") != 0) {
-			if (getword(leks,sizeof(leks),&gwarea1,'#')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (missing # at end of tag)\n"));
-				exit(EXIT_FAILURE);
+		ptr=buf;
+		for (i=0 ; i<NRedirectorFields ; i++) {
+			// cut the column in place
+			field=ptr;
+			if (RedirectorFields[i].Sep) {
+				while (*ptr && *ptr!=RedirectorFields[i].Sep) ptr++;
+				if (*ptr) *ptr++='\0';
+			} else {
+				ptr+=strlen(ptr);
 			}
-			if (getword(sep,sizeof(sep),&gwarea1,'#')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid \"redirector_log_format\" option in your sarg.conf (too many characters in column separator)\n"));
-				exit(EXIT_FAILURE);
+			len=strlen(field);
+			if (len>=MAXLEN) {
+				// the columns were truncated at that length when they were copied into a buffer
+				field[MAXLEN-1]='\0';
+				len=MAXLEN-1;
 			}
-			if (strcmp(leks,"end") != 0) {
-				if (getword_limit(res,sizeof(res),&gwarea,sep[0])<0) {
-					debuga(__FILE__,__LINE__,_("Parsing of tag \"%s\" in redirector log \"%s\" returned no result\n"),leks,wentp);
-					RedirectorErrors++;
-					return;
-				}
-				if (strcmp(leks,"year") == 0) {
-					year=atoi(res);
-				} else if (strcmp(leks,"mon") == 0) {
-					mon=atoi(res);
-				} else if (strcmp(leks,"day") == 0) {
-					day=atoi(res);
-				} else if (strcmp(leks,"hour") == 0) {
-					if (strlen(res)>=sizeof(hour)) {
+			switch (RedirectorFields[i].Tag)
+			{
+				case RDTAG_Ignore:
+					break;
+				case RDTAG_Year:
+					year=atoi(field);
+					break;
+				case RDTAG_Mon:
+					mon=atoi(field);
+					break;
+				case RDTAG_Day:
+					day=atoi(field);
+					break;
+				case RDTAG_Hour:
+					if (len>=sizeof(hourbuf)) {
 						debuga(__FILE__,__LINE__,_("Hour string too long in redirector log file \"%s\"\n"),wentp);
 						RedirectorErrors++;
 						return;
 					}
-					strcpy(hour,res);
-				} else if (strcmp(leks,"source") == 0) {
-					if (strlen(res)>=sizeof(source)) {
+					hour=field;
+					break;
+				case RDTAG_Source:
+					if (len>=sizeof(sourcebuf)) {
 						debuga(__FILE__,__LINE__,_("Banning source name too long in redirector log file \"%s\"\n"),wentp);
 						RedirectorErrors++;
 						return;
 					}
-					strcpy(source,res);
-				} else if (strcmp(leks,"list") == 0) {
-					if (strlen(res)>=sizeof(list)) {
+					source=field;
+					break;
+				case RDTAG_List:
+					if (len>=sizeof(listbuf)) {
 						debuga(__FILE__,__LINE__,_("Banning list name too long in redirector log file \"%s\"\n"),wentp);
 						RedirectorErrors++;
 						return;
 					}
-					strcpy(list,res);
-				} else if (strcmp(leks,"ip") == 0) {
-					if (strlen(res)>=sizeof(ip)) {
+					list=field;
+					break;
+				case RDTAG_Ip:
+					if (len>=sizeof(ipbuf)) {
 						debuga(__FILE__,__LINE__,_("IP address too long in redirector log file \"%s\"\n"),wentp);
 						RedirectorErrors++;
 						return;
 					}
-					strcpy(ip,res);
-				} else if (strcmp(leks,"user") == 0) {
-					if (strlen(res)>=sizeof(UserBuf)) {
+					ip=field;
+					break;
+				case RDTAG_User:
+					if (len>=sizeof(UserBuf)) {
 						debuga(__FILE__,__LINE__,_("User ID too long in redirector log file \"%s\"\n"),wentp);
 						RedirectorErrors++;
 						return;
 					}
-					strcpy(UserBuf,res);
-				} else if (strcmp(leks,"url") == 0) {
+					UserId=field;
+					break;
+				case RDTAG_Url:
 					/*
 					 * Don't worry about the url being truncated as we only keep the host name
 					 * any way...
 					 */
-					safe_strcpy(full_url,res,sizeof(full_url));
-				}
+					safe_strcpy(full_url,field,sizeof(full_url));
+					break;
 			}
 		}
 	} else {
+		getword_start(&gwarea,buf);
 		if (getword_atoll(&lyear,&gwarea,'-')<0 || getword_atoll(&lmon,&gwarea,'-')<0 ||
 				getword_atoll(&lday,&gwarea,' ')<0) {
 			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),wentp);
@@ -151,17 +290,17 @@ static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct Re
 		year=(int)lyear;
 		mon=(int)lmon;
 		day=(int)lday;
-		if (getword(hour,sizeof(hour),&gwarea,' ')<0) {
+		if (getword(hourbuf,sizeof(hourbuf),&gwarea,' ')<0) {
 			debuga(__FILE__,__LINE__,_("Invalid time in file \"%s\"\n"),wentp);
 			RedirectorErrors++;
 			return;
 		}
-		if (getword_skip(MAXLEN,&gwarea,'(')<0 || getword(source,sizeof(source),&gwarea,'/')<0) {
+		if (getword_skip(MAXLEN,&gwarea,'(')<0 || getword(sourcebuf,sizeof(sourcebuf),&gwarea,'/')<0) {
 			debuga(__FILE__,__LINE__,_("Invalid redirected source in file \"%s\"\n"),wentp);
 			RedirectorErrors++;
 			return;
 		}
-		if (getword(list,sizeof(list),&gwarea,'/')<0) {
+		if (getword(listbuf,sizeof(listbuf),&gwarea,'/')<0) {
 			debuga(__FILE__,__LINE__,_("Invalid redirected list in file \"%s\"\n"),wentp);
 			RedirectorErrors++;
 			return;
@@ -171,7 +310,7 @@ static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct Re
 			RedirectorErrors++;
 			return;
 		}
-		if (getword(ip,sizeof(ip),&gwarea,'/')<0) {
+		if (getword(ipbuf,sizeof(ipbuf),&gwarea,'/')<0) {
 			debuga(__FILE__,__LINE__,_("Invalid source IP in file \"%s\"\n"),wentp);
 			RedirectorErrors++;
 			return;
@@ -181,10 +320,21 @@ static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct Re
 			RedirectorErrors++;
 			return;
 		}
+		hour=hourbuf;
+		source=sourcebuf;
+		list=listbuf;
+		ip=ipbuf;
+		UserId=UserBuf;
 	}
 	url=process_url(full_url,false);
 
-	//sprintf(warea,"%04d%02d%02d",year,mon,day);
+	sec=0;
+	if (sscanf(hour,"%d:%d:%d",&h,&m,&sec)<2)
+	{
+		debuga(__FILE__,__LINE__,_("Can't parse time \"%s\" found in \"%s\"\n"),hour,wentp);
+		RedirectorErrors++;
+		return;
+	}
 
 	if (RedirectorFilterOutDate)
 	{
@@ -193,21 +343,15 @@ static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct Re
 			return;
 		if (ReadFilter->StartTime>=0 && ReadFilter->EndTime>=0)
 		{
-			int h,m,hmr;
+			int hmr;
 
-			if (sscanf(hour,"%d:%d",&h,&m)!=2)
-			{
-				debuga(__FILE__,__LINE__,_("Can't parse time \"%s\" found in \"%s\"\n"),hour,wentp);
-				RedirectorErrors++;
-				return;
-			}
 			hmr=h*100+m;
 			if (hmr<ReadFilter->StartTime || hmr>=ReadFilter->EndTime)
 				return;
 		}
 	}
 
-	user=UserBuf;
+	user=UserId;
 	PUser=process_user(&user,ip,&id_is_ip);
 	if (PUser!=USERERR_NoError) return;
 
@@ -223,17 +367,19 @@ static void parse_log(FILE *fp_ou,char *buf,int dfrom,int duntil,const struct Re
 		user_find(userlabel,MAX_USER_LEN, user);
 		userinfo_label(uinfo,userlabel);
 	}
-	fprintf(fp_ou,"%s\t%04d%02d%02d\t%s\t%s\t%s\t",uinfo->id,year,mon,day,hour,ip,url);
 	if (source[0] && list[0])
-		fprintf(fp_ou,"%s/%s\n",source,list);
-	else if (source[0])
-		fprintf(fp_ou,"%s\n",source);
+		snprintf(rule,sizeof(rule),"%s/%s",source,list);
 	else
-		fprintf(fp_ou,"%s\n",list);
+		safe_strcpy(rule,(source[0]) ? source : list,sizeof(rule));
+	computedate(year,mon,day,&t);
+	t.tm_hour=h;
+	t.tm_min=m;
+	t.tm_sec=sec;
+	EventList_AddRule(redirector_events,&t,uinfo->id,ip,url,rule);
 	redirector_count++;
 }
 
-static void read_log(const char *wentp, FILE *fp_ou,int dfrom,int duntil,const struct ReadLogDataStruct *ReadFilter)
+static void read_log(const char *wentp,int dfrom,int duntil,const struct ReadLogDataStruct *ReadFilter)
 {
 	FileObject *fp_in = NULL;
 	char *buf;
@@ -288,7 +434,7 @@ static void read_log(const char *wentp, FILE *fp_ou,int dfrom,int duntil,const s
 	}
 
 	while ((buf=longline_read(fp_in,line)) != NULL) {
-		parse_log(fp_ou,buf,dfrom,duntil,ReadFilter);
+		parse_log(buf,dfrom,duntil,ReadFilter);
 	}
 	if (FileObject_Close(fp_in)) {
 		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),wentp,FileObject_GetLastCloseError());
@@ -301,15 +447,12 @@ static void read_log(const char *wentp, FILE *fp_ou,int dfrom,int duntil,const s
 
 void redirector_log(const struct ReadLogDataStruct *ReadFilter)
 {
-	FILE *fp_ou = NULL, *fp_guard = NULL;
+	FILE *fp_guard = NULL;
 	char buf[MAXLEN];
-	char guard_in[MAXLEN];
 	char logdir[MAXLEN];
 	char user[MAXLEN];
-	char tmp6[MAXLEN];
 	int i;
 	int  y;
-	int cstatus;
 	int dfrom, duntil;
 	char *str;
 	char *str2;
@@ -321,17 +464,13 @@ void redirector_log(const struct ReadLogDataStruct *ReadFilter)
 		return;
 	}
 
-	format_path(__FILE__, __LINE__, guard_in, sizeof(guard_in), "%s/redirector.int_unsort", tmp);
-	if ((fp_ou=fopen(guard_in,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	redirector_events=EventList_Create("redirector",EVENTSORT_UserDateIp);
 
 	getperiod_torange(&period,&dfrom,&duntil);
 
 	if (NRedirectorLogs>0) {
 		for (i=0 ; i<NRedirectorLogs ; i++)
-			read_log(RedirectorLogs[i],fp_ou,dfrom,duntil,ReadFilter);
+			read_log(RedirectorLogs[i],dfrom,duntil,ReadFilter);
 	} else {
 		if (access(SquidGuardConf, R_OK) != 0) {
 			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),SquidGuardConf,strerror(errno));
@@ -385,7 +524,7 @@ void redirector_log(const struct ReadLogDataStruct *ReadFilter)
 					}
 				}
 				wentp[y]=0;
-				read_log(wentp,fp_ou,dfrom,duntil,ReadFilter);
+				read_log(wentp,dfrom,duntil,ReadFilter);
 			}
 		}
 		if (fclose(fp_guard)==EOF) {
@@ -394,10 +533,7 @@ void redirector_log(const struct ReadLogDataStruct *ReadFilter)
 		}
 	}
 
-	if (fp_ou && fclose(fp_ou)==EOF) {
-		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Close(redirector_events);
 
 	if (files_done) {
 		for (y=0; y<nfiles_done; y++)
@@ -405,28 +541,6 @@ void redirector_log(const struct ReadLogDataStruct *ReadFilter)
 		free(files_done);
 	}
 
-	if (redirector_count) {
-		format_path(__FILE__,__LINE__, redirector_sorted, sizeof(redirector_sorted), "%s/redirector.int_log", tmp);
-		if (debug) {
-			debuga(__FILE__,__LINE__,_("Sorting file \"%s\"\n"),redirector_sorted);
-		}
-
-		if (snprintf(tmp6,sizeof(tmp6),"sort -t \"\t\" -k 1,1 -k 2,2 -k 4,4 \"%s\" -o \"%s\"",guard_in, redirector_sorted)>=sizeof(tmp6)) {
-			debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),guard_in,redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		cstatus=system(tmp6);
-		if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-			debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-			debuga(__FILE__,__LINE__,_("sort command: %s\n"),tmp6);
-			exit(EXIT_FAILURE);
-		}
-	}
-
-	if (!KeepTempLog && unlink(guard_in)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),guard_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
 	return;
 }
 
@@ -440,58 +554,42 @@ static void show_ignored_redirector(FILE *fp_ou,int count)
 
 void redirector_report(void)
 {
-	FileObject *fp_in = NULL;
 	FILE *fp_ou = NULL;
 
-	char *buf;
-	char *url;
 	char report[MAXLEN];
-	char ip[45];
-	char rule[255];
 	char oip[45];
-	char user[MAXLEN];
 	char ouser[MAXLEN];
 	char data[15];
-	char hora[15];
 	char ouser2[255];
 	char oname[MAXLEN];
 	bool  z=false;
 	int  count=0;
-	long long int data2;
 	bool new_user;
-	struct getwordstruct gwarea;
 	const struct userinfostruct *uinfo;
 	struct tm t;
-	longline line;
+	struct EventStruct event;
 
 	ouser[0]='\0';
 	ouser2[0]='\0';
 
 	if (!redirector_count) {
 		if (debugz>=LogLevel_Process) {
-			if (redirector_sorted[0])
+			if (redirector_events)
 				debugaz(__FILE__,__LINE__,_("Redirector report not generated because it is empty\n"));
 		}
+		EventList_Destroy(&redirector_events);
 		return;
 	}
 
 	format_path(__FILE__,__LINE__, report, sizeof(report), "%s/redirector.html", outdirname);
 
-	if ((fp_in=FileObject_Open(redirector_sorted))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),redirector_sorted,FileObject_GetLastOpenError());
-		exit(EXIT_FAILURE);
-	}
+	EventList_Sort(redirector_events);
 
-	if ((fp_ou=fopen(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
 
-	if ((line=longline_create())==NULL) {
-		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),redirector_sorted);
-		exit(EXIT_FAILURE);
-	}
-
 	write_html_header(fp_ou,(IndexTree == INDEX_TREE_DATE) ? 3 : 1,_("Redirector report"),HTML_JS_NONE);
 	fputs("<tr><td class=\"header_c\">",fp_ou);
 	fprintf(fp_ou,_("Period: %s"),period.html);
@@ -502,58 +600,32 @@ void redirector_report(void)
 	fputs("<div class=\"report\"><table cellpadding=1 cellspacing=2>\n",fp_ou);
 	fprintf(fp_ou,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("IP/NAME"),_("DATE/TIME"),_("ACCESSED SITE"),_("RULE"));
 
-	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(user,sizeof(user),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid user in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_atoll(&data2,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(hora,sizeof(hora),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid time in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid IP address in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		if (getword_ptr(buf,&url,&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid url in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(rule,sizeof(rule),&gwarea,'\n')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid rule in file \"%s\"\n"),redirector_sorted);
-			exit(EXIT_FAILURE);
-		}
-
-		uinfo=userinfo_find_from_id(user);
+	while (EventList_Read(redirector_events,&event)) {
+		uinfo=userinfo_find_from_id(event.User);
 		if (!uinfo) {
-			debuga(__FILE__,__LINE__,_("Unknown user ID %s in file \"%s\"\n"),user,redirector_sorted);
+			debuga(__FILE__,__LINE__,_("Unknown user ID %s in the redirector report\n"),event.User);
 			exit(EXIT_FAILURE);
 		}
 
-		computedate(data2/10000,(data2/100)%100,data2%100,&t);
+		computedate(event.Year,event.Month,event.Day,&t);
 		strftime(data,sizeof(data),"%x",&t);
 
 		new_user=false;
 		if (!z) {
-			strcpy(ouser,user);
-			strcpy(oip,ip);
-			strcpy(oname,ip);
+			safe_strcpy(ouser,event.User,sizeof(ouser));
+			safe_strcpy(oip,event.Ip,sizeof(oip));
+			safe_strcpy(oname,event.Ip,sizeof(oname));
 			if (Ip2Name && !uinfo->id_is_ip) ip2name(oname,sizeof(oname));
 			z=true;
 			new_user=true;
 		} else {
-			if (strcmp(ouser,user) != 0) {
-				strcpy(ouser,user);
+			if (strcmp(ouser,event.User) != 0) {
+				safe_strcpy(ouser,event.User,sizeof(ouser));
 				new_user=true;
 			}
-			if (strcmp(oip,ip) != 0) {
-				strcpy(oip,ip);
-				strcpy(oname,ip);
+			if (strcmp(oip,event.Ip) != 0) {
+				safe_strcpy(oip,event.Ip,sizeof(oip));
+				safe_strcpy(oname,event.Ip,sizeof(oname));
 				if (Ip2Name && !uinfo->id_is_ip) ip2name(oname,sizeof(oname));
 				new_user=true;
 			}
@@ -573,18 +645,13 @@ void redirector_report(void)
 		}
 
 		if (new_user)
-			fprintf(fp_ou,"<tr><td class=\"data2\">%s</td><td class=\"data2\">%s</td>",uinfo->label,ip);
+			fprintf(fp_ou,"<tr><td class=\"data2\">%s</td><td class=\"data2\">%s</td>",uinfo->label,event.Ip);
 		else
 			fputs("<tr><td class=\"data2\"></td><td class=\"data2\"></td>",fp_ou);
-		fprintf(fp_ou,"<td class=\"data2\">%s-%s</td><td class=\"data2\">",data,hora);
-		output_html_link(fp_ou,url,100);
-		fprintf(fp_ou,"</td><td class=\"data2\">%s</td></tr>\n",rule);
+		fprintf(fp_ou,"<td class=\"data2\">%s-%s</td><td class=\"data2\">",data,event.Time);
+		output_html_link(fp_ou,event.Url,100);
+		fprintf(fp_ou,"</td><td class=\"data2\">%s</td></tr>\n",event.Rule);
 	}
-	if (FileObject_Close(fp_in)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),redirector_sorted,FileObject_GetLastCloseError());
-		exit(EXIT_FAILURE);
-	}
-	longline_destroy(&line);
 
 	if (count>SquidGuardReportLimit && SquidGuardReportLimit>0)
 		show_ignored_redirector(fp_ou,count-SquidGuardReportLimit);
@@ -605,10 +672,7 @@ void redirector_report(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(redirector_sorted)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),redirector_sorted,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Destroy(&redirector_events);
 
 	return;
 }
@@ -123,7 +123,7 @@ void report_day(const struct userinfostruct *uinfo)
 		exit(EXIT_FAILURE);
 	}
 
-	if ((fp_ou=fopen(arqout,"w"))==NULL) {
+	if ((fp_ou=open_html_file(arqout,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arqout,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
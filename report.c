@@ -27,11 +27,18 @@
 #include "include/conf.h"
 #include "include/defs.h"
 #include "include/filelist.h"
+#include "include/stage.h"
 
 //! The global statistics of the whole log read.
 struct globalstatstruct globstat;
 //! \c True to enable the smart filter.
 bool smartfilter=false;
+//! Maximum number of report stages to run concurrently.
+int ReportJobs=1;
+//! \c True to display the time taken by each report stage.
+bool ShowStages=false;
+//! How to write the site, user, time and date report.
+enum TimeDatePageEnum TimeDatePages=TDP_Html;
 
 extern FileListObject UserAgentLog;
 
@@ -39,13 +46,205 @@ extern FileListObject UserAgentLog;
 static FILE *fp_tt=NULL;
 //! The name of the file containing the access time of the site/user.
 static char arqtt[4096]="";
+//! Number of access times written for the current site in the compact data file.
+static int ttrows=0;
+//! The last IP address written in the compact data file.
+static char ttlastip[256];
+//! The last date written in the compact data file.
+static char ttlastday[11];
 
 static FILE *maketmp(const char *user, const char *dirname, int debug);
 static void gravatmp(FILE *fp_ou, const char *oldurl, long long int nacc, long long int nbytes, const char *oldmsg, long long int nelap, long long int incache, long long int oucache);
 static void closett(void);
+static void lazytt_open(const struct userinfostruct *uinfo);
+static void lazytt_site(const char *url);
+static void lazytt_row(const char *ip, const char *day, const char *hour);
+static void write_tt_viewer(const char *sort_field,const char *sort_order);
+/*!
+Create the compact file storing the site, user, time and date data of one user.
+
+The file is a javascript call loaded by the page written by write_tt_viewer().
+The sites are stored in an array with the anchor used by the links of the user's
+report. The access times of a site are packed in one string.
+*/
+static void lazytt_open(const struct userinfostruct *uinfo)
+{
+	format_path(__FILE__, __LINE__, arqtt, sizeof(arqtt), "%s/%s/"TT_DATA_FILE, outdirname, uinfo->filename);
+	if ((fp_tt = fopen(arqtt, "w")) == 0) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arqtt,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fputs("sarg_tt(\"",fp_tt);
+	output_js_string(fp_tt,uinfo->label);
+	fputs("\",[",fp_tt);
+	ttrows=0;
+}
+
+/*!
+Start a new site in the compact data file.
+*/
+static void lazytt_site(const char *url)
+{
+	char siteind[MAX_TRUNCATED_URL];
+
+	url_to_anchor(url,siteind,sizeof(siteind));
+	if (*url==ALIAS_PREFIX) url++;
+	fputs((ttrows>0) ? "\"],\n[\"" : "\n[\"",fp_tt);
+	output_js_string(fp_tt,url);
+	fputs("\",\"",fp_tt);
+	output_js_string(fp_tt,siteind);
+	fputs("\",\"",fp_tt);
+	ttrows=0;
+	ttlastip[0]='\0';
+	ttlastday[0]='\0';
+}
+
+/*!
+Store one access time in the compact data file.
+
+The rows are separated by a semicolon and the columns by a space. The IP address
+and the date are left empty if they are the same as in the previous row of the site.
+*/
+static void lazytt_row(const char *ip, const char *day, const char *hour)
+{
+	if (ttrows>0) fputc(';',fp_tt);
+	if (strcmp(ip,ttlastip)!=0) {
+		output_js_string(fp_tt,ip);
+		safe_strcpy(ttlastip,ip,sizeof(ttlastip));
+	}
+	fputc(' ',fp_tt);
+	if (strcmp(day,ttlastday)!=0) {
+		output_js_string(fp_tt,day);
+		safe_strcpy(ttlastday,day,sizeof(ttlastday));
+	}
+	fputc(' ',fp_tt);
+	output_js_string(fp_tt,hour);
+	ttrows++;
+}
+
+/*!
+Write the page displaying the compact site, user, time and date data of the user
+given in the query string of the URL.
+*/
+static void write_tt_viewer(const char *sort_field,const char *sort_order)
+{
+	FILE *fp_ou;
+	char filename[MAXLEN];
+
+	format_path(__FILE__, __LINE__, filename, sizeof(filename), "%s/"TT_VIEWER_FILE, outdirname);
+	if ((fp_ou=open_html_file(filename,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),filename,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	write_html_header(fp_ou,(IndexTree == INDEX_TREE_DATE) ? 3 : 1,_("Site access report"),HTML_JS_NONE);
+	fprintf(fp_ou,"<tr><td class=\"header_c\">%s:&nbsp;%s</td></tr>\n",_("Period"),period.html);
+	fprintf(fp_ou,"<tr><td class=\"header_c\">%s:&nbsp;<span id=\"tt_user\"></span></td></tr>\n",_("User"));
+	fputs("<tr><td class=\"header_c\">",fp_ou);
+	fprintf(fp_ou,_("Sort:&nbsp;%s, %s"),sort_field,sort_order);
+	fputs("</td></tr>\n",fp_ou);
+	fprintf(fp_ou,"<tr><th class=\"header_c\">%s</th></tr>\n",_("User"));
+	close_html_header(fp_ou);
+
+	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\" id=\"tt\"></table></div>\n",fp_ou);
+	fputs("<script type=\"text/javascript\">\n",fp_ou);
+	fputs("var sarg_tt_text=[\"",fp_ou);
+	output_js_string(fp_ou,_("Accessed site: "));
+	fputs("\",\"",fp_ou);
+	output_js_string(fp_ou,_("IP"));
+	fputs("\",\"",fp_ou);
+	output_js_string(fp_ou,_("DATE"));
+	fputs("\",\"",fp_ou);
+	output_js_string(fp_ou,pgettext("wall clock","TIME"));
+	fputs("\",\"",fp_ou);
+	output_js_string(fp_ou,_("All the sites"));
+	fputs("\"];\n",fp_ou);
+	fputs("var sarg_tt_data=null;\n"
+	      "function sarg_tt_cell(tr,tag,cls,text,span) {\n"
+	      " var c=document.createElement(tag);\n"
+	      " if (cls) c.className=cls;\n"
+	      " if (span) c.colSpan=span;\n"
+	      " if (text) c.appendChild(document.createTextNode(text));\n"
+	      " tr.appendChild(c);\n"
+	      " return(c);\n"
+	      "}\n"
+	      "function sarg_tt_show() {\n"
+	      " var tbl=document.getElementById(\"tt\"),want=location.hash.substring(1),i,j,f,rows,ip,day,tr,c,b,url;\n"
+	      " while (tbl.rows.length>0) tbl.deleteRow(0);\n"
+	      " for (i=0 ; i<sarg_tt_data.length ; i++) {\n"
+	      "  if (want && sarg_tt_data[i][1]!=want) continue;\n"
+	      "  url=sarg_tt_data[i][0];\n"
+	      "  if (url.length>100) url=url.substring(0,100)+\"\\u2026\";\n"
+	      "  tr=tbl.insertRow(-1);\n"
+	      "  tr.className=\"tt\";\n"
+	      "  c=sarg_tt_cell(tr,\"td\",\"\",null,3);\n"
+	      "  b=document.createElement(\"b\");\n"
+	      "  b.appendChild(document.createTextNode(sarg_tt_text[0]));\n"
+	      "  c.appendChild(b);\n"
+	      "  c.appendChild(document.createTextNode(url));\n"
+	      "  tr=tbl.insertRow(-1);\n"
+	      "  for (j=1 ; j<=3 ; j++) sarg_tt_cell(tr,\"th\",\"header_l\",sarg_tt_text[j]);\n"
+	      "  rows=sarg_tt_data[i][2].split(\";\");\n"
+	      "  ip=\"\";\n"
+	      "  day=\"\";\n"
+	      "  for (j=0 ; j<rows.length ; j++) {\n"
+	      "   f=rows[j].split(\" \");\n"
+	      "   if (f[0]) ip=f[0];\n"
+	      "   if (f[1]) day=f[1];\n"
+	      "   tr=tbl.insertRow(-1);\n"
+	      "   sarg_tt_cell(tr,\"td\",\"data2\",ip);\n"
+	      "   sarg_tt_cell(tr,\"td\",\"data\",day);\n"
+	      "   sarg_tt_cell(tr,\"td\",\"data\",f[2]);\n"
+	      "  }\n"
+	      " }\n"
+	      " if (want) {\n"
+	      "  tr=tbl.insertRow(-1);\n"
+	      "  c=sarg_tt_cell(tr,\"td\",\"\",null,3);\n"
+	      "  b=document.createElement(\"a\");\n"
+	      "  b.href=\"#\";\n"
+	      "  b.appendChild(document.createTextNode(sarg_tt_text[4]));\n"
+	      "  c.appendChild(b);\n"
+	      " }\n"
+	      "}\n"
+	      "function sarg_tt(label,sites) {\n"
+	      " document.getElementById(\"tt_user\").appendChild(document.createTextNode(label));\n"
+	      " sarg_tt_data=sites;\n"
+	      " sarg_tt_show();\n"
+	      "}\n"
+	      "window.onhashchange=function() { if (sarg_tt_data) sarg_tt_show(); };\n"
+	      "(function() {\n"
+	      " var m=/[?&]u=([^&#]*)/.exec(location.search),s;\n"
+	      " if (!m) return;\n"
+	      " m=decodeURIComponent(m[1]);\n"
+	      " if (!m || /[\\/\\\\]/.test(m) || m==\"..\") return;\n"
+	      " s=document.createElement(\"script\");\n"
+	      " s.type=\"text/javascript\";\n",fp_ou);
+	fputs(" s.charset=\"",fp_ou);
+	output_js_string(fp_ou,CharSet);
+	fputs("\";\n",fp_ou);
+	fputs(" s.src=encodeURIComponent(m)+\"/"TT_DATA_FILE"\";\n"
+	      " document.body.appendChild(s);\n"
+	      "})();\n"
+	      "</script>\n",fp_ou);
+	fputs("</body>\n</html>\n",fp_ou);
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),filename,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+Purge the temporary data kept in the report directory and record the size of
+the finished directory for the index of the date tree.
+*/
+static void report_finish(void)
+{
+	removetmp(outdirname);
+	if ((IndexTree == INDEX_TREE_DATE) && (IndexFields & INDEXFIELDS_DIRSIZE)!=0)
+		dir_size_record(outdirname);
+}
+
 static void gravaporuser(const struct userinfostruct *uinfo, const char *dirname, const char *url, const char *ip, const char *data, const char *hora, long long int tam, long long int elap);
 static void gravager(FILE *fp_gen,const char *filename, const struct userinfostruct *uinfo, long long int nacc, const char *url, long long int nbytes, const char *ip, const char *hora, const char *dia, long long int nelap, long long int incache, long long int oucache);
-static void grava_SmartFilter(const char *dirname, const char *user, const char *ip, const char *data, const char *hora, const char *url, const char *smart);
 
 void gerarel(const struct ReadLogDataStruct *ReadFilter)
 {
@@ -76,6 +275,7 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 	long long int incache=0;
 	long long int oucache=0;
 	long long int accbytes, accelap;
+	long long int accrecords;
 	char *str;
 	userscan uscan;
 	const char *sort_field;
@@ -90,6 +290,7 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 	longline line;
 	struct userinfostruct *uinfo;
 	DayObject daystat;
+	StageListObject stages;
 
 	ipantes[0]='\0';
 	smartfilter=false;
@@ -202,10 +403,16 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 				debuga(__FILE__,__LINE__,_("Invalid smart info in file \"%s\"\n"),tmp3);
 				exit(EXIT_FAILURE);
 			}
+			// a line read from the daily totals stands for several records
+			accrecords=1;
+			if (gwarea.current[0]=='\t' && (getword_skip(1,&gwarea,'\t')<0 || getword_atoll(&accrecords,&gwarea,'\t')<0)) {
+				debuga(__FILE__,__LINE__,_("Invalid number of records in file \"%s\"\n"),tmp3);
+				exit(EXIT_FAILURE);
+			}
 
 			if (accsmart[0] != '\0') {
 				smartfilter=true;
-				grava_SmartFilter(tmp,uinfo->id,accip,accdia,acchora,accurl,accsmart);
+				smartfilter_write(uinfo->id,accip,accdia,acchora,accurl,accsmart);
 			}
 
 			if (Ip2Name) {
@@ -255,7 +462,7 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 					oucache=0;
 				}
 			}
-			nacc++;
+			nacc+=accrecords;
 			nbytes+=accbytes;
 			nelap+=accelap;
 
@@ -267,45 +474,55 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 					format_path(__FILE__, __LINE__, arqtt, sizeof(arqtt), "%s/%s", outdirname, uinfo->filename);
 					if (access(arqtt, R_OK) != 0)
 						my_mkdir(arqtt);
-					format_path(__FILE__, __LINE__, arqtt, sizeof(arqtt), "%s/%s/tt.html", outdirname, uinfo->filename);
-					if ((fp_tt = fopen(arqtt, "w")) == 0) {
-						debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arqtt,strerror(errno));
-						exit(EXIT_FAILURE);
+					if (TimeDatePages==TDP_Lazy) {
+						lazytt_open(uinfo);
+					} else {
+						format_path(__FILE__, __LINE__, arqtt, sizeof(arqtt), "%s/%s/tt.html", outdirname, uinfo->filename);
+						if ((fp_tt = open_html_file(arqtt,"w")) == 0) {
+							debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arqtt,strerror(errno));
+							exit(EXIT_FAILURE);
+						}
+
+						/*
+						if (Privacy)
+							sprintf(httplink,"<font size=%s color=%s><href=http://%s>%s",FontSize,PrivacyStringColor,PrivacyString,PrivacyString);
+						else
+							sprintf(httplink,"<font size=%s><a href=\"http://%s\">%s</a>",FontSize,accurl,accurl);
+						*/
+
+						write_html_header(fp_tt,(IndexTree == INDEX_TREE_DATE) ? 4 : 2,_("Site access report"),HTML_JS_NONE);
+						fprintf(fp_tt,"<tr><td class=\"header_c\">%s:&nbsp;%s</td></tr>\n",_("Period"),period.html);
+						fprintf(fp_tt,"<tr><td class=\"header_c\">%s:&nbsp;%s</td></tr>\n",_("User"),uinfo->label);
+						fputs("<tr><td class=\"header_c\">",fp_tt);
+						fprintf(fp_tt,_("Sort:&nbsp;%s, %s"),sort_field,sort_order);
+						fputs("</td></tr>\n",fp_tt);
+						fprintf(fp_tt,"<tr><th class=\"header_c\">%s</th></tr>\n",_("User"));
+						close_html_header(fp_tt);
+
+						fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\">\n",fp_tt);
 					}
 					ttopen=1;
-
-					/*
-					if (Privacy)
-						sprintf(httplink,"<font size=%s color=%s><href=http://%s>%s",FontSize,PrivacyStringColor,PrivacyString,PrivacyString);
-					else
-						sprintf(httplink,"<font size=%s><a href=\"http://%s\">%s</a>",FontSize,accurl,accurl);
-					*/
-
-					write_html_header(fp_tt,(IndexTree == INDEX_TREE_DATE) ? 4 : 2,_("Site access report"),HTML_JS_NONE);
-					fprintf(fp_tt,"<tr><td class=\"header_c\">%s:&nbsp;%s</td></tr>\n",_("Period"),period.html);
-					fprintf(fp_tt,"<tr><td class=\"header_c\">%s:&nbsp;%s</td></tr>\n",_("User"),uinfo->label);
-					fputs("<tr><td class=\"header_c\">",fp_tt);
-					fprintf(fp_tt,_("Sort:&nbsp;%s, %s"),sort_field,sort_order);
-					fputs("</td></tr>\n",fp_tt);
-					fprintf(fp_tt,"<tr><th class=\"header_c\">%s</th></tr>\n",_("User"));
-					close_html_header(fp_tt);
-
-					fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"2\">\n",fp_tt);
-				}
-				if (!oldurltt || strcmp(oldurltt,accurl)) {
-					const char *url=accurl;
-					if (*url==ALIAS_PREFIX) url++;
-					url_to_anchor(accurl,siteind,sizeof(siteind));
-					fprintf(fp_tt,"<tr class=\"tt\"><td colspan=\"3\"><a name=\"%s\">",siteind);
-					fprintf(fp_tt,"<b>%s</b>",_("Accessed site: "));
-					output_html_string(fp_tt,url,100);
-					fputs("</a></td></tr>\n",fp_tt);
-					fprintf(fp_tt,"<tr><th class=\"header_l\">%s</th>",_("IP"));
-					fprintf(fp_tt,"<th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("DATE"),pgettext("wall clock","TIME"));
 				}
+				if (TimeDatePages==TDP_Lazy) {
+					if (!oldurltt || strcmp(oldurltt,accurl))
+						lazytt_site(accurl);
+					lazytt_row(accip,accdia,acchora);
+				} else {
+					if (!oldurltt || strcmp(oldurltt,accurl)) {
+						const char *url=accurl;
+						if (*url==ALIAS_PREFIX) url++;
+						url_to_anchor(accurl,siteind,sizeof(siteind));
+						fprintf(fp_tt,"<tr class=\"tt\"><td colspan=\"3\"><a name=\"%s\">",siteind);
+						fprintf(fp_tt,"<b>%s</b>",_("Accessed site: "));
+						output_html_string(fp_tt,url,100);
+						fputs("</a></td></tr>\n",fp_tt);
+						fprintf(fp_tt,"<tr><th class=\"header_l\">%s</th>",_("IP"));
+						fprintf(fp_tt,"<th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("DATE"),pgettext("wall clock","TIME"));
+					}
 
-				fprintf(fp_tt,"<tr><td class=\"data2\">%s</td>",accip);
-				fprintf(fp_tt,"<td class=\"data\">%s</td><td class=\"data\">%s</td></tr>\n",accdia,acchora);
+					fprintf(fp_tt,"<tr><td class=\"data2\">%s</td>",accip);
+					fprintf(fp_tt,"<td class=\"data\">%s</td><td class=\"data\">%s</td></tr>\n",accdia,acchora);
+				}
 
 				url_len=strlen(accurl);
 				if (!oldurltt || url_len>=ourltt_size) {
@@ -382,6 +599,9 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 	userinfo_stopscan(uscan);
 	day_cleanup(daystat);
 
+	if ((ReportType & REPORT_TYPE_SITE_USER_TIME_DATE) != 0 && TimeDatePages==TDP_Lazy && !indexonly)
+		write_tt_viewer(sort_field,sort_order);
+
 	totalger(fp_gen,wdirname);
 	if (fclose(fp_gen)==EOF) {
 		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),wdirname,strerror(errno));
@@ -398,48 +618,58 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 			redirector_log(ReadFilter);
 		}
 
-		topuser();
+		stages=Stage_Create();
+		Stage_Add(stages,"topuser",topuser,"sarg-general","top,index.html,sarg-users,topuser_list",STAGEF_MAIN_PROCESS);
 
 		if (!indexonly) {
 			if ((ReportType & REPORT_TYPE_DOWNLOADS) != 0)
-				download_report();
+				Stage_Add(stages,"download",download_report,"download,topuser_list","download.html",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("Downloaded files report not requested in report_type\n"));
 
 			if ((ReportType & REPORT_TYPE_TOPSITES) != 0)
-				topsites();
+				Stage_Add(stages,"topsites",topsites,"sarg-general","sarg-sites,sarg-general2,sarg-general3,topsites.html",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("Top sites report not requested in report_type\n"));
 
 			if ((ReportType & REPORT_TYPE_SITES_USERS) != 0)
-				siteuser();
+				Stage_Add(stages,"siteuser",siteuser,"sarg-general,topuser_list","sarg-sites,sarg-general2,siteuser.html",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("Sites & users report not requested in report_type\n"));
 
 			if ((ReportType & REPORT_TYPE_DENIED) != 0)
-				gen_denied_report();
+				Stage_Add(stages,"denied",gen_denied_report,"denied,topuser_list","denied.html",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("Denied accesses report not requested in report_type\n"));
 
 			if ((ReportType & REPORT_TYPE_AUTH_FAILURES) != 0)
-				authfail_report();
+				Stage_Add(stages,"authfail",authfail_report,"authfail,topuser_list","authfail.html",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("Authentication failures report not requested in report_type\n"));
 
-			if (smartfilter) smartfilter_report();
+			if (smartfilter)
+				Stage_Add(stages,"smartfilter",smartfilter_report,"smartfilter,topuser_list","sarg-sites,smartfilter.html,denied_user",0);
 
 			if (DansGuardianConf[0] != '\0')
-				dansguardian_report();
+				Stage_Add(stages,"dansguardian",dansguardian_report,"dansguardian","dansguardian.html",0);
 
-			redirector_report();
+			Stage_Add(stages,"redirector",redirector_report,"redirector","redirector.html",0);
 
 			if ((ReportType & REPORT_TYPE_USERS_SITES) != 0)
-				htmlrel();
+				Stage_Add(stages,"htmlrel",htmlrel,"topuser_list,htmlrel,denied_user","user_pages",0);
 			else if (debugz>=LogLevel_Process)
 				debugaz(__FILE__,__LINE__,_("User's detailed report not requested in report_type\n"));
 		}
 
-		make_index();
+		// the size of the report is recorded once every file is written
+		if (!indexonly)
+			Stage_Add(stages,"finish",report_finish,"*","sarg-general,sarg-size",STAGEF_MAIN_PROCESS);
+		// the index lists what the other stages produced
+		Stage_Add(stages,"index",make_index,"*","index",STAGEF_MAIN_PROCESS);
+
+		Stage_Run(stages,ReportJobs);
+		if (ShowStages) Stage_Summary(stages);
+		Stage_Destroy(&stages);
 
 		if (SuccessfulMsg) debuga(__FILE__,__LINE__,_("Successful report generated on %s\n"),outdirname);
 	} else {
@@ -451,7 +681,7 @@ void gerarel(const struct ReadLogDataStruct *ReadFilter)
 
 	if (indexonly) index_only(outdirname, debug);
 
-	removetmp(outdirname);
+	if (email[0] != '\0' || indexonly) removetmp(outdirname);
 	return;
 }
 
@@ -495,8 +725,13 @@ static void closett(void)
 	ttopen=0;
 
 	if (fp_tt) {
-		fputs("</table>\n</div>\n",fp_tt);
-		fputs("</body>\n</html>\n",fp_tt);
+		if (TimeDatePages==TDP_Lazy) {
+			if (ttrows>0) fputs("\"]",fp_tt);
+			fputs("\n]);\n",fp_tt);
+		} else {
+			fputs("</table>\n</div>\n",fp_tt);
+			fputs("</body>\n</html>\n",fp_tt);
+		}
 		if (fclose(fp_tt)==EOF) {
 			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),arqtt,strerror(errno));
 			exit(EXIT_FAILURE);
@@ -794,30 +1029,3 @@ int ger_read(char *buffer,struct generalitemstruct *item,const char *filename)
 	}
 	return(0);
 }
-
-static void grava_SmartFilter(const char *dirname, const char *user, const char *ip, const char *data, const char *hora, const char *url, const char *smart)
-{
-	FILE *fp_ou;
-	char wdirname[MAXLEN];
-
-	if (snprintf(wdirname,sizeof(wdirname),"%s/smartfilter.int_unsort",dirname)>=sizeof(wdirname)) {
-		debuga(__FILE__,__LINE__,_("Path too long: "));
-		debuga_more("%s/smartfilter.int_unsort\n",dirname);
-		exit(EXIT_FAILURE);
-	}
-
-	if ((fp_ou=MY_FOPEN(wdirname,"a"))==NULL){
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),wdirname,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	fprintf(fp_ou,"%s\t%s\t%s\t%s\t%s\t%s\n",user,data,hora,ip,url,smart);
-	fputs("</body>\n</html>\n",fp_tt);
-
-	if (fclose(fp_ou)==EOF) {
-		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),wdirname,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
-	return;
-}
@@ -26,74 +26,70 @@
 
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/eventlist.h"
+
+//! The accesses blocked by SmartFilter.
+static EventListObject smartfilter_events=NULL;
+
+/*!
+Store one access blocked by SmartFilter.
+
+\param user The ID of the user.
+\param ip The IP address of the user.
+\param data The date of the access formatted as dd/mm/yyyy.
+\param hora The time of the access formatted as HH:MM:SS.
+\param url The URL accessed by the user.
+\param smart The SmartFilter category that blocked the access.
+*/
+void smartfilter_write(const char *user, const char *ip, const char *data, const char *hora, const char *url, const char *smart)
+{
+	int day, month, year;
+	struct tm t;
+
+	if (sscanf(data,"%d/%d/%d",&day,&month,&year)!=3) {
+		debuga(__FILE__,__LINE__,_("Invalid date \"%s\" in the SmartFilter entries\n"),data);
+		exit(EXIT_FAILURE);
+	}
+	computedate(year,month,day,&t);
+	if (sscanf(hora,"%d:%d:%d",&t.tm_hour,&t.tm_min,&t.tm_sec)!=3) {
+		debuga(__FILE__,__LINE__,_("Invalid time \"%s\" in the SmartFilter entries\n"),hora);
+		exit(EXIT_FAILURE);
+	}
+	if (!smartfilter_events)
+		smartfilter_events=EventList_Create("smartfilter",EVENTSORT_UserDateIp);
+	EventList_AddRule(smartfilter_events,&t,user,ip,url,smart);
+}
 
 void smartfilter_report(void)
 {
-	FILE *fp_in = NULL, *fp_ou = NULL, *fp_user = NULL;
+	FILE *fp_ou = NULL, *fp_user = NULL;
 
-	char buf[MAXLEN];
-	char url[MAXLEN];
-	char csort[255];
-	char smart_in[MAXLEN];
-	char smart_ou[MAXLEN];
 	char sites[MAXLEN];
 	char report[MAXLEN];
-	char ip[MAXLEN];
-	char user[MAXLEN];
 	char ouser[MAXLEN];
 	char data[15];
-	char hora[15];
-	char smartcat[256];
 	char ftime[128];
 	char smartuser[MAXLEN];
-	int cstatus;
-	struct getwordstruct gwarea;
 	const struct userinfostruct *uinfo;
+	struct EventStruct event;
 
 	ouser[0]='\0';
 
-	if (snprintf(smart_in,sizeof(smart_in),"%s/smartfilter.int_unsort",tmp)>=sizeof(smart_in)) {
-		debuga(__FILE__,__LINE__,_("Path too long: "));
-		debuga_more("%s/smartfilter.int_unsort\n",tmp);
-		exit(EXIT_FAILURE);
-	}
+	if (!smartfilter_events) return;
 	if (snprintf(sites,sizeof(sites),"%s/sarg-sites",outdirname)>=sizeof(sites)) {
 		debuga(__FILE__,__LINE__,_("Path too long: "));
 		debuga_more("%s/sarg-sites\n",outdirname);
 		exit(EXIT_FAILURE);
 	}
-	if (snprintf(smart_ou,sizeof(smart_ou),"%s/smartfilter.int_log",tmp)>=sizeof(smart_ou)) {
-		debuga(__FILE__,__LINE__,_("Path too long: "));
-		debuga_more("%s/smartfilter.int_log\n",tmp);
-		exit(EXIT_FAILURE);
-	}
 	if (snprintf(report,sizeof(report),"%s/smartfilter.html",outdirname)>=sizeof(report)) {
 		debuga(__FILE__,__LINE__,_("Path too long: "));
 		debuga_more("%s/smartfilter.html\n",outdirname);
 		exit(EXIT_FAILURE);
 	}
 
-	if (snprintf(csort,sizeof(csort),"sort -n -t \"\t\" -k 1,1 -k 2,2 -k 3,3 -o \"%s\" \"%s\"",smart_ou,smart_in)>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Cannot build the sort command to sort file \"%s\"\n"),smart_in);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if ((fp_in=fopen(smart_ou,"r"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),smart_ou,strerror(errno));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if (!KeepTempLog && unlink(smart_in)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),smart_in,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Sort(smartfilter_events);
 
-	if ((fp_ou=fopen(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -118,22 +114,15 @@ void smartfilter_report(void)
 	fputs("<tr><td></td></tr>\n",fp_ou);
 	fprintf(fp_ou,"<tr><th bgcolor=%s><font size=\"%s\">%s</font></th><th bgcolor=\"%s\"><font size=\"%s\">%s</font></th><th bgcolor=\"%s\"><font size=\"%s\">%s</font></th><th bgcolor=\"%s\"><font size=\"%s\">%s</font></th><th bgcolor=\"%s\"><font size=\"%s\">%s</font></th></tr>\n",HeaderBgColor,FontSize,_("USERID"),HeaderBgColor,FontSize,_("IP/NAME"),HeaderBgColor,FontSize,_("DATE/TIME"),HeaderBgColor,FontSize,_("ACCESSED SITE"),HeaderBgColor,FontSize,_("SMARTFILTER"));
 
-	while(fgets(buf,sizeof(buf),fp_in)!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(user,sizeof(user),&gwarea,'\t')<0 || getword(data,sizeof(data),&gwarea,'\t')<0 ||
-		    getword(hora,sizeof(hora),&gwarea,'\t')<0 || getword(ip,sizeof(ip),&gwarea,'\t')<0 ||
-		    getword(url,sizeof(url),&gwarea,'\t')<0 || getword(smartcat,sizeof(smartcat),&gwarea,'\n')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),smart_ou);
-			exit(EXIT_FAILURE);
-		}
-
-		uinfo=userinfo_find_from_id(user);
+	while (EventList_Read(smartfilter_events,&event)) {
+		uinfo=userinfo_find_from_id(event.User);
 		if (!uinfo) {
-			debuga(__FILE__,__LINE__,_("Unknown user ID %s in file \"%s\"\n"),user,smart_ou);
+			debuga(__FILE__,__LINE__,_("Unknown user ID %s in the SmartFilter report\n"),event.User);
 			exit(EXIT_FAILURE);
 		}
-		if (strcmp(ouser,user) != 0) {
-			strcpy(ouser,user);
+		snprintf(data,sizeof(data),"%02d/%02d/%04d",event.Day,event.Month,event.Year);
+		if (strcmp(ouser,event.User) != 0) {
+			safe_strcpy(ouser,event.User,sizeof(ouser));
 			format_path(__FILE__, __LINE__, smartuser, sizeof(smartuser), "%s/denied_%s.html", outdirname, uinfo->filename);
 			if (fp_user) {
 				fputs("</table>\n",fp_user);
@@ -150,7 +139,7 @@ void smartfilter_report(void)
 				}
 				fp_user=NULL;
 			}
-			if ((fp_user = fopen(smartuser, "a")) == 0) {
+			if ((fp_user = open_html_file(smartuser,"a")) == 0) {
 				debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),smartuser,strerror(errno));
 				exit(EXIT_FAILURE);
 			}
@@ -189,9 +178,9 @@ void smartfilter_report(void)
 			fputs("<tr><td></td></tr>\n",fp_user);
 			fprintf(fp_user,"<tr><th bgcolor=%s><font size=%s>%s</font></th><th bgcolor=%s><font size=%s>%s</font></th><th bgcolor=%s><font size=%s>%s</font></th><th bgcolor=%s><font size=%s>%s</font></th><th bgcolor=%s><font size=%s>%s</font></th></tr>\n",HeaderBgColor,FontSize,_("USERID"),HeaderBgColor,FontSize,_("IP/NAME"),HeaderBgColor,FontSize,_("DATE/TIME"),HeaderBgColor,FontSize,_("ACCESSED SITE"),HeaderBgColor,FontSize,_("SMARTFILTER"));
 		}
-		fprintf(fp_user,"<tr><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s-%s</font></td><td bgcolor=%s><font size=%s>%s</font></td><td bgcolor=%s><font size=%s>%s</font></td></th>\n",TxBgColor,FontSize,uinfo->label,TxBgColor,FontSize,ip,TxBgColor,FontSize,data,hora,TxBgColor,FontSize,url,TxBgColor,FontSize,smartcat);
+		fprintf(fp_user,"<tr><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s-%s</font></td><td bgcolor=%s><font size=%s>%s</font></td><td bgcolor=%s><font size=%s>%s</font></td></th>\n",TxBgColor,FontSize,uinfo->label,TxBgColor,FontSize,event.Ip,TxBgColor,FontSize,data,event.Time,TxBgColor,FontSize,event.Url,TxBgColor,FontSize,event.Rule);
 
-		fprintf(fp_ou,"<tr><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s-%s</font></td><td bgcolor=%s><font size=%s>%s</font></td><td bgcolor=%s><font size=%s>%s</font></td></th>\n",TxBgColor,FontSize,uinfo->label,TxBgColor,FontSize,ip,TxBgColor,FontSize,data,hora,TxBgColor,FontSize,url,TxBgColor,FontSize,smartcat);
+		fprintf(fp_ou,"<tr><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s</font></td><td bgcolor=%s align=center><font size=%s>%s-%s</font></td><td bgcolor=%s><font size=%s>%s</font></td><td bgcolor=%s><font size=%s>%s</font></td></th>\n",TxBgColor,FontSize,uinfo->label,TxBgColor,FontSize,event.Ip,TxBgColor,FontSize,data,event.Time,TxBgColor,FontSize,event.Url,TxBgColor,FontSize,event.Rule);
 	}
 
 	fputs("</table>\n",fp_ou);
@@ -224,10 +213,7 @@ void smartfilter_report(void)
 		}
 	}
 
-	if (!KeepTempLog && unlink(smart_ou)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),smart_ou,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	EventList_Destroy(&smartfilter_events);
 
 	return;
 }
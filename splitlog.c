@@ -24,136 +24,586 @@
  *
  */
 
+/*!\file
+\brief Extract a date range from a squid log file and write it into separate files.
+
+The lines are written to one file per day. The files are kept open so that
+the lines logged slightly out of order around midnight don't close and
+reopen the files. A large uncompressed log is split by several processes
+each reading a part of the log.
+*/
+
 #include "include/conf.h"
 #include "include/defs.h"
+#include "include/stage.h"
 
-/*
-Extract a date range from a squid log file and write it into a separate file.
+//! Maximum number of daily files kept open at the same time.
+#define SPLIT_MAX_OPEN 32
+//! Size of the buffer of the uncompressed daily files.
+#define SPLIT_BUFFER_SIZE (64*1024)
+//! Smallest part of a log read by one process when the log is split by several processes.
+#define SPLIT_MIN_PART (16LL*1024LL*1024LL)
 
-It can optionally convert the date in human readable format.
+extern int ReportJobs;
 
-The output can be split by day into separate files.
+//! How to compress the daily files.
+enum StreamCompressionEnum SplitCompression=STREAMCOMP_None;
 
-\param arq The squid log file to split.
-\param df The date format if the date is to be converted in human readable form. Only the first
-character is taken into account. It can be 'e' for European date format or anything else for
-US date format.
-\param ReadFilter How to filter out log data.
-\param convert \c True if the date must be converted into human readable form.
-\param splitprefix If not empty, the output file is written in separate files (one for each day) and
-the files are named after the day they contain prefixed with the string contained in this variable.
-*/
-void splitlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilter, int convert, const char *splitprefix)
+/*!
+ * \brief One daily output file.
+ */
+struct SplitDayStruct
 {
-	FileObject *fp_in;
-	FILE *fp_ou=NULL;
-	char *buf;
-	char data[30];
-	char dia[11];
-	char output_file[MAXLEN];
-	time_t tt;
-	time_t min_tt;
-	time_t max_tt=0;
-	int idata=0;
-	int autosplit=0;
-	int output_prefix_len=0;
-	int prev_year=0, prev_month=0, prev_day=0;
-	struct tm *t;
-	struct getwordstruct gwarea;
-	longline line;
+	//! The day stored in the file as YYYYMMDD.
+	int Date;
+	//! The file or NULL if it is closed.
+	FILE *File;
+	//! When the file was last written to. The least recently used file is closed first.
+	unsigned long int LastUse;
+};
 
-	if (splitprefix[0]!='\0') {
-		// '/' + '-YYYY-mm-dd' + '\0' == 13
-		output_prefix_len=snprintf(output_file,sizeof(output_file)-12,"%s%s",outdir,splitprefix);
-		if (output_prefix_len>=sizeof(output_file)-12) {
-			debuga(__FILE__,__LINE__,_("Path too long: "));
-			debuga_more("%s%s-YYYY-mm-dd\n",outdir,splitprefix);
+//! The daily files written so far.
+static struct SplitDayStruct *SplitDays=NULL;
+//! The number of daily files in SplitDays.
+static int SplitNDays=0;
+//! The number of entries allocated in SplitDays.
+static int SplitNAlloc=0;
+//! The number of open daily files.
+static int SplitNOpen=0;
+//! Counter incremented every time a daily file is written to.
+static unsigned long int SplitClock=0;
+//! The index of the daily file written last.
+static int SplitLastDay=-1;
+//! The last day converted to the local time.
+static struct LocalTimeCacheStruct SplitTime;
+//! The number of the process reading a part of the log or -1 in the main process.
+static int SplitPart=-1;
+//! The offset of the first byte of each part of a log split by several processes.
+static long long int SplitPartStart[MAX_STAGES];
+//! The offset of the byte following the last byte of each part of the log.
+static long long int SplitPartEnd[MAX_STAGES];
+//! The log being split.
+static const char *SplitFile;
+//! The date format if the date is converted.
+static char SplitDateFormat;
+//! How to filter out log data.
+static const struct ReadLogDataStruct *SplitFilter;
+//! \c True to convert the date in human readable form.
+static int SplitConvert;
+//! The path and prefix of the daily files or an empty string to write to stdout.
+static char SplitPrefix[MAXLEN];
+
+/*!
+ * Get the name of a daily file.
+ *
+ * \param Buffer The buffer to store the file name into.
+ * \param BufferSize The size of the buffer.
+ * \param Date The day stored in the file as YYYYMMDD.
+ * \param Part The number of the process writing the file or -1 for the
+ * file of the main process.
+ */
+static void split_day_name(char *Buffer,int BufferSize,int Date,int Part)
+{
+	if (Part<0)
+		format_path(__FILE__, __LINE__, Buffer, BufferSize, "%s-%04d-%02d-%02d%s", SplitPrefix, Date/10000, (Date/100)%100, Date%100, compressed_file_suffix(SplitCompression));
+	else
+		format_path(__FILE__, __LINE__, Buffer, BufferSize, "%s-%04d-%02d-%02d%s.part%d", SplitPrefix, Date/10000, (Date/100)%100, Date%100, compressed_file_suffix(SplitCompression), Part);
+}
+
+/*!
+ * Get the name of the file listing the days written by a process
+ * reading a part of the log.
+ *
+ * \param Buffer The buffer to store the file name into.
+ * \param BufferSize The size of the buffer.
+ * \param Part The number of the process.
+ */
+static void split_list_name(char *Buffer,int BufferSize,int Part)
+{
+	format_path(__FILE__, __LINE__, Buffer, BufferSize, "%s.part%d", SplitPrefix, Part);
+}
+
+/*!
+ * Close a daily file.
+ *
+ * \param Day The daily file to close. Nothing is done if the file is not open.
+ */
+static void split_close_day(struct SplitDayStruct *Day)
+{
+	char FileName[MAXLEN];
+
+	if (!Day->File) return;
+	if (fclose(Day->File)==EOF) {
+		split_day_name(FileName,sizeof(FileName),Day->Date,SplitPart);
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),FileName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	Day->File=NULL;
+	SplitNOpen--;
+}
+
+/*!
+ * Find a day in the list of the daily files.
+ *
+ * \param Date The day as YYYYMMDD.
+ * \param Created Set to \c true if the day was seen for the first time.
+ *
+ * \return The index of the day in SplitDays.
+ */
+static int split_find_day(int Date,bool *Created)
+{
+	int i;
+	struct SplitDayStruct *Days;
+
+	*Created=false;
+	if (SplitLastDay>=0 && SplitDays[SplitLastDay].Date==Date)
+		return(SplitLastDay);
+	for (i=0 ; i<SplitNDays ; i++)
+		if (SplitDays[i].Date==Date) return(i);
+
+	if (SplitNDays>=SplitNAlloc) {
+		SplitNAlloc+=32;
+		Days=(struct SplitDayStruct *)realloc(SplitDays,SplitNAlloc*sizeof(*Days));
+		if (!Days) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the daily files of the split log\n"));
 			exit(EXIT_FAILURE);
 		}
-		autosplit=1;
-	} else {
-		fp_ou=stdout;
+		SplitDays=Days;
 	}
+	SplitDays[SplitNDays].Date=Date;
+	SplitDays[SplitNDays].File=NULL;
+	SplitDays[SplitNDays].LastUse=0;
+	*Created=true;
+	return(SplitNDays++);
+}
 
-	if (arq[0] == '\0')
-		arq="/var/log/squid/access.log";
+/*!
+ * Get the daily file to write a line of the given day to.
+ *
+ * \param Date The day as YYYYMMDD.
+ *
+ * \return The file to write to.
+ */
+static FILE *split_day_file(int Date)
+{
+	struct SplitDayStruct *Day;
+	char FileName[MAXLEN];
+	bool Created;
+	int Oldest;
+	int i;
 
-	if ((fp_in=decomp(arq))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
-		exit(EXIT_FAILURE);
+	SplitLastDay=split_find_day(Date,&Created);
+	Day=SplitDays+SplitLastDay;
+	if (!Day->File) {
+		if (SplitNOpen>=SPLIT_MAX_OPEN) {
+			Oldest=-1;
+			for (i=0 ; i<SplitNDays ; i++)
+				if (SplitDays[i].File && (Oldest<0 || SplitDays[i].LastUse<SplitDays[Oldest].LastUse))
+					Oldest=i;
+			split_close_day(SplitDays+Oldest);
+		}
+		split_day_name(FileName,sizeof(FileName),Date,SplitPart);
+		/*
+		The file is created if the date is seen for the first time. The idea is to create the files
+		from scratch if the split is started a second time. A file closed to limit the number of open
+		files is reopened in append mode.
+		*/
+		if ((Day->File=open_compressed_file(FileName,SplitCompression,!Created))==NULL)
+			exit(EXIT_FAILURE);
+		if (SplitCompression==STREAMCOMP_None)
+			setvbuf(Day->File,NULL,_IOFBF,SPLIT_BUFFER_SIZE);
+		SplitNOpen++;
 	}
+	Day->LastUse=++SplitClock;
+	return(Day->File);
+}
+
+/*!
+ * Close all the daily files. They are reopened in append mode if more
+ * lines are written to them.
+ */
+static void split_close_all(void)
+{
+	int i;
+
+	for (i=0 ; i<SplitNDays ; i++)
+		split_close_day(SplitDays+i);
+}
+
+/*!
+ * Read the lines of a log and write them to the output files.
+ *
+ * \param fp_in The log to read.
+ * \param arq The name of the log for the messages.
+ */
+static void split_read(FileObject *fp_in,const char *arq)
+{
+	char *buf;
+	char *Field;
+	char *Rest;
+	char dia[11];
+	time_t tt;
+	struct tm t;
+	FILE *fp_ou=stdout;
+	longline line;
 
 	if ((line=longline_create())==NULL) {
 		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),arq);
 		exit(EXIT_FAILURE);
 	}
-	time(&min_tt);
 
 	while((buf=longline_read(fp_in,line))!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(data,sizeof(data),&gwarea,' ')<0) {
+		// the date is the number of seconds since the epoch with the milliseconds after a dot
+		tt=0;
+		for (Field=buf ; (unsigned char)(*Field-'0')<=9 ; Field++)
+			tt=tt*10+(*Field-'0');
+		while (*Field && *Field!=' ') Field++;
+		if (Field-buf>=30) {
 			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),arq);
 			exit(EXIT_FAILURE);
 		}
-		tt=atoi(data);
-		t=localtime(&tt);
+		localtime_cached(&SplitTime,tt,&t);
 
-		if (ReadFilter->DateRange[0])
+		if (SplitFilter->DateRange[0])
 		{
-			idata=(t->tm_year+1900)*10000+(t->tm_mon+1)*100+t->tm_mday;
-			if (idata<ReadFilter->StartDate || idata>ReadFilter->EndDate)
+			if (SplitTime.Date<SplitFilter->StartDate || SplitTime.Date>SplitFilter->EndDate)
 				continue;
 		}
-		if (ReadFilter->StartTime>=0 || ReadFilter->EndTime>=0)
+		if (SplitFilter->StartTime>=0 || SplitFilter->EndTime>=0)
 		{
-			int hmr=t->tm_hour*100+t->tm_min;
-			if (hmr<ReadFilter->StartTime || hmr>=ReadFilter->EndTime)
+			int hmr=t.tm_hour*100+t.tm_min;
+			if (hmr<SplitFilter->StartTime || hmr>=SplitFilter->EndTime)
 				continue;
 		}
 
-		if (autosplit && (prev_year!=t->tm_year || prev_month!=t->tm_mon || prev_day!=t->tm_mday)) {
-			prev_year=t->tm_year;
-			prev_month=t->tm_mon;
-			prev_day=t->tm_mday;
-			if (fp_ou && fclose(fp_ou)==EOF) {
-				debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),output_file,strerror(errno));
-				exit(EXIT_FAILURE);
+		if (SplitPrefix[0])
+			fp_ou=split_day_file(SplitTime.Date);
+
+		if (!SplitConvert) {
+			if (*Field) {
+				fputs(buf,fp_ou);
+				putc('\n',fp_ou);
+			} else {
+				fprintf(fp_ou,"%s \n",buf);
 			}
-			strftime(output_file+output_prefix_len, sizeof(output_file)-output_prefix_len, "-%Y-%m-%d", t);
-			/*
-			The line must be added to a file we have already created. The file must be created if the date
-			is seen for the first time. The idea is to create the files from scratch if the split is started
-			a second time.
-			*/
-			if ((fp_ou=MY_FOPEN(output_file,(tt>=min_tt && tt<=max_tt) ? "a" : "w"))==NULL) {
-				debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),output_file,strerror(errno));
+		} else {
+			Rest=(*Field) ? Field+1 : Field;
+			if (SplitDateFormat=='e')
+				strftime(dia, sizeof(dia), "%d/%m/%Y", &t);
+			else
+				strftime(dia, sizeof(dia), "%m/%d/%Y", &t);
+
+			fprintf(fp_ou,"%s %02d:%02d:%02d %s\n",dia,t.tm_hour,t.tm_min,t.tm_sec,Rest);
+		}
+	}
+
+	longline_destroy(&line);
+	if (FileObject_Close(fp_in)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),arq,FileObject_GetLastCloseError());
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*!
+ * Cut a log into parts starting at the beginning of a line.
+ *
+ * \param arq The name of the log.
+ * \param Size The size of the log.
+ * \param Parts The number of parts.
+ */
+static void split_cut(const char *arq,long long int Size,int Parts)
+{
+	char buf[4096];
+	int fd;
+	long long int Pos;
+	ssize_t nread;
+	ssize_t i;
+	int Part;
+
+	fd=open(arq,O_RDONLY | O_LARGEFILE);
+	if (fd==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arq,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	SplitPartStart[0]=0;
+	for (Part=1 ; Part<Parts ; Part++) {
+		// the part starts after the end of the line containing the byte preceding the cut
+		Pos=Size/Parts*Part-1;
+		if (Pos<SplitPartStart[Part-1]) Pos=SplitPartStart[Part-1];
+		for (;;) {
+			nread=pread(fd,buf,sizeof(buf),(off_t)Pos);
+			if (nread==-1) {
+				debuga(__FILE__,__LINE__,_("Error while reading \"%s\": %s\n"),arq,strerror(errno));
 				exit(EXIT_FAILURE);
 			}
-			if (tt<min_tt) min_tt=tt;
-			if (tt>max_tt) max_tt=tt;
+			if (nread==0 || Pos>=Size) {
+				Pos=Size;
+				break;
+			}
+			for (i=0 ; i<nread && buf[i]!='\n' ; i++);
+			Pos+=i;
+			if (i<nread) {
+				Pos++;
+				break;
+			}
 		}
+		if (Pos>Size) Pos=Size;
+		SplitPartEnd[Part-1]=Pos;
+		SplitPartStart[Part]=Pos;
+	}
+	SplitPartEnd[Parts-1]=Size;
+	close(fd);
+}
 
-		if (!convert) {
-			fprintf(fp_ou,"%s %s\n",data,gwarea.current);
-		} else {
-			if (df=='e')
-				strftime(dia, sizeof(dia), "%d/%m/%Y", t);
-			else
-				strftime(dia, sizeof(dia), "%m/%d/%Y", t);
+/*!
+ * Split a part of the log in a separate process.
+ *
+ * The daily files are suffixed with the number of the part and the days
+ * written are listed in a file for the main process.
+ *
+ * \param Part The number of the part to read.
+ */
+static void split_worker(int Part)
+{
+	FileObject *fp_in;
+	char ListName[MAXLEN];
+	FILE *fp_ou;
+	int i;
+
+	// the daily files of the main process are closed and belong to it
+	SplitDays=NULL;
+	SplitNDays=0;
+	SplitNAlloc=0;
+	SplitNOpen=0;
+	SplitLastDay=-1;
+	SplitPart=Part;
+
+	if ((fp_in=decomp_range(SplitFile,SplitPartStart[Part],&SplitPartEnd[Part]))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),SplitFile,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	split_read(fp_in,SplitFile);
+
+	split_list_name(ListName,sizeof(ListName),Part);
+	if ((fp_ou=MY_FOPEN(ListName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),ListName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	for (i=0 ; i<SplitNDays ; i++) {
+		split_close_day(SplitDays+i);
+		fprintf(fp_ou,"%d\n",SplitDays[i].Date);
+	}
+	if (fclose(fp_ou)==EOF) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),ListName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	free(SplitDays);
+}
 
-			fprintf(fp_ou,"%s %02d:%02d:%02d %s\n",dia,t->tm_hour,t->tm_min,t->tm_sec,gwarea.current);
+/*!
+ * Append a file to another one.
+ *
+ * Compressed files are concatenated as they are because the gzip members
+ * and the zstd frames are read as one stream.
+ *
+ * \param InputName The file to append. It is deleted.
+ * \param OutputName The file to append to.
+ * \param Append \c False to replace the output file.
+ */
+static void split_append_file(const char *InputName,const char *OutputName,bool Append)
+{
+	char buf[SPLIT_BUFFER_SIZE];
+	int fd_in;
+	int fd_ou;
+	ssize_t nread;
+	ssize_t nwritten;
+	ssize_t i;
+
+	if (!Append && rename(InputName,OutputName)==0)
+		return;
+
+	fd_in=open(InputName,O_RDONLY | O_LARGEFILE);
+	if (fd_in==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),InputName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fd_ou=open(OutputName,O_WRONLY | O_CREAT | ((Append) ? O_APPEND : O_TRUNC) | O_LARGEFILE,0666);
+	if (fd_ou==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),OutputName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	while ((nread=read(fd_in,buf,sizeof(buf)))>0) {
+		for (i=0 ; i<nread ; i+=nwritten) {
+			nwritten=write(fd_ou,buf+i,nread-i);
+			if (nwritten<=0) {
+				debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),OutputName,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
 		}
 	}
+	if (nread==-1) {
+		debuga(__FILE__,__LINE__,_("Error while reading \"%s\": %s\n"),InputName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	close(fd_in);
+	if (close(fd_ou)==-1) {
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),OutputName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (unlink(InputName)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),InputName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
 
+/*!
+ * Add the daily files written by a process to the daily files of the
+ * main process.
+ *
+ * \param Part The number of the process.
+ */
+static void split_merge(int Part)
+{
+	FileObject *fp_in;
+	char ListName[MAXLEN];
+	char InputName[MAXLEN];
+	char OutputName[MAXLEN];
+	char *buf;
+	longline line;
+	struct getwordstruct gwarea;
+	int Date;
+	bool Created;
+
+	split_list_name(ListName,sizeof(ListName),Part);
+	if ((fp_in=FileObject_Open(ListName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),ListName,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+	if ((line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),ListName);
+		exit(EXIT_FAILURE);
+	}
+	while ((buf=longline_read(fp_in,line))!=NULL) {
+		getword_start(&gwarea,buf);
+		if (getword_atoi(&Date,&gwarea,'\n')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),ListName);
+			exit(EXIT_FAILURE);
+		}
+		SplitLastDay=split_find_day(Date,&Created);
+		split_day_name(InputName,sizeof(InputName),Date,Part);
+		split_day_name(OutputName,sizeof(OutputName),Date,-1);
+		split_append_file(InputName,OutputName,!Created);
+	}
 	longline_destroy(&line);
 	if (FileObject_Close(fp_in)) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),arq,FileObject_GetLastCloseError());
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),ListName,FileObject_GetLastCloseError());
 		exit(EXIT_FAILURE);
 	}
-	if (autosplit && fp_ou) {
-		if (fclose(fp_ou)==EOF) {
-			debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),output_file,strerror(errno));
+	if (unlink(ListName)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),ListName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+Extract a date range from a squid log file and write it into a separate file.
+
+It can optionally convert the date in human readable format.
+
+The output can be split by day into separate files. The daily files remain open
+until splitlog_close() is called. If the log is not compressed, it is large and
+report_jobs allows it, the log is cut into parts read by separate processes.
+
+\param arq The squid log file to split.
+\param df The date format if the date is to be converted in human readable form. Only the first
+character is taken into account. It can be 'e' for European date format or anything else for
+US date format.
+\param ReadFilter How to filter out log data.
+\param convert \c True if the date must be converted into human readable form.
+\param splitprefix If not empty, the output file is written in separate files (one for each day) and
+the files are named after the day they contain prefixed with the string contained in this variable.
+*/
+void splitlog(const char *arq, char df, const struct ReadLogDataStruct *ReadFilter, int convert, const char *splitprefix)
+{
+	FileObject *fp_in;
+	struct stat st;
+	long long int Size;
+	int Parts;
+	int Part;
+
+	if (splitprefix[0]!='\0') {
+		if (snprintf(SplitPrefix,sizeof(SplitPrefix),"%s%s",outdir,splitprefix)>=sizeof(SplitPrefix)) {
+			debuga(__FILE__,__LINE__,_("Path too long: "));
+			debuga_more("%s%s-YYYY-mm-dd\n",outdir,splitprefix);
 			exit(EXIT_FAILURE);
 		}
+	} else {
+		SplitPrefix[0]='\0';
 	}
+
+	if (arq[0] == '\0')
+		arq="/var/log/squid/access.log";
+	SplitFile=arq;
+	SplitDateFormat=df;
+	SplitFilter=ReadFilter;
+	SplitConvert=convert;
+
+	if (stat(arq,&st)==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot get the size of file \"%s\": %s\n"),arq,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	Size=(long long int)st.st_size;
+	if ((fp_in=decomp_range(arq,0,&Size))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),arq,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+
+	// only an uncompressed log can be read from the middle
+	Parts=1;
+	if (SplitPrefix[0] && Size>=0) {
+		Parts=ReportJobs;
+		if (Parts>MAX_STAGES) Parts=MAX_STAGES;
+		while (Parts>1 && Size/Parts<SPLIT_MIN_PART) Parts--;
+	}
+#ifndef HAVE_FORK
+	Parts=1;
+#endif
+	if (Parts<2) {
+		split_read(fp_in,arq);
+		return;
+	}
+	FileObject_Close(fp_in);
+
+	if (debug)
+		debuga(__FILE__,__LINE__,_("Splitting file \"%s\" with %d processes\n"),arq,Parts);
+	split_cut(arq,Size,Parts);
+	// the processes append to the daily files after they are closed
+	split_close_all();
+	{
+		StageListObject stages;
+		char Name[40];
+
+		stages=Stage_Create();
+		for (Part=0 ; Part<Parts ; Part++) {
+			snprintf(Name,sizeof(Name),"split%d",Part);
+			Stage_AddArg(stages,Name,split_worker,Part,NULL,NULL,0);
+		}
+		Stage_Run(stages,Parts);
+		Stage_Destroy(&stages);
+	}
+	for (Part=0 ; Part<Parts ; Part++)
+		split_merge(Part);
+}
+
+/*!
+Close the daily files written by splitlog().
+*/
+void splitlog_close(void)
+{
+	split_close_all();
+	free(SplitDays);
+	SplitDays=NULL;
+	SplitNDays=0;
+	SplitNAlloc=0;
+	SplitLastDay=-1;
 }
@@ -0,0 +1,450 @@
+/*
+ * SARG Squid Analysis Report Generator      http://sarg.sourceforge.net
+ *                                                            1998, 2015
+ *
+ * SARG donations:
+ *      please look at http://sarg.sourceforge.net/donations.php
+ * Support:
+ *     http://sourceforge.net/projects/sarg/forums/forum/363374
+ * ---------------------------------------------------------------------
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "include/conf.h"
+#include "include/defs.h"
+#include "include/stage.h"
+#include <signal.h>
+
+//! The stage is waiting for its dependencies.
+#define STAGE_PENDING 0
+//! The stage is running.
+#define STAGE_RUNNING 1
+//! The stage is complete.
+#define STAGE_DONE    2
+
+/*!
+ * \brief One step of the report generation.
+ */
+struct StageItemStruct
+{
+	//! Name of the stage for the messages.
+	char *Name;
+	//! Function producing the stage.
+	StageFunction Run;
+	//! Function producing the stage if it takes an argument.
+	StageArgFunction RunArg;
+	//! Argument passed to \a RunArg.
+	int Arg;
+	//! Comma separated list of the resources read by the stage.
+	char *Inputs;
+	//! Comma separated list of the resources written by the stage.
+	char *Outputs;
+	//! Flags from the STAGEF_ constants.
+	int Flags;
+	//! Bit mask of the stages that must be complete before this one starts.
+	unsigned long DependsOn;
+	//! Current state of the stage.
+	int State;
+	//! Process running the stage or zero if it ran in the main process.
+	pid_t Pid;
+	//! Time the stage started.
+	struct timeval Start;
+	//! Time the stage completed.
+	struct timeval End;
+};
+
+/*!
+ * \brief List of the stages producing a report.
+ */
+struct StageListStruct
+{
+	//! The stages in the order they were declared.
+	struct StageItemStruct Stage[MAX_STAGES];
+	//! Number of stages in the list.
+	int NStages;
+	//! Time the list started to run.
+	struct timeval Start;
+	//! Number of stages run concurrently.
+	int Jobs;
+};
+
+/*!
+ * Create an empty list of stages.
+ *
+ * \return The object. It must be freed with Stage_Destroy().
+ */
+StageListObject Stage_Create(void)
+{
+	StageListObject List;
+
+	List=(StageListObject)calloc(1,sizeof(*List));
+	if (!List) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the report stages\n"));
+		exit(EXIT_FAILURE);
+	}
+	return(List);
+}
+
+/*!
+ * Destroy the list of stages.
+ *
+ * \param ListPtr A pointer to the object to destroy. It is
+ * reset to NULL before the function returns.
+ */
+void Stage_Destroy(StageListObject *ListPtr)
+{
+	StageListObject List;
+	int i;
+
+	if (!ListPtr || !*ListPtr) return;
+	List=*ListPtr;
+	*ListPtr=NULL;
+	for (i=0 ; i<List->NStages ; i++) {
+		free(List->Stage[i].Name);
+		free(List->Stage[i].Inputs);
+		free(List->Stage[i].Outputs);
+	}
+	free(List);
+}
+
+/*!
+ * Check if two comma separated lists of resources share any resource.
+ *
+ * \param List1 The first list.
+ * \param List2 The second list.
+ *
+ * \return \c True if one resource is in both lists.
+ */
+static bool Stage_Overlap(const char *List1,const char *List2)
+{
+	const char *Res1;
+	const char *Res2;
+	const char *End2;
+	int Len1;
+
+	for (Res1=List1 ; *Res1 ; ) {
+		for (Len1=0 ; Res1[Len1] && Res1[Len1]!=',' ; Len1++);
+		if (Len1>0) {
+			for (Res2=List2 ; *Res2 ; ) {
+				for (End2=Res2 ; *End2 && *End2!=',' ; End2++);
+				if (End2-Res2==Len1 && strncmp(Res1,Res2,Len1)==0) return(true);
+				Res2=(*End2) ? End2+1 : End2;
+			}
+		}
+		Res1+=Len1;
+		if (*Res1) Res1++;
+	}
+	return(false);
+}
+
+/*!
+ * Add one stage at the end of the list.
+ *
+ * The dependencies are derived from the declared resources and the order in which
+ * the stages are added. The stage depends on every previous stage that writes one of
+ * its inputs, writes one of its outputs or reads one of its outputs. An input equal
+ * to \c * makes the stage depend on every previous stage.
+ *
+ * \param List The list to add the stage to.
+ * \param Name The name of the stage.
+ * \param Run The function producing the stage.
+ * \param Inputs The comma separated list of the resources read by the stage.
+ * \param Outputs The comma separated list of the resources written by the stage.
+ * \param Flags The STAGEF_ flags of the stage.
+ */
+void Stage_Add(StageListObject List,const char *Name,StageFunction Run,const char *Inputs,const char *Outputs,int Flags)
+{
+	struct StageItemStruct *Item;
+	const struct StageItemStruct *Prev;
+	int i;
+
+	if (List->NStages>=MAX_STAGES) {
+		debuga(__FILE__,__LINE__,_("Too many report stages\n"));
+		exit(EXIT_FAILURE);
+	}
+	Item=List->Stage+List->NStages;
+	Item->Name=strdup(Name);
+	Item->Inputs=strdup(Inputs ? Inputs : "");
+	Item->Outputs=strdup(Outputs ? Outputs : "");
+	if (!Item->Name || !Item->Inputs || !Item->Outputs) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the report stages\n"));
+		exit(EXIT_FAILURE);
+	}
+	Item->Run=Run;
+	Item->RunArg=NULL;
+	Item->Arg=0;
+	Item->Flags=Flags;
+	Item->State=STAGE_PENDING;
+	Item->DependsOn=0UL;
+	for (i=0 ; i<List->NStages ; i++) {
+		Prev=List->Stage+i;
+		if (strcmp(Item->Inputs,"*")==0 ||
+		    Stage_Overlap(Item->Inputs,Prev->Outputs) ||
+		    Stage_Overlap(Item->Outputs,Prev->Outputs) ||
+		    Stage_Overlap(Item->Outputs,Prev->Inputs))
+			Item->DependsOn|=1UL<<i;
+	}
+	List->NStages++;
+}
+
+/*!
+ * Add one stage taking an argument at the end of the list.
+ *
+ * It is meant to split one task in several stages working on different parts
+ * of the data. The dependencies are computed as for Stage_Add().
+ *
+ * \param List The list to add the stage to.
+ * \param Name The name of the stage.
+ * \param Run The function producing the stage.
+ * \param Arg The argument to pass to \a Run.
+ * \param Inputs The comma separated list of the resources read by the stage.
+ * \param Outputs The comma separated list of the resources written by the stage.
+ * \param Flags The STAGEF_ flags of the stage.
+ */
+void Stage_AddArg(StageListObject List,const char *Name,StageArgFunction Run,int Arg,const char *Inputs,const char *Outputs,int Flags)
+{
+	struct StageItemStruct *Item;
+
+	Stage_Add(List,Name,NULL,Inputs,Outputs,Flags);
+	Item=List->Stage+List->NStages-1;
+	Item->RunArg=Run;
+	Item->Arg=Arg;
+}
+
+/*!
+ * Call the function of a stage.
+ */
+static void Stage_Call(struct StageItemStruct *Item)
+{
+	if (Item->RunArg)
+		Item->RunArg(Item->Arg);
+	else
+		Item->Run();
+}
+
+/*!
+ * Run one stage in the current process.
+ */
+static void Stage_RunHere(struct StageItemStruct *Item)
+{
+	if (debugz>=LogLevel_Process)
+		debugaz(__FILE__,__LINE__,_("Starting report stage %s\n"),Item->Name);
+	Item->State=STAGE_RUNNING;
+	Item->Pid=0;
+	gettimeofday(&Item->Start,NULL);
+	Stage_Call(Item);
+	gettimeofday(&Item->End,NULL);
+	Item->State=STAGE_DONE;
+}
+
+#ifdef HAVE_FORK
+/*!
+ * Start one stage in a child process.
+ */
+static void Stage_Fork(struct StageItemStruct *Item)
+{
+	pid_t Pid;
+
+	if (debugz>=LogLevel_Process)
+		debugaz(__FILE__,__LINE__,_("Starting report stage %s in a separate process\n"),Item->Name);
+	// don't let the child flush the pending output of the parent a second time
+	fflush(NULL);
+	gettimeofday(&Item->Start,NULL);
+	Pid=fork();
+	if (Pid==-1) {
+		debuga(__FILE__,__LINE__,_("Cannot start a process for the report stage %s: %s\n"),Item->Name,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if (Pid==0) {
+		Stage_Call(Item);
+		fflush(NULL);
+		_exit(EXIT_SUCCESS);
+	}
+	Item->Pid=Pid;
+	Item->State=STAGE_RUNNING;
+}
+
+/*!
+ * Catch SIGCHLD to wake up the wait for the stages.
+ */
+static void Stage_ChildSignal(int sig)
+{
+}
+
+/*!
+ * Wait for one child process to terminate and mark its stage as complete.
+ *
+ * Only the processes of the stages are waited for so that the status of the
+ * other children of sarg (decompression, compression, mailer) is not consumed.
+ * SIGCHLD is blocked while the stages are checked and the process sleeps in
+ * sigsuspend() until the next child terminates.
+ *
+ * \return \c False if the stage failed.
+ */
+static bool Stage_WaitChild(StageListObject List)
+{
+	pid_t Pid;
+	int Status;
+	int i;
+	sigset_t ChildMask;
+	sigset_t OldMask;
+	sigset_t WaitMask;
+	struct sigaction sa;
+	struct sigaction OldAction;
+
+	sigemptyset(&ChildMask);
+	sigaddset(&ChildMask,SIGCHLD);
+	sigprocmask(SIG_BLOCK,&ChildMask,&OldMask);
+	memset(&sa,0,sizeof(sa));
+	sa.sa_handler=Stage_ChildSignal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGCHLD,&sa,&OldAction);
+	WaitMask=OldMask;
+	sigdelset(&WaitMask,SIGCHLD);
+
+	while (true) {
+		for (i=0 ; i<List->NStages ; i++) {
+			if (List->Stage[i].State!=STAGE_RUNNING || List->Stage[i].Pid==0) continue;
+			while ((Pid=waitpid(List->Stage[i].Pid,&Status,WNOHANG))==-1 && errno==EINTR);
+			if (Pid==0) continue;
+			if (Pid==-1) {
+				debuga(__FILE__,__LINE__,_("Failed to wait for the report stage %s: %s\n"),List->Stage[i].Name,strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			break;
+		}
+		if (i<List->NStages) break;
+		sigsuspend(&WaitMask);
+	}
+
+	sigaction(SIGCHLD,&OldAction,NULL);
+	sigprocmask(SIG_SETMASK,&OldMask,NULL);
+	gettimeofday(&List->Stage[i].End,NULL);
+	List->Stage[i].State=STAGE_DONE;
+	if (!WIFEXITED(Status) || WEXITSTATUS(Status)!=EXIT_SUCCESS) {
+		debuga(__FILE__,__LINE__,_("Report stage %s failed\n"),List->Stage[i].Name);
+		return(false);
+	}
+	return(true);
+}
+
+/*!
+ * Check if every dependency of the stage is complete.
+ */
+static bool Stage_IsReady(StageListObject List,const struct StageItemStruct *Item)
+{
+	int i;
+
+	if (Item->State!=STAGE_PENDING) return(false);
+	for (i=0 ; i<List->NStages ; i++)
+		if ((Item->DependsOn & (1UL<<i))!=0 && List->Stage[i].State!=STAGE_DONE)
+			return(false);
+	return(true);
+}
+#endif
+
+/*!
+ * Run all the stages of the list.
+ *
+ * The report functions depend on the global variables and static buffers of sarg
+ * so the independent stages run in child processes instead of threads. The stages
+ * flagged with STAGEF_MAIN_PROCESS always run in the main process.
+ *
+ * \param List The stages to run.
+ * \param Jobs The maximum number of stages running at the same time. If it is
+ * less than two, the stages run one after the other in the order they were added.
+ */
+void Stage_Run(StageListObject List,int Jobs)
+{
+	int i;
+#ifdef HAVE_FORK
+	int NDone=0;
+	int NRunning=0;
+	bool Failed=false;
+	bool Started;
+#endif
+
+	gettimeofday(&List->Start,NULL);
+#ifndef HAVE_FORK
+	Jobs=1;
+#endif
+	if (Jobs<2) {
+		List->Jobs=1;
+		for (i=0 ; i<List->NStages ; i++)
+			Stage_RunHere(List->Stage+i);
+		return;
+	}
+#ifdef HAVE_FORK
+	List->Jobs=Jobs;
+	while (NDone<List->NStages) {
+		Started=false;
+		for (i=0 ; !Failed && i<List->NStages ; i++) {
+			struct StageItemStruct *Item=List->Stage+i;
+
+			if (!Stage_IsReady(List,Item)) continue;
+			if ((Item->Flags & STAGEF_MAIN_PROCESS)!=0) {
+				Stage_RunHere(Item);
+				NDone++;
+				Started=true;
+				break;
+			}
+			if (NRunning>=Jobs) continue;
+			Stage_Fork(Item);
+			NRunning++;
+			Started=true;
+		}
+		if (Started) continue;
+		if (NRunning==0) {
+			if (Failed) break;
+			debuga(__FILE__,__LINE__,_("The report stages have circular dependencies\n"));
+			exit(EXIT_FAILURE);
+		}
+		if (!Stage_WaitChild(List)) Failed=true;
+		NRunning--;
+		NDone++;
+	}
+	if (Failed) exit(EXIT_FAILURE);
+#endif
+}
+
+/*!
+ * Write the time taken by each stage of the list.
+ */
+void Stage_Summary(StageListObject List)
+{
+	int i;
+	const struct StageItemStruct *Item;
+	double Offset;
+	double Elapsed;
+	struct timeval End;
+
+	if (List->NStages==0) return;
+	End=List->Start;
+	debuga(__FILE__,__LINE__,_("Report stages run with %d job(s):\n"),List->Jobs);
+	for (i=0 ; i<List->NStages ; i++) {
+		Item=List->Stage+i;
+		if (Item->State!=STAGE_DONE) continue;
+		Offset=(double)(Item->Start.tv_sec-List->Start.tv_sec)+(double)(Item->Start.tv_usec-List->Start.tv_usec)/1E6;
+		Elapsed=(double)(Item->End.tv_sec-Item->Start.tv_sec)+(double)(Item->End.tv_usec-Item->Start.tv_usec)/1E6;
+		/* TRANSLATORS: The first string is the name of the stage. The numbers are the time, in seconds,
+		 * when the stage started relative to the first stage and how long it took. */
+		debuga(__FILE__,__LINE__,_("   %-20s start %8.3lf s  duration %8.3lf s%s\n"),Item->Name,Offset,Elapsed,(Item->Pid==0) ? "" : _(" (separate process)"));
+		if (timercmp(&Item->End,&End,>)) End=Item->End;
+	}
+	Elapsed=(double)(End.tv_sec-List->Start.tv_sec)+(double)(End.tv_usec-List->Start.tv_usec)/1E6;
+	debuga(__FILE__,__LINE__,_("Report stages completed in %.3lf seconds\n"),Elapsed);
+}
@@ -233,7 +233,7 @@ void topsites(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if ((fp_ou=fopen(report,"w"))==NULL) {
+	if ((fp_ou=open_html_file(report,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),report,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
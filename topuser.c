@@ -105,7 +105,7 @@ static void TopUser_HtmlReport(const char *ListFile,struct TopUserStatistics *St
 	}
 
 	format_path(__FILE__, __LINE__, top3, sizeof(top3), "%s/"INDEX_HTML_FILE, outdirname);
-	if ((fp_top3=fopen(top3,"w"))==NULL) {
+	if ((fp_top3=open_html_file(top3,"w"))==NULL) {
 		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),top3,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
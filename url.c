@@ -860,16 +860,27 @@ Get the part of the URL necessary to generate the report.
 the URL is truncated to only keep the host name and port number.
 */
 const char *process_url(const char *url,bool full_url)
+{
+	return(process_schemeless_url(skip_scheme(url),full_url));
+}
+
+/*!
+Get the part of the URL necessary to generate the report once the scheme
+has been removed by skip_scheme().
+
+\param start The URL without the scheme.
+\param full_url \c True to keep the whole URL. If \c false,
+the URL is truncated to only keep the host name and port number.
+*/
+const char *process_schemeless_url(const char *start,bool full_url)
 {
 	static char short_url[1024];
 	int i;
-	const char *start;
 	int type;
 	unsigned char ipv4[4];
 	unsigned short int ipv6[8];
 	const char *next;
 
-	start=skip_scheme(url);
 	if (!full_url) {
 		for (i=0 ; i<sizeof(short_url)-1 && start[i] && start[i]!='/' && start[i]!='?' ; i++)
 			short_url[i]=start[i];
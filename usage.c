@@ -35,8 +35,11 @@ void usage(const char *prog)
 	puts  (_("     -c FILE        Exclude connected hosts from the report"));
 	puts  (_("     --convert      Convert the access.log file to a legible date"));
 	puts  (_("     --css          Output the internal CSS"));
+	puts  (_("     --daemon       Keep reading the input logs and refresh the reports periodically"));
 	puts  (_("     -d DATE        Date range to include in the report: from-until dd/mm/yyyy-dd/mm/yyyy"));
 	puts  (_("     -e MAIL        Email address to send reports to (stdout for console)"));
+	puts  (_("     --from-aggregates\n"
+	         "                    Produce the report from the daily totals in aggregate_dir"));
 	printf(_("     -f FILE        Config file to read (default is %s/sarg.conf)\n"),SYSCONFDIR);
 	puts  (_("     -g FMT         Date format [e=Europe -> dd/mm/yyyy, u=USA -> mm/dd/yyyy]"));
 	puts  (_("     -h             This help"));
@@ -48,12 +51,13 @@ void usage(const char *prog)
 	puts  (_("     -n             Resolve IP addresses using RDNS"));
 	puts  (_("     -o DIR         Report output directory"));
 	puts  (_("     -p             Use Ip Address instead of userid (reports)"));
-	puts  (_("     -P PREFIX      Prepend a prefix to the splitted file names"));
+	puts  (_("     -P PREFIX      Prepend a prefix to the splitted or converted file names"));
 	puts  (_("     -r             Produce real time report"));
 	puts  (_("     -s SITE        Limit report to accessed site [eg. www.microsoft.com]"));
 	puts  (_("     --split        Split the log file by date in -d parameter"));
 	puts  (_("     --splitprefix PREFIX\n"
-	         "                    Prepend a prefix to the splitted file names"));
+	         "                    Prepend a prefix to the splitted or converted file names"));
+	puts  (_("     --stages       Print the time taken by each report stage"));
 	puts  (_("     --statistics   Print run time statistics"));
 	puts  (_("     -t TIME        Limit report to time range [HH:MM or HH:MM-HH:MM]"));
 	puts  (_("     -u USER        Report only that user's activity"));
@@ -27,415 +27,793 @@
 #include "include/conf.h"
 #include "include/defs.h"
 #include "include/filelist.h"
+#include "include/readlog.h"
+#include "include/stage.h"
 
 FileListObject UserAgentLog=NULL;
+extern int ReportJobs;
 
-//! Log file where the user agent data are written.
-static char UserAgentTempLog[MAXLEN]="";
+//! One user agent.
+struct UserAgentItemStruct
+{
+	//! The position of the user agent string in the pool.
+	int Name;
+	//! The number of records with this user agent.
+	long long int Records;
+	//! The number of distinct users of this user agent.
+	int Users;
+};
+
+//! One user of a user agent.
+struct UserAgentUserStruct
+{
+	//! The index of the user agent.
+	int Agent;
+	//! The position of the user ID in the pool.
+	int User;
+	//! The number of records of the user with this user agent.
+	long long int Records;
+};
 
-static struct tm UserAgentStartDate;
-static struct tm UserAgentEndDate;
+/*!
+ * The user agents found in the logs.
+ *
+ * The strings are stored once in a pool. The hash tables store the index
+ * of the item plus one or zero if the slot is free.
+ */
+struct UserAgentStatsStruct
+{
+	//! The user agents and user IDs.
+	char *Pool;
+	//! The number of bytes used in the pool.
+	int PoolSize;
+	//! The number of bytes allocated for the pool.
+	int PoolAllocated;
+	//! The user agents.
+	struct UserAgentItemStruct *Agent;
+	//! The number of user agents.
+	int NAgents;
+	//! The number of user agents allocated.
+	int AgentsAllocated;
+	//! The hash table to find a user agent.
+	int *AgentHash;
+	//! The number of slots in the hash table of the user agents.
+	int AgentHashSize;
+	//! The hash table to find a user ID in the pool. The slot contains the position in the pool plus one.
+	int *UserHash;
+	//! The number of slots in the hash table of the users.
+	int UserHashSize;
+	//! The number of users.
+	int NUsers;
+	//! The users of each user agent.
+	struct UserAgentUserStruct *Pair;
+	//! The number of users of the user agents.
+	int NPairs;
+	//! The number of users of the user agents allocated.
+	int PairsAllocated;
+	//! The hash table to find the user of a user agent.
+	int *PairHash;
+	//! The number of slots in the hash table of the users of the user agents.
+	int PairHashSize;
+	//! The index plus one of the last user of a user agent found. Consecutive entries often repeat it.
+	int LastPair;
+	//! \c True if the period is set.
+	bool HasPeriod;
+	//! The first day of the entries.
+	struct tm StartDate;
+	//! The last day of the entries.
+	struct tm EndDate;
+};
+
+//! The user agents collected so far.
+static struct UserAgentStatsStruct *UserAgentStats=NULL;
+
+//! The filter to apply to the user agent logs.
+static const struct ReadLogDataStruct *UserAgentFilter;
+//! The first date to keep from the user agent logs as computed by getperiod_torange().
+static int UserAgentFrom;
+//! The last date to keep from the user agent logs as computed by getperiod_torange().
+static int UserAgentUntil;
+//! The number of processes reading the user agent logs.
+static int UserAgentWorkers;
+//! The number of lines read from the user agent logs.
+static unsigned long UserAgentLines;
 
 /*!
- * Open the temporary file to store the useragent entries to be
- * reported.
+ * Compute the hash of a string.
+ */
+static unsigned int UserAgent_HashString(const char *String)
+{
+	unsigned int Hash=2166136261U;
+
+	for ( ; *String ; String++)
+		Hash=(Hash ^ (unsigned char)*String)*16777619U;
+	return(Hash);
+}
+
+/*!
+ * Compute the hash of one user of one user agent.
+ */
+static unsigned int UserAgent_HashPair(int Agent,int User)
+{
+	return(((unsigned int)Agent*2654435761U) ^ ((unsigned int)User*2246822519U));
+}
+
+static unsigned int UserAgent_AgentSlotHash(int Slot)
+{
+	return(UserAgent_HashString(UserAgentStats->Pool+UserAgentStats->Agent[Slot-1].Name));
+}
+
+static unsigned int UserAgent_UserSlotHash(int Slot)
+{
+	return(UserAgent_HashString(UserAgentStats->Pool+Slot-1));
+}
+
+static unsigned int UserAgent_PairSlotHash(int Slot)
+{
+	const struct UserAgentUserStruct *Pair=UserAgentStats->Pair+Slot-1;
+
+	return(UserAgent_HashPair(Pair->Agent,Pair->User));
+}
+
+/*!
+ * Double the size of a hash table.
  *
- * \return The file handle. It must be closed when the data have
- * been written.
+ * \param HashPtr A pointer to the hash table to enlarge.
+ * \param HashSizePtr A pointer to the number of slots in the table.
+ * \param SlotHash The function computing the hash of the item stored in a slot.
  */
-FILE *UserAgent_Open(void)
+static void UserAgent_GrowHash(int **HashPtr,int *HashSizePtr,unsigned int (*SlotHash)(int Slot))
 {
-	FILE *fp_ou=NULL;
+	int *Hash;
+	int HashSize;
+	int i;
+	int j;
+
+	HashSize=(*HashSizePtr>0) ? 2 * *HashSizePtr : 1024;
+	Hash=calloc(HashSize,sizeof(*Hash));
+	if (!Hash) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the user agents\n"));
+		exit(EXIT_FAILURE);
+	}
+	for (i=0 ; i<*HashSizePtr ; i++) {
+		if ((*HashPtr)[i]==0) continue;
+		j=SlotHash((*HashPtr)[i]) & (HashSize-1);
+		while (Hash[j]!=0) j=(j+1) & (HashSize-1);
+		Hash[j]=(*HashPtr)[i];
+	}
+	if (*HashPtr) free(*HashPtr);
+	*HashPtr=Hash;
+	*HashSizePtr=HashSize;
+}
 
-	if (UserAgentTempLog[0]) {
-		debuga(__FILE__,__LINE__,_("Useragent log already opened\n"));
+/*!
+ * Make room for one more item in an array.
+ *
+ * \param Array The array to enlarge.
+ * \param Used The number of items in the array.
+ * \param AllocatedPtr A pointer to the number of items allocated.
+ * \param ItemSize The size of one item.
+ *
+ * \return The array that may have moved.
+ */
+static void *UserAgent_GrowArray(void *Array,int Used,int *AllocatedPtr,size_t ItemSize)
+{
+	int Size;
+
+	if (Used<*AllocatedPtr) return(Array);
+	Size=(*AllocatedPtr>0) ? 2 * *AllocatedPtr : 256;
+	Array=realloc(Array,Size*ItemSize);
+	if (!Array) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to store the user agents\n"));
 		exit(EXIT_FAILURE);
 	}
+	*AllocatedPtr=Size;
+	return(Array);
+}
+
+/*!
+ * Store a string in the pool.
+ *
+ * \return The position of the string in the pool.
+ */
+static int UserAgent_StoreString(const char *String)
+{
+	struct UserAgentStatsStruct *Stats=UserAgentStats;
+	int Len=strlen(String)+1;
+	int Offset;
+
+	if (Stats->PoolSize+Len>Stats->PoolAllocated) {
+		char *Pool;
+		int Size=Stats->PoolAllocated+((Len>65536) ? Len : 65536);
+
+		Pool=realloc(Stats->Pool,Size);
+		if (!Pool) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the user agents\n"));
+			exit(EXIT_FAILURE);
+		}
+		Stats->Pool=Pool;
+		Stats->PoolAllocated=Size;
+	}
+	Offset=Stats->PoolSize;
+	memcpy(Stats->Pool+Offset,String,Len);
+	Stats->PoolSize+=Len;
+	return(Offset);
+}
+
+/*!
+ * Free the user agents.
+ */
+static void UserAgent_Free(void)
+{
+	struct UserAgentStatsStruct *Stats=UserAgentStats;
+
+	if (!Stats) return;
+	UserAgentStats=NULL;
+	if (Stats->Pool) free(Stats->Pool);
+	if (Stats->Agent) free(Stats->Agent);
+	if (Stats->AgentHash) free(Stats->AgentHash);
+	if (Stats->UserHash) free(Stats->UserHash);
+	if (Stats->Pair) free(Stats->Pair);
+	if (Stats->PairHash) free(Stats->PairHash);
+	free(Stats);
+}
+
+/*!
+ * Prepare the storage of the useragent entries to be reported.
+ *
+ * Nothing is stored if the useragent report is not requested.
+ */
+void UserAgent_Open(void)
+{
+	if (UserAgentStats) return;
 	if ((ReportType & REPORT_TYPE_USERAGENT)!=0) {
-		format_path(__FILE__, __LINE__, UserAgentTempLog, sizeof(UserAgentTempLog), "%s/squagent.int_unsort", tmp);
-		if ((fp_ou=fopen(UserAgentTempLog,"w"))==NULL) {
-			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),UserAgentTempLog,strerror(errno));
+		UserAgentStats=calloc(1,sizeof(*UserAgentStats));
+		if (!UserAgentStats) {
+			debuga(__FILE__,__LINE__,_("Not enough memory to store the user agents\n"));
 			exit(EXIT_FAILURE);
 		}
-		memset(&UserAgentStartDate,0,sizeof(UserAgentStartDate));
-		memset(&UserAgentEndDate,0,sizeof(UserAgentEndDate));
 	}
-	return(fp_ou);
 }
 
 /*!
- * Write a user agent entry into the temporary log.
+ * Extend the period covered by the user agents to include a date.
+ */
+static void UserAgent_AddPeriod(const struct tm *Time)
+{
+	struct UserAgentStatsStruct *Stats=UserAgentStats;
+
+	if (!Stats->HasPeriod || compare_date(&Stats->StartDate,Time)>0)
+		memcpy(&Stats->StartDate,Time,sizeof(Stats->StartDate));
+	if (!Stats->HasPeriod || compare_date(&Stats->EndDate,Time)<0)
+		memcpy(&Stats->EndDate,Time,sizeof(Stats->EndDate));
+	Stats->HasPeriod=true;
+}
+
+/*!
+ * Count the records of one user with one user agent.
  *
- * \param fp The file opened by UserAgent_Open().
- * \param Ip The IP address using this agent.
  * \param User The user name.
  * \param Agent The user agent string.
+ * \param Records The number of records to count.
  */
-void UserAgent_Write(FILE *fp,const struct tm *Time,const char *Ip,const char *User,const char *Agent)
+static void UserAgent_AddPair(const char *User,const char *Agent,long long int Records)
 {
-	if (fp) {
-		if (useragent_count==0 || compare_date(&UserAgentStartDate,Time)>0)
-			memcpy(&UserAgentStartDate,Time,sizeof(UserAgentStartDate));
-		if (useragent_count==0 || compare_date(&UserAgentEndDate,Time)<0)
-			memcpy(&UserAgentEndDate,Time,sizeof(UserAgentEndDate));
-		fprintf(fp,"%s\t%s\t%s\n",Ip,Agent,User);
-		useragent_count++;
+	struct UserAgentStatsStruct *Stats=UserAgentStats;
+	struct UserAgentUserStruct *Pair;
+	int AgentIdx;
+	int UserPos;
+	int i;
+
+	if (Stats->LastPair>0) {
+		Pair=Stats->Pair+Stats->LastPair-1;
+		if (strcmp(Stats->Pool+Pair->User,User)==0 && strcmp(Stats->Pool+Stats->Agent[Pair->Agent].Name,Agent)==0) {
+			Stats->Pair[Stats->LastPair-1].Records+=Records;
+			Stats->Agent[Pair->Agent].Records+=Records;
+			useragent_count+=Records;
+			return;
+		}
 	}
+
+	if (Stats->NAgents*2>=Stats->AgentHashSize)
+		UserAgent_GrowHash(&Stats->AgentHash,&Stats->AgentHashSize,UserAgent_AgentSlotHash);
+	i=UserAgent_HashString(Agent) & (Stats->AgentHashSize-1);
+	while (Stats->AgentHash[i]!=0 && strcmp(Stats->Pool+Stats->Agent[Stats->AgentHash[i]-1].Name,Agent)!=0)
+		i=(i+1) & (Stats->AgentHashSize-1);
+	if (Stats->AgentHash[i]==0) {
+		struct UserAgentItemStruct *Item;
+
+		Stats->Agent=UserAgent_GrowArray(Stats->Agent,Stats->NAgents,&Stats->AgentsAllocated,sizeof(*Stats->Agent));
+		Item=Stats->Agent+Stats->NAgents;
+		Item->Name=UserAgent_StoreString(Agent);
+		Item->Records=0;
+		Item->Users=0;
+		Stats->AgentHash[i]=++Stats->NAgents;
+	}
+	AgentIdx=Stats->AgentHash[i]-1;
+	Stats->Agent[AgentIdx].Records+=Records;
+
+	if (Stats->NUsers*2>=Stats->UserHashSize)
+		UserAgent_GrowHash(&Stats->UserHash,&Stats->UserHashSize,UserAgent_UserSlotHash);
+	i=UserAgent_HashString(User) & (Stats->UserHashSize-1);
+	while (Stats->UserHash[i]!=0 && strcmp(Stats->Pool+Stats->UserHash[i]-1,User)!=0)
+		i=(i+1) & (Stats->UserHashSize-1);
+	if (Stats->UserHash[i]==0) {
+		Stats->UserHash[i]=UserAgent_StoreString(User)+1;
+		Stats->NUsers++;
+	}
+	UserPos=Stats->UserHash[i]-1;
+
+	if (Stats->NPairs*2>=Stats->PairHashSize)
+		UserAgent_GrowHash(&Stats->PairHash,&Stats->PairHashSize,UserAgent_PairSlotHash);
+	i=UserAgent_HashPair(AgentIdx,UserPos) & (Stats->PairHashSize-1);
+	while (Stats->PairHash[i]!=0 && (Stats->Pair[Stats->PairHash[i]-1].Agent!=AgentIdx || Stats->Pair[Stats->PairHash[i]-1].User!=UserPos))
+		i=(i+1) & (Stats->PairHashSize-1);
+	if (Stats->PairHash[i]==0) {
+		Stats->Pair=UserAgent_GrowArray(Stats->Pair,Stats->NPairs,&Stats->PairsAllocated,sizeof(*Stats->Pair));
+		Pair=Stats->Pair+Stats->NPairs;
+		Pair->Agent=AgentIdx;
+		Pair->User=UserPos;
+		Pair->Records=0;
+		Stats->PairHash[i]=++Stats->NPairs;
+		Stats->Agent[AgentIdx].Users++;
+	}
+	Stats->LastPair=Stats->PairHash[i];
+	Stats->Pair[Stats->LastPair-1].Records+=Records;
+	useragent_count+=Records;
 }
 
 /*!
- * Read the user provided useragent file and create
- * a temporary file with the data to report.
+ * Count the user agent of a log entry.
+ *
+ * The access log entries providing the user agent and the entries of the
+ * useragent logs are counted here.
+ *
+ * \param log_entry The entry to count. Nothing is done if it has no user agent.
  */
-void UserAgent_Readlog(const struct ReadLogDataStruct *ReadFilter)
+void UserAgent_Write(const struct ReadLogStruct *log_entry)
+{
+	const char *User;
+
+	if (!log_entry->UserAgent) return;
+	if (!UserAgentStats) {
+		UserAgent_Open();
+		if (!UserAgentStats) return;
+	}
+	User=log_entry->User;
+	if (User[0]=='\0' || User[0]=='-') User=log_entry->Ip;
+	UserAgent_AddPeriod(&log_entry->EntryTime);
+	UserAgent_AddPair(User,log_entry->UserAgent,1);
+}
+
+/*!
+ * Parse one line of a useragent log.
+ *
+ * The line contains the IP address, the date and time within square brackets,
+ * the user agent within double quotes and, optionally, the user ID.
+ *
+ * \param Line The line to parse. It is modified to terminate the strings
+ * stored in \a Entry.
+ * \param Entry The structure to fill.
+ *
+ * \return \c False if the line is invalid.
+ */
+static bool UserAgent_ParseLine(char *Line,struct ReadLogStruct *Entry)
+{
+	char *Ip;
+	char *Agent;
+	char MonthName[4];
+	int MonthNameLen;
+	int Day;
+	int Month;
+	int Year;
+	int Hour;
+	int Minute;
+
+	memset(Entry,0,sizeof(*Entry));
+
+	Entry->Ip=Ip=Line;
+	while (*Line && *Line!=' ') Line++;
+	if (*Line!=' ' || Line==Ip) return(false);
+	*Line++='\0';
+
+	// the date and time are enclosed within square brackets
+	while (*Line && *Line!='[') Line++;
+	if (*Line!='[') return(false);
+	++Line;
+	Day=0;
+	while (isdigit(*Line)) Day=Day*10+(*Line++-'0');
+	if (*Line!='/') return(false);
+	++Line;
+	for (MonthNameLen=0 ; MonthNameLen<sizeof(MonthName)-1 && isalpha(*Line) ; MonthNameLen++) MonthName[MonthNameLen]=*Line++;
+	if (*Line!='/') return(false);
+	MonthName[MonthNameLen]='\0';
+	Month=month2num(MonthName);
+	if (Month>=12) return(false);
+	++Line;
+	Year=0;
+	while (isdigit(*Line)) Year=Year*10+(*Line++-'0');
+	if (*Line!=':') return(false);
+	++Line;
+	Hour=0;
+	while (isdigit(*Line)) Hour=Hour*10+(*Line++-'0');
+	if (*Line!=':') return(false);
+	++Line;
+	Minute=0;
+	while (isdigit(*Line)) Minute=Minute*10+(*Line++-'0');
+	if (*Line!=':') return(false);
+	Entry->EntryTime.tm_year=Year-1900;
+	Entry->EntryTime.tm_mon=Month;
+	Entry->EntryTime.tm_mday=Day;
+	Entry->EntryTime.tm_hour=Hour;
+	Entry->EntryTime.tm_min=Minute;
+
+	// the user agent is enclosed within double quotes
+	while (*Line && *Line!='"') Line++;
+	if (*Line!='"') return(false);
+	Entry->UserAgent=Agent=++Line;
+	while (*Line && *Line!='"') Line++;
+	if (*Line!='"') return(false);
+	*Line++='\0';
+
+	// the user ID, if any, is the rest of the line after the next space
+	while (*Line && *Line!=' ') Line++;
+	if (*Line==' ') Line++;
+	Entry->User=Line;
+	return(true);
+}
+
+/*!
+ * Read one useragent log provided by the user.
+ *
+ * \param FileName The name of the log file.
+ */
+static void UserAgent_ReadFile(const char *FileName)
 {
 	FileObject *fp_log;
-	FILE *fp_ou = NULL;
 	char *ptr;
-	char ip[80], data[50], agent[MAXLEN], user[MAXLEN];
-	int day,month,year;
-	char monthname[5];
-	int hour,min;
-	const char *FileName;
-	unsigned long totregsl=0;
 	int ndate;
-	struct getwordstruct gwarea, gwarea1;
 	longline line;
-	FileListIterator FIter;
-	struct tm logtime;
-	int dfrom;
-	int duntil;
-
-	fp_ou=UserAgent_Open();
+	struct ReadLogStruct log_entry;
 
 	if ((line=longline_create())==NULL) {
 		debuga(__FILE__,__LINE__,_("Not enough memory to read useragent log\n"));
 		exit(EXIT_FAILURE);
 	}
-	memset(&logtime,0,sizeof(logtime));
-	getperiod_torange(&period,&dfrom,&duntil);
 
-	FIter=FileListIter_Open(UserAgentLog);
-	while ((FileName=FileListIter_Next(FIter))!=NULL)
-	{
-		longline_reset(line);
-		if ((fp_log=decomp(FileName))==NULL) {
-			debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,FileObject_GetLastOpenError());
+	if ((fp_log=decomp(FileName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),FileName,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
+	}
+
+	if (debug) {
+		debuga(__FILE__,__LINE__,_("Reading useragent log \"%s\"\n"),FileName);
+	}
+
+	while ((ptr=longline_read(fp_log,line))!=NULL) {
+		UserAgentLines++;
+		if (!UserAgent_ParseLine(ptr,&log_entry)) {
+			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),FileName);
 			exit(EXIT_FAILURE);
 		}
-
-		if (debug) {
-			debuga(__FILE__,__LINE__,_("Reading useragent log \"%s\"\n"),FileName);
+		if (UserAgentFrom!=0 || UserAgentUntil!=0){
+			ndate=(log_entry.EntryTime.tm_year+1900)*10000+(log_entry.EntryTime.tm_mon+1)*100+log_entry.EntryTime.tm_mday;
+			if (ndate<UserAgentFrom) continue;
+			if (ndate>UserAgentUntil) break;
 		}
-
-		while ((ptr=longline_read(fp_log,line))!=NULL) {
-			totregsl++;
-			getword_start(&gwarea,ptr);
-			if (getword(ip,sizeof(ip),&gwarea,' ')<0 || getword_skip(10,&gwarea,'[')<0 ||
-				getword(data,sizeof(data),&gwarea,' ')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),FileName);
-				exit(EXIT_FAILURE);
-			}
-			getword_start(&gwarea1,data);
-			if (getword_atoi(&day,&gwarea1,'/')<0 || getword(monthname,sizeof(monthname),&gwarea1,'/')<0 ||
-				getword_atoi(&year,&gwarea1,':')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),FileName);
-				exit(EXIT_FAILURE);
-			}
-			month=month2num(monthname)+1;
-			if (month>12) {
-				debuga(__FILE__,__LINE__,_("Invalid month name \"%s\" found in user agent file \"%s\""),monthname,FileName);
-				exit(EXIT_FAILURE);
-			}
-			if (dfrom!=0 || duntil!=0){
-				ndate=year*10000+month*100+day;
-				if (ndate<dfrom) continue;
-				if (ndate>duntil) break;
-			}
-			if (getword_atoi(&hour,&gwarea1,':')<0 || getword_atoi(&min,&gwarea1,':')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid time in file \"%s\"\n"),FileName);
-				exit(EXIT_FAILURE);
-			}
-			if (ReadFilter->StartTime>=0 || ReadFilter->EndTime>=0)
-			{
-				int hmr=hour*100+min;
-				if (hmr<ReadFilter->StartTime || hmr>=ReadFilter->EndTime)
-					continue;
-			}
-			logtime.tm_year=year-1900;
-			logtime.tm_mon=month-1;
-			logtime.tm_mday=day;
-			if (getword_skip(MAXLEN,&gwarea,'"')<0 || getword(agent,sizeof(agent),&gwarea,'"')<0) {
-				debuga(__FILE__,__LINE__,_("Invalid useragent in file \"%s\"\n"),FileName);
-				exit(EXIT_FAILURE);
-			}
-
-			if (gwarea.current[0]!='\0') {
-				if (getword_skip(MAXLEN,&gwarea,' ')<0 || getword(user,sizeof(user),&gwarea,'\n')<0) {
-					debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),FileName);
-					exit(EXIT_FAILURE);
-				}
-				if (user[0] == '-')
-					strcpy(user,ip);
-				if (user[0] == '\0')
-					strcpy(user,ip);
-			} else {
-				strcpy(user,ip);
-			}
-
-			UserAgent_Write(fp_ou,&logtime,ip,user,agent);
+		if (UserAgentFilter->StartTime>=0 || UserAgentFilter->EndTime>=0)
+		{
+			int hmr=log_entry.EntryTime.tm_hour*100+log_entry.EntryTime.tm_min;
+			if (hmr<UserAgentFilter->StartTime || hmr>=UserAgentFilter->EndTime)
+				continue;
 		}
+		// only the date is reported
+		log_entry.EntryTime.tm_hour=0;
+		log_entry.EntryTime.tm_min=0;
 
-		if (FileObject_Close(fp_log)==EOF) {
-			debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),FileName,FileObject_GetLastCloseError());
-			exit(EXIT_FAILURE);
-		}
+		UserAgent_Write(&log_entry);
 	}
-	FileListIter_Close(FIter);
-	longline_destroy(&line);
 
-	if (debug) {
-		debuga(__FILE__,__LINE__,_("   Records read: %ld\n"),totregsl);
+	if (FileObject_Close(fp_log)==EOF) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),FileName,FileObject_GetLastCloseError());
+		exit(EXIT_FAILURE);
 	}
+	longline_destroy(&line);
+}
+
+/*!
+ * Name the file where a process reading the useragent logs stores the user
+ * agents it found.
+ */
+static void UserAgent_PartName(char *Buffer,int BufferSize,int Worker)
+{
+	format_path(__FILE__, __LINE__, Buffer, BufferSize, "%s/squagent%d.int_part", tmp, Worker);
+}
+
+/*!
+ * Read the share of the useragent logs assigned to one process and write
+ * the user agents found in a file to be merged by the main process.
+ *
+ * \param Worker The number of the process. It reads every log whose
+ * position in the list modulo the number of processes is \a Worker.
+ */
+static void UserAgent_ReadWorker(int Worker)
+{
+	FileListIterator FIter;
+	const char *FileName;
+	char PartName[MAXLEN];
+	FILE *fp_ou;
+	int i;
+	const struct UserAgentUserStruct *Pair;
+
+	// the user agents inherited from the main process are counted by the main process
+	UserAgentStats=NULL;
+	useragent_count=0;
+	UserAgentLines=0;
+	UserAgent_Open();
+
+	FIter=FileListIter_Open(UserAgentLog);
+	for (i=0 ; (FileName=FileListIter_Next(FIter))!=NULL ; i++)
+		if (i%UserAgentWorkers==Worker)
+			UserAgent_ReadFile(FileName);
+	FileListIter_Close(FIter);
 
+	UserAgent_PartName(PartName,sizeof(PartName),Worker);
+	if ((fp_ou=fopen(PartName,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),PartName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(fp_ou,"%lu\t%d\t",UserAgentLines,UserAgentStats->HasPeriod);
+	fprintf(fp_ou,"%04d%02d%02d\t",UserAgentStats->StartDate.tm_year+1900,UserAgentStats->StartDate.tm_mon+1,UserAgentStats->StartDate.tm_mday);
+	fprintf(fp_ou,"%04d%02d%02d\n",UserAgentStats->EndDate.tm_year+1900,UserAgentStats->EndDate.tm_mon+1,UserAgentStats->EndDate.tm_mday);
+	for (i=0 ; i<UserAgentStats->NPairs ; i++) {
+		Pair=UserAgentStats->Pair+i;
+		fprintf(fp_ou,"%"PRIu64"\t%s\t%s\n",(uint64_t)Pair->Records,UserAgentStats->Pool+UserAgentStats->Agent[Pair->Agent].Name,UserAgentStats->Pool+Pair->User);
+	}
 	if (fclose(fp_ou)==EOF) {
-		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),UserAgentTempLog,strerror(errno));
+		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),PartName,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
 }
 
-void UserAgent(void)
+/*!
+ * Add the user agents found by one process reading the useragent logs.
+ *
+ * \param Worker The number of the process.
+ */
+static void UserAgent_MergePart(int Worker)
 {
-	FILE *fp_in = NULL, *fp_ou = NULL, *fp_ht = NULL;
-	char buf[MAXLEN];
-	char ip[80], agent[MAXLEN], user[MAXLEN];
-	char ipbefore[MAXLEN]="";
-	char namebefore[MAXLEN]="";
-	char tagent[MAXLEN];
-	char user_old[MAXLEN]="";
-	char agent_old[MAXLEN]="";
-	char hfile[MAXLEN];
-	char idate[100], fdate[100];
-	char tmp2[MAXLEN];
-	char tmp3[MAXLEN];
-	char csort[MAXLEN];
-	int  agentot=0, agentot2=0, agentdif=0, cont=0, nagent;
-	int cstatus;
-	double perc;
+	FileObject *fp_in;
+	char PartName[MAXLEN];
+	char agent[MAXLEN], user[MAXLEN];
+	char *buf;
+	longline line;
 	struct getwordstruct gwarea;
+	unsigned long Lines;
+	int HasPeriod;
+	int Date;
+	long long int Records;
+	struct tm logtime;
 
-	if (!UserAgentTempLog[0] || useragent_count==0) return;
-
-	format_path(__FILE__, __LINE__, tmp2, sizeof(tmp2), "%s/squagent.int_log", tmp);
-	if (debug) {
-		debuga(__FILE__,__LINE__,_("Sorting file \"%s\"\n"),tmp2);
+	UserAgent_PartName(PartName,sizeof(PartName),Worker);
+	if ((fp_in=FileObject_Open(PartName))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),PartName,FileObject_GetLastOpenError());
+		exit(EXIT_FAILURE);
 	}
-
-	if (snprintf(csort,sizeof(csort),"sort -n -t \"\t\" -k 3,3 -k 2,2 -k 1,1 -o \"%s\" \"%s\"",tmp2,UserAgentTempLog)>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),tmp2,UserAgentTempLog);
+	if ((line=longline_create())==NULL) {
+		debuga(__FILE__,__LINE__,_("Not enough memory to read file \"%s\"\n"),PartName);
 		exit(EXIT_FAILURE);
 	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
+	if ((buf=longline_read(fp_in,line))==NULL) {
+		debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),PartName);
 		exit(EXIT_FAILURE);
 	}
-	if ((fp_in=fopen(tmp2,"r"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),tmp2,strerror(errno));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
+	getword_start(&gwarea,buf);
+	if (getword_atolu(&Lines,&gwarea,'\t')<0 || getword_atoi(&HasPeriod,&gwarea,'\t')<0) {
+		debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),PartName);
 		exit(EXIT_FAILURE);
 	}
+	UserAgentLines+=Lines;
+	if (HasPeriod) {
+		memset(&logtime,0,sizeof(logtime));
+		if (getword_atoi(&Date,&gwarea,'\t')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),PartName);
+			exit(EXIT_FAILURE);
+		}
+		computedate(Date/10000,(Date/100)%100,Date%100,&logtime);
+		UserAgent_AddPeriod(&logtime);
+		if (getword_atoi(&Date,&gwarea,'\t')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid date in file \"%s\"\n"),PartName);
+			exit(EXIT_FAILURE);
+		}
+		computedate(Date/10000,(Date/100)%100,Date%100,&logtime);
+		UserAgent_AddPeriod(&logtime);
+	}
 
-	if (!KeepTempLog && unlink(UserAgentTempLog)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),UserAgentTempLog,strerror(errno));
-		exit(EXIT_FAILURE);
+	while ((buf=longline_read(fp_in,line))!=NULL) {
+		getword_start(&gwarea,buf);
+		if (getword_atoll(&Records,&gwarea,'\t')<0 || getword(agent,sizeof(agent),&gwarea,'\t')<0 ||
+		    getword(user,sizeof(user),&gwarea,'\n')<0) {
+			debuga(__FILE__,__LINE__,_("Invalid record in file \"%s\"\n"),PartName);
+			exit(EXIT_FAILURE);
+		}
+		UserAgent_AddPair(user,agent,Records);
 	}
 
-	format_path(__FILE__, __LINE__, hfile, sizeof(hfile), "%s/useragent.html", outdirname);
-	if ((fp_ht=fopen(hfile,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),hfile,strerror(errno));
+	if (FileObject_Close(fp_in)) {
+		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),PartName,FileObject_GetLastCloseError());
 		exit(EXIT_FAILURE);
 	}
+	longline_destroy(&line);
+	if (!KeepTempLog && unlink(PartName)) {
+		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),PartName,strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
 
-	if (debug)
-		debuga(__FILE__,__LINE__,_("Making Useragent report\n"));
-
-	write_html_header(fp_ht,(IndexTree == INDEX_TREE_DATE) ? 3 : 1,_("Squid Useragent's Report"),HTML_JS_NONE);
-	fprintf(fp_ht,"<tr><th class=\"header_c\">%s</th></tr>\n",_("Squid Useragent's Report"));
-	strftime(idate,sizeof(idate),"%x",&UserAgentStartDate);
-	strftime(fdate,sizeof(fdate),"%x",&UserAgentEndDate);
-	fprintf(fp_ht,"<tr><td class=\"header_c\">%s: %s - %s</td></tr>\n",_("Period"),idate,fdate);
-	close_html_header(fp_ht);
+/*!
+ * Read the user provided useragent files and store the user agents to
+ * report.
+ *
+ * Several files are read at the same time by separate processes if
+ * report_jobs allows it.
+ */
+void UserAgent_Readlog(const struct ReadLogDataStruct *ReadFilter)
+{
+	FileListIterator FIter;
+	const char *FileName;
+	int NFiles;
+	int i;
 
-	fputs("<br><br>\n",fp_ht);
+	UserAgent_Open();
+	if (!UserAgentStats) return;
 
-	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"0\">\n",fp_ht);
-	fputs("<tr><td>&nbsp;</td><td>&nbsp;</td></tr>",fp_ht);
+	UserAgentFilter=ReadFilter;
+	getperiod_torange(&period,&UserAgentFrom,&UserAgentUntil);
+	UserAgentLines=0;
 
-	fprintf(fp_ht,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("AGENT"));
+	FIter=FileListIter_Open(UserAgentLog);
+	for (NFiles=0 ; FileListIter_Next(FIter)!=NULL ; NFiles++);
+	FileListIter_Close(FIter);
 
-	while (fgets(buf,sizeof(buf),fp_in)!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid IP address in file \"%s\"\n"),tmp2);
-			exit(EXIT_FAILURE);
+	UserAgentWorkers=ReportJobs;
+	if (UserAgentWorkers>NFiles) UserAgentWorkers=NFiles;
+	if (UserAgentWorkers>MAX_STAGES) UserAgentWorkers=MAX_STAGES;
+#ifndef HAVE_FORK
+	UserAgentWorkers=1;
+#endif
+
+	if (UserAgentWorkers<2) {
+		FIter=FileListIter_Open(UserAgentLog);
+		while ((FileName=FileListIter_Next(FIter))!=NULL)
+			UserAgent_ReadFile(FileName);
+		FileListIter_Close(FIter);
+	} else {
+		StageListObject stages;
+		char Name[40];
+
+		stages=Stage_Create();
+		for (i=0 ; i<UserAgentWorkers ; i++) {
+			snprintf(Name,sizeof(Name),"useragent%d",i);
+			Stage_AddArg(stages,Name,UserAgent_ReadWorker,i,NULL,NULL,0);
 		}
+		Stage_Run(stages,UserAgentWorkers);
+		Stage_Destroy(&stages);
+		for (i=0 ; i<UserAgentWorkers ; i++)
+			UserAgent_MergePart(i);
+	}
 
-		if (Ip2Name) {
-			if (strcmp(ip,ipbefore) != 0) {
-				strcpy(ipbefore,ip);
-				ip2name(ip,sizeof(ip));
-				strcpy(namebefore,ip);
-			} else strcpy(ip,namebefore);
-		}
+	if (debug) {
+		debuga(__FILE__,__LINE__,_("   Records read: %ld\n"),UserAgentLines);
+	}
+}
 
-		if (getword(agent,sizeof(agent),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid useragent in file \"%s\"\n"),tmp2);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(user,sizeof(user),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid user ID in file \"%s\"\n"),tmp2);
-			exit(EXIT_FAILURE);
-		}
+/*!
+ * Sort the users of the user agents by user ID and user agent for qsort.
+ */
+static int UserAgent_ComparePair(const void *Ptr1,const void *Ptr2)
+{
+	const struct UserAgentUserStruct *Pair1=(const struct UserAgentUserStruct *)Ptr1;
+	const struct UserAgentUserStruct *Pair2=(const struct UserAgentUserStruct *)Ptr2;
+	int Cmp;
 
-		if (strcmp(user,user_old) != 0) {
-			fprintf(fp_ht,"<tr><td class=\"data2\">%s</td><td class=\"data2\">",user);
-			output_html_string(fp_ht,agent,250);
-			fputs("</td></tr>\n",fp_ht);
-			strcpy(user_old,user);
-			strcpy(agent_old,agent);
-		} else if (strcmp(agent,agent_old) != 0) {
-			fputs("<tr><td></td><td class=\"data2\">",fp_ht);
-			output_html_string(fp_ht,agent,250);
-			fputs("</td></tr>\n",fp_ht);
-			strcpy(agent_old,agent);
-		}
-	}
+	if (Pair1->User!=Pair2->User && (Cmp=strcoll(UserAgentStats->Pool+Pair1->User,UserAgentStats->Pool+Pair2->User))!=0) return(Cmp);
+	return(strcoll(UserAgentStats->Pool+UserAgentStats->Agent[Pair1->Agent].Name,UserAgentStats->Pool+UserAgentStats->Agent[Pair2->Agent].Name));
+}
 
-	fputs("</table>\n",fp_ht);
-	if (fclose(fp_in)==EOF) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),tmp2,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+/*!
+ * Sort the user agents by decreasing number of records for qsort.
+ */
+static int UserAgent_CompareAgent(const void *Ptr1,const void *Ptr2)
+{
+	const struct UserAgentItemStruct *Agent1=(const struct UserAgentItemStruct *)Ptr1;
+	const struct UserAgentItemStruct *Agent2=(const struct UserAgentItemStruct *)Ptr2;
 
-	format_path(__FILE__, __LINE__, tmp3, sizeof(tmp3), "%s/squagent2.int_log", tmp);
-	if (snprintf(csort,sizeof(csort),"sort -t \"\t\" -k 2,2 -o \"%s\" \"%s\"",tmp3,tmp2)>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),tmp2,tmp3);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if ((fp_in=fopen(tmp3,"r"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),tmp3,strerror(errno));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
+	if (Agent1->Records!=Agent2->Records) return((Agent1->Records>Agent2->Records) ? -1 : 1);
+	return(strcoll(UserAgentStats->Pool+Agent2->Name,UserAgentStats->Pool+Agent1->Name));
+}
 
-	if (!KeepTempLog && unlink(tmp2)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),tmp2,strerror(errno));
-		exit(EXIT_FAILURE);
+void UserAgent(void)
+{
+	FILE *fp_ht = NULL;
+	struct UserAgentStatsStruct *Stats=UserAgentStats;
+	const struct UserAgentUserStruct *Pair;
+	const struct UserAgentItemStruct *Agent;
+	int user_old=-1;
+	char hfile[MAXLEN];
+	char idate[100], fdate[100];
+	int i;
+	double perc;
+
+	if (!Stats || useragent_count==0) {
+		UserAgent_Free();
+		return;
 	}
 
-	if ((fp_ou=fopen(tmp2,"w"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),tmp2,strerror(errno));
+	// the hash tables are useless once the entries are sorted
+	free(Stats->AgentHash);
+	Stats->AgentHash=NULL;
+	free(Stats->UserHash);
+	Stats->UserHash=NULL;
+	free(Stats->PairHash);
+	Stats->PairHash=NULL;
+
+	// the users refer to the agents by index so they are sorted first
+	if (Stats->NPairs>1)
+		qsort(Stats->Pair,Stats->NPairs,sizeof(*Stats->Pair),UserAgent_ComparePair);
+
+	format_path(__FILE__, __LINE__, hfile, sizeof(hfile), "%s/useragent.html", outdirname);
+	if ((fp_ht=open_html_file(hfile,"w"))==NULL) {
+		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),hfile,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
 
-	agent_old[0]='\0';
-	cont=0;
+	if (debug)
+		debuga(__FILE__,__LINE__,_("Making Useragent report\n"));
 
-	while (fgets(buf,sizeof(buf),fp_in)!=NULL) {
-		getword_start(&gwarea,buf);
-		if (getword(ip,sizeof(ip),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid IP address in file \"%s\"\n"),tmp3);
-			exit(EXIT_FAILURE);
-		}
-		if (getword(agent,sizeof(agent),&gwarea,'\t')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid useragent in file \"%s\"\n"),tmp3);
-			exit(EXIT_FAILURE);
-		}
+	write_html_header(fp_ht,(IndexTree == INDEX_TREE_DATE) ? 3 : 1,_("Squid Useragent's Report"),HTML_JS_NONE);
+	fprintf(fp_ht,"<tr><th class=\"header_c\">%s</th></tr>\n",_("Squid Useragent's Report"));
+	strftime(idate,sizeof(idate),"%x",&Stats->StartDate);
+	strftime(fdate,sizeof(fdate),"%x",&Stats->EndDate);
+	fprintf(fp_ht,"<tr><td class=\"header_c\">%s: %s - %s</td></tr>\n",_("Period"),idate,fdate);
+	close_html_header(fp_ht);
 
-		if (!cont) {
-			cont++;
-			strcpy(agent_old,agent);
-		}
+	fputs("<br><br>\n",fp_ht);
 
-		if (strcmp(agent,agent_old) != 0) {
-			agentdif++;
-			fprintf(fp_ou,"%06d %s\n",agentot,agent_old);
-			strcpy(agent_old,agent);
-			agentot2+=agentot;
-			agentot=0;
-		}
-		agentot++;
-	}
-	agentdif++;
-	fprintf(fp_ou,"%06d %s\n",agentot,agent);
-	agentot2+=agentot;
+	fputs("<div class=\"report\"><table cellpadding=\"0\" cellspacing=\"0\">\n",fp_ht);
+	fputs("<tr><td>&nbsp;</td><td>&nbsp;</td></tr>",fp_ht);
 
-	if (fclose(fp_ou)==EOF) {
-		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),tmp2,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	if (fclose(fp_in)==EOF) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),tmp3,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	fprintf(fp_ht,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th></tr>\n",_("USERID"),_("AGENT"));
 
-	if (!KeepTempLog && unlink(tmp3)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),tmp3,strerror(errno));
-		exit(EXIT_FAILURE);
+	for (i=0 ; i<Stats->NPairs ; i++) {
+		Pair=Stats->Pair+i;
+		if (Pair->User!=user_old) {
+			fprintf(fp_ht,"<tr><td class=\"data2\">%s</td><td class=\"data2\">",Stats->Pool+Pair->User);
+			user_old=Pair->User;
+		} else {
+			fputs("<tr><td></td><td class=\"data2\">",fp_ht);
+		}
+		output_html_string(fp_ht,Stats->Pool+Stats->Agent[Pair->Agent].Name,250);
+		fputs("</td></tr>\n",fp_ht);
 	}
 
-	if (snprintf(csort,sizeof(csort),"sort -n -r -k 1,1 -o \"%s\" \"%s\"",tmp3,tmp2)>=sizeof(csort)) {
-		debuga(__FILE__,__LINE__,_("Sort command too long when sorting file \"%s\" to \"%s\"\n"),tmp2,tmp3);
-		exit(EXIT_FAILURE);
-	}
-	cstatus=system(csort);
-	if (!WIFEXITED(cstatus) || WEXITSTATUS(cstatus)) {
-		debuga(__FILE__,__LINE__,_("sort command return status %d\n"),WEXITSTATUS(cstatus));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
-	if ((fp_in=fopen(tmp3,"r"))==NULL) {
-		debuga(__FILE__,__LINE__,_("Cannot open file \"%s\": %s\n"),tmp3,strerror(errno));
-		debuga(__FILE__,__LINE__,_("sort command: %s\n"),csort);
-		exit(EXIT_FAILURE);
-	}
+	fputs("</table>\n",fp_ht);
 
-	if (!KeepTempLog && unlink(tmp2)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),tmp2,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	if (Stats->NAgents>1)
+		qsort(Stats->Agent,Stats->NAgents,sizeof(*Stats->Agent),UserAgent_CompareAgent);
 
 	fputs("<br><br>\n",fp_ht);
 
 	fputs("<table cellpadding=\"0\" cellspacing=\"0\">\n",fp_ht);
-	fprintf(fp_ht,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_c\">%%</th></tr>\n",_("AGENT"),_("TOTAL"));
+	fprintf(fp_ht,"<tr><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_l\">%s</th><th class=\"header_c\">%%</th></tr>\n",_("AGENT"),_("USERS"),_("TOTAL"));
 
-	perc=0.;
-	while(fgets(buf,sizeof(buf),fp_in)!=NULL) {
-		fixendofline(buf);
-		getword_start(&gwarea,buf);
-		if (getword(tagent,sizeof(tagent),&gwarea,' ')<0) {
-			debuga(__FILE__,__LINE__,_("Invalid useragent in file \"%s\"\n"),tmp3);
-			exit(EXIT_FAILURE);
-		}
-		nagent=atoi(tagent);
-		perc=(agentot2>0) ? nagent * 100. / agentot2 : 0.;
+	for (i=0 ; i<Stats->NAgents ; i++) {
+		Agent=Stats->Agent+i;
+		perc=(useragent_count>0) ? Agent->Records * 100. / useragent_count : 0.;
 
 		fputs("<tr><td class=\"data2\">",fp_ht);
-		output_html_string(fp_ht,gwarea.current,250);
-		fprintf(fp_ht,"</td><td class=\"data\">%d</td><td class=\"data\">%3.2lf</td></tr>\n",nagent,perc);
-	}
-	if (fclose(fp_in)==EOF) {
-		debuga(__FILE__,__LINE__,_("Read error in \"%s\": %s\n"),tmp3,strerror(errno));
-		exit(EXIT_FAILURE);
+		output_html_string(fp_ht,Stats->Pool+Agent->Name,250);
+		fprintf(fp_ht,"</td><td class=\"data\">%d</td><td class=\"data\">%"PRIu64"</td><td class=\"data\">%3.2lf</td></tr>\n",Agent->Users,(uint64_t)Agent->Records,perc);
 	}
 
 	fputs("</table></div>\n",fp_ht);
@@ -445,10 +823,6 @@ void UserAgent(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!KeepTempLog && unlink(tmp3)) {
-		debuga(__FILE__,__LINE__,_("Cannot delete \"%s\": %s\n"),tmp3,strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-
+	UserAgent_Free();
 	return;
 }
@@ -897,6 +897,65 @@ void computedate(int year,int month,int day,struct tm *t)
 	t->tm_mday=day;
 }
 
+/*!
+ * Store the day containing a time.
+ *
+ * \param Cache The day to update.
+ * \param tt The time.
+ */
+static void localtime_cache_day(struct LocalTimeCacheStruct *Cache,time_t tt)
+{
+	struct tm *t;
+	struct tm Next;
+
+	t=localtime(&tt);
+	Cache->Day=*t;
+	Cache->Date=(t->tm_year+1900)*10000+(t->tm_mon+1)*100+t->tm_mday;
+	Cache->Day.tm_hour=0;
+	Cache->Day.tm_min=0;
+	Cache->Day.tm_sec=0;
+	Next=Cache->Day;
+	Next.tm_isdst=-1;
+	Cache->Start=mktime(&Next);
+	Next=Cache->Day;
+	Next.tm_mday++;
+	Next.tm_isdst=-1;
+	Cache->End=mktime(&Next);
+	Cache->Linear=(Cache->Start!=(time_t)-1 && Cache->End-Cache->Start==24*60*60 && tt>=Cache->Start && tt<Cache->End);
+	if (!Cache->Linear) {
+		if (Cache->Start==(time_t)-1 || tt<Cache->Start) Cache->Start=tt;
+		if (Cache->End==(time_t)-1 || tt>=Cache->End) Cache->End=tt+1;
+	}
+}
+
+/*!
+ * Convert a time to the local time without calling localtime() for
+ * every time of the same day.
+ *
+ * The time of the day is computed from the seconds elapsed since midnight unless
+ * the day is not 24 hours long because of a daylight saving time change.
+ *
+ * \param Cache The day of the previous conversion.
+ * \param tt The time to convert.
+ * \param t The structure to fill with the local time.
+ */
+void localtime_cached(struct LocalTimeCacheStruct *Cache,time_t tt,struct tm *t)
+{
+	long int Seconds;
+
+	if (tt<Cache->Start || tt>=Cache->End)
+		localtime_cache_day(Cache,tt);
+	if (!Cache->Linear) {
+		*t=*localtime(&tt);
+		return;
+	}
+	Seconds=(long int)(tt-Cache->Start);
+	*t=Cache->Day;
+	t->tm_hour=Seconds/3600;
+	t->tm_min=(Seconds/60)%60;
+	t->tm_sec=Seconds%60;
+}
+
 
 int obtuser(const char *dirname, const char *name)
 {
@@ -1498,15 +1557,20 @@ int vrfydir(const struct periodstruct *per1, const char *addr, const char *site,
 			num++;
 		}
 		if (num>1) {
+			struct stat dirstat;
+
 			if (debug)
 				debuga(__FILE__,__LINE__,_("File \"%s\" already exists, moved to \"%s\"\n"),outdirname,wdir);
+			if (stat(outdirname,&dirstat)==-1) dirstat.st_mtime=time(NULL);
 			rename(outdirname,wdir);
+			lastlog_register(wdir,dirstat.st_mtime);
 		}
 	} else {
 		if (access(outdirname,R_OK) == 0) {
 			unlinkdir(outdirname,1);
 		}
 	}
+	if (DaemonMode) daemon_replace_report(outdirname);
 	my_mkdir(outdirname);
 
 	// create sarg-date to keep track of the report creation date
@@ -1533,6 +1597,7 @@ int vrfydir(const struct periodstruct *per1, const char *addr, const char *site,
 		debuga(__FILE__,__LINE__,_("Write error in \"%s\": %s\n"),wdir,strerror(errno));
 		exit(EXIT_FAILURE);
 	}
+	lastlog_register(outdirname,curtime);
 
 	copy_images();
 	return(0);
@@ -2202,6 +2267,43 @@ void output_html_url(FILE *fp_ou,const char *url)
 	}
 }
 
+/*!
+  Write a string inside a javascript string literal. The enclosing quotes are
+  not written. The characters that could close the string or the script block
+  are escaped.
+
+  \param fp_ou The handle of the output file.
+  \param str The string to write.
+ */
+void output_js_string(FILE *fp_ou,const char *str)
+{
+	while (*str) {
+		switch (*str) {
+			case '\\':
+				fputs("\\\\",fp_ou);
+				break;
+			case '"':
+				fputs("\\\"",fp_ou);
+				break;
+			case '\'':
+				fputs("\\'",fp_ou);
+				break;
+			case '<':
+				fputs("\\u003c",fp_ou);
+				break;
+			case '>':
+				fputs("\\u003e",fp_ou);
+				break;
+			default:
+				if ((unsigned char)*str<' ')
+					fprintf(fp_ou,"\\u%04x",(unsigned char)*str);
+				else
+					fputc(*str,fp_ou);
+		}
+		str++;
+	}
+}
+
 /*!
   Write a host name inside an A tag of a HTML file. If the host name starts
   with a star, it is assumed to be an alias that cannot be put inside a link